@@ -0,0 +1,80 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/affine_transform.hpp"
+
+namespace sv {
+
+AffineTransform::AffineTransform() :
+  m{ 1, 0, 0, 0,
+     0, 1, 0, 0,
+     0, 0, 1, 0 } {}
+
+AffineTransform AffineTransform::FromTrs(const QVector3D& translation,
+    const QQuaternion& rotation, const QVector3D& scale) {
+  // Rotation matrix of the quaternion, with the same arithmetic as
+  // QMatrix4x4::rotate().
+  const float x2 = rotation.x() + rotation.x();
+  const float y2 = rotation.y() + rotation.y();
+  const float z2 = rotation.z() + rotation.z();
+  const float xw = x2 * rotation.scalar();
+  const float yw = y2 * rotation.scalar();
+  const float zw = z2 * rotation.scalar();
+  const float xx = x2 * rotation.x();
+  const float xy = x2 * rotation.y();
+  const float xz = x2 * rotation.z();
+  const float yy = y2 * rotation.y();
+  const float yz = y2 * rotation.z();
+  const float zz = z2 * rotation.z();
+
+  // Each column of the rotation is multiplied by the scale along that axis.
+  const float sx = scale.x();
+  const float sy = scale.y();
+  const float sz = scale.z();
+  AffineTransform result;
+  float* r = result.m;
+  r[0] = (1.0f - (yy + zz)) * sx;
+  r[1] = (xy - zw) * sy;
+  r[2] = (xz + yw) * sz;
+  r[3] = translation.x();
+  r[4] = (xy + zw) * sx;
+  r[5] = (1.0f - (xx + zz)) * sy;
+  r[6] = (yz - xw) * sz;
+  r[7] = translation.y();
+  r[8] = (xz - yw) * sx;
+  r[9] = (yz + xw) * sy;
+  r[10] = (1.0f - (xx + yy)) * sz;
+  r[11] = translation.z();
+  return result;
+}
+
+void AffineTransform::Multiply(const QMatrix4x4& lhs,
+    const AffineTransform& rhs, QMatrix4x4* result) {
+  // QMatrix4x4 stores its values in column-major order.
+  const float* a = lhs.constData();
+  const float* b = rhs.m;
+  float* r = result->data();
+  for (int row = 0; row < 3; ++row) {
+    const float a0 = a[row];
+    const float a1 = a[4 + row];
+    const float a2 = a[8 + row];
+    for (int col = 0; col < 4; ++col) {
+      r[col * 4 + row] = a0 * b[col] + a1 * b[4 + col] + a2 * b[8 + col];
+    }
+    r[12 + row] += a[12 + row];
+  }
+  r[3] = 0;
+  r[7] = 0;
+  r[11] = 0;
+  r[15] = 1;
+}
+
+void AffineTransform::ToMatrix4x4(QMatrix4x4* matrix) const {
+  const float values[16] = {
+    m[0], m[1], m[2], m[3],
+    m[4], m[5], m[6], m[7],
+    m[8], m[9], m[10], m[11],
+    0, 0, 0, 1 };
+  *matrix = QMatrix4x4(values);
+}
+
+}  // namespace sv
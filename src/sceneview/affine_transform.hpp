@@ -0,0 +1,55 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_AFFINE_TRANSFORM_HPP__
+#define SCENEVIEW_AFFINE_TRANSFORM_HPP__
+
+#include <QMatrix4x4>
+#include <QQuaternion>
+#include <QVector3D>
+
+namespace sv {
+
+/**
+ * Affine transform, stored as the top three rows of a 4x4 matrix in
+ * row-major order. The bottom row is implicitly (0, 0, 0, 1).
+ *
+ * Used by SceneNode to compute world transforms. Composing a transform from
+ * a translation, rotation, and scale takes no matrix multiplies, and
+ * applying it to an affine QMatrix4x4 takes 36 multiplies instead of the 64
+ * of a QMatrix4x4 product. The loops work on plain float arrays, so that the
+ * compiler can vectorize them.
+ *
+ * Internal class, not part of the public API.
+ */
+struct AffineTransform {
+  float m[12];
+
+  /**
+   * Constructs an identity transform.
+   */
+  AffineTransform();
+
+  /**
+   * Returns Translation * Rotation * Scale, the same transform as
+   * QMatrix4x4::translate(), rotate(), and scale() applied to an identity
+   * matrix. Like QMatrix4x4::rotate(), the rotation is not normalized.
+   */
+  static AffineTransform FromTrs(const QVector3D& translation,
+      const QQuaternion& rotation, const QVector3D& scale);
+
+  /**
+   * Computes @p lhs * @p rhs into @p result, which may not alias @p lhs.
+   * The bottom row of @p lhs must be (0, 0, 0, 1).
+   */
+  static void Multiply(const QMatrix4x4& lhs, const AffineTransform& rhs,
+      QMatrix4x4* result);
+
+  /**
+   * Writes the transform into @p matrix.
+   */
+  void ToMatrix4x4(QMatrix4x4* matrix) const;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_AFFINE_TRANSFORM_HPP__
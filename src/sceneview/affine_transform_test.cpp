@@ -0,0 +1,69 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <QMatrix4x4>
+#include <QQuaternion>
+#include <QVector3D>
+
+#include "sceneview/affine_transform.hpp"
+
+using sv::AffineTransform;
+
+static void ExpectNear(const QMatrix4x4& expected,
+    const QMatrix4x4& actual) {
+  for (int row = 0; row < 4; ++row) {
+    for (int col = 0; col < 4; ++col) {
+      EXPECT_NEAR(expected(row, col), actual(row, col), 1e-4)
+          << "row " << row << " col " << col;
+    }
+  }
+}
+
+static void ExpectNear(const QMatrix4x4& expected,
+    const AffineTransform& actual) {
+  QMatrix4x4 matrix;
+  actual.ToMatrix4x4(&matrix);
+  ExpectNear(expected, matrix);
+}
+
+static QMatrix4x4 TrsMatrix(const QVector3D& translation,
+    const QQuaternion& rotation, const QVector3D& scale) {
+  QMatrix4x4 matrix;
+  matrix.translate(translation);
+  matrix.rotate(rotation);
+  matrix.scale(scale);
+  return matrix;
+}
+
+TEST(AffineTransform, Identity) {
+  ExpectNear(QMatrix4x4(), AffineTransform());
+  ExpectNear(QMatrix4x4(), AffineTransform::FromTrs(QVector3D(),
+        QQuaternion(), QVector3D(1, 1, 1)));
+}
+
+TEST(AffineTransform, FromTrs) {
+  const QVector3D translation(1, -2, 3.5);
+  const QQuaternion rotation =
+      QQuaternion::fromAxisAndAngle(QVector3D(1, 2, -1).normalized(), 37);
+  const QVector3D scale(2, 0.5, -1.5);
+  ExpectNear(TrsMatrix(translation, rotation, scale),
+      AffineTransform::FromTrs(translation, rotation, scale));
+}
+
+TEST(AffineTransform, Multiply) {
+  const QVector3D translation1(4, 5, -6);
+  const QQuaternion rotation1 =
+      QQuaternion::fromAxisAndAngle(QVector3D(0, 0, 1), 90);
+  const QVector3D scale1(1, 2, 3);
+  const QVector3D translation2(-1, 0.25, 2);
+  const QQuaternion rotation2 =
+      QQuaternion::fromAxisAndAngle(QVector3D(1, 1, 0).normalized(), -20);
+  const QVector3D scale2(0.5, 0.5, 4);
+
+  const QMatrix4x4 lhs = TrsMatrix(translation1, rotation1, scale1);
+  QMatrix4x4 product;
+  AffineTransform::Multiply(lhs,
+      AffineTransform::FromTrs(translation2, rotation2, scale2), &product);
+  ExpectNear(lhs * TrsMatrix(translation2, rotation2, scale2), product);
+}
@@ -4,12 +4,21 @@
 
 #include "sceneview/importer_assimp.hpp"
 #include "sceneview/importer_rwx.hpp"
+#include "sceneview/tracing.hpp"
 
 namespace sv {
 
 Scene::Ptr AssetImporter::ImportFile(ResourceManager::Ptr resources,
     const QString& fname, const QString& resource_name) {
-  Scene::Ptr assimp_scene = ImportAssimpFile(resources, fname, resource_name);
+  return ImportFile(resources, fname, LodOptions(), resource_name);
+}
+
+Scene::Ptr AssetImporter::ImportFile(ResourceManager::Ptr resources,
+    const QString& fname, const LodOptions& lod_options,
+    const QString& resource_name) {
+  SV_TRACE_SCOPE_DETAIL("import", "AssetImporter::ImportFile", fname);
+  Scene::Ptr assimp_scene =
+      ImportAssimpFile(resources, fname, resource_name, lod_options);
   if (assimp_scene) {
     return assimp_scene;
   }
@@ -18,6 +18,30 @@ namespace sv {
  */
 class AssetImporter {
   public:
+    /**
+     * Settings for generating levels of detail of imported meshes.
+     */
+    struct LodOptions {
+      /**
+       * Number of simplified levels to generate for each mesh, in addition
+       * to the full detail mesh. If zero, then plain draw nodes are created.
+       */
+      int num_levels = 0;
+
+      /**
+       * Number of triangles of each level, relative to the previous level.
+       */
+      double reduction = 0.5;
+
+      /**
+       * Screen size below which the full detail mesh is replaced by the
+       * first simplified level. Each further level switches at half the
+       * screen size of the previous one, and the least detailed level is
+       * always drawn. See LodDrawNode.
+       */
+      double screen_size = 0.5;
+    };
+
     /**
      * Imports assets from a file.
      *
@@ -37,6 +61,18 @@ class AssetImporter {
     static Scene::Ptr ImportFile(ResourceManager::Ptr resources,
         const QString& fname,
         const QString& resource_name = ResourceManager::kAutoName);
+
+    /**
+     * Imports assets from a file, and generates levels of detail for each
+     * mesh with MeshSimplifier.
+     *
+     * Each mesh is drawn by a LodDrawNode. Levels of detail are only
+     * generated for file formats supported by Assimp.
+     */
+    static Scene::Ptr ImportFile(ResourceManager::Ptr resources,
+        const QString& fname,
+        const LodOptions& lod_options,
+        const QString& resource_name = ResourceManager::kAutoName);
 };
 
 
@@ -89,6 +89,19 @@ bool AxisAlignedBox::Intersects(const AxisAlignedBox& other) const {
            max_.z() < other.min_.z() || min_.z() > other.max_.z());
 }
 
+double AxisAlignedBox::SquaredDistance(const QVector3D& point) const {
+  if (!Valid()) {
+    return 0;
+  }
+  const double dx = std::max({ 0.0, min_.x() - static_cast<double>(point.x()),
+      static_cast<double>(point.x()) - max_.x() });
+  const double dy = std::max({ 0.0, min_.y() - static_cast<double>(point.y()),
+      static_cast<double>(point.y()) - max_.y() });
+  const double dz = std::max({ 0.0, min_.z() - static_cast<double>(point.z()),
+      static_cast<double>(point.z()) - max_.z() });
+  return dx * dx + dy * dy + dz * dz;
+}
+
 AxisAlignedBox AxisAlignedBox::Intersection(const AxisAlignedBox& other) const {
   if (!Valid() || !other.Valid()) {
     return AxisAlignedBox();
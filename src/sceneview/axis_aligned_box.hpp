@@ -77,6 +77,13 @@ class AxisAlignedBox {
      */
     bool Intersects(const AxisAlignedBox& other) const;
 
+    /**
+     * Computes the squared distance from a point to the nearest point of
+     * this box. Points inside the box have a distance of 0, and so do all
+     * points if the box is not valid.
+     */
+    double SquaredDistance(const QVector3D& point) const;
+
     /**
      * Check if this box is identical to another.
      */
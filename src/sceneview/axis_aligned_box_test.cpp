@@ -89,3 +89,15 @@ TEST(AxisAlignedBox, Intersection) {
   EXPECT_EQ(box55.Min(), box5.Min());
   EXPECT_EQ(box55.Max(), box5.Max());
 }
+
+TEST(AxisAlignedBox, SquaredDistance) {
+  const AxisAlignedBox box(QVector3D(0, 0, 0), QVector3D(2, 2, 2));
+  EXPECT_EQ(0, box.SquaredDistance(QVector3D(1, 1, 1)));
+  EXPECT_EQ(0, box.SquaredDistance(QVector3D(2, 0, 1)));
+  EXPECT_EQ(9, box.SquaredDistance(QVector3D(5, 1, 1)));
+  EXPECT_EQ(4, box.SquaredDistance(QVector3D(1, -2, 1)));
+  EXPECT_EQ(3, box.SquaredDistance(QVector3D(-1, 3, 3)));
+
+  // Nodes without a bounding box sort as if they were at the eye.
+  EXPECT_EQ(0, AxisAlignedBox().SquaredDistance(QVector3D(1, 2, 3)));
+}
@@ -7,9 +7,11 @@
 
 #include <QVector4D>
 
+#include "sceneview/object_pool.hpp"
+
 namespace sv {
 
-struct CameraNode::Priv {
+struct CameraNode::Priv : PooledObject<CameraNode::Priv> {
   static const AxisAlignedBox kBoundingBox;
 
   QVector3D look;
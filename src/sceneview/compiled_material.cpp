@@ -0,0 +1,67 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/internal_gl.hpp"
+#include "sceneview/compiled_material.hpp"
+
+#include <QOpenGLTexture>
+
+#include "sceneview/gl_state.hpp"
+
+namespace sv {
+
+void CompiledMaterial::Load(GLState* gl_state) const {
+  for (const CompiledUniform& uniform : uniforms) {
+    switch (uniform.type) {
+      case ShaderUniform::Type::kFloat:
+        switch (uniform.size) {
+          case 1:
+            glUniform1fv(uniform.location, 1, uniform.floats);
+            break;
+          case 2:
+            glUniform2fv(uniform.location, 1, uniform.floats);
+            break;
+          case 3:
+            glUniform3fv(uniform.location, 1, uniform.floats);
+            break;
+          case 4:
+            glUniform4fv(uniform.location, 1, uniform.floats);
+            break;
+          default:
+            break;
+        }
+        break;
+      case ShaderUniform::Type::kInt:
+        switch (uniform.size) {
+          case 1:
+            glUniform1iv(uniform.location, 1, uniform.ints);
+            break;
+          case 2:
+            glUniform2iv(uniform.location, 1, uniform.ints);
+            break;
+          case 3:
+            glUniform3iv(uniform.location, 1, uniform.ints);
+            break;
+          case 4:
+            glUniform4iv(uniform.location, 1, uniform.ints);
+            break;
+          default:
+            break;
+        }
+        break;
+      case ShaderUniform::Type::kMat4f:
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, uniform.floats);
+        break;
+      case ShaderUniform::Type::kInvalid:
+      default:
+        break;
+    }
+  }
+
+  for (const CompiledTexture& texture : textures) {
+    gl_state->BindTexture(texture.unit, texture.texture->target(),
+                          texture.texture->textureId());
+    glUniform1i(texture.location, texture.unit);
+  }
+}
+
+}  // namespace sv
@@ -0,0 +1,72 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_COMPILED_MATERIAL_HPP__
+#define SCENEVIEW_COMPILED_MATERIAL_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include "sceneview/shader_uniform.hpp"
+
+class QOpenGLTexture;
+
+namespace sv {
+
+class GLState;
+
+/**
+ * A material shader parameter with its uniform location resolved and its
+ * value stored inline.
+ */
+struct CompiledUniform {
+  int location;
+
+  ShaderUniform::Type type;
+
+  // Number of components: 1-4 for kFloat and kInt, 16 for kMat4f.
+  int size;
+
+  union {
+    float floats[16];
+    int ints[4];
+  };
+};
+
+/**
+ * A material texture with its sampler location and texture unit resolved.
+ */
+struct CompiledTexture {
+  int location;
+
+  int unit;
+
+  // Owned by the material.
+  QOpenGLTexture* texture;
+};
+
+/**
+ * Flattened form of a material's shader parameters and textures for its
+ * shader, so that they can be uploaded without name lookups or map walks.
+ *
+ * Built by MaterialResource when its parameters, textures, or shader change.
+ *
+ * Internal class, not part of the public API.
+ */
+struct CompiledMaterial {
+  std::vector<CompiledUniform> uniforms;
+
+  std::vector<CompiledTexture> textures;
+
+  // ShaderResource::LinkGeneration() of the shader when compiled.
+  uint64_t shader_generation = 0;
+
+  /**
+   * Uploads the uniform values and binds the textures. The shader program
+   * must be bound.
+   */
+  void Load(GLState* gl_state) const;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_COMPILED_MATERIAL_HPP__
@@ -4,22 +4,43 @@
 
 #include "sceneview/draw_context.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <typeinfo>
+#include <utility>
 #include <vector>
 
+#include <QOpenGLContext>
 #include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
 
 #include "sceneview/camera_node.hpp"
+#include "sceneview/compiled_material.hpp"
 #include "sceneview/drawable.hpp"
 #include "sceneview/draw_group.hpp"
 #include "sceneview/draw_node.hpp"
+#include "sceneview/draw_order_map.hpp"
+#include "sceneview/frustum.hpp"
+#include "sceneview/gl_state.hpp"
 #include "sceneview/group_node.hpp"
+#include "sceneview/instanced_draw_node.hpp"
 #include "sceneview/light_node.hpp"
-#include "sceneview/plane.hpp"
+#include "sceneview/lod_draw_node.hpp"
+#include "sceneview/occlusion_buffer.hpp"
+#include "sceneview/radix_sort.hpp"
+#include "sceneview/render_queue.hpp"
 #include "sceneview/renderer.hpp"
 #include "sceneview/resource_manager.hpp"
 #include "sceneview/scene_node.hpp"
+#include "sceneview/scene_updater.hpp"
 #include "sceneview/stock_resources.hpp"
+#include "sceneview/tracing.hpp"
+#include "sceneview/worker_pool.hpp"
 
 #if 0
 #define dbg(fmt, ...) printf(fmt, __VA_ARGS__)
@@ -27,118 +48,171 @@
 #define dbg(...)
 #endif
 
-using std::max;
-
 namespace sv {
 
-struct DrawNodeData {
-  DrawNode* node = nullptr;
-  float squared_distance = 0;
-  QMatrix4x4 model_mat;
-  AxisAlignedBox world_bbox;
+static void CheckGLErrors(const QString& name) {
+  GLenum err_code = glGetError();
+  const char* err_str;
+  while (err_code != GL_NO_ERROR) {
+    err_str = sv::glErrorString(err_code);
+    fprintf(stderr, "OpenGL Error (%s)\n", name.toStdString().c_str());
+    fprintf(stderr, "%s\n", err_str);
+    err_code = glGetError();
+  }
+}
+
+// If the camera moves less than this (as a fraction of the near clipping
+// distance) and the same nodes are in view, then the previous frame's draw
+// order is reused.
+static constexpr float kSortReuseDistance = 1e-3;
+
+// Layout of the 64-bit keys used to sort the nodes in a draw group, from most
+// to least significant bits:
+//
+//   63-48  SceneNode::DrawOrder(), mapped by DrawOrderMap
+//   47     0 for opaque nodes, 1 otherwise
+//
+// Opaque nodes are grouped by state to minimize state changes, then drawn
+// roughly front to back:
+//   46-36  shader id
+//   35-22  material id
+//   21-10  geometry id
+//   9-0    coarse depth
+//
+// Other nodes are drawn in depth order as specified by the draw group's
+// NodeOrdering, then grouped by state:
+//   46-23  depth
+//   22-12  shader id
+//   11-0   material id
+//
+// Depth is always zero for NodeOrdering::kNodeDrawOrder. Ids are truncated to
+// fit, which only affects how well draws are grouped.
+static uint64_t DrawOrderBits(uint32_t mapped_draw_order) {
+  return static_cast<uint64_t>(mapped_draw_order) << 48;
+}
+
+static uint64_t KeyField(uint32_t value, int num_bits, int shift) {
+  return (static_cast<uint64_t>(value) & ((1ull << num_bits) - 1)) << shift;
+}
+
+static uint32_t DepthBits(float squared_distance) {
+  // The bit patterns of non-negative floats sort in the same order as their
+  // values.
+  uint32_t bits;
+  memcpy(&bits, &squared_distance, sizeof(bits));
+  return bits;
+}
+
+// Layout of sv_camera_block. See ShaderStandardVariables::sv_camera_block.
+struct CameraBlock {
+  float proj_mat[16];
+  float view_mat[16];
+  float view_mat_inv[16];
 };
 
-/**
- * Frustum data structure used for view frustum culling.
- */
-class Frustum {
- public:
-  Frustum(CameraNode* camera);
+// Layout of one element of sv_lights_block, following the std140 rules. See
+// ShaderStandardVariables::sv_lights_block.
+struct LightBlock {
+  int32_t is_directional;
+  float pad0[3];
+  float position[3];
+  float pad1;
+  float direction[3];
+  float pad2;
+  float color[3];
+  float ambient;
+  float specular;
+  float attenuation;
+  float cone_angle;
+  float pad3;
+};
+
+static_assert(sizeof(CameraBlock) == 192, "Unexpected std140 layout");
+static_assert(sizeof(LightBlock) == 80, "Unexpected std140 layout");
 
-  bool Intersects(const AxisAlignedBox& box);
+static void CopyVector(const QVector3D& vec, float* dst) {
+  dst[0] = vec.x();
+  dst[1] = vec.y();
+  dst[2] = vec.z();
+}
 
- private:
-  std::vector<Plane> planes_;
+// Visible nodes are tested for occlusion again after this many frames, plus
+// up to kOcclusionTestJitter - 1 frames so that the tests of nodes that
+// became visible together are spread out over several frames.
+static constexpr int kOcclusionTestInterval = 8;
+static constexpr int kOcclusionTestJitter = 4;
+
+// Nodes whose bounding box is within this many near clipping distances of
+// the camera are not tested for occlusion, since the near plane could clip
+// their bounding box.
+static constexpr float kOcclusionNearMargin = 2;
+
+// Number of bounding boxes tested against the software occlusion buffer by
+// each worker thread task.
+static constexpr int kOcclusionTestBatchSize = 256;
+
+// An occlusion query issued during a previous frame whose result has not
+// been read back yet.
+struct PendingQuery {
+  GLuint query;
+
+  // The node tested, and the index of its entry in the render queue when
+  // the query was issued. The node is only used to check that the entry
+  // still belongs to the same node, since the node may have been deleted.
+  const DrawNode* node;
+  int index;
 };
 
-Frustum::Frustum(CameraNode* camera) {
-  // Compute the frustum planes
-  QSize viewport_size = camera->GetViewportSize();
-  const int x1 = viewport_size.width();
-  const int y1 = viewport_size.height();
-
-  QVector3D top_left_start;
-  QVector3D bot_left_start;
-  QVector3D top_right_start;
-  QVector3D bot_right_start;
-
-  QVector3D top_left_end = camera->Unproject(0, 0, 1);
-  QVector3D bot_left_end = camera->Unproject(0, y1, 1);
-  QVector3D top_right_end = camera->Unproject(x1, 0, 1);
-  QVector3D bot_right_end = camera->Unproject(x1, y1, 1);
-
-  if (camera->GetProjectionType() == sv::CameraNode::kOrthographic) {
-    top_left_start = camera->Unproject(0, 0, 0);
-    bot_left_start = camera->Unproject(0, y1, 0);
-    top_right_start = camera->Unproject(x1, 0, 0);
-    bot_right_start = camera->Unproject(x1, y1, 0);
-  } else {
-    const QVector3D eye = camera->WorldTransform().map(QVector3D(0, 0, 0));
-    top_left_start = eye;
-    bot_left_start = eye;
-    top_right_start = eye;
-    bot_right_start = eye;
-  }
-
-  const QVector3D top_left_dir = (top_left_end - top_left_start).normalized();
-  const QVector3D bot_left_dir = (bot_left_end - bot_left_start).normalized();
-  const QVector3D top_right_dir = (top_right_end - top_right_start).normalized();
-  const QVector3D bot_right_dir = (bot_right_end - bot_right_start).normalized();
-
-  const double near = camera->GetZNear();
-  const double far = camera->GetZFar();
-
-  const QVector3D ntl = top_left_start + near * top_left_dir;
-  const QVector3D ntr = top_right_start + near * top_right_dir;
-  const QVector3D nbl = bot_left_start + near * bot_left_dir;
-  const QVector3D nbr = bot_right_start + near * bot_right_dir;
-  const QVector3D ftl = top_left_start + far * top_left_dir;
-  const QVector3D ftr = top_right_start + far * top_right_dir;
-  const QVector3D fbl = bot_left_start + far * bot_left_dir;
-  const QVector3D fbr = bot_right_start + far * bot_right_dir;
-
-  planes_.push_back(Plane::FromThreePoints(ntr, ftl, ftr));  // top
-  planes_.push_back(Plane::FromThreePoints(nbr, fbr, fbl));  // bottom
-  planes_.push_back(Plane::FromThreePoints(ntl, nbl, fbl));  // left
-  planes_.push_back(Plane::FromThreePoints(ntr, fbr, nbr));  // right
-  planes_.push_back(Plane::FromThreePoints(ntl, ntr, nbr));  // near
-  planes_.push_back(Plane::FromThreePoints(ftl, fbr, ftr));  // far
-}
-
-bool Frustum::Intersects(const AxisAlignedBox& box) {
-  const QVector3D& bmin = box.Min();
-  const QVector3D& bmax = box.Max();
-  for (const Plane& plane : planes_) {
-    const QVector3D& normal = plane.Normal();
-    const QVector3D test_point(normal.x() > 0 ? bmax.x() : bmin.x(),
-                               normal.y() > 0 ? bmax.y() : bmin.y(),
-                               normal.z() > 0 ? bmax.z() : bmin.z());
-    if (plane.SignedDistance(test_point) < 0) {
-      return false;
-    }
+static void SetOcclusionResult(OcclusionState* state, bool visible,
+                               uint64_t frame_number, int index) {
+  state->query_pending = false;
+  state->occluded = !visible;
+  if (visible) {
+    state->next_test_frame = frame_number + kOcclusionTestInterval +
+        index % kOcclusionTestJitter;
   }
-  return true;
 }
 
-static void CheckGLErrors(const QString& name) {
-  GLenum err_code = glGetError();
-  const char* err_str;
-  while (err_code != GL_NO_ERROR) {
-    err_str = sv::glErrorString(err_code);
-    fprintf(stderr, "OpenGL Error (%s)\n", name.toStdString().c_str());
-    fprintf(stderr, "%s\n", err_str);
-    err_code = glGetError();
+// A GPU timer query of a draw group, issued during a previous frame.
+struct PendingTimer {
+  GLuint query;
+  uint64_t frame_number;
+  int group_index;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// Returns the milliseconds elapsed since a time point, and moves the time
+// point to now.
+static double Lap(Clock::time_point* start) {
+  const Clock::time_point now = Clock::now();
+  const double elapsed =
+      std::chrono::duration<double, std::milli>(now - *start).count();
+  *start = now;
+  return elapsed;
+}
+
+static int64_t NumTriangles(GLenum mode, int64_t count) {
+  switch (mode) {
+    case GL_TRIANGLES:
+      return count / 3;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+      return std::max<int64_t>(count - 2, 0);
+    default:
+      return 0;
   }
 }
 
-static double squaredDistanceToAABB(const QVector3D& point,
-                                    const AxisAlignedBox& box) {
-  const QVector3D center = (box.Max() + box.Min()) / 2;
-  const QVector3D half_sz = (box.Max() - box.Min()) / 2;
-  const QVector3D vec(max(0.0, fabs(center.x() - point.x()) - half_sz.x()),
-                      max(0.0, fabs(center.y() - point.y()) - half_sz.y()),
-                      max(0.0, fabs(center.z() - point.z()) - half_sz.z()));
-  return vec.lengthSquared();
+static GLuint TakeQuery(std::vector<GLuint>* free_queries) {
+  GLuint query = 0;
+  if (free_queries->empty()) {
+    glGenQueries(1, &query);
+  } else {
+    query = free_queries->back();
+    free_queries->pop_back();
+  }
+  return query;
 }
 
 struct DrawContext::Priv {
@@ -163,19 +237,94 @@ struct DrawContext::Priv {
 
   std::vector<DrawGroup*> draw_groups;
 
-  bool gl_two_sided;
-  bool gl_depth_test;
-  GLenum gl_depth_func;
-  bool gl_depth_write;
-  bool gl_color_write;
-  float gl_point_size;
-  float gl_line_width;
-  bool gl_blend;
-  GLenum gl_sfactor;
-  GLenum gl_dfactor;
-
-  bool stencil_enabled;
-  StencilSettings stencil;
+  // Scratch space for DrawDrawGroup(), reused across frames to avoid
+  // reallocating every frame.
+  std::vector<const RenderQueueEntry*> candidates;
+  std::vector<std::pair<GroupNode*, uint32_t>> cull_stack;
+  std::vector<uint32_t> cull_indices;
+  std::vector<uint32_t> cull_visible;
+  std::vector<float> squared_distances;
+  std::vector<int> draw_orders;
+  DrawOrderMap draw_order_map;
+  std::vector<uint64_t> sort_keys;
+  std::vector<SortItem> sort_items;
+  std::vector<SortItem> sort_scratch;
+  std::vector<GeometryResource*> batch_geometries;
+  std::vector<GLsizei> batch_counts;
+  std::vector<const void*> batch_indices;
+  std::vector<GLint> batch_base_vertices;
+  std::vector<const RenderQueueEntry*> draw_list;
+  std::vector<const RenderQueueEntry*> unoccluded_list;
+  std::vector<const RenderQueueEntry*> visible_test_list;
+  std::vector<const RenderQueueEntry*> occluded_list;
+  std::vector<GLuint> proxy_queries;
+
+  // Tracks OpenGL state to skip redundant calls.
+  GLState gl_state;
+
+  // Number of state changes issued and skipped during the last Draw().
+  int num_state_changes_issued = 0;
+  int num_state_changes_skipped = 0;
+
+  // Camera and light data, computed once per draw group and once per frame
+  // respectively.
+  QMatrix4x4 proj_mat;
+  QMatrix4x4 view_mat;
+  QMatrix4x4 view_mat_inv;
+  std::vector<LightBlock> lights;
+
+  // Optional OpenGL features, checked on the first Draw().
+  bool features_checked = false;
+  bool use_instancing = false;
+
+  // Uniform buffers holding the camera and light data, if supported.
+  bool use_uniform_blocks = false;
+  GLuint camera_ubo = 0;
+  GLuint lights_ubo = 0;
+
+  // Occlusion culling. See DrawGroup::SetOcclusionCulling().
+  bool use_occlusion_queries = false;
+  bool use_conditional_render = false;
+  uint64_t frame_number = 0;
+  QVector3D eye;
+  std::vector<GLuint> free_queries;
+  std::map<DrawGroup*, std::vector<PendingQuery>> pending_queries;
+  GeometryResource::Ptr occlusion_proxy_geometry;
+  MaterialResource::Ptr occlusion_proxy_material;
+  int num_nodes_occluded = 0;
+
+  // Brings world transforms and bounding boxes up to date before culling.
+  SceneUpdater scene_updater;
+
+  // Threads of the scene update and of software occlusion culling. Only
+  // created once one of them has enough work to use them.
+  std::unique_ptr<WorkerPool> worker_pool;
+
+  // Software occlusion culling. See
+  // DrawGroup::SetSoftwareOcclusionCulling().
+  std::unique_ptr<OcclusionBuffer> occlusion_buffer;
+  std::vector<uint8_t> software_occluded;
+  int num_nodes_software_tested = 0;
+  int num_nodes_software_occluded = 0;
+
+  // Drawn for level of detail nodes without a selected level.
+  std::vector<Drawable::Ptr> no_drawables;
+
+  // Statistics of the frame being drawn, of the draw group being drawn, and
+  // of the recent frames.
+  FrameStats stats;
+  DrawGroupStats* group_stats = nullptr;
+  FrameStatsHistory stats_history;
+
+  // NumBytesUploaded() at the end of the previous frame.
+  int64_t num_bytes_uploaded = 0;
+
+  // GPU timer queries of the draw groups, if supported.
+  bool use_timer_queries = false;
+  std::vector<GLuint> free_timer_queries;
+  // Oldest first. A vector rather than a deque, which would allocate and free
+  // blocks as queries are issued and read back every frame.
+  std::vector<PendingTimer> pending_timers;
 
   // For debugging
   DrawNode* bounding_box_node;
@@ -193,11 +342,35 @@ DrawContext::DrawContext(const ResourceManager::Ptr& resources,
 
 DrawContext::~DrawContext()
 {
+  // The buffers can only be deleted while the OpenGL context is current.
+  if (p_->use_uniform_blocks && QOpenGLContext::currentContext()) {
+    glDeleteBuffers(1, &p_->camera_ubo);
+    glDeleteBuffers(1, &p_->lights_ubo);
+  }
+  if (QOpenGLContext::currentContext()) {
+    for (const auto& item : p_->pending_queries) {
+      for (const PendingQuery& pending : item.second) {
+        p_->free_queries.push_back(pending.query);
+      }
+    }
+    if (!p_->free_queries.empty()) {
+      glDeleteQueries(p_->free_queries.size(), p_->free_queries.data());
+    }
+    for (const PendingTimer& pending : p_->pending_timers) {
+      p_->free_timer_queries.push_back(pending.query);
+    }
+    if (!p_->free_timer_queries.empty()) {
+      glDeleteQueries(p_->free_timer_queries.size(),
+          p_->free_timer_queries.data());
+    }
+  }
   delete p_;
 }
 
 void DrawContext::Draw(int viewport_width, int viewport_height,
                        std::vector<Renderer*>* prenderers) {
+  SV_TRACE_SCOPE("render", "DrawContext::Draw");
+  Clock::time_point frame_start = Clock::now();
   p_->viewport_width = viewport_width;
   p_->viewport_height = viewport_height;
   p_->cur_camera = p_->scene->GetDefaultDrawGroup()->GetCamera();
@@ -210,14 +383,46 @@ void DrawContext::Draw(int viewport_width, int viewport_height,
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+  if (!p_->features_checked) {
+    p_->features_checked = true;
+    p_->use_instancing = InstancingSupported();
+    p_->use_uniform_blocks = UniformBlocksSupported();
+    p_->use_occlusion_queries = OcclusionQueriesSupported();
+    p_->use_conditional_render = ConditionalRenderSupported();
+    p_->use_timer_queries = TimerQueriesSupported();
+    if (p_->use_uniform_blocks) {
+      glGenBuffers(1, &p_->camera_ubo);
+      glGenBuffers(1, &p_->lights_ubo);
+    }
+  }
+
   std::vector<Renderer*>& renderers = *prenderers;
 
+  // Fill in the GPU times of previous frames that are done.
+  if (p_->use_timer_queries) {
+    ReadTimerQueries();
+  }
+
+  FrameStats& stats = p_->stats;
+  stats.renderers.resize(renderers.size());
+  stats.draw_groups.clear();
+
   // Setup the fixed-function pipeline.
   PrepareFixedFunctionPipeline();
 
   // Inform the renderers that drawing is about to begin
-  for (Renderer* renderer : renderers) {
+  for (size_t renderer_ind = 0; renderer_ind < renderers.size();
+      ++renderer_ind) {
+    Renderer* renderer = renderers[renderer_ind];
+    renderer->SetDrawContext(this);
+    RendererStats& renderer_stats = stats.renderers[renderer_ind];
+    renderer_stats.name = renderer->Name();
+    renderer_stats.begin_ms = 0;
+    renderer_stats.end_ms = 0;
     if (renderer->Enabled()) {
+      SV_TRACE_SCOPE_DETAIL("render", "Renderer::RenderBegin",
+          renderer->Name());
+      Clock::time_point start = Clock::now();
       glPushAttrib(GL_ENABLE_BIT | GL_POINT_BIT | GL_POLYGON_STIPPLE_BIT |
                    GL_POLYGON_BIT | GL_LINE_BIT | GL_FOG_BIT | GL_LIGHTING_BIT);
       glMatrixMode(GL_MODELVIEW);
@@ -227,43 +432,69 @@ void DrawContext::Draw(int viewport_width, int viewport_height,
       glMatrixMode(GL_MODELVIEW);
       glPopMatrix();
       glPopAttrib();
+      renderer_stats.begin_ms = Lap(&start);
     }
   }
 
-  // Set some OpenGL state to a known configuration
-  p_->gl_two_sided = false;
-  glDisable(GL_CULL_FACE);
-  p_->gl_depth_test = true;
-  glEnable(GL_DEPTH_TEST);
-  p_->gl_depth_func = GL_LESS;
-  glDepthFunc(p_->gl_depth_func);
-  p_->gl_depth_write = true;
-  glDepthMask(GL_TRUE);
-  p_->stencil_enabled = false;
-  glDisable(GL_STENCIL_TEST);
-  p_->gl_color_write = true;
-  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-  p_->gl_point_size = 1;
-  glPointSize(p_->gl_point_size);
-  p_->gl_line_width = 1;
-  glLineWidth(p_->gl_line_width);
-  p_->gl_blend = false;
-  glDisable(GL_BLEND);
-  p_->gl_sfactor = GL_ONE;
-  p_->gl_dfactor = GL_ZERO;
-  glBlendFunc(p_->gl_sfactor, p_->gl_dfactor);
+  // The renderers and resource loading may have changed any OpenGL state, so
+  // set some OpenGL state to a known configuration.
+  GLState& gl_state = p_->gl_state;
+  gl_state.Invalidate();
+  gl_state.ResetCounters();
+  gl_state.SetCullFaceEnabled(false);
+  gl_state.SetDepthTest(true);
+  gl_state.SetDepthFunc(GL_LESS);
+  gl_state.SetDepthMask(true);
+  gl_state.SetStencilTest(false);
+  gl_state.SetColorMask(true);
+  gl_state.SetPointSize(1);
+  gl_state.SetLineWidth(1);
+  gl_state.SetBlend(false);
+  gl_state.SetBlendFunc(GL_ONE, GL_ZERO);
+
+  // Renderers may have moved lights in RenderBegin(), so gather the light
+  // parameters only now.
+  UpdateLights();
+
+  // Compute the world transforms and bounding boxes of the parts of the scene
+  // graph that changed, in parallel, so that culling only reads them.
+  Clock::time_point update_start = Clock::now();
+  p_->scene_updater.Update(p_->scene->Root(), &p_->worker_pool);
+  stats.update_ms = Lap(&update_start);
+
+  p_->frame_number++;
+  p_->num_nodes_occluded = 0;
+  p_->num_nodes_software_tested = 0;
+  p_->num_nodes_software_occluded = 0;
 
   // Draw nodes, ordered first by draw group.
   for (DrawGroup* dgroup : p_->draw_groups) {
     DrawDrawGroup(dgroup);
   }
 
+  // The depth and color write masks also apply to glClear(), so leave them
+  // enabled for the next frame.
+  gl_state.SetDepthMask(true);
+  gl_state.SetColorMask(true);
+  gl_state.SetStencilTest(false);
+  gl_state.BindVertexArray(0);
+  gl_state.BindArrayBuffer(0);
+  gl_state.BindElementArrayBuffer(0);
+
+  p_->num_state_changes_issued = gl_state.NumIssued();
+  p_->num_state_changes_skipped = gl_state.NumSkipped();
+
   // Setup the fixed-function pipeline again.
   PrepareFixedFunctionPipeline();
 
   // Notify renderers that drawing has finished
-  for (Renderer* renderer : renderers) {
+  for (size_t renderer_ind = 0; renderer_ind < renderers.size();
+      ++renderer_ind) {
+    Renderer* renderer = renderers[renderer_ind];
     if (renderer->Enabled()) {
+      SV_TRACE_SCOPE_DETAIL("render", "Renderer::RenderEnd",
+          renderer->Name());
+      Clock::time_point start = Clock::now();
       glPushAttrib(GL_ENABLE_BIT | GL_POINT_BIT | GL_POLYGON_STIPPLE_BIT |
                    GL_POLYGON_BIT | GL_LINE_BIT | GL_FOG_BIT | GL_LIGHTING_BIT);
       glMatrixMode(GL_MODELVIEW);
@@ -273,14 +504,75 @@ void DrawContext::Draw(int viewport_width, int viewport_height,
       glMatrixMode(GL_MODELVIEW);
       glPopMatrix();
       glPopAttrib();
+      stats.renderers[renderer_ind].end_ms = Lap(&start);
     }
+    renderer->SetDrawContext(nullptr);
   }
 
   p_->cur_camera = nullptr;
+
+  // Sum up the draw groups.
+  stats.frame_number = p_->frame_number;
+  stats.gpu_ms = -1;
+  stats.nodes_considered = 0;
+  stats.nodes_culled = 0;
+  stats.nodes_occluded = 0;
+  stats.nodes_drawn = 0;
+  stats.draw_calls = 0;
+  stats.triangles = 0;
+  for (const DrawGroupStats& group_stats : stats.draw_groups) {
+    stats.nodes_considered += group_stats.nodes_considered;
+    stats.nodes_culled += group_stats.nodes_culled;
+    stats.nodes_occluded += group_stats.nodes_occluded;
+    stats.nodes_drawn += group_stats.nodes_drawn;
+    stats.draw_calls += group_stats.draw_calls;
+    stats.triangles += group_stats.triangles;
+  }
+  stats.state_changes = p_->num_state_changes_issued;
+  stats.state_changes_skipped = p_->num_state_changes_skipped;
+  const int64_t num_bytes_uploaded = NumBytesUploaded();
+  stats.bytes_uploaded = num_bytes_uploaded - p_->num_bytes_uploaded;
+  p_->num_bytes_uploaded = num_bytes_uploaded;
+  stats.cpu_ms = Lap(&frame_start);
+  p_->stats_history.Add(stats);
 }
 
 void DrawContext::SetClearColor(const QColor& color) { p_->clear_color = color; }
 
+int DrawContext::ViewportWidth() const { return p_->viewport_width; }
+
+int DrawContext::ViewportHeight() const { return p_->viewport_height; }
+
+int DrawContext::NumStateChangesIssued() const {
+  return p_->num_state_changes_issued;
+}
+
+int DrawContext::NumStateChangesSkipped() const {
+  return p_->num_state_changes_skipped;
+}
+
+int DrawContext::NumNodesOccluded() const {
+  return p_->num_nodes_occluded;
+}
+
+int DrawContext::NumNodesSoftwareTested() const {
+  return p_->num_nodes_software_tested;
+}
+
+int DrawContext::NumNodesSoftwareOccluded() const {
+  return p_->num_nodes_software_occluded;
+}
+
+const FrameStats& DrawContext::Stats() const {
+  // The history copy receives the GPU times as they become available.
+  const FrameStatsHistory& history = p_->stats_history;
+  return history.Size() ? history.At(history.Size() - 1) : p_->stats;
+}
+
+const FrameStatsHistory& DrawContext::StatsHistory() const {
+  return p_->stats_history;
+}
+
 void DrawContext::SetDrawGroups(const std::vector<DrawGroup*>& groups) {
   p_->draw_groups = groups;
   std::sort(p_->draw_groups.begin(), p_->draw_groups.end(),
@@ -289,6 +581,61 @@ void DrawContext::SetDrawGroups(const std::vector<DrawGroup*>& groups) {
             });
 }
 
+void DrawContext::UpdateLights() {
+  const std::vector<LightNode*>& lights = p_->scene->Lights();
+  int num_lights = lights.size();
+  if (num_lights > kShaderMaxLights) {
+    printf("Too many lights. Max: %d\n", kShaderMaxLights);
+    num_lights = kShaderMaxLights;
+  }
+
+  // Unused lights are left zeroed out, and so contribute nothing.
+  p_->lights.assign(kShaderMaxLights, LightBlock());
+  for (int light_ind = 0; light_ind < num_lights; ++light_ind) {
+    const LightNode* light_node = lights[light_ind];
+    LightBlock& light = p_->lights[light_ind];
+    light.is_directional =
+        light_node->GetLightType() == LightType::kDirectional;
+    CopyVector(light_node->Translation(), light.position);
+    CopyVector(light_node->Direction(), light.direction);
+    CopyVector(light_node->Color(), light.color);
+    light.ambient = light_node->Ambient();
+    light.specular = light_node->Specular();
+    light.attenuation = light_node->Attenuation();
+    light.cone_angle = light_node->ConeAngle() * M_PI / 180;
+  }
+
+  if (p_->use_uniform_blocks) {
+    glBindBuffer(GL_UNIFORM_BUFFER, p_->lights_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, p_->lights.size() * sizeof(LightBlock),
+                 p_->lights.data(), GL_STREAM_DRAW);
+    CountBytesUploaded(p_->lights.size() * sizeof(LightBlock));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kShaderLightsBlockBinding,
+                     p_->lights_ubo);
+  }
+}
+
+void DrawContext::UpdateCamera() {
+  p_->proj_mat = p_->cur_camera->GetProjectionMatrix();
+  p_->view_mat = p_->cur_camera->GetViewMatrix();
+  p_->view_mat_inv = p_->view_mat.inverted();
+
+  if (p_->use_uniform_blocks) {
+    CameraBlock camera;
+    memcpy(camera.proj_mat, p_->proj_mat.constData(), sizeof(camera.proj_mat));
+    memcpy(camera.view_mat, p_->view_mat.constData(), sizeof(camera.view_mat));
+    memcpy(camera.view_mat_inv, p_->view_mat_inv.constData(),
+           sizeof(camera.view_mat_inv));
+    glBindBuffer(GL_UNIFORM_BUFFER, p_->camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(camera), &camera, GL_STREAM_DRAW);
+    CountBytesUploaded(sizeof(camera));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kShaderCameraBlockBinding,
+                     p_->camera_ubo);
+  }
+}
+
 void DrawContext::PrepareFixedFunctionPipeline() {
   p_->cur_camera = p_->scene->GetDefaultDrawGroup()->GetCamera();
 
@@ -306,8 +653,9 @@ void DrawContext::PrepareFixedFunctionPipeline() {
   // Setup lights
   const GLenum gl_lights[] = {GL_LIGHT0, GL_LIGHT1, GL_LIGHT2, GL_LIGHT3,
                               GL_LIGHT4, GL_LIGHT5, GL_LIGHT6, GL_LIGHT7};
-  std::vector<LightNode*> lights = p_->scene->Lights();
-  for (int light_ind = 0; light_ind < 8; ++light_ind) {
+  const std::vector<LightNode*>& lights = p_->scene->Lights();
+  const int num_lights = std::min(static_cast<int>(lights.size()), 8);
+  for (int light_ind = 0; light_ind < num_lights; ++light_ind) {
     const GLenum gl_light = gl_lights[light_ind];
     LightNode* light = lights[light_ind];
     const LightType light_type = light->GetLightType();
@@ -353,246 +701,793 @@ void DrawContext::PrepareFixedFunctionPipeline() {
   glEnable(GL_DEPTH_TEST);
 }
 
+/**
+ * Collects the visible nodes in @p queue that intersect the view frustum by
+ * traversing the scene graph from @p root.
+ *
+ * Subtrees whose bounding box is outside the frustum are skipped entirely, and
+ * subtrees whose bounding box is fully inside a frustum plane are not tested
+ * against that plane again. The draw nodes directly under each group are
+ * tested together with Frustum::CullBoxes().
+ *
+ * Nodes without a valid bounding box are left out, since the box of their
+ * group does not include them. The caller collects them separately.
+ */
+static void CullHierarchy(GroupNode* root, RenderQueue* queue,
+    Frustum* frustum,
+    std::vector<std::pair<GroupNode*, uint32_t>>* pstack,
+    std::vector<uint32_t>* pindices,
+    std::vector<uint32_t>* pvisible,
+    std::vector<const RenderQueueEntry*>* candidates) {
+  std::vector<std::pair<GroupNode*, uint32_t>>& stack = *pstack;
+  std::vector<uint32_t>& indices = *pindices;
+  std::vector<uint32_t>& visible = *pvisible;
+  const RenderQueueEntry* entries = queue->Entries().data();
+  stack.clear();
+  if (root->Visible()) {
+    stack.emplace_back(root, Frustum::kAllPlanes);
+  }
+
+  while (!stack.empty()) {
+    GroupNode* group = stack.back().first;
+    const uint32_t group_mask = stack.back().second;
+    stack.pop_back();
+
+    indices.clear();
+    for (SceneNode* child : group->Children()) {
+      if (!child->Visible()) {
+        continue;
+      }
+
+      switch (child->NodeType()) {
+        case SceneNodeType::kGroupNode: {
+          GroupNode* child_group = static_cast<GroupNode*>(child);
+          uint32_t child_mask = group_mask;
+          const AxisAlignedBox& box = child_group->WorldBoundingBox();
+          // Groups with no valid bounding box are descended without a test.
+          if (child_mask && box.Valid() &&
+              !frustum->Intersects(box, &child_mask)) {
+            continue;
+          }
+          stack.emplace_back(child_group, child_mask);
+        } break;
+        case SceneNodeType::kDrawNode: {
+          const RenderQueueEntry* entry =
+              queue->Find(static_cast<DrawNode*>(child));
+          if (!entry || entry->unbounded) {
+            // Belongs to a different draw group, or is never culled.
+            continue;
+          }
+          indices.push_back(entry - entries);
+        } break;
+        default:
+          break;
+      }
+    }
+
+    if (indices.empty()) {
+      continue;
+    }
+    if (group_mask) {
+      visible.clear();
+      frustum->CullBoxes(queue->Boxes(), indices.data(), indices.size(),
+          group_mask, true, &visible);
+      for (uint32_t index : visible) {
+        candidates->push_back(&entries[index]);
+      }
+    } else {
+      for (uint32_t index : indices) {
+        candidates->push_back(&entries[index]);
+      }
+    }
+  }
+}
+
 void DrawContext::DrawDrawGroup(DrawGroup* dgroup) {
+  SV_TRACE_SCOPE_DETAIL("render", "DrawContext::DrawDrawGroup",
+      dgroup->Name());
+  const int group_index = p_->stats.draw_groups.size();
+  p_->stats.draw_groups.emplace_back();
+  DrawGroupStats& group_stats = p_->stats.draw_groups.back();
+  group_stats.name = dgroup->Name();
+  p_->group_stats = &group_stats;
+  Clock::time_point lap_start = Clock::now();
+  SV_TRACE_BEGIN(cull_phase, "render", "Cull");
+
+  GLuint timer_query = 0;
+  if (p_->use_timer_queries) {
+    timer_query = TakeQuery(&p_->free_timer_queries);
+    glBeginQuery(GL_TIME_ELAPSED, timer_query);
+  }
+
   p_->cur_camera = dgroup->GetCamera();
   p_->cur_camera->SetViewportSize(p_->viewport_width, p_->viewport_height);
 
-  Frustum frustum = p_->cur_camera;
+  Frustum frustum(p_->cur_camera);
+  UpdateCamera();
   const QVector3D eye = p_->cur_camera->WorldTransform().map(QVector3D(0, 0, 0));
+  p_->eye = eye;
 
-  // Figure out which nodes to draw and some data about them.
-  std::vector<DrawNodeData> to_draw;
-  const int num_draw_nodes = dgroup->DrawNodes().size();
-  to_draw.reserve(num_draw_nodes);
-  const bool do_frustum_culling = dgroup->GetFrustumCulling();
-
-  for (DrawNode* draw_node : dgroup->DrawNodes()) {
-    // If the node is not visible, then skip it.
-    bool visible = true;
-    for (SceneNode* node = draw_node; node; node = node->ParentNode()) {
-      if (!node->Visible()) {
-        visible = false;
-        break;
+  // The bounding box node is added to the default draw group, so it must be
+  // created before holding pointers into any render queue.
+  if (p_->draw_bounding_boxes) {
+    MakeBoundingBoxNode();
+  }
+
+  const bool occlusion_culling =
+      dgroup->GetOcclusionCulling() && p_->use_occlusion_queries;
+  if (occlusion_culling) {
+    MakeOcclusionProxy();
+  }
+
+  // Bring the render queue up to date with any scene graph changes since the
+  // last frame.
+  GroupNode* root = p_->scene->Root();
+  RenderQueue* queue = dgroup->Queue();
+  queue->Update(root);
+
+  // Figure out which nodes to draw.
+  std::vector<const RenderQueueEntry*>& candidates = p_->candidates;
+  candidates.clear();
+
+  if (dgroup->GetFrustumCulling()) {
+    CullHierarchy(root, queue, &frustum, &p_->cull_stack, &p_->cull_indices,
+        &p_->cull_visible, &candidates);
+
+    // Nodes that are not attached to the scene root are not reached by the
+    // hierarchical traversal, so test them individually. Attached nodes
+    // without a valid bounding box are drawn without a test, as they would
+    // be if they were tested individually.
+    if (queue->NumDetached() || queue->NumUnbounded()) {
+      const std::vector<RenderQueueEntry>& entries = queue->Entries();
+      std::vector<uint32_t>& indices = p_->cull_indices;
+      std::vector<uint32_t>& visible = p_->cull_visible;
+      indices.clear();
+      visible.clear();
+      for (size_t index = 0; index < entries.size(); ++index) {
+        const RenderQueueEntry& entry = entries[index];
+        if (!entry.visible) {
+          continue;
+        }
+        if (entry.detached) {
+          indices.push_back(index);
+        } else if (entry.unbounded) {
+          candidates.push_back(&entry);
+        }
+      }
+      frustum.CullBoxes(queue->Boxes(), indices.data(), indices.size(),
+          Frustum::kAllPlanes, true, &visible);
+      for (uint32_t index : visible) {
+        candidates.push_back(&entries[index]);
       }
     }
-    if (!visible) {
-      continue;
+  } else {
+    for (const RenderQueueEntry& entry : queue->Entries()) {
+      if (entry.visible) {
+        candidates.push_back(&entry);
+      }
     }
+  }
 
-    // For each draw node, compute:
-    //   - model matrix
-    //   - world frame axis aligned bounding box
-    //   - squared distance to camera
-    //   - view frustum intersection
-    DrawNodeData dndata;
-    dndata.node = draw_node;
+  const int num_in_view = candidates.size();
+  if (dgroup->GetSoftwareOcclusionCulling()) {
+    SoftwareOcclusionCull(&candidates);
+  }
+  const int num_unoccluded = candidates.size();
+
+  SelectLevelsOfDetail(&candidates);
+
+  group_stats.nodes_considered = queue->Entries().size();
+  group_stats.nodes_occluded = num_in_view - num_unoccluded;
+  group_stats.nodes_culled = group_stats.nodes_considered -
+      candidates.size() - group_stats.nodes_occluded;
+  group_stats.cull_ms = Lap(&lap_start);
+  SV_TRACE_END(cull_phase);
+  SV_TRACE_BEGIN(sort_phase, "render", "Sort");
+
+  // If the same nodes are in view as last frame and the camera has barely
+  // moved, then reuse last frame's depth values.
+  const NodeOrdering ordering = dgroup->GetNodeOrdering();
+  RenderQueueSortCache* cache = queue->SortCache();
+  const float reuse_distance = kSortReuseDistance * p_->cur_camera->GetZNear();
+  const bool same_view =
+      cache->valid && cache->generation == queue->Generation() &&
+      cache->node_ordering == static_cast<int>(ordering) &&
+      (eye - cache->eye).lengthSquared() < reuse_distance * reuse_distance &&
+      cache->candidates == candidates;
+
+  const int num_candidates = candidates.size();
+  std::vector<float>& squared_distances =
+      same_view ? cache->squared_distances : p_->squared_distances;
+  if (!same_view) {
+    squared_distances.resize(num_candidates);
+    for (int index = 0; index < num_candidates; ++index) {
+      squared_distances[index] =
+          candidates[index]->world_bbox.SquaredDistance(eye);
+    }
+  }
 
-    // Cache the model mat matrix and world frame bounding box
-    dndata.model_mat = draw_node->WorldTransform();
+  // Compute sort keys. See the comment above DrawOrderBits() for the layout.
+  std::vector<int>& draw_orders = p_->draw_orders;
+  draw_orders.resize(num_candidates);
+  for (int index = 0; index < num_candidates; ++index) {
+    draw_orders[index] = candidates[index]->node->DrawOrder();
+  }
+  p_->draw_order_map.Build(draw_orders);
+  std::vector<uint64_t>& keys = p_->sort_keys;
+  keys.resize(num_candidates);
+  for (int index = 0; index < num_candidates; ++index) {
+    DrawNode* node = candidates[index]->node;
+
+    bool opaque = true;
+    ShaderResource* shader = nullptr;
+    MaterialResource* material = nullptr;
+    GeometryResource* geometry = nullptr;
+    for (const Drawable::Ptr& drawable : DrawablesToDraw(node)) {
+      MaterialResource* drawable_material = drawable->Material().get();
+      if (!drawable_material->Shader()) {
+        continue;
+      }
+      opaque = opaque && drawable_material->Opaque();
+      if (!material) {
+        material = drawable_material;
+        shader = material->Shader().get();
+        geometry = drawable->Geometry().get();
+      }
+    }
+    const uint32_t shader_id = shader ? shader->SortId() : 0;
+    const uint32_t material_id = material ? material->SortId() : 0;
+    const uint32_t geometry_id = geometry ? geometry->SortId() : 0;
 
-    // Compute the world frame axis-aligned bounding box
-    dndata.world_bbox = draw_node->WorldBoundingBox();
+    uint32_t depth = 0;
+    if (ordering != NodeOrdering::kNodeDrawOrder) {
+      depth = DepthBits(squared_distances[index]);
+    }
 
-    // View frustum culling
-    if (do_frustum_culling && dndata.world_bbox.Valid() &&
-        !frustum.Intersects(dndata.world_bbox)) {
-      continue;
+    uint64_t key =
+        DrawOrderBits(p_->draw_order_map.Map(draw_orders[index]));
+    if (opaque) {
+      key |= KeyField(shader_id, 11, 36) |
+             KeyField(material_id, 14, 22) |
+             KeyField(geometry_id, 12, 10) |
+             KeyField(depth >> 21, 10, 0);
+    } else {
+      uint32_t ordered_depth = depth >> 7;
+      if (ordering == NodeOrdering::kBackToFront) {
+        ordered_depth = ~ordered_depth;
+      }
+      key |= (1ull << 47) |
+             KeyField(ordered_depth, 24, 23) |
+             KeyField(shader_id, 11, 12) |
+             KeyField(material_id, 12, 0);
+    }
+    keys[index] = key;
+  }
+
+  // Sort, unless the keys are identical to last frame.
+  if (!same_view || keys != cache->keys) {
+    std::vector<SortItem>& order = p_->sort_items;
+    order.resize(num_candidates);
+    for (int index = 0; index < num_candidates; ++index) {
+      order[index].key = keys[index];
+      order[index].index = index;
     }
+    RadixSort(&order, &p_->sort_scratch);
+
+    cache->valid = true;
+    cache->generation = queue->Generation();
+    cache->node_ordering = static_cast<int>(ordering);
+    cache->candidates.swap(candidates);
+    cache->keys.swap(keys);
+    cache->order.swap(order);
+    if (!same_view) {
+      cache->eye = eye;
+      cache->squared_distances.swap(squared_distances);
+    }
+  }
+
+  group_stats.sort_ms = Lap(&lap_start);
+  SV_TRACE_END(sort_phase);
+  SV_TRACE_BEGIN(submit_phase, "render", "Submit");
 
-    dndata.squared_distance = squaredDistanceToAABB(eye, dndata.world_bbox);
+  const std::vector<SortItem>& order = cache->order;
+  std::vector<const RenderQueueEntry*>& draw_list = p_->draw_list;
+  if (!occlusion_culling) {
+    draw_list.clear();
+    for (const SortItem& item : order) {
+      draw_list.push_back(cache->candidates[item.index]);
+    }
+    DrawEntries(draw_list);
+  } else {
+    // With occlusion culling, opaque nodes with the same draw order may be
+    // drawn in any order, so each such run of nodes is drawn in passes.
+    // Other nodes are drawn in sorted order. The opacity bit and the draw
+    // order are the top bits of the sort keys.
+    const int num_occluded = p_->num_nodes_occluded;
+    ReadOcclusionQueries(dgroup);
+    const int num_items = order.size();
+    for (int item_ind = 0; item_ind < num_items;) {
+      const uint64_t run_bits = order[item_ind].key >> 47;
+      int run_end = item_ind + 1;
+      while (run_end < num_items && (order[run_end].key >> 47) == run_bits) {
+        ++run_end;
+      }
 
-    to_draw.push_back(dndata);
+      draw_list.clear();
+      for (int ind = item_ind; ind < run_end; ++ind) {
+        draw_list.push_back(cache->candidates[order[ind].index]);
+      }
+      if (run_bits & 1) {
+        DrawEntries(draw_list);
+      } else {
+        DrawOcclusionCulled(dgroup, draw_list);
+      }
+      item_ind = run_end;
+    }
+    group_stats.nodes_occluded += p_->num_nodes_occluded - num_occluded;
   }
 
-  switch (dgroup->GetNodeOrdering()) {
-    case NodeOrdering::kBackToFront:
-      // Sort nodes to draw back to front
-      std::sort(to_draw.begin(), to_draw.end(),
-                [](const DrawNodeData& dndata_a, const DrawNodeData& dndata_b) {
-                  return dndata_a.node->DrawOrder() < dndata_b.node->DrawOrder() ||
-                  dndata_a.squared_distance > dndata_b.squared_distance;
-                });
-      break;
-    case NodeOrdering::kFrontToBack:
-      // Sort nodes to draw front to back
-      std::sort(to_draw.begin(), to_draw.end(),
-                [](const DrawNodeData& dndata_a, const DrawNodeData& dndata_b) {
-                  return dndata_a.node->DrawOrder() < dndata_b.node->DrawOrder() ||
-                  dndata_a.squared_distance < dndata_b.squared_distance;
-                });
-      break;
-    case NodeOrdering::kNone:
-    default:
-      // Sort nodes only by DrawOrder() vaules
-      std::sort(to_draw.begin(), to_draw.end(),
-                [](const DrawNodeData& dndata_a, const DrawNodeData& dndata_b) {
-                  return dndata_a.node->DrawOrder() < dndata_b.node->DrawOrder();
-                });
-      break;
+  if (timer_query) {
+    glEndQuery(GL_TIME_ELAPSED);
+    p_->pending_timers.push_back(
+        PendingTimer{timer_query, p_->frame_number, group_index});
   }
+  group_stats.submit_ms = Lap(&lap_start);
+  SV_TRACE_END(submit_phase);
+  p_->group_stats = nullptr;
+}
 
-  // Draw each draw node
-  for (DrawNodeData& dndata : to_draw) {
-    const QString name = dndata.node->Name();
-    p_->model_mat = dndata.model_mat;
-    DrawDrawNode(dndata.node);
+void DrawContext::ReadTimerQueries() {
+  SV_TRACE_SCOPE("render", "DrawContext::ReadTimerQueries");
+  // Queries complete in the order that they were issued, so stop at the
+  // first one whose result is not available yet.
+  std::vector<PendingTimer>& pending = p_->pending_timers;
+  size_t num_read = 0;
+  for (; num_read < pending.size(); ++num_read) {
+    const PendingTimer timer = pending[num_read];
+    GLuint available = 0;
+    glGetQueryObjectuiv(timer.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+    GLuint64 elapsed_ns = 0;
+    glGetQueryObjectui64v(timer.query, GL_QUERY_RESULT, &elapsed_ns);
+    p_->free_timer_queries.push_back(timer.query);
 
-    if (p_->draw_bounding_boxes) {
-      DrawBoundingBox(dndata.world_bbox);
+    FrameStats* frame = p_->stats_history.Find(timer.frame_number);
+    if (!frame || timer.group_index >= static_cast<int>(
+          frame->draw_groups.size())) {
+      continue;
     }
+    frame->draw_groups[timer.group_index].gpu_ms = elapsed_ns / 1e6;
+
+    // The frame total is known once every draw group is.
+    double gpu_ms = 0;
+    for (const DrawGroupStats& group_stats : frame->draw_groups) {
+      if (group_stats.gpu_ms < 0) {
+        gpu_ms = -1;
+        break;
+      }
+      gpu_ms += group_stats.gpu_ms;
+    }
+    frame->gpu_ms = gpu_ms;
   }
+  pending.erase(pending.begin(), pending.begin() + num_read);
 }
 
-void DrawContext::DrawDrawNode(DrawNode* draw_node) {
-  for (const Drawable::Ptr& drawable : draw_node->Drawables()) {
-    p_->geometry = drawable->Geometry();
-    p_->material = drawable->Material();
-    p_->shader = p_->material->Shader();
+void DrawContext::SoftwareOcclusionCull(
+    std::vector<const RenderQueueEntry*>* pcandidates) {
+  SV_TRACE_SCOPE("render", "DrawContext::SoftwareOcclusionCull");
+  std::vector<const RenderQueueEntry*>& candidates = *pcandidates;
+  if (!p_->occlusion_buffer) {
+    p_->occlusion_buffer.reset(new OcclusionBuffer());
+  }
+  OcclusionBuffer* buffer = p_->occlusion_buffer.get();
+
+  // Rasterize the occluders in view.
+  buffer->Begin(p_->proj_mat * p_->view_mat);
+  for (const RenderQueueEntry* entry : candidates) {
+    const std::shared_ptr<const OccluderMesh>& mesh = entry->node->Occluder();
+    if (mesh) {
+      buffer->AddOccluder(entry->model_mat, mesh.get());
+    }
+  }
+  if (!buffer->NumOccluders()) {
+    return;
+  }
+  if (!p_->worker_pool) {
+    p_->worker_pool.reset(new WorkerPool());
+  }
+  WorkerPool* pool = p_->worker_pool.get();
+  buffer->Rasterize(pool);
+
+  // Test the other nodes against the occluders, in parallel.
+  const int num_candidates = candidates.size();
+  std::vector<uint8_t>& occluded = p_->software_occluded;
+  occluded.resize(num_candidates);
+  const int num_tasks = (num_candidates + kOcclusionTestBatchSize - 1) /
+      kOcclusionTestBatchSize;
+  // The task only captures two pointers, so that std::function can store it
+  // without allocating.
+  pool->Run(num_tasks, [this, &candidates](int task) {
+    const int num_candidates = candidates.size();
+    const int begin = task * kOcclusionTestBatchSize;
+    const int end = std::min(begin + kOcclusionTestBatchSize, num_candidates);
+    for (int index = begin; index < end; ++index) {
+      const RenderQueueEntry* entry = candidates[index];
+      p_->software_occluded[index] = !entry->node->Occluder() &&
+          p_->occlusion_buffer->IsOccluded(entry->world_bbox);
+    }
+  });
 
-    // Activate the shader program
-    if (!p_->shader) {
-      continue;
+  int num_kept = 0;
+  for (int index = 0; index < num_candidates; ++index) {
+    if (!occluded[index]) {
+      candidates[num_kept++] = candidates[index];
     }
-    p_->program = p_->shader->Program();
-    if (!p_->program) {
+  }
+  candidates.resize(num_kept);
+
+  p_->num_nodes_software_tested += num_candidates - buffer->NumOccluders();
+  p_->num_nodes_software_occluded += num_candidates - num_kept;
+}
+
+void DrawContext::SelectLevelsOfDetail(
+    std::vector<const RenderQueueEntry*>* pcandidates) {
+  std::vector<const RenderQueueEntry*>& candidates = *pcandidates;
+  int num_kept = 0;
+  for (const RenderQueueEntry* entry : candidates) {
+    LodDrawNode* lod = entry->node->Lod();
+    if (lod && !lod->SelectLevel(LodDrawNode::ScreenSize(entry->world_bbox,
+            p_->proj_mat, p_->eye))) {
       continue;
     }
+    candidates[num_kept++] = entry;
+  }
+  candidates.resize(num_kept);
+}
 
-    ActivateMaterial();
+const std::vector<Drawable::Ptr>& DrawContext::DrawablesToDraw(
+    DrawNode* node) {
+  LodDrawNode* lod = node->Lod();
+  if (!lod) {
+    return node->Drawables();
+  }
+  const int level = lod->CurrentLevel();
+  return level >= 0 ? lod->LevelDrawables(level) : p_->no_drawables;
+}
 
-    if (drawable->PreDraw()) {
-      DrawGeometry();
+void DrawContext::DrawEntries(
+    const std::vector<const RenderQueueEntry*>& entries) {
+  // Returns the drawable of a draw node if it can be drawn as part of a
+  // batch, or nullptr if not. Drawable subclasses may customize PreDraw()
+  // and PostDraw(), so only plain drawables of batched geometry qualify.
+  auto batchable = [this](const RenderQueueEntry* entry)
+      -> const Drawable::Ptr* {
+    DrawNode* node = entry->node;
+    const std::vector<Drawable::Ptr>& drawables = DrawablesToDraw(node);
+    if (node->Instanced() || drawables.size() != 1) {
+      return nullptr;
+    }
+    const Drawable::Ptr& drawable = drawables.front();
+    if (typeid(*drawable) != typeid(Drawable) ||
+        !drawable->Geometry()->Arena() ||
+        !drawable->Material()->Shader() ||
+        !drawable->Material()->Shader()->Program()) {
+      return nullptr;
+    }
+    return &drawable;
+  };
+
+  // Draw each draw node. Consecutive draw nodes with the same material and
+  // world transform, and whose geometry is in the same shared buffers, are
+  // drawn with a single draw call.
+  const int num_entries = entries.size();
+  std::vector<GeometryResource*>& batch = p_->batch_geometries;
+  if (p_->group_stats) {
+    p_->group_stats->nodes_drawn += num_entries;
+  }
+  for (int entry_ind = 0; entry_ind < num_entries;) {
+    const RenderQueueEntry* entry = entries[entry_ind];
+    p_->model_mat = entry->model_mat;
+
+    int batch_end = entry_ind + 1;
+    const Drawable::Ptr* first = batchable(entry);
+    if (first) {
+      GeometryResource* first_geometry = (*first)->Geometry().get();
+      batch.clear();
+      batch.push_back(first_geometry);
+      for (; batch_end < num_entries; ++batch_end) {
+        const RenderQueueEntry* other = entries[batch_end];
+        const Drawable::Ptr* drawable = batchable(other);
+        if (!drawable ||
+            (*drawable)->Material() != (*first)->Material() ||
+            (*drawable)->Geometry()->Arena() != first_geometry->Arena() ||
+            (*drawable)->Geometry()->GLMode() != first_geometry->GLMode() ||
+            other->model_mat != entry->model_mat) {
+          break;
+        }
+        batch.push_back((*drawable)->Geometry().get());
+      }
     }
 
-    drawable->PostDraw();
+    if (batch_end - entry_ind > 1) {
+      DrawBatch(*first, batch);
+    } else {
+      DrawDrawNode(entry->node);
+    }
 
-    GLenum gl_err = glGetError();
-    if (gl_err != GL_NO_ERROR) {
-      printf("OpenGL: %s\n", sv::glErrorString(gl_err));
+    if (p_->draw_bounding_boxes) {
+      for (int ind = entry_ind; ind < batch_end; ++ind) {
+        DrawBoundingBox(entries[ind]->world_bbox);
+      }
     }
+    entry_ind = batch_end;
+  }
+}
 
-    // Done. Release resources
-    p_->program->release();
+void DrawContext::DrawEntry(const RenderQueueEntry* entry) {
+  if (p_->group_stats) {
+    p_->group_stats->nodes_drawn++;
+  }
+  p_->model_mat = entry->model_mat;
+  DrawDrawNode(entry->node);
 
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  if (p_->draw_bounding_boxes) {
+    DrawBoundingBox(entry->world_bbox);
   }
 }
 
-void DrawContext::ActivateMaterial() {
-  p_->program->bind();
+void DrawContext::ReadOcclusionQueries(DrawGroup* dgroup) {
+  RenderQueue* queue = dgroup->Queue();
+  const std::vector<RenderQueueEntry>& entries = queue->Entries();
+  const int num_entries = entries.size();
+  std::vector<PendingQuery>& pending = p_->pending_queries[dgroup];
+
+  // Read back the results that are available without waiting, and keep
+  // the remaining queries for a later frame.
+  size_t num_pending = 0;
+  for (const PendingQuery& query : pending) {
+    GLuint available = 0;
+    glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      pending[num_pending++] = query;
+      continue;
+    }
 
-  glFrontFace(GL_CCW);
+    GLuint num_samples = 0;
+    glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &num_samples);
+    p_->free_queries.push_back(query.query);
 
-  // set OpenGL attributes based on material properties.
-  const bool mat_two_sided = p_->material->TwoSided();
-  if (mat_two_sided != p_->gl_two_sided) {
-    p_->gl_two_sided = mat_two_sided;
-    if (p_->gl_two_sided) {
-      glDisable(GL_CULL_FACE);
-    } else {
-      glCullFace(GL_BACK);
-      glEnable(GL_CULL_FACE);
+    // The node may have been removed from the draw group since.
+    if (query.index < num_entries && entries[query.index].node == query.node) {
+      const RenderQueueEntry* entry = &entries[query.index];
+      SetOcclusionResult(queue->Occlusion(entry), num_samples > 0,
+          p_->frame_number, query.index);
     }
   }
+  pending.resize(num_pending);
+}
 
-  const bool mat_depth_test = p_->material->DepthTest();
-  if (mat_depth_test != p_->gl_depth_test) {
-    p_->gl_depth_test = mat_depth_test;
-    if (p_->gl_depth_test) {
-      glEnable(GL_DEPTH_TEST);
+void DrawContext::DrawOcclusionCulled(DrawGroup* dgroup,
+    const std::vector<const RenderQueueEntry*>& entries) {
+  RenderQueue* queue = dgroup->Queue();
+  const RenderQueueEntry* queue_entries = queue->Entries().data();
+  std::vector<PendingQuery>& pending = p_->pending_queries[dgroup];
+  const uint64_t frame_number = p_->frame_number;
+  const float near_margin =
+      kOcclusionNearMargin * p_->cur_camera->GetZNear();
+
+  // Split the nodes into nodes drawn without a query, previously visible
+  // nodes due for a test, and previously occluded nodes.
+  std::vector<const RenderQueueEntry*>& unoccluded = p_->unoccluded_list;
+  std::vector<const RenderQueueEntry*>& visible_tests = p_->visible_test_list;
+  std::vector<const RenderQueueEntry*>& occluded = p_->occluded_list;
+  unoccluded.clear();
+  visible_tests.clear();
+  occluded.clear();
+  for (const RenderQueueEntry* entry : entries) {
+    const OcclusionState* state = queue->Occlusion(entry);
+    if (state->query_pending || !entry->world_bbox.Valid() ||
+        entry->world_bbox.SquaredDistance(p_->eye) <
+            near_margin * near_margin) {
+      unoccluded.push_back(entry);
+    } else if (state->occluded) {
+      occluded.push_back(entry);
+    } else if (frame_number >= state->next_test_frame) {
+      visible_tests.push_back(entry);
     } else {
-      glDisable(GL_DEPTH_TEST);
+      unoccluded.push_back(entry);
     }
   }
 
-  const GLenum mat_depth_func = p_->material->DepthFunc();
-  if (mat_depth_func != p_->gl_depth_func) {
-    p_->gl_depth_func = mat_depth_func;
-    glDepthFunc(p_->gl_depth_func);
+  // Draw the nodes that were visible during the previous frame first, so
+  // that they occlude as much as possible.
+  DrawEntries(unoccluded);
+
+  // Previously visible nodes are tested by counting the samples that they
+  // draw. The results are read back during a later frame.
+  for (const RenderQueueEntry* entry : visible_tests) {
+    const GLuint query = TakeQuery(&p_->free_queries);
+    glBeginQuery(GL_SAMPLES_PASSED, query);
+    DrawEntry(entry);
+    glEndQuery(GL_SAMPLES_PASSED);
+
+    const int index = entry - queue_entries;
+    pending.push_back(PendingQuery{query, entry->node, index});
+    queue->Occlusion(entry)->query_pending = true;
   }
 
-  const bool mat_depth_write = p_->material->DepthWrite();
-  if (p_->gl_depth_write != mat_depth_write) {
-    p_->gl_depth_write = mat_depth_write;
-    if (p_->gl_depth_write) {
-      glDepthMask(GL_TRUE);
+  if (occluded.empty()) {
+    return;
+  }
+
+  // Previously occluded nodes are tested by drawing their bounding boxes.
+  // All of the bounding boxes are drawn before any of the nodes, so that
+  // the queries have time to complete.
+  std::vector<GLuint>& queries = p_->proxy_queries;
+  queries.clear();
+  for (size_t ind = 0; ind < occluded.size(); ++ind) {
+    queries.push_back(TakeQuery(&p_->free_queries));
+  }
+  if (!DrawOcclusionProxies(occluded, queries)) {
+    // None of the queries were issued, so give them back and treat the
+    // nodes as visible.
+    for (size_t ind = 0; ind < occluded.size(); ++ind) {
+      const RenderQueueEntry* entry = occluded[ind];
+      p_->free_queries.push_back(queries[ind]);
+      SetOcclusionResult(queue->Occlusion(entry), true, frame_number,
+          entry - queue_entries);
+    }
+    DrawEntries(occluded);
+    return;
+  }
+
+  for (size_t ind = 0; ind < occluded.size(); ++ind) {
+    const RenderQueueEntry* entry = occluded[ind];
+    const GLuint query = queries[ind];
+    OcclusionState* state = queue->Occlusion(entry);
+    const int index = entry - queue_entries;
+
+    if (p_->use_conditional_render) {
+      // Let the GPU skip the node if its bounding box was not visible, and
+      // read the result back during a later frame.
+      glBeginConditionalRender(query, GL_QUERY_WAIT);
+      DrawEntry(entry);
+      glEndConditionalRender();
+      pending.push_back(PendingQuery{query, entry->node, index});
+      state->query_pending = true;
+      p_->num_nodes_occluded++;
     } else {
-      glDepthMask(GL_FALSE);
+      GLuint num_samples = 0;
+      glGetQueryObjectuiv(query, GL_QUERY_RESULT, &num_samples);
+      p_->free_queries.push_back(query);
+      SetOcclusionResult(state, num_samples > 0, frame_number, index);
+      if (num_samples > 0) {
+        DrawEntry(entry);
+      } else {
+        p_->num_nodes_occluded++;
+      }
     }
   }
+}
+
+bool DrawContext::DrawOcclusionProxies(
+    const std::vector<const RenderQueueEntry*>& entries,
+    const std::vector<GLuint>& queries) {
+  p_->geometry = p_->occlusion_proxy_geometry;
+  p_->material = p_->occlusion_proxy_material;
+  p_->shader = p_->material->Shader();
+  p_->program = p_->shader->Program();
+  if (!p_->program) {
+    return false;
+  }
 
-  const StencilSettings* mat_stencil = p_->material->Stencil();
-  if (mat_stencil) {
-    if (!p_->stencil_enabled) {
-      glEnable(GL_STENCIL_TEST);
-      p_->stencil_enabled = true;
+  const int num_entries = entries.size();
+  for (int ind = 0; ind < num_entries; ++ind) {
+    // Inflate the bounding box slightly, so that the bounding boxes of flat
+    // or thin nodes still cover some pixels.
+    const AxisAlignedBox& box = entries[ind]->world_bbox;
+    const QVector3D size = box.Max() - box.Min();
+    const float padding =
+        0.01 * std::max(size.x(), std::max(size.y(), size.z()));
+    const QVector3D pad(padding, padding, padding);
+    p_->model_mat.setToIdentity();
+    p_->model_mat.translate(box.Min() - pad);
+    p_->model_mat.scale(size + 2 * pad);
+
+    if (ind == 0) {
+      ActivateMaterial();
+    } else {
+      LoadModelUniforms();
     }
 
-    if (*mat_stencil != p_->stencil) {
-      p_->stencil = *mat_stencil;
-      glStencilOpSeparate(GL_FRONT, p_->stencil.front.sfail,
-          p_->stencil.front.dpfail, p_->stencil.front.dppass);
-      glStencilOpSeparate(GL_BACK, p_->stencil.back.sfail,
-          p_->stencil.back.dpfail, p_->stencil.back.dppass);
+    glBeginQuery(GL_SAMPLES_PASSED, queries[ind]);
+    DrawGeometry();
+    glEndQuery(GL_SAMPLES_PASSED);
+  }
+  return true;
+}
+
+void DrawContext::DrawDrawNode(DrawNode* draw_node) {
+  InstancedDrawNode* instanced = draw_node->Instanced();
+  for (const Drawable::Ptr& drawable : DrawablesToDraw(draw_node)) {
+    p_->geometry = drawable->Geometry();
+    p_->material = drawable->Material();
+    p_->shader = p_->material->Shader();
+
+    // Activate the shader program
+    if (!p_->shader) {
+      continue;
+    }
+    p_->program = p_->shader->Program();
+    if (!p_->program) {
+      continue;
+    }
 
-      glStencilFuncSeparate(GL_FRONT, p_->stencil.front.func,
-          p_->stencil.front.func_ref, p_->stencil.front.func_mask);
-      glStencilFuncSeparate(GL_BACK, p_->stencil.back.func,
-          p_->stencil.back.func_ref, p_->stencil.back.func_mask);
+    ActivateMaterial();
 
-      glStencilMaskSeparate(GL_FRONT, p_->stencil.front.mask);
-      glStencilMaskSeparate(GL_BACK, p_->stencil.back.mask);
+    if (drawable->PreDraw()) {
+      if (instanced) {
+        DrawInstances(instanced);
+      } else {
+        DrawGeometry();
+      }
     }
-  } else if (p_->stencil_enabled) {
-    glDisable(GL_STENCIL_TEST);
-    p_->stencil_enabled = false;
-  }
 
-  const bool mat_color_write = p_->material->ColorWrite();
-  if (p_->gl_color_write != mat_color_write) {
-    p_->gl_color_write = mat_color_write;
-    if (p_->gl_color_write) {
-      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    } else {
-      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    drawable->PostDraw();
+
+    GLenum gl_err = glGetError();
+    if (gl_err != GL_NO_ERROR) {
+      printf("OpenGL: %s\n", sv::glErrorString(gl_err));
     }
   }
+}
 
-  const float mat_point_size = p_->material->PointSize();
-  if (p_->gl_point_size != mat_point_size) {
-    p_->gl_point_size = mat_point_size;
-    glPointSize(p_->gl_point_size);
-  }
+void DrawContext::ActivateMaterial() {
+  GLState& gl_state = p_->gl_state;
+  const MaterialResource::Ptr& material = p_->material;
+
+  gl_state.UseProgram(p_->program->programId());
 
-  const float mat_line_width = p_->material->LineWidth();
-  if (p_->gl_line_width != mat_line_width) {
-    p_->gl_line_width = mat_line_width;
-    glLineWidth(p_->gl_line_width);
+  gl_state.SetFrontFace(GL_CCW);
+
+  // set OpenGL attributes based on material properties.
+  if (material->TwoSided()) {
+    gl_state.SetCullFaceEnabled(false);
+  } else {
+    gl_state.SetCullFace(GL_BACK);
+    gl_state.SetCullFaceEnabled(true);
   }
 
-  const bool mat_blend = p_->material->Blend();
-  if (p_->gl_blend != mat_blend) {
-    p_->gl_blend = mat_blend;
-    if (p_->gl_blend) {
-      glEnable(GL_BLEND);
-    } else {
-      glDisable(GL_BLEND);
-    }
+  gl_state.SetDepthTest(material->DepthTest());
+  gl_state.SetDepthFunc(material->DepthFunc());
+  gl_state.SetDepthMask(material->DepthWrite());
+
+  const StencilSettings* mat_stencil = material->Stencil();
+  if (mat_stencil) {
+    gl_state.SetStencilTest(true);
+    gl_state.SetStencil(*mat_stencil);
+  } else {
+    gl_state.SetStencilTest(false);
   }
 
+  gl_state.SetColorMask(material->ColorWrite());
+  gl_state.SetPointSize(material->PointSize());
+  gl_state.SetLineWidth(material->LineWidth());
+  gl_state.SetBlend(material->Blend());
+
   GLenum mat_sfactor;
   GLenum mat_dfactor;
-  p_->material->BlendFunc(&mat_sfactor, &mat_dfactor);
-  if (p_->gl_sfactor != mat_sfactor || p_->gl_dfactor != mat_dfactor) {
-    p_->gl_sfactor = mat_sfactor;
-    p_->gl_dfactor = mat_dfactor;
-    glBlendFunc(p_->gl_sfactor, p_->gl_dfactor);
-  }
+  material->BlendFunc(&mat_sfactor, &mat_dfactor);
+  gl_state.SetBlendFunc(mat_sfactor, mat_dfactor);
 
-  // Set shader standard variables
+  // Set shader standard variables. Camera and light data is normally in
+  // uniform blocks that are filled once per frame, but shaders may also
+  // declare loose uniform variables.
   const ShaderStandardVariables& locs = p_->shader->StandardVariables();
-  const QMatrix4x4 proj_mat = p_->cur_camera->GetProjectionMatrix();
-  const QMatrix4x4 view_mat = p_->cur_camera->GetViewMatrix();
+  const QMatrix4x4& proj_mat = p_->proj_mat;
+  const QMatrix4x4& view_mat = p_->view_mat;
 
   // Set uniform variables
   if (locs.sv_proj_mat >= 0) {
@@ -602,8 +1497,64 @@ void DrawContext::ActivateMaterial() {
     p_->program->setUniformValue(locs.sv_view_mat, view_mat);
   }
   if (locs.sv_view_mat_inv >= 0) {
-    p_->program->setUniformValue(locs.sv_view_mat_inv, view_mat.inverted());
+    p_->program->setUniformValue(locs.sv_view_mat_inv, p_->view_mat_inv);
+  }
+  LoadModelUniforms();
+
+  if (locs.sv_lights_block < 0) {
+    const int num_lights = p_->lights.size();
+    for (int light_ind = 0; light_ind < num_lights; ++light_ind) {
+      const LightBlock& light = p_->lights[light_ind];
+      const ShaderLightLocation light_loc = locs.sv_lights[light_ind];
+
+      if (light_loc.is_directional >= 0) {
+        p_->program->setUniformValue(light_loc.is_directional,
+                                     light.is_directional);
+      }
+
+      if (light_loc.direction >= 0) {
+        p_->program->setUniformValue(light_loc.direction, light.direction[0],
+            light.direction[1], light.direction[2]);
+      }
+
+      if (light_loc.position >= 0) {
+        p_->program->setUniformValue(light_loc.position, light.position[0],
+            light.position[1], light.position[2]);
+      }
+
+      if (light_loc.ambient >= 0) {
+        p_->program->setUniformValue(light_loc.ambient, light.ambient);
+      }
+
+      if (light_loc.specular >= 0) {
+        p_->program->setUniformValue(light_loc.specular, light.specular);
+      }
+
+      if (light_loc.color >= 0) {
+        p_->program->setUniformValue(light_loc.color, light.color[0],
+            light.color[1], light.color[2]);
+      }
+
+      if (light_loc.attenuation >= 0) {
+        p_->program->setUniformValue(light_loc.attenuation,
+                                     light.attenuation);
+      }
+
+      if (light_loc.cone_angle >= 0) {
+        p_->program->setUniformValue(light_loc.cone_angle, light.cone_angle);
+      }
+    }
   }
+
+  // Load shader uniform variables and textures from the material
+  p_->material->Compiled().Load(&gl_state);
+}
+
+void DrawContext::LoadModelUniforms() {
+  const ShaderStandardVariables& locs = p_->shader->StandardVariables();
+  const QMatrix4x4& proj_mat = p_->proj_mat;
+  const QMatrix4x4& view_mat = p_->view_mat;
+
   if (locs.sv_model_mat >= 0) {
     p_->program->setUniformValue(locs.sv_model_mat, p_->model_mat);
   }
@@ -618,129 +1569,312 @@ void DrawContext::ActivateMaterial() {
     p_->program->setUniformValue(locs.sv_model_normal_mat,
                               p_->model_mat.normalMatrix());
   }
+}
 
-  const std::vector<LightNode*>& lights = p_->scene->Lights();
-  int num_lights = lights.size();
-  if (num_lights > kShaderMaxLights) {
-    printf("Too many lights. Max: %d\n", kShaderMaxLights);
-    num_lights = kShaderMaxLights;
+static void SetupAttributeArray(QOpenGLShaderProgram* program, int location,
+                                int num_attributes, GLenum attr_type,
+                                int offset, int attribute_size, int stride) {
+  if (location < 0) {
+    return;
   }
 
-  for (int light_ind = 0; light_ind < num_lights; ++light_ind) {
-    const LightNode* light_node = lights[light_ind];
-    const ShaderLightLocation light_loc = locs.sv_lights[light_ind];
-    LightType light_type = light_node->GetLightType();
+  if (num_attributes > 0) {
+    program->enableAttributeArray(location);
+    program->setAttributeBuffer(location, attr_type, offset, attribute_size,
+                                stride);
+  } else {
+    program->disableAttributeArray(location);
+  }
+}
 
-    if (light_loc.is_directional >= 0) {
-      const bool is_directional = light_type == LightType::kDirectional;
-      p_->program->setUniformValue(light_loc.is_directional, is_directional);
+// Sets the per-instance attributes of a shader to constant values, for
+// drawing without per-instance attribute arrays.
+static void SetConstantInstanceAttributes(const ShaderStandardVariables& locs,
+                                          const QVector4D& color) {
+  if (locs.sv_instance_model_mat >= 0) {
+    for (int col = 0; col < 4; ++col) {
+      glVertexAttrib4f(locs.sv_instance_model_mat + col, col == 0, col == 1,
+                       col == 2, col == 3);
     }
-
-    if (light_loc.direction >= 0) {
-      const QVector3D light_dir = light_node->Direction();
-      p_->program->setUniformValue(light_loc.direction, light_dir);
+  }
+  if (locs.sv_instance_normal_mat >= 0) {
+    for (int col = 0; col < 3; ++col) {
+      glVertexAttrib3f(locs.sv_instance_normal_mat + col, col == 0, col == 1,
+                       col == 2);
     }
+  }
+  if (locs.sv_instance_color >= 0) {
+    glVertexAttrib4f(locs.sv_instance_color, color.x(), color.y(), color.z(),
+                     color.w());
+  }
+}
 
-    if (light_loc.position >= 0) {
-      const QVector3D light_pos = light_node->Translation();
-      p_->program->setUniformValue(light_loc.position, light_pos);
-    }
+// Enables a per-instance attribute array of num_columns consecutive
+// locations (e.g., 4 for a mat4), sourced from the bound array buffer.
+static void SetupInstanceAttributeArray(int location, int num_columns,
+                                        int column_size, int offset) {
+  if (location < 0) {
+    return;
+  }
+  for (int col = 0; col < num_columns; ++col) {
+    const intptr_t col_offset = offset + col * column_size * sizeof(GLfloat);
+    glEnableVertexAttribArray(location + col);
+    glVertexAttribPointer(location + col, column_size, GL_FLOAT, GL_FALSE,
+                          sizeof(InstanceAttributes),
+                          reinterpret_cast<const void*>(col_offset));
+    glVertexAttribDivisor(location + col, 1);
+  }
+}
 
-    if (light_loc.ambient >= 0) {
-      const float ambient = light_node->Ambient();
-      p_->program->setUniformValue(light_loc.ambient, ambient);
-    }
+static void DisableInstanceAttributeArray(int location, int num_columns) {
+  if (location < 0) {
+    return;
+  }
+  for (int col = 0; col < num_columns; ++col) {
+    glVertexAttribDivisor(location + col, 0);
+    glDisableVertexAttribArray(location + col);
+  }
+}
 
-    if (light_loc.specular >= 0) {
-      const float specular = light_node->Specular();
-      p_->program->setUniformValue(light_loc.specular, specular);
+// Issues the draw call for a geometry whose vertex arrays are bound. If
+// num_instances is positive, then the geometry is drawn with instancing.
+static void DrawBoundGeometry(GeometryResource* geometry, int num_instances,
+    DrawGroupStats* stats) {
+  const GLenum mode = geometry->GLMode();
+  if (stats) {
+    const int64_t count = geometry->IndexBuffer() ?
+        geometry->NumIndices() : geometry->NumVertices();
+    stats->draw_calls++;
+    stats->triangles += NumTriangles(mode, count) * std::max(num_instances, 1);
+  }
+  if (!geometry->IndexBuffer()) {
+    if (num_instances > 0) {
+      glDrawArraysInstanced(mode, 0, geometry->NumVertices(), num_instances);
+    } else {
+      glDrawArrays(mode, 0, geometry->NumVertices());
     }
+    return;
+  }
 
-    if (light_loc.color >= 0) {
-      const QVector3D color = light_node->Color();
-      p_->program->setUniformValue(light_loc.color, color);
+  const GLsizei count = geometry->NumIndices();
+  const GLenum type = geometry->IndexType();
+  const void* indices =
+      reinterpret_cast<const void*>(static_cast<intptr_t>(
+            geometry->IndexOffset()));
+  const GLint base_vertex = geometry->BaseVertex();
+  if (num_instances > 0) {
+    if (base_vertex) {
+      glDrawElementsInstancedBaseVertex(mode, count, type, indices,
+                                        num_instances, base_vertex);
+    } else {
+      glDrawElementsInstanced(mode, count, type, indices, num_instances);
     }
-
-    if (light_loc.attenuation >= 0) {
-      const float attenuation = light_node->Attenuation();
-      p_->program->setUniformValue(light_loc.attenuation, attenuation);
+  } else {
+    if (base_vertex) {
+      glDrawElementsBaseVertex(mode, count, type, indices, base_vertex);
+    } else {
+      glDrawElements(mode, count, type, indices);
     }
+  }
+}
 
-    if (light_loc.cone_angle >= 0) {
-      const float cone_angle = light_node->ConeAngle() * M_PI / 180;
-      p_->program->setUniformValue(light_loc.cone_angle, cone_angle);
+void DrawContext::BindGeometry() {
+  GeometryResource* geometry = p_->geometry.get();
+  GLState& gl_state = p_->gl_state;
+
+  // Bind the vertex array object for this geometry and shader. The attribute
+  // arrays only need to be specified when it is first created, or after the
+  // geometry is reloaded or the shader relinked.
+  bool needs_setup = true;
+  QOpenGLVertexArrayObject* vao =
+      geometry->VertexArray(p_->shader.get(), &needs_setup);
+  gl_state.BindVertexArray(vao ? vao->objectId() : 0);
+
+  if (needs_setup) {
+    // Load per-vertex attribute arrays
+    QOpenGLBuffer* vbo = geometry->VBO();
+    gl_state.BindArrayBuffer(vbo->bufferId());
+
+    const ShaderStandardVariables& locs = p_->shader->StandardVariables();
+    const int stride = geometry->VertexStride();
+    SetupAttributeArray(p_->program, locs.sv_vert_pos, geometry->NumVertices(),
+                        GL_FLOAT, geometry->VertexOffset(), 3, stride);
+    SetupAttributeArray(p_->program, locs.sv_normal, geometry->NumNormals(),
+                        GL_FLOAT, geometry->NormalOffset(), 3, stride);
+    SetupAttributeArray(p_->program, locs.sv_diffuse, geometry->NumDiffuse(),
+                        GL_FLOAT, geometry->DiffuseOffset(), 4, stride);
+    SetupAttributeArray(p_->program, locs.sv_specular, geometry->NumSpecular(),
+                        GL_FLOAT, geometry->SpecularOffset(), 4, stride);
+    SetupAttributeArray(p_->program, locs.sv_shininess,
+                        geometry->NumShininess(), GL_FLOAT,
+                        geometry->ShininessOffset(), 1, stride);
+    SetupAttributeArray(p_->program, locs.sv_tex_coords_0,
+                        geometry->NumTexCoords0(), GL_FLOAT,
+                        geometry->TexCoords0Offset(), 2, stride);
+
+    // The index buffer binding is part of the vertex array object.
+    QOpenGLBuffer* index_buffer = geometry->IndexBuffer();
+    if (index_buffer) {
+      gl_state.BindElementArrayBuffer(index_buffer->bufferId());
     }
   }
 
-  // Load shader uniform variables from the material
-  for (auto& item : p_->material->ShaderParameters()) {
-    ShaderUniform& uniform = item.second;
-    uniform.LoadToProgram(p_->program);
-  }
+  // TODO load custom attribute arrays
+}
 
-  // Load textures
-  unsigned int texunit = 0;
-  for (auto& item : p_->material->GetTextures()) {
-    const QString& texname = item.first;
-    const std::shared_ptr<QOpenGLTexture>& texture = item.second;
-    texture->bind(texunit);
-    p_->program->setUniformValue(texname.toStdString().c_str(), texunit);
+void DrawContext::DrawGeometry() {
+  BindGeometry();
+
+  // Shaders that support instancing can also draw regular draw nodes.
+  const ShaderStandardVariables& locs = p_->shader->StandardVariables();
+  if (locs.sv_instance_model_mat >= 0 || locs.sv_instance_color >= 0) {
+    SetConstantInstanceAttributes(locs, QVector4D(1, 1, 1, 1));
   }
+
+  // Draw the geometry
+  DrawBoundGeometry(p_->geometry.get(), 0, p_->group_stats);
 }
 
-static void SetupAttributeArray(QOpenGLShaderProgram* program, int location,
-                                int num_attributes, GLenum attr_type,
-                                int offset, int attribute_size) {
-  if (location < 0) {
+void DrawContext::DrawInstances(InstancedDrawNode* node) {
+  const int num_instances = node->NumInstances();
+  if (num_instances == 0) {
     return;
   }
 
-  if (num_attributes > 0) {
-    program->enableAttributeArray(location);
-    program->setAttributeBuffer(location, attr_type, offset, attribute_size, 0);
-  } else {
-    program->disableAttributeArray(location);
+  BindGeometry();
+
+  GeometryResource* geometry = p_->geometry.get();
+  const ShaderStandardVariables& locs = p_->shader->StandardVariables();
+
+  if (!p_->use_instancing || locs.sv_instance_model_mat < 0) {
+    // Draw each instance separately, with its transform folded into the
+    // model matrix.
+    const QMatrix4x4 node_model_mat = p_->model_mat;
+    const std::vector<QMatrix4x4>& transforms = node->InstanceTransforms();
+    const std::vector<QVector4D>& colors = node->InstanceColors();
+    for (int index = 0; index < num_instances; ++index) {
+      p_->model_mat = node_model_mat * transforms[index];
+      LoadModelUniforms();
+      SetConstantInstanceAttributes(locs, colors[index]);
+      DrawBoundGeometry(geometry, 0, p_->group_stats);
+    }
+    p_->model_mat = node_model_mat;
+    return;
   }
+
+  // The per-instance attribute arrays are only enabled for the duration of
+  // the draw call, so that the geometry's vertex array object can still be
+  // used to draw regular draw nodes.
+  node->InstanceBuffer(&p_->gl_state);
+  SetupInstanceAttributeArray(locs.sv_instance_model_mat, 4, 4,
+      offsetof(InstanceAttributes, model_mat));
+  SetupInstanceAttributeArray(locs.sv_instance_normal_mat, 3, 3,
+      offsetof(InstanceAttributes, normal_mat));
+  SetupInstanceAttributeArray(locs.sv_instance_color, 1, 4,
+      offsetof(InstanceAttributes, color));
+
+  DrawBoundGeometry(geometry, num_instances, p_->group_stats);
+
+  DisableInstanceAttributeArray(locs.sv_instance_model_mat, 4);
+  DisableInstanceAttributeArray(locs.sv_instance_normal_mat, 3);
+  DisableInstanceAttributeArray(locs.sv_instance_color, 1);
 }
 
-void DrawContext::DrawGeometry() {
-  // Load geometry and bind a vertex buffer
-  QOpenGLBuffer* vbo = p_->geometry->VBO();
-  vbo->bind();
+void DrawContext::DrawBatch(const Drawable::Ptr& first,
+                            const std::vector<GeometryResource*>& geometries) {
+  p_->geometry = first->Geometry();
+  p_->material = first->Material();
+  p_->shader = p_->material->Shader();
+  p_->program = p_->shader->Program();
+
+  ActivateMaterial();
+
+  // All geometries in the same shared buffers have the same attribute
+  // arrays, so the vertex array object of the first one serves them all.
+  BindGeometry();
 
-  // Load per-vertex attribute arrays
   const ShaderStandardVariables& locs = p_->shader->StandardVariables();
-  SetupAttributeArray(p_->program, locs.sv_vert_pos, p_->geometry->NumVertices(),
-                      GL_FLOAT, p_->geometry->VertexOffset(), 3);
-  SetupAttributeArray(p_->program, locs.sv_normal, p_->geometry->NumNormals(),
-                      GL_FLOAT, p_->geometry->NormalOffset(), 3);
-  SetupAttributeArray(p_->program, locs.sv_diffuse, p_->geometry->NumDiffuse(),
-                      GL_FLOAT, p_->geometry->DiffuseOffset(), 4);
-  SetupAttributeArray(p_->program, locs.sv_specular, p_->geometry->NumSpecular(),
-                      GL_FLOAT, p_->geometry->SpecularOffset(), 4);
-  SetupAttributeArray(p_->program, locs.sv_shininess, p_->geometry->NumShininess(),
-                      GL_FLOAT, p_->geometry->ShininessOffset(), 1);
-  SetupAttributeArray(p_->program, locs.sv_tex_coords_0,
-                      p_->geometry->NumTexCoords0(), GL_FLOAT,
-                      p_->geometry->TexCoords0Offset(), 2);
+  if (locs.sv_instance_model_mat >= 0 || locs.sv_instance_color >= 0) {
+    SetConstantInstanceAttributes(locs, QVector4D(1, 1, 1, 1));
+  }
 
-  // TODO load custom attribute arrays
+  std::vector<GLsizei>& counts = p_->batch_counts;
+  std::vector<const void*>& indices = p_->batch_indices;
+  std::vector<GLint>& base_vertices = p_->batch_base_vertices;
+  counts.clear();
+  indices.clear();
+  base_vertices.clear();
+  for (GeometryResource* geometry : geometries) {
+    counts.push_back(geometry->NumIndices());
+    indices.push_back(reinterpret_cast<const void*>(
+          static_cast<intptr_t>(geometry->IndexOffset())));
+    base_vertices.push_back(geometry->BaseVertex());
+  }
+  glMultiDrawElementsBaseVertex(p_->geometry->GLMode(), counts.data(),
+      GL_UNSIGNED_INT, indices.data(), counts.size(), base_vertices.data());
+
+  if (p_->group_stats) {
+    p_->group_stats->draw_calls++;
+    for (GLsizei count : counts) {
+      p_->group_stats->triangles +=
+          NumTriangles(p_->geometry->GLMode(), count);
+    }
+  }
 
-  // Draw the geometry
-  QOpenGLBuffer* index_buffer = p_->geometry->IndexBuffer();
-  if (index_buffer) {
-    index_buffer->bind();
-    glDrawElements(p_->geometry->GLMode(), p_->geometry->NumIndices(),
-                   p_->geometry->IndexType(), 0);
-    index_buffer->release();
-  } else {
-    glDrawArrays(p_->geometry->GLMode(), 0, p_->geometry->NumVertices());
+  GLenum gl_err = glGetError();
+  if (gl_err != GL_NO_ERROR) {
+    printf("OpenGL: %s\n", sv::glErrorString(gl_err));
   }
-  vbo->release();
 }
 
-void DrawContext::DrawBoundingBox(const AxisAlignedBox& box) {
+void DrawContext::MakeOcclusionProxy() {
+  if (p_->occlusion_proxy_geometry) {
+    return;
+  }
+
+  // Loading the geometry binds its index buffer, which would otherwise be
+  // recorded in the currently bound vertex array object.
+  p_->gl_state.BindVertexArray(0);
+
+  StockResources stock(p_->resources);
+  ShaderResource::Ptr shader =
+      stock.Shader(StockResources::kUniformColorNoLighting);
+
+  // Bounding boxes are tested against the depth buffer without changing it.
+  MaterialResource::Ptr material = p_->resources->MakeMaterial(shader);
+  material->SetParam("color", 1.0f, 1.0f, 1.0f, 1.0f);
+  material->SetColorWrite(false);
+  material->SetDepthWrite(false);
+  material->SetTwoSided(true);
+
+  // A unit cube, drawn as triangles.
+  GeometryResource::Ptr geometry = p_->resources->MakeGeometry();
+  GeometryData gdata;
+  gdata.gl_mode = GL_TRIANGLES;
+  gdata.vertices = {
+      {QVector3D(0, 0, 0)}, {QVector3D(0, 1, 0)}, {QVector3D(1, 1, 0)},
+      {QVector3D(1, 0, 0)}, {QVector3D(0, 0, 1)}, {QVector3D(0, 1, 1)},
+      {QVector3D(1, 1, 1)}, {QVector3D(1, 0, 1)},
+  };
+  gdata.indices = {0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6,
+                   0, 4, 5, 0, 5, 1, 3, 2, 6, 3, 6, 7,
+                   0, 3, 7, 0, 7, 4, 1, 5, 6, 1, 6, 2};
+  geometry->Load(gdata);
+
+  p_->occlusion_proxy_geometry = geometry;
+  p_->occlusion_proxy_material = material;
+
+  // Loading the resources binds buffers and programs behind the state
+  // tracker's back.
+  p_->gl_state.Invalidate();
+}
+
+void DrawContext::MakeBoundingBoxNode() {
   if (!p_->bounding_box_node) {
+    // Loading the geometry binds its index buffer, which would otherwise be
+    // recorded in the currently bound vertex array object.
+    p_->gl_state.BindVertexArray(0);
+
     StockResources stock(p_->resources);
     ShaderResource::Ptr shader =
         stock.Shader(StockResources::kUniformColorNoLighting);
@@ -765,8 +1899,14 @@ void DrawContext::DrawBoundingBox(const AxisAlignedBox& box) {
 
     // hack to prevent the bounding box to appear during normal rendering
     p_->bounding_box_node->SetVisible(false);
+
+    // Loading the resources binds buffers and programs behind the state
+    // tracker's back.
+    p_->gl_state.Invalidate();
   }
+}
 
+void DrawContext::DrawBoundingBox(const AxisAlignedBox& box) {
   p_->bounding_box_node->SetScale(box.Max() - box.Min());
   p_->bounding_box_node->SetTranslation(box.Min());
   p_->model_mat = p_->bounding_box_node->WorldTransform();
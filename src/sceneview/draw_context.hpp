@@ -7,6 +7,7 @@
 
 #include <QColor>
 
+#include <sceneview/frame_stats.hpp>
 #include <sceneview/resource_manager.hpp>
 #include <sceneview/scene.hpp>
 
@@ -15,7 +16,9 @@ namespace sv {
 class AxisAlignedBox;
 class DrawGroup;
 class DrawNode;
+class InstancedDrawNode;
 class Renderer;
+struct RenderQueueEntry;
 
 class DrawContext {
   public:
@@ -40,17 +43,108 @@ class DrawContext {
 
     void SetDrawGroups(const std::vector<DrawGroup*>& groups);
 
+    /**
+     * Viewport size passed to the most recent Draw().
+     */
+    int ViewportWidth() const;
+
+    int ViewportHeight() const;
+
+    /**
+     * Number of OpenGL state changes issued during the most recent Draw().
+     */
+    int NumStateChangesIssued() const;
+
+    /**
+     * Number of OpenGL state changes skipped during the most recent Draw()
+     * because they would not have changed anything.
+     */
+    int NumStateChangesSkipped() const;
+
+    /**
+     * Number of draw nodes that were considered occluded during the most
+     * recent Draw(), and so were only drawn if their bounding box turned out
+     * to be visible. See DrawGroup::SetOcclusionCulling().
+     */
+    int NumNodesOccluded() const;
+
+    /**
+     * Number of draw nodes tested against the occluders during the most
+     * recent Draw(). See DrawGroup::SetSoftwareOcclusionCulling().
+     */
+    int NumNodesSoftwareTested() const;
+
+    /**
+     * Number of draw nodes culled because they were hidden by occluders
+     * during the most recent Draw(). See
+     * DrawGroup::SetSoftwareOcclusionCulling().
+     */
+    int NumNodesSoftwareOccluded() const;
+
+    /**
+     * Statistics of the most recent Draw().
+     */
+    const FrameStats& Stats() const;
+
+    /**
+     * Statistics of the recent frames. GPU times are filled in as they become
+     * available.
+     */
+    const FrameStatsHistory& StatsHistory() const;
+
   private:
     void PrepareFixedFunctionPipeline();
 
+    void UpdateLights();
+
+    void UpdateCamera();
+
     void DrawDrawGroup(DrawGroup* dgroup);
 
+    void ReadTimerQueries();
+
+    void SoftwareOcclusionCull(
+        std::vector<const RenderQueueEntry*>* candidates);
+
+    void SelectLevelsOfDetail(
+        std::vector<const RenderQueueEntry*>* candidates);
+
+    const std::vector<Drawable::Ptr>& DrawablesToDraw(DrawNode* node);
+
+    void DrawEntries(const std::vector<const RenderQueueEntry*>& entries);
+
+    void DrawEntry(const RenderQueueEntry* entry);
+
+    void ReadOcclusionQueries(DrawGroup* dgroup);
+
+    void DrawOcclusionCulled(DrawGroup* dgroup,
+        const std::vector<const RenderQueueEntry*>& entries);
+
+    // Returns false, without beginning any query, if the proxy material
+    // cannot be drawn.
+    bool DrawOcclusionProxies(
+        const std::vector<const RenderQueueEntry*>& entries,
+        const std::vector<GLuint>& queries);
+
+    void MakeOcclusionProxy();
+
     void DrawDrawNode(DrawNode* node);
 
     void ActivateMaterial();
 
+    void LoadModelUniforms();
+
+    void BindGeometry();
+
     void DrawGeometry();
 
+    void DrawInstances(InstancedDrawNode* node);
+
+    void DrawBatch(const Drawable::Ptr& first,
+        const std::vector<GeometryResource*>& geometries);
+
+    void MakeBoundingBoxNode();
+
     void DrawBoundingBox(const AxisAlignedBox& box);
 
     class Priv;
@@ -0,0 +1,188 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include <QGuiApplication>
+#include <QVector3D>
+
+#include "sceneview/camera_node.hpp"
+#include "sceneview/draw_node.hpp"
+#include "sceneview/frame_stats.hpp"
+#include "sceneview/group_node.hpp"
+#include "sceneview/light_node.hpp"
+#include "sceneview/offscreen_renderer.hpp"
+#include "sceneview/resource_manager.hpp"
+#include "sceneview/scene.hpp"
+#include "sceneview/stock_resources.hpp"
+
+using sv::CameraNode;
+using sv::DrawNode;
+using sv::FrameStatsHistory;
+using sv::GeometryData;
+using sv::GeometryResource;
+using sv::GroupNode;
+using sv::LightNode;
+using sv::MaterialResource;
+using sv::OffscreenRenderer;
+using sv::ResourceManager;
+using sv::Scene;
+using sv::StockResources;
+
+// Counts the calls to operator new, on any thread, while enabled.
+static std::atomic<bool> g_count_allocations(false);
+static std::atomic<int> g_num_allocations(0);
+
+static void* CountedAlloc(std::size_t size) {
+  if (g_count_allocations) {
+    g_num_allocations++;
+  }
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new(std::size_t size) { return CountedAlloc(size); }
+
+void* operator new[](std::size_t size) { return CountedAlloc(size); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+
+// Renders offscreen. Tests are skipped where no OpenGL context can be made.
+class DrawContextTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    app_.reset(new QGuiApplication(argc_, argv_));
+
+    resources = ResourceManager::Create();
+    scene = resources->MakeScene();
+    try {
+      renderer.reset(new OffscreenRenderer(resources, scene, 64, 64));
+    } catch (const std::runtime_error& ex) {
+      GTEST_SKIP() << ex.what();
+    }
+
+    CameraNode* camera = scene->MakeCamera(scene->Root());
+    camera->SetPerspective(50, 0.1, 100);
+    camera->LookAt(QVector3D(0, -10, 10), QVector3D(0, 0, 0),
+        QVector3D(0, 0, 1));
+    renderer->SetCamera(camera);
+  }
+
+  void TearDown() override {
+    renderer.reset();
+    scene.reset();
+    resources.reset();
+    app_.reset();
+  }
+
+  ResourceManager::Ptr resources;
+  Scene::Ptr scene;
+  std::unique_ptr<OffscreenRenderer> renderer;
+
+ private:
+  int argc_ = 1;
+  char arg0_[18] = "draw_context_test";
+  char* argv_[2] = { arg0_, nullptr };
+  std::unique_ptr<QGuiApplication> app_;
+};
+
+TEST_F(DrawContextTest, StaticSceneDoesNotAllocate) {
+  // Opaque and transparent nodes, so that both sorting paths run.
+  StockResources stock(resources);
+  LightNode* light = scene->MakeLight(scene->Root());
+  light->SetDirection(QVector3D(-1, -1, -2).normalized());
+  const GeometryResource::Ptr cube = stock.Cube();
+  MaterialResource::Ptr opaque =
+      stock.NewMaterial(StockResources::kUniformColorLighting);
+  opaque->SetParam(sv::kDiffuse, 0.8, 0.2, 0.2, 1.0);
+  MaterialResource::Ptr transparent =
+      stock.NewMaterial(StockResources::kUniformColorLighting);
+  transparent->SetParam(sv::kDiffuse, 0.2, 0.2, 0.8, 0.5);
+  transparent->SetBlend(true);
+  transparent->SetDepthWrite(false);
+  for (int ind = 0; ind < 20; ++ind) {
+    DrawNode* node = scene->MakeDrawNode(scene->Root(), cube,
+        ind % 4 ? opaque : transparent);
+    node->SetTranslation(ind % 5 * 2 - 4, ind / 5 * 2 - 3, 0);
+  }
+
+  // Fill the frame statistics history, whose slots keep their memory once
+  // every one of them has been used.
+  const int num_warmup_frames = FrameStatsHistory::kDefaultCapacity + 10;
+  for (int frame = 0; frame < num_warmup_frames; ++frame) {
+    renderer->Render(nullptr, nullptr);
+  }
+  ASSERT_GT(renderer->GetFrameStats().draw_calls, 0);
+
+  g_num_allocations = 0;
+  g_count_allocations = true;
+  for (int frame = 0; frame < 100; ++frame) {
+    renderer->Render(nullptr, nullptr);
+  }
+  g_count_allocations = false;
+  EXPECT_EQ(0, g_num_allocations);
+}
+
+TEST_F(DrawContextTest, NodesWithoutBoundsAreNotCulled) {
+  StockResources stock(resources);
+  MaterialResource::Ptr material =
+      stock.NewMaterial(StockResources::kUniformColorNoLighting);
+  material->SetParam(sv::kColor, 0.8, 0.2, 0.2, 1.0);
+
+  // A group well out of view, with a node in it that has no bounding box.
+  GroupNode* group = scene->MakeGroup(scene->Root());
+  group->SetTranslation(1000, 0, 0);
+  DrawNode* bounded = scene->MakeDrawNode(group, stock.Cube(), material);
+  DrawNode* unbounded = scene->MakeDrawNode(group);
+  renderer->Render(nullptr, nullptr);
+  ASSERT_FALSE(unbounded->WorldBoundingBox().Valid());
+  EXPECT_EQ(2, renderer->GetFrameStats().nodes_considered);
+  EXPECT_EQ(1, renderer->GetFrameStats().nodes_culled);
+
+  // Moving a node into view updates the bounding box of its group.
+  bounded->SetTranslation(-1000, 0, 0);
+  renderer->Render(nullptr, nullptr);
+  EXPECT_EQ(0, renderer->GetFrameStats().nodes_culled);
+  EXPECT_GT(renderer->GetFrameStats().draw_calls, 0);
+}
+
+TEST_F(DrawContextTest, ReloadIntoSharedBuffersFreesOwnBuffers) {
+  resources->SetGeometryBatching(true);
+  GeometryData small;
+  small.gl_mode = GL_TRIANGLES;
+  small.vertices = { QVector3D(0, 0, 0), QVector3D(1, 0, 0),
+    QVector3D(0, 1, 0) };
+  GeometryResource::Ptr reference = resources->MakeGeometry();
+  reference->Load(small);
+  if (reference->MemoryUsage()) {
+    GTEST_SKIP() << "Geometry batching is not supported";
+  }
+  const int64_t shared_bytes = resources->GeometryMemoryUsage();
+
+  // Too large for the shared buffers, so the geometry gets its own.
+  GeometryData large;
+  large.gl_mode = GL_POINTS;
+  large.vertices.resize(2 * 1024 * 1024);
+  GeometryResource::Ptr geometry = resources->MakeGeometry();
+  geometry->Load(large);
+  EXPECT_LT(0, geometry->MemoryUsage());
+
+  // Reloaded into the shared buffers, it only takes room in them.
+  geometry->Load(small);
+  EXPECT_EQ(0, geometry->MemoryUsage());
+  EXPECT_EQ(shared_bytes, resources->GeometryMemoryUsage());
+}
@@ -1,5 +1,7 @@
 #include "draw_group.hpp"
 
+#include "sceneview/render_queue.hpp"
+
 namespace sv {
 
 struct DrawGroup::Priv {
@@ -11,9 +13,15 @@ struct DrawGroup::Priv {
 
   bool frustum_culling = true;
 
+  bool occlusion_culling = false;
+
+  bool software_occlusion_culling = false;
+
   CameraNode* camera = nullptr;
 
   std::unordered_set<DrawNode*> nodes;
+
+  RenderQueue queue;
 };
 
 DrawGroup::~DrawGroup() {
@@ -37,6 +45,20 @@ void DrawGroup::SetFrustumCulling(bool value) { p_->frustum_culling = value; }
 
 bool DrawGroup::GetFrustumCulling() const { return p_->frustum_culling; }
 
+void DrawGroup::SetOcclusionCulling(bool value) {
+  p_->occlusion_culling = value;
+}
+
+bool DrawGroup::GetOcclusionCulling() const { return p_->occlusion_culling; }
+
+void DrawGroup::SetSoftwareOcclusionCulling(bool value) {
+  p_->software_occlusion_culling = value;
+}
+
+bool DrawGroup::GetSoftwareOcclusionCulling() const {
+  return p_->software_occlusion_culling;
+}
+
 void DrawGroup::SetCamera(CameraNode* camera) { p_->camera = camera; }
 
 CameraNode* DrawGroup::GetCamera() { return p_->camera; }
@@ -47,11 +69,21 @@ DrawGroup::DrawGroup(const QString& name, int order) : p_(new Priv()) {
 }
 
 void DrawGroup::AddNode(DrawNode* node) {
-  p_->nodes.insert(node);
+  if (p_->nodes.insert(node).second) {
+    p_->queue.Add(node);
+  }
 }
 
 void DrawGroup::RemoveNode(DrawNode* node) {
-  p_->nodes.erase(node);
+  if (p_->nodes.erase(node)) {
+    p_->queue.Remove(node);
+  }
 }
 
+void DrawGroup::NodeChanged(DrawNode* node) {
+  p_->queue.MarkDirty(node);
+}
+
+RenderQueue* DrawGroup::Queue() { return &p_->queue; }
+
 }  // namespace sv
@@ -12,6 +12,7 @@ namespace sv {
 class CameraNode;
 class Scene;
 class DrawNode;
+class RenderQueue;
 
 enum class NodeOrdering {
   /**
@@ -19,19 +20,25 @@ enum class NodeOrdering {
    */
   kNone = 0,
   /**
-   * Nodes are sorted by values returned by SceneNode::DrawOrder()
+   * Nodes are sorted by values returned by SceneNode::DrawOrder().
+   * Nodes with identical SceneNode::DrawOrder() values are grouped by
+   * shader and material.
    */
   kNodeDrawOrder = 0,
   /**
    * Nodes are first sorted by values returned by SceneNode::DrawOrder().
-   * Nodes with identical SceneNode::DrawOrder() values are sorted by depth
-   * (nodes in back are drawn first).
+   * Among nodes with identical SceneNode::DrawOrder() values, opaque nodes
+   * (see MaterialResource::Opaque()) are drawn first, grouped by shader and
+   * material. The remaining nodes are then sorted by depth (nodes in back are
+   * drawn first).
    */
   kBackToFront = 1,
   /**
    * Nodes are first sorted by values returned by SceneNode::DrawOrder().
-   * Nodes with identical SceneNode::DrawOrder() values are sorted by depth
-   * (nodes in back are drawn first).
+   * Among nodes with identical SceneNode::DrawOrder() values, opaque nodes
+   * (see MaterialResource::Opaque()) are drawn first, grouped by shader and
+   * material. The remaining nodes are then sorted by depth (nodes in front
+   * are drawn first).
    */
   kFrontToBack = 2
 };
@@ -57,6 +64,44 @@ class DrawGroup {
 
     bool GetFrustumCulling() const;
 
+    /**
+     * Enables or disables occlusion culling with hardware occlusion queries.
+     *
+     * When enabled, opaque draw nodes that were visible during the previous
+     * frame are drawn first. Nodes that were occluded during the previous
+     * frame are then tested by drawing their bounding boxes, without writing
+     * color or depth, inside an occlusion query, and are only drawn if some
+     * of the bounding box is visible. If conditional rendering is supported,
+     * then the GPU skips the draw itself without stalling the CPU. Visible
+     * nodes are tested again every few frames, using the query results of a
+     * previous frame so that the CPU never waits for them.
+     *
+     * This pays off for scenes where nearby geometry hides most of the draw
+     * nodes in view, such as building interiors and city streets. Disabled
+     * by default. Ignored if the OpenGL implementation does not support
+     * occlusion queries.
+     */
+    void SetOcclusionCulling(bool value);
+
+    bool GetOcclusionCulling() const;
+
+    /**
+     * Enables or disables software occlusion culling.
+     *
+     * When enabled, the occluders in view (see DrawNode::SetOccluder()) are
+     * rasterized on the CPU into a low resolution depth buffer, and draw
+     * nodes whose bounding box is hidden behind them are culled before any
+     * OpenGL work is done for them. Rasterization and testing run on worker
+     * threads.
+     *
+     * Unlike SetOcclusionCulling(), this never waits on the GPU and has no
+     * frame of latency, but only culls nodes hidden by occluders. The two
+     * can be combined. Disabled by default.
+     */
+    void SetSoftwareOcclusionCulling(bool value);
+
+    bool GetSoftwareOcclusionCulling() const;
+
     void SetCamera(CameraNode* camera);
 
     CameraNode* GetCamera();
@@ -64,12 +109,24 @@ class DrawGroup {
   private:
     friend class Scene;
 
+    friend class DrawNode;
+
+    friend class DrawContext;
+
     DrawGroup(const QString& name, int order);
 
     void AddNode(DrawNode* node);
 
     void RemoveNode(DrawNode* node);
 
+    /**
+     * Called by a member DrawNode when its transform, bounding box, or
+     * visibility changes.
+     */
+    void NodeChanged(DrawNode* node);
+
+    RenderQueue* Queue();
+
     class Priv;
 
     Priv* p_;
@@ -2,17 +2,29 @@
 
 #include "sceneview/draw_node.hpp"
 
+#include <cstdio>
 #include <vector>
 
+#include "sceneview/draw_group.hpp"
+#include "sceneview/object_pool.hpp"
+#include "sceneview/occlusion_buffer.hpp"
+
 namespace sv {
 
-struct DrawNode::Priv {
+struct DrawNode::Priv : PooledObject<DrawNode::Priv> {
   std::vector<Drawable::Ptr> drawables;
 
+  // Position of the node in the listeners of each drawable, so that it can
+  // be removed from them in constant time.
+  std::vector<int> listener_indices;
+
   AxisAlignedBox bounding_box;
   bool bounding_box_dirty;
 
   DrawGroup* draw_group = nullptr;
+  int render_queue_index = -1;
+
+  std::shared_ptr<const OccluderMesh> occluder;
 };
 
 DrawNode::DrawNode(const QString& name) : SceneNode(name), p_(new Priv()) {
@@ -20,8 +32,8 @@ DrawNode::DrawNode(const QString& name) : SceneNode(name), p_(new Priv()) {
 }
 
 DrawNode::~DrawNode() {
-  for (Drawable::Ptr& drawable : p_->drawables) {
-    drawable->RemoveListener(this);
+  for (size_t slot = 0; slot < p_->drawables.size(); ++slot) {
+    p_->drawables[slot]->RemoveListener(p_->listener_indices[slot]);
   }
   delete p_;
 }
@@ -32,8 +44,9 @@ void DrawNode::Add(const GeometryResource::Ptr& geometry,
 }
 
 void DrawNode::Add(const Drawable::Ptr& drawable) {
+  p_->listener_indices.push_back(
+      drawable->AddListener(this, p_->drawables.size()));
   p_->drawables.push_back(drawable);
-  drawable->AddListener(this);
   BoundingBoxChanged();
 }
 
@@ -56,6 +69,54 @@ const AxisAlignedBox& DrawNode::WorldBoundingBox() {
 void DrawNode::BoundingBoxChanged() {
   SceneNode::BoundingBoxChanged();
   p_->bounding_box_dirty = true;
+  if (p_->draw_group) {
+    p_->draw_group->NodeChanged(this);
+  }
+}
+
+void DrawNode::VisibilityChanged() {
+  const bool was_visible = EffectivelyVisible();
+  SceneNode::VisibilityChanged();
+  if (p_->draw_group && EffectivelyVisible() != was_visible) {
+    p_->draw_group->NodeChanged(this);
+  }
+}
+
+void DrawNode::SetOccluder(const GeometryData& data) {
+  if (data.gl_mode != GL_TRIANGLES) {
+    printf("SetOccluder: occluder geometry must use GL_TRIANGLES\n");
+    ClearOccluder();
+    return;
+  }
+
+  std::shared_ptr<OccluderMesh> mesh(new OccluderMesh());
+  mesh->vertices.reserve(data.vertices.size() * 3);
+  for (const QVector3D& vertex : data.vertices) {
+    mesh->vertices.push_back(vertex.x());
+    mesh->vertices.push_back(vertex.y());
+    mesh->vertices.push_back(vertex.z());
+  }
+  if (data.indices.empty()) {
+    for (size_t index = 0; index < data.vertices.size(); ++index) {
+      mesh->indices.push_back(index);
+    }
+  } else {
+    mesh->indices.assign(data.indices.begin(), data.indices.end());
+  }
+  p_->occluder = mesh;
+}
+
+void DrawNode::ClearOccluder() { p_->occluder.reset(); }
+
+bool DrawNode::IsOccluder() const { return static_cast<bool>(p_->occluder); }
+
+const std::shared_ptr<const OccluderMesh>& DrawNode::Occluder() const {
+  return p_->occluder;
+}
+
+void DrawNode::SetOccluderMesh(
+    const std::shared_ptr<const OccluderMesh>& mesh) {
+  p_->occluder = mesh;
 }
 
 DrawGroup* DrawNode::GetDrawGroup() { return p_->draw_group; }
@@ -64,4 +125,14 @@ void DrawNode::SetDrawGroup(DrawGroup* draw_group) {
   p_->draw_group = draw_group;
 }
 
+int DrawNode::RenderQueueIndex() const { return p_->render_queue_index; }
+
+void DrawNode::SetRenderQueueIndex(int index) {
+  p_->render_queue_index = index;
+}
+
+void DrawNode::SetListenerIndex(int slot, int index) {
+  p_->listener_indices[slot] = index;
+}
+
 }  // namespace sv
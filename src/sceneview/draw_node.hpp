@@ -16,6 +16,9 @@ namespace sv {
 
 class Drawable;
 class DrawGroup;
+class InstancedDrawNode;
+class LodDrawNode;
+struct OccluderMesh;
 
 /**
  * Scene node that contains a list of drawable objects.
@@ -56,19 +59,70 @@ class DrawNode : public SceneNode {
 
   const AxisAlignedBox& WorldBoundingBox() override;
 
+  /**
+   * Marks the node as an occluder for software occlusion culling. See
+   * DrawGroup::SetSoftwareOcclusionCulling().
+   *
+   * The occluder geometry is rasterized on the CPU every frame, so it
+   * should be a much simplified version of what the node draws, with few
+   * triangles. It must lie entirely inside the geometry that the node
+   * draws, or else nodes that should be visible may be culled.
+   *
+   * @param data occluder geometry in the node's frame. Must use
+   * GL_TRIANGLES. Only the vertices and indices are used. If there are no
+   * indices, then each group of three vertices forms a triangle.
+   */
+  void SetOccluder(const GeometryData& data);
+
+  /**
+   * Stops using the node as an occluder.
+   */
+  void ClearOccluder();
+
+  bool IsOccluder() const;
+
  protected:
+  explicit DrawNode(const QString& name);
+
   void BoundingBoxChanged() override;
 
+  void VisibilityChanged() override;
+
  private:
+  /**
+   * Returns this node if it is an InstancedDrawNode, or nullptr otherwise.
+   */
+  virtual InstancedDrawNode* Instanced() { return nullptr; }
+
+  /**
+   * Returns this node if it is a LodDrawNode, or nullptr otherwise.
+   */
+  virtual LodDrawNode* Lod() { return nullptr; }
+
   DrawGroup* GetDrawGroup();
 
   void SetDrawGroup(DrawGroup* draw_group);
 
+  int RenderQueueIndex() const;
+
+  void SetRenderQueueIndex(int index);
+
+  // Position of the node in the listeners of its drawable at index @p slot.
+  void SetListenerIndex(int slot, int index);
+
+  const std::shared_ptr<const OccluderMesh>& Occluder() const;
+
+  void SetOccluderMesh(const std::shared_ptr<const OccluderMesh>& mesh);
+
   friend class Scene;
 
+  friend class GroupNode;
+
   friend class Drawable;
 
-  explicit DrawNode(const QString& name);
+  friend class RenderQueue;
+
+  friend class DrawContext;
 
   struct Priv;
 
@@ -0,0 +1,40 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/draw_order_map.hpp"
+
+#include <algorithm>
+
+namespace sv {
+
+constexpr uint32_t DrawOrderMap::kMaxValue;
+
+void DrawOrderMap::Build(const std::vector<int>& draw_orders) {
+  offset_ = 0;
+  ranked_ = false;
+  if (draw_orders.empty()) {
+    return;
+  }
+  const auto min_max =
+      std::minmax_element(draw_orders.begin(), draw_orders.end());
+  offset_ = *min_max.first;
+  if (*min_max.second - offset_ <= kMaxValue) {
+    return;
+  }
+
+  ranked_ = true;
+  sorted_.assign(draw_orders.begin(), draw_orders.end());
+  std::sort(sorted_.begin(), sorted_.end());
+  sorted_.erase(std::unique(sorted_.begin(), sorted_.end()), sorted_.end());
+}
+
+uint32_t DrawOrderMap::Map(int draw_order) const {
+  if (!ranked_) {
+    return static_cast<uint32_t>(draw_order - offset_);
+  }
+  const size_t rank =
+      std::lower_bound(sorted_.begin(), sorted_.end(), draw_order) -
+      sorted_.begin();
+  return std::min<size_t>(rank, kMaxValue);
+}
+
+}  // namespace sv
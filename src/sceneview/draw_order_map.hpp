@@ -0,0 +1,47 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_DRAW_ORDER_MAP_HPP__
+#define SCENEVIEW_DRAW_ORDER_MAP_HPP__
+
+#include <cstdint>
+#include <vector>
+
+namespace sv {
+
+/**
+ * Maps the SceneNode::DrawOrder() values of the nodes being sorted to the
+ * 16-bit field that sort keys have for them, preserving their order.
+ *
+ * When the values span at most kMaxValue, they are offset by the smallest
+ * one. Otherwise, each value is replaced by its rank among the distinct
+ * values, so any set of up to kMaxValue + 1 distinct values keeps its order.
+ * Beyond that, the largest values share the last rank.
+ *
+ * Internal class, not part of the public API.
+ */
+class DrawOrderMap {
+ public:
+  static constexpr uint32_t kMaxValue = 0xffff;
+
+  /**
+   * Prepares the map for @p draw_orders, which may contain duplicates.
+   */
+  void Build(const std::vector<int>& draw_orders);
+
+  /**
+   * Maps a value that was passed to Build() into [0, kMaxValue].
+   */
+  uint32_t Map(int draw_order) const;
+
+ private:
+  int64_t offset_ = 0;
+
+  bool ranked_ = false;
+
+  // Distinct values in ascending order, when ranked_ is true.
+  std::vector<int> sorted_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_DRAW_ORDER_MAP_HPP__
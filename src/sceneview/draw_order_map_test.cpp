@@ -0,0 +1,55 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <vector>
+
+#include "sceneview/draw_order_map.hpp"
+
+using sv::DrawOrderMap;
+
+// Checks that the mapped values are in range and sort like the originals.
+static void ExpectSameOrder(const std::vector<int>& draw_orders) {
+  DrawOrderMap map;
+  map.Build(draw_orders);
+  for (int lhs : draw_orders) {
+    ASSERT_LE(map.Map(lhs), DrawOrderMap::kMaxValue);
+    for (int rhs : draw_orders) {
+      EXPECT_EQ(lhs < rhs, map.Map(lhs) < map.Map(rhs)) << lhs << " " << rhs;
+      EXPECT_EQ(lhs == rhs, map.Map(lhs) == map.Map(rhs)) << lhs << " " << rhs;
+    }
+  }
+}
+
+TEST(DrawOrderMap, SmallRange) {
+  ExpectSameOrder({ 0 });
+  ExpectSameOrder({ 3, -2, 0, 3, 7 });
+  ExpectSameOrder({ -40000, -40000 + 0xffff, -30000 });
+
+  // Offset by the smallest value.
+  DrawOrderMap map;
+  map.Build({ 100000, 100005 });
+  EXPECT_EQ(0, map.Map(100000));
+  EXPECT_EQ(5, map.Map(100005));
+}
+
+TEST(DrawOrderMap, WideRange) {
+  // Values beyond a 16-bit range used to all share the same key bits.
+  ExpectSameOrder({ -100000, 40000, 50000, 0, 40000 });
+  ExpectSameOrder({ INT_MIN, INT_MAX, 0, -1, 1 });
+  ExpectSameOrder({ 0, 0x10000 });
+}
+
+TEST(DrawOrderMap, TooManyValues) {
+  std::vector<int> draw_orders;
+  for (int ind = 0; ind < 0x20000; ++ind) {
+    draw_orders.push_back(ind * 2);
+  }
+  DrawOrderMap map;
+  map.Build(draw_orders);
+  for (int ind = 1; ind <= static_cast<int>(DrawOrderMap::kMaxValue); ++ind) {
+    ASSERT_LT(map.Map(draw_orders[ind - 1]), map.Map(draw_orders[ind]));
+  }
+  EXPECT_EQ(DrawOrderMap::kMaxValue, map.Map(draw_orders.back()));
+}
@@ -1,11 +1,19 @@
 #include "drawable.hpp"
 
+#include <vector>
+
 #include "sceneview/draw_node.hpp"
 
 namespace sv {
 
 struct Drawable::Priv {
-  std::vector<DrawNode*> listeners;
+  // Draw nodes that hold the drawable, and the index of the drawable in each
+  // node's drawables.
+  struct Listener {
+    DrawNode* node;
+    int slot;
+  };
+  std::vector<Listener> listeners;
 
   GeometryResource::Ptr geometry;
   MaterialResource::Ptr material;
@@ -37,8 +45,8 @@ void Drawable::SetMaterial(const MaterialResource::Ptr& material) {
 }
 
 void Drawable::BoundingBoxChanged() {
-  for (DrawNode* listener : p_->listeners) {
-    listener->BoundingBoxChanged();
+  for (const Priv::Listener& listener : p_->listeners) {
+    listener.node->BoundingBoxChanged();
   }
 }
 
@@ -46,14 +54,18 @@ const AxisAlignedBox& Drawable::BoundingBox() {
   return p_->geometry->BoundingBox();
 }
 
-void Drawable::AddListener(DrawNode* listener) {
-  p_->listeners.push_back(listener);
+int Drawable::AddListener(DrawNode* listener, int slot) {
+  p_->listeners.push_back({ listener, slot });
+  return p_->listeners.size() - 1;
 }
 
-void Drawable::RemoveListener(DrawNode* listener) {
-  auto iter = std::find(p_->listeners.begin(), p_->listeners.end(), listener);
-  if (iter != p_->listeners.end()) {
-    p_->listeners.erase(iter);
+void Drawable::RemoveListener(int index) {
+  // Move the last listener into the hole, and tell its node where it went.
+  const Priv::Listener last = p_->listeners.back();
+  p_->listeners.pop_back();
+  if (index < static_cast<int>(p_->listeners.size())) {
+    p_->listeners[index] = last;
+    last.node->SetListenerIndex(last.slot, index);
   }
 }
 
@@ -54,6 +54,10 @@ class Drawable {
      * If this method returns true (the default), then the render engine
      * draws the referenced geometry. If it returns false, then geometry
      * rendering is skipped.
+     *
+     * The render engine keeps track of OpenGL state to skip redundant calls,
+     * so any state changed here (bound program, buffers, textures, or
+     * material settings) must be restored by PostDraw().
      */
     virtual bool PreDraw() { return true; }
 
@@ -66,6 +70,13 @@ class Drawable {
     /**
      * Called by the render engine to determine the axis-aligned bounding box
      * of the Drawable, in the Drawable's own coordinate frame.
+     *
+     * The render engine computes bounding boxes on worker threads, so this
+     * may be called concurrently, including on the same Drawable when it is
+     * shared by several nodes, and without a current OpenGL context.
+     * Overrides must only read state. To change the bounding box, update it
+     * outside of rendering, for example in Renderer::RenderBegin(), and call
+     * BoundingBoxChanged().
      */
     virtual const AxisAlignedBox& BoundingBox();
 
@@ -83,9 +94,11 @@ class Drawable {
 
     friend class GeometryResource;
 
-    void AddListener(DrawNode* listener);
+    // Adds @p listener for its drawable at index @p slot, and returns the
+    // position of the listener, to pass to RemoveListener().
+    int AddListener(DrawNode* listener, int slot);
 
-    void RemoveListener(DrawNode* listener);
+    void RemoveListener(int index);
 
     class Priv;
 
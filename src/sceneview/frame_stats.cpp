@@ -0,0 +1,86 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/frame_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace sv {
+
+constexpr int FrameStatsHistory::kDefaultCapacity;
+
+FrameStatsHistory::FrameStatsHistory(int capacity) :
+  frames_(std::max(capacity, 1)) {}
+
+void FrameStatsHistory::Add(const FrameStats& stats) {
+  const int capacity = Capacity();
+  if (size_ < capacity) {
+    frames_[(first_ + size_) % capacity] = stats;
+    size_++;
+  } else {
+    // Assigning over the oldest frame reuses the memory of its vectors.
+    frames_[first_] = stats;
+    first_ = (first_ + 1) % capacity;
+  }
+}
+
+const FrameStats& FrameStatsHistory::At(int index) const {
+  if (index < 0 || index >= size_) {
+    throw std::invalid_argument("Invalid frame index");
+  }
+  return frames_[(first_ + index) % Capacity()];
+}
+
+FrameStats* FrameStatsHistory::Find(uint64_t frame_number) {
+  if (!size_) {
+    return nullptr;
+  }
+  // Frames are usually added in order, so look up the frame by its offset
+  // from the oldest one first.
+  const uint64_t oldest = At(0).frame_number;
+  if (frame_number >= oldest && frame_number - oldest < uint64_t(size_)) {
+    FrameStats& frame =
+        frames_[(first_ + (frame_number - oldest)) % Capacity()];
+    if (frame.frame_number == frame_number) {
+      return &frame;
+    }
+  }
+  for (int index = 0; index < size_; ++index) {
+    FrameStats& frame = frames_[(first_ + index) % Capacity()];
+    if (frame.frame_number == frame_number) {
+      return &frame;
+    }
+  }
+  return nullptr;
+}
+
+double FrameStatsHistory::Percentile(double percentile,
+    const std::function<double(const FrameStats&)>& value) const {
+  std::vector<double> values;
+  values.reserve(size_);
+  for (int index = 0; index < size_; ++index) {
+    const double frame_value = value(At(index));
+    if (frame_value >= 0) {
+      values.push_back(frame_value);
+    }
+  }
+  if (values.empty()) {
+    return -1;
+  }
+
+  // Nearest rank.
+  const double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100;
+  const int rank = std::max(
+      static_cast<int>(std::ceil(fraction * values.size())), 1);
+  std::nth_element(values.begin(), values.begin() + rank - 1, values.end());
+  return values[rank - 1];
+}
+
+void FrameStatsHistory::Clear() {
+  first_ = 0;
+  size_ = 0;
+}
+
+}  // namespace sv
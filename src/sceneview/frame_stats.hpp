@@ -0,0 +1,224 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_FRAME_STATS_HPP__
+#define SCENEVIEW_FRAME_STATS_HPP__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <QString>
+
+namespace sv {
+
+/**
+ * Time spent in a Renderer during a frame.
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/frame_stats.hpp
+ */
+struct RendererStats {
+  QString name;
+
+  /**
+   * CPU time spent in Renderer::RenderBegin(), in milliseconds.
+   */
+  double begin_ms = 0;
+
+  /**
+   * CPU time spent in Renderer::RenderEnd(), in milliseconds.
+   */
+  double end_ms = 0;
+};
+
+/**
+ * Time spent and work done drawing a DrawGroup during a frame.
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/frame_stats.hpp
+ */
+struct DrawGroupStats {
+  QString name;
+
+  /**
+   * CPU time spent bringing the render queue up to date, culling nodes, and
+   * selecting levels of detail, in milliseconds.
+   */
+  double cull_ms = 0;
+
+  /**
+   * CPU time spent computing sort keys and sorting nodes, in milliseconds.
+   */
+  double sort_ms = 0;
+
+  /**
+   * CPU time spent issuing OpenGL commands for the nodes, in milliseconds.
+   */
+  double submit_ms = 0;
+
+  /**
+   * GPU time spent executing the group's commands, in milliseconds,
+   * measured with a timer query.
+   *
+   * Query results are read back without waiting, usually a few frames
+   * later, so this is negative until the result is available. It is always
+   * negative if timer queries are not supported.
+   */
+  double gpu_ms = -1;
+
+  /**
+   * Number of draw nodes in the group.
+   */
+  int nodes_considered = 0;
+
+  /**
+   * Number of draw nodes skipped because they are hidden, outside of the
+   * view, or too small for any of their levels of detail.
+   */
+  int nodes_culled = 0;
+
+  /**
+   * Number of draw nodes skipped by occlusion culling. Nodes drawn with
+   * conditional rendering are counted both here and as drawn.
+   */
+  int nodes_occluded = 0;
+
+  /**
+   * Number of draw nodes submitted for drawing.
+   */
+  int nodes_drawn = 0;
+
+  int draw_calls = 0;
+
+  /**
+   * Number of triangles submitted, counting each instance separately.
+   */
+  int64_t triangles = 0;
+};
+
+/**
+ * Statistics of a single frame drawn by a Viewport.
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/frame_stats.hpp
+ */
+struct FrameStats {
+  /**
+   * Sequence number of the frame. The first frame is 1.
+   */
+  uint64_t frame_number = 0;
+
+  /**
+   * CPU time spent drawing the frame, including the renderers, in
+   * milliseconds.
+   */
+  double cpu_ms = 0;
+
+  /**
+   * CPU time spent bringing the world transforms and bounding boxes of the
+   * scene graph up to date before culling, in milliseconds. Included in
+   * cpu_ms.
+   */
+  double update_ms = 0;
+
+  /**
+   * Total GPU time of the draw groups, in milliseconds. Negative until the
+   * GPU time of every draw group is available.
+   */
+  double gpu_ms = -1;
+
+  std::vector<RendererStats> renderers;
+
+  std::vector<DrawGroupStats> draw_groups;
+
+  /**
+   * Totals over all draw groups.
+   */
+  int nodes_considered = 0;
+  int nodes_culled = 0;
+  int nodes_occluded = 0;
+  int nodes_drawn = 0;
+  int draw_calls = 0;
+  int64_t triangles = 0;
+
+  /**
+   * Number of OpenGL state changes issued while drawing the draw groups.
+   */
+  int state_changes = 0;
+
+  /**
+   * Number of OpenGL state changes skipped while drawing the draw groups,
+   * because they would not have changed anything.
+   */
+  int state_changes_skipped = 0;
+
+  /**
+   * Number of bytes uploaded to OpenGL buffer objects since the previous
+   * frame, including geometry loaded by renderers.
+   */
+  int64_t bytes_uploaded = 0;
+};
+
+/**
+ * Rolling history of the most recent frames.
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/frame_stats.hpp
+ */
+class FrameStatsHistory {
+  public:
+    static constexpr int kDefaultCapacity = 300;
+
+    explicit FrameStatsHistory(int capacity = kDefaultCapacity);
+
+    int Capacity() const { return frames_.size(); }
+
+    /**
+     * Number of frames in the history, up to the capacity.
+     */
+    int Size() const { return size_; }
+
+    /**
+     * Adds a frame, replacing the oldest one if the history is full.
+     */
+    void Add(const FrameStats& stats);
+
+    /**
+     * Retrieves a frame. Index 0 is the oldest frame, and Size() - 1 the
+     * most recent one.
+     */
+    const FrameStats& At(int index) const;
+
+    /**
+     * Retrieves a frame by frame number, or nullptr if it is not in the
+     * history.
+     */
+    FrameStats* Find(uint64_t frame_number);
+
+    /**
+     * Computes a percentile of a value over the frames in the history.
+     *
+     * @param percentile in [0, 100].
+     * @param value extracts the value from a frame. Negative values are
+     * treated as unknown, and skipped.
+     *
+     * @return the smallest value that is at least as large as the given
+     * percentage of the values, or -1 if there are no values.
+     */
+    double Percentile(double percentile,
+        const std::function<double(const FrameStats&)>& value) const;
+
+    void Clear();
+
+  private:
+    std::vector<FrameStats> frames_;
+
+    // Index of the oldest frame in frames_.
+    int first_ = 0;
+
+    int size_ = 0;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_FRAME_STATS_HPP__
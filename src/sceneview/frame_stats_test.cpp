@@ -0,0 +1,69 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include "sceneview/frame_stats.hpp"
+
+using sv::FrameStats;
+using sv::FrameStatsHistory;
+
+static FrameStats MakeFrame(uint64_t frame_number, double cpu_ms) {
+  FrameStats stats;
+  stats.frame_number = frame_number;
+  stats.cpu_ms = cpu_ms;
+  return stats;
+}
+
+static double CpuTime(const FrameStats& stats) { return stats.cpu_ms; }
+
+static double GpuTime(const FrameStats& stats) { return stats.gpu_ms; }
+
+TEST(FrameStatsHistory, Empty) {
+  FrameStatsHistory history(4);
+  EXPECT_EQ(4, history.Capacity());
+  EXPECT_EQ(0, history.Size());
+  EXPECT_EQ(nullptr, history.Find(0));
+  EXPECT_EQ(-1, history.Percentile(50, CpuTime));
+  EXPECT_THROW(history.At(0), std::invalid_argument);
+}
+
+TEST(FrameStatsHistory, Rolling) {
+  FrameStatsHistory history(4);
+  for (int frame = 0; frame < 6; ++frame) {
+    history.Add(MakeFrame(frame, frame));
+  }
+  ASSERT_EQ(4, history.Size());
+  for (int index = 0; index < 4; ++index) {
+    EXPECT_EQ(index + 2, history.At(index).frame_number);
+  }
+
+  EXPECT_EQ(nullptr, history.Find(1));
+  ASSERT_NE(nullptr, history.Find(3));
+  EXPECT_EQ(3, history.Find(3)->cpu_ms);
+  history.Find(3)->gpu_ms = 2;
+  EXPECT_EQ(2, history.At(1).gpu_ms);
+
+  history.Clear();
+  EXPECT_EQ(0, history.Size());
+  history.Add(MakeFrame(10, 1));
+  EXPECT_EQ(10, history.At(0).frame_number);
+}
+
+TEST(FrameStatsHistory, Percentile) {
+  FrameStatsHistory history(100);
+  for (int frame = 0; frame < 100; ++frame) {
+    // Frame times 1 to 100, added out of order.
+    history.Add(MakeFrame(frame, (frame * 37) % 100 + 1));
+  }
+  EXPECT_EQ(1, history.Percentile(0, CpuTime));
+  EXPECT_EQ(50, history.Percentile(50, CpuTime));
+  EXPECT_EQ(95, history.Percentile(95, CpuTime));
+  EXPECT_EQ(99, history.Percentile(99, CpuTime));
+  EXPECT_EQ(100, history.Percentile(100, CpuTime));
+
+  // Unknown GPU times are skipped.
+  history.Find(10)->gpu_ms = 4;
+  history.Find(20)->gpu_ms = 8;
+  EXPECT_EQ(4, history.Percentile(50, GpuTime));
+  EXPECT_EQ(8, history.Percentile(90, GpuTime));
+}
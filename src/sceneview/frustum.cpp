@@ -0,0 +1,452 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "sceneview/camera_node.hpp"
+
+namespace sv {
+
+// Number of boxes tested at once by Frustum::CullBatch().
+#if defined(__AVX2__)
+static constexpr int kBatchSize = 8;
+#else
+static constexpr int kBatchSize = 4;
+#endif
+
+// Number of arrays in a batch: center x, y, z, extent x, y, z, and radius.
+static constexpr int kNumBatchArrays = 7;
+
+BoxArray::BoxArray() {}
+
+void BoxArray::Clear() {
+  center_x_.clear();
+  center_y_.clear();
+  center_z_.clear();
+  extent_x_.clear();
+  extent_y_.clear();
+  extent_z_.clear();
+  radius_.clear();
+}
+
+void BoxArray::Reserve(int num_boxes) {
+  center_x_.reserve(num_boxes);
+  center_y_.reserve(num_boxes);
+  center_z_.reserve(num_boxes);
+  extent_x_.reserve(num_boxes);
+  extent_y_.reserve(num_boxes);
+  extent_z_.reserve(num_boxes);
+  radius_.reserve(num_boxes);
+}
+
+void BoxArray::Add(const AxisAlignedBox& box) {
+  center_x_.push_back(0);
+  center_y_.push_back(0);
+  center_z_.push_back(0);
+  extent_x_.push_back(0);
+  extent_y_.push_back(0);
+  extent_z_.push_back(0);
+  radius_.push_back(0);
+  Set(Size() - 1, box);
+}
+
+void BoxArray::Set(int index, const AxisAlignedBox& box) {
+  if (!box.Valid()) {
+    const float huge = std::numeric_limits<float>::max();
+    center_x_[index] = 0;
+    center_y_[index] = 0;
+    center_z_[index] = 0;
+    extent_x_[index] = huge;
+    extent_y_[index] = huge;
+    extent_z_[index] = huge;
+    radius_[index] = huge;
+    return;
+  }
+  const QVector3D center = (box.Max() + box.Min()) / 2;
+  const QVector3D extent = (box.Max() - box.Min()) / 2;
+  center_x_[index] = center.x();
+  center_y_[index] = center.y();
+  center_z_[index] = center.z();
+  extent_x_[index] = extent.x();
+  extent_y_[index] = extent.y();
+  extent_z_[index] = extent.z();
+  radius_[index] = extent.length();
+}
+
+void BoxArray::SwapRemove(int index) {
+  const int last = Size() - 1;
+  center_x_[index] = center_x_[last];
+  center_y_[index] = center_y_[last];
+  center_z_[index] = center_z_[last];
+  extent_x_[index] = extent_x_[last];
+  extent_y_[index] = extent_y_[last];
+  extent_z_[index] = extent_z_[last];
+  radius_[index] = radius_[last];
+  center_x_.pop_back();
+  center_y_.pop_back();
+  center_z_.pop_back();
+  extent_x_.pop_back();
+  extent_y_.pop_back();
+  extent_z_.pop_back();
+  radius_.pop_back();
+}
+
+Frustum::Frustum(CameraNode* camera) {
+  // Compute the frustum planes
+  QSize viewport_size = camera->GetViewportSize();
+  const int x1 = viewport_size.width();
+  const int y1 = viewport_size.height();
+
+  QVector3D top_left_start;
+  QVector3D bot_left_start;
+  QVector3D top_right_start;
+  QVector3D bot_right_start;
+
+  QVector3D top_left_end = camera->Unproject(0, 0, 1);
+  QVector3D bot_left_end = camera->Unproject(0, y1, 1);
+  QVector3D top_right_end = camera->Unproject(x1, 0, 1);
+  QVector3D bot_right_end = camera->Unproject(x1, y1, 1);
+
+  if (camera->GetProjectionType() == sv::CameraNode::kOrthographic) {
+    top_left_start = camera->Unproject(0, 0, 0);
+    bot_left_start = camera->Unproject(0, y1, 0);
+    top_right_start = camera->Unproject(x1, 0, 0);
+    bot_right_start = camera->Unproject(x1, y1, 0);
+  } else {
+    const QVector3D eye = camera->WorldTransform().map(QVector3D(0, 0, 0));
+    top_left_start = eye;
+    bot_left_start = eye;
+    top_right_start = eye;
+    bot_right_start = eye;
+  }
+
+  const QVector3D top_left_dir = (top_left_end - top_left_start).normalized();
+  const QVector3D bot_left_dir = (bot_left_end - bot_left_start).normalized();
+  const QVector3D top_right_dir = (top_right_end - top_right_start).normalized();
+  const QVector3D bot_right_dir = (bot_right_end - bot_right_start).normalized();
+
+  const double near = camera->GetZNear();
+  const double far = camera->GetZFar();
+
+  const QVector3D ntl = top_left_start + near * top_left_dir;
+  const QVector3D ntr = top_right_start + near * top_right_dir;
+  const QVector3D nbl = bot_left_start + near * bot_left_dir;
+  const QVector3D nbr = bot_right_start + near * bot_right_dir;
+  const QVector3D ftl = top_left_start + far * top_left_dir;
+  const QVector3D ftr = top_right_start + far * top_right_dir;
+  const QVector3D fbl = bot_left_start + far * bot_left_dir;
+  const QVector3D fbr = bot_right_start + far * bot_right_dir;
+
+  planes_[0] = Plane::FromThreePoints(ntr, ftl, ftr);  // top
+  planes_[1] = Plane::FromThreePoints(nbr, fbr, fbl);  // bottom
+  planes_[2] = Plane::FromThreePoints(ntl, nbl, fbl);  // left
+  planes_[3] = Plane::FromThreePoints(ntr, fbr, nbr);  // right
+  planes_[4] = Plane::FromThreePoints(ntl, ntr, nbr);  // near
+  planes_[5] = Plane::FromThreePoints(ftl, fbr, ftr);  // far
+  ComputePlaneData();
+}
+
+Frustum::Frustum(const Plane* planes) {
+  for (int plane_ind = 0; plane_ind < kNumPlanes; ++plane_ind) {
+    planes_[plane_ind] = planes[plane_ind];
+  }
+  ComputePlaneData();
+}
+
+void Frustum::ComputePlaneData() {
+  for (int plane_ind = 0; plane_ind < kNumPlanes; ++plane_ind) {
+    const QVector3D& normal = planes_[plane_ind].Normal();
+    normal_x_[plane_ind] = normal.x();
+    normal_y_[plane_ind] = normal.y();
+    normal_z_[plane_ind] = normal.z();
+    d_[plane_ind] = planes_[plane_ind].D();
+    abs_normal_x_[plane_ind] = std::fabs(normal.x());
+    abs_normal_y_[plane_ind] = std::fabs(normal.y());
+    abs_normal_z_[plane_ind] = std::fabs(normal.z());
+  }
+}
+
+bool Frustum::Intersects(const AxisAlignedBox& box) const {
+  const QVector3D& bmin = box.Min();
+  const QVector3D& bmax = box.Max();
+  for (const Plane& plane : planes_) {
+    const QVector3D& normal = plane.Normal();
+    const QVector3D test_point(normal.x() > 0 ? bmax.x() : bmin.x(),
+                               normal.y() > 0 ? bmax.y() : bmin.y(),
+                               normal.z() > 0 ? bmax.z() : bmin.z());
+    if (plane.SignedDistance(test_point) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::Intersects(const AxisAlignedBox& box,
+    uint32_t* plane_mask) const {
+  const QVector3D& bmin = box.Min();
+  const QVector3D& bmax = box.Max();
+  for (int plane_ind = 0; plane_ind < kNumPlanes; ++plane_ind) {
+    const uint32_t plane_bit = 1 << plane_ind;
+    if (!(*plane_mask & plane_bit)) {
+      continue;
+    }
+    const Plane& plane = planes_[plane_ind];
+    const QVector3D& normal = plane.Normal();
+
+    // Corner of the box furthest along the plane normal.
+    const QVector3D p_vertex(normal.x() > 0 ? bmax.x() : bmin.x(),
+                             normal.y() > 0 ? bmax.y() : bmin.y(),
+                             normal.z() > 0 ? bmax.z() : bmin.z());
+    if (plane.SignedDistance(p_vertex) < 0) {
+      return false;
+    }
+
+    // Corner of the box furthest against the plane normal.
+    const QVector3D n_vertex(normal.x() > 0 ? bmin.x() : bmax.x(),
+                             normal.y() > 0 ? bmin.y() : bmax.y(),
+                             normal.z() > 0 ? bmin.z() : bmax.z());
+    if (plane.SignedDistance(n_vertex) >= 0) {
+      *plane_mask &= ~plane_bit;
+    }
+  }
+  return true;
+}
+
+// Tests kBatchSize boxes against the planes in plane_mask. batch holds
+// kNumBatchArrays pointers to the box data, in the same order as the BoxArray
+// accessors.
+//
+// For each plane with normal n and offset d, a box with center c and
+// half-extents e is outside if n.c + d + |n|.e < 0. A bounding sphere of
+// radius r is outside if n.c + d < -r, and inside if n.c + d >= r.
+//
+// Returns a bit mask with one bit set for each box that is not outside.
+#if defined(__AVX2__)
+
+uint32_t Frustum::CullBatch(const float* const* batch, uint32_t plane_mask,
+    bool sphere_pretest) const {
+  const __m256 center_x = _mm256_loadu_ps(batch[0]);
+  const __m256 center_y = _mm256_loadu_ps(batch[1]);
+  const __m256 center_z = _mm256_loadu_ps(batch[2]);
+  const __m256 extent_x = _mm256_loadu_ps(batch[3]);
+  const __m256 extent_y = _mm256_loadu_ps(batch[4]);
+  const __m256 extent_z = _mm256_loadu_ps(batch[5]);
+  const __m256 radius = _mm256_loadu_ps(batch[6]);
+  const __m256 neg_radius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+  const __m256 zero = _mm256_setzero_ps();
+  constexpr int kAllLanes = (1 << kBatchSize) - 1;
+
+  __m256 outside = _mm256_setzero_ps();
+  for (int plane_ind = 0; plane_ind < kNumPlanes; ++plane_ind) {
+    if (!(plane_mask & (1 << plane_ind))) {
+      continue;
+    }
+    const __m256 dist = _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_mul_ps(_mm256_set1_ps(normal_x_[plane_ind]), center_x),
+          _mm256_mul_ps(_mm256_set1_ps(normal_y_[plane_ind]), center_y)),
+        _mm256_add_ps(
+          _mm256_mul_ps(_mm256_set1_ps(normal_z_[plane_ind]), center_z),
+          _mm256_set1_ps(d_[plane_ind])));
+
+    if (sphere_pretest) {
+      outside = _mm256_or_ps(outside,
+          _mm256_cmp_ps(dist, neg_radius, _CMP_LT_OQ));
+      const __m256 straddling = _mm256_andnot_ps(outside,
+          _mm256_cmp_ps(dist, radius, _CMP_LT_OQ));
+      if (!_mm256_movemask_ps(straddling)) {
+        if (_mm256_movemask_ps(outside) == kAllLanes) {
+          return 0;
+        }
+        continue;
+      }
+    }
+
+    const __m256 reach = _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_mul_ps(_mm256_set1_ps(abs_normal_x_[plane_ind]), extent_x),
+          _mm256_mul_ps(_mm256_set1_ps(abs_normal_y_[plane_ind]), extent_y)),
+        _mm256_mul_ps(_mm256_set1_ps(abs_normal_z_[plane_ind]), extent_z));
+    outside = _mm256_or_ps(outside,
+        _mm256_cmp_ps(_mm256_add_ps(dist, reach), zero, _CMP_LT_OQ));
+    if (_mm256_movemask_ps(outside) == kAllLanes) {
+      return 0;
+    }
+  }
+  return ~_mm256_movemask_ps(outside) & kAllLanes;
+}
+
+#elif defined(__SSE2__)
+
+uint32_t Frustum::CullBatch(const float* const* batch, uint32_t plane_mask,
+    bool sphere_pretest) const {
+  const __m128 center_x = _mm_loadu_ps(batch[0]);
+  const __m128 center_y = _mm_loadu_ps(batch[1]);
+  const __m128 center_z = _mm_loadu_ps(batch[2]);
+  const __m128 extent_x = _mm_loadu_ps(batch[3]);
+  const __m128 extent_y = _mm_loadu_ps(batch[4]);
+  const __m128 extent_z = _mm_loadu_ps(batch[5]);
+  const __m128 radius = _mm_loadu_ps(batch[6]);
+  const __m128 neg_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+  const __m128 zero = _mm_setzero_ps();
+  constexpr int kAllLanes = (1 << kBatchSize) - 1;
+
+  __m128 outside = _mm_setzero_ps();
+  for (int plane_ind = 0; plane_ind < kNumPlanes; ++plane_ind) {
+    if (!(plane_mask & (1 << plane_ind))) {
+      continue;
+    }
+    const __m128 dist = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(normal_x_[plane_ind]), center_x),
+                   _mm_mul_ps(_mm_set1_ps(normal_y_[plane_ind]), center_y)),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(normal_z_[plane_ind]), center_z),
+                   _mm_set1_ps(d_[plane_ind])));
+
+    if (sphere_pretest) {
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, neg_radius));
+      const __m128 straddling =
+          _mm_andnot_ps(outside, _mm_cmplt_ps(dist, radius));
+      if (!_mm_movemask_ps(straddling)) {
+        if (_mm_movemask_ps(outside) == kAllLanes) {
+          return 0;
+        }
+        continue;
+      }
+    }
+
+    const __m128 reach = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs_normal_x_[plane_ind]), extent_x),
+                   _mm_mul_ps(_mm_set1_ps(abs_normal_y_[plane_ind]), extent_y)),
+        _mm_mul_ps(_mm_set1_ps(abs_normal_z_[plane_ind]), extent_z));
+    outside = _mm_or_ps(outside,
+        _mm_cmplt_ps(_mm_add_ps(dist, reach), zero));
+    if (_mm_movemask_ps(outside) == kAllLanes) {
+      return 0;
+    }
+  }
+  return ~_mm_movemask_ps(outside) & kAllLanes;
+}
+
+#else
+
+uint32_t Frustum::CullBatch(const float* const* batch, uint32_t plane_mask,
+    bool sphere_pretest) const {
+  uint32_t result = 0;
+  for (int lane = 0; lane < kBatchSize; ++lane) {
+    const float center_x = batch[0][lane];
+    const float center_y = batch[1][lane];
+    const float center_z = batch[2][lane];
+    const float radius = batch[6][lane];
+    bool outside = false;
+    for (int plane_ind = 0; plane_ind < kNumPlanes && !outside; ++plane_ind) {
+      if (!(plane_mask & (1 << plane_ind))) {
+        continue;
+      }
+      const float dist = normal_x_[plane_ind] * center_x +
+                         normal_y_[plane_ind] * center_y +
+                         normal_z_[plane_ind] * center_z + d_[plane_ind];
+      if (sphere_pretest) {
+        if (dist < -radius) {
+          outside = true;
+          break;
+        }
+        if (!(dist < radius)) {
+          continue;
+        }
+      }
+      const float reach = abs_normal_x_[plane_ind] * batch[3][lane] +
+                          abs_normal_y_[plane_ind] * batch[4][lane] +
+                          abs_normal_z_[plane_ind] * batch[5][lane];
+      outside = dist + reach < 0;
+    }
+    if (!outside) {
+      result |= 1 << lane;
+    }
+  }
+  return result;
+}
+
+#endif
+
+static void AppendVisible(uint32_t lanes, const uint32_t* indices,
+    std::vector<uint32_t>* visible) {
+  for (int lane = 0; lanes; ++lane, lanes >>= 1) {
+    if (lanes & 1) {
+      visible->push_back(indices[lane]);
+    }
+  }
+}
+
+void Frustum::CullBoxes(const BoxArray& boxes, uint32_t plane_mask,
+    bool sphere_pretest, std::vector<uint32_t>* visible) const {
+  const int num_boxes = boxes.Size();
+  const float* const arrays[kNumBatchArrays] = {
+    boxes.CenterX(), boxes.CenterY(), boxes.CenterZ(),
+    boxes.ExtentX(), boxes.ExtentY(), boxes.ExtentZ(), boxes.Radius() };
+
+  uint32_t indices[kBatchSize];
+  int start = 0;
+  for (; start + kBatchSize <= num_boxes; start += kBatchSize) {
+    const float* batch[kNumBatchArrays];
+    for (int array = 0; array < kNumBatchArrays; ++array) {
+      batch[array] = arrays[array] + start;
+    }
+    const uint32_t lanes = CullBatch(batch, plane_mask, sphere_pretest);
+    if (lanes) {
+      for (int lane = 0; lane < kBatchSize; ++lane) {
+        indices[lane] = start + lane;
+      }
+      AppendVisible(lanes, indices, visible);
+    }
+  }
+
+  // Copy the remaining boxes into a zero-padded batch.
+  const int num_remaining = num_boxes - start;
+  if (num_remaining > 0) {
+    for (int lane = 0; lane < num_remaining; ++lane) {
+      indices[lane] = start + lane;
+    }
+    CullBoxes(boxes, indices, num_remaining, plane_mask, sphere_pretest,
+        visible);
+  }
+}
+
+void Frustum::CullBoxes(const BoxArray& boxes, const uint32_t* indices,
+    int num_indices, uint32_t plane_mask, bool sphere_pretest,
+    std::vector<uint32_t>* visible) const {
+  const float* const arrays[kNumBatchArrays] = {
+    boxes.CenterX(), boxes.CenterY(), boxes.CenterZ(),
+    boxes.ExtentX(), boxes.ExtentY(), boxes.ExtentZ(), boxes.Radius() };
+
+  float data[kNumBatchArrays][kBatchSize];
+  const float* batch[kNumBatchArrays];
+  for (int array = 0; array < kNumBatchArrays; ++array) {
+    batch[array] = data[array];
+  }
+
+  for (int start = 0; start < num_indices; start += kBatchSize) {
+    const int count = std::min(kBatchSize, num_indices - start);
+    for (int array = 0; array < kNumBatchArrays; ++array) {
+      for (int lane = 0; lane < count; ++lane) {
+        data[array][lane] = arrays[array][indices[start + lane]];
+      }
+      for (int lane = count; lane < kBatchSize; ++lane) {
+        data[array][lane] = 0;
+      }
+    }
+    const uint32_t lanes = CullBatch(batch, plane_mask, sphere_pretest) &
+        ((1u << count) - 1);
+    AppendVisible(lanes, indices + start, visible);
+  }
+}
+
+}  // namespace sv
@@ -0,0 +1,166 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_FRUSTUM_HPP__
+#define SCENEVIEW_FRUSTUM_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include "sceneview/axis_aligned_box.hpp"
+#include "sceneview/plane.hpp"
+
+namespace sv {
+
+class CameraNode;
+
+/**
+ * A list of axis-aligned boxes stored in structure-of-arrays form for batched
+ * view frustum culling.
+ *
+ * Each box is stored as a center point, a half-extent vector, and the radius
+ * of its bounding sphere. Invalid boxes are stored as very large boxes so that
+ * they are never culled.
+ *
+ * Internal class, not part of the public API.
+ */
+class BoxArray {
+ public:
+  BoxArray();
+
+  /**
+   * Removes all boxes.
+   */
+  void Clear();
+
+  void Reserve(int num_boxes);
+
+  /**
+   * Appends a box to the end of the array.
+   */
+  void Add(const AxisAlignedBox& box);
+
+  /**
+   * Replaces the box at the specified index.
+   */
+  void Set(int index, const AxisAlignedBox& box);
+
+  /**
+   * Moves the last box to @p index and shrinks the array by one.
+   */
+  void SwapRemove(int index);
+
+  int Size() const { return center_x_.size(); }
+
+  const float* CenterX() const { return center_x_.data(); }
+  const float* CenterY() const { return center_y_.data(); }
+  const float* CenterZ() const { return center_z_.data(); }
+  const float* ExtentX() const { return extent_x_.data(); }
+  const float* ExtentY() const { return extent_y_.data(); }
+  const float* ExtentZ() const { return extent_z_.data(); }
+  const float* Radius() const { return radius_.data(); }
+
+ private:
+  std::vector<float> center_x_;
+  std::vector<float> center_y_;
+  std::vector<float> center_z_;
+  std::vector<float> extent_x_;
+  std::vector<float> extent_y_;
+  std::vector<float> extent_z_;
+  std::vector<float> radius_;
+};
+
+/**
+ * A view frustum, used for view frustum culling.
+ *
+ * The frustum is represented by six planes whose normals point into the
+ * frustum.
+ *
+ * Internal class, not part of the public API.
+ */
+class Frustum {
+ public:
+  static constexpr int kNumPlanes = 6;
+
+  /**
+   * Bit mask with one bit set for each of the frustum planes.
+   */
+  static constexpr uint32_t kAllPlanes = (1 << kNumPlanes) - 1;
+
+  /**
+   * Constructs the view frustum of a camera.
+   */
+  explicit Frustum(CameraNode* camera);
+
+  /**
+   * Constructs a frustum from six planes, in the order top, bottom, left,
+   * right, near, far.
+   */
+  explicit Frustum(const Plane* planes);
+
+  const Plane& GetPlane(int index) const { return planes_[index]; }
+
+  /**
+   * Checks if a box intersects or is contained by the frustum.
+   */
+  bool Intersects(const AxisAlignedBox& box) const;
+
+  /**
+   * Tests a box against the planes selected by @p plane_mask.
+   *
+   * On return, bits are cleared from @p plane_mask for each plane that the box
+   * is entirely inside of. Boxes contained in @p box do not need to be tested
+   * against those planes.
+   *
+   * @return false if the box is outside the frustum.
+   */
+  bool Intersects(const AxisAlignedBox& box, uint32_t* plane_mask) const;
+
+  /**
+   * Tests many boxes against the frustum at once.
+   *
+   * Boxes are tested 8 at a time with AVX2 or 4 at a time with SSE2,
+   * depending on the instruction sets enabled at compile time, with a scalar
+   * fallback otherwise.
+   *
+   * @param boxes the boxes to test.
+   * @param plane_mask only planes whose bit is set are tested.
+   * @param sphere_pretest if true, boxes are first tested against each plane
+   *        using their bounding spheres, and the box test for a plane is
+   *        skipped when the spheres alone decide it. This is faster when most
+   *        boxes are either well inside or well outside the frustum.
+   * @param visible the indices of boxes that intersect the frustum are
+   *        appended to this vector, in increasing order.
+   */
+  void CullBoxes(const BoxArray& boxes, uint32_t plane_mask,
+      bool sphere_pretest, std::vector<uint32_t>* visible) const;
+
+  /**
+   * Same as above, but only tests the boxes whose indices are listed in
+   * @p indices. The indices that pass are appended to @p visible in the order
+   * they are listed.
+   */
+  void CullBoxes(const BoxArray& boxes, const uint32_t* indices,
+      int num_indices, uint32_t plane_mask, bool sphere_pretest,
+      std::vector<uint32_t>* visible) const;
+
+ private:
+  void ComputePlaneData();
+
+  uint32_t CullBatch(const float* const* batch, uint32_t plane_mask,
+      bool sphere_pretest) const;
+
+  Plane planes_[kNumPlanes];
+
+  // Plane coefficients in structure-of-arrays form for CullBatch().
+  float normal_x_[kNumPlanes];
+  float normal_y_[kNumPlanes];
+  float normal_z_[kNumPlanes];
+  float d_[kNumPlanes];
+  float abs_normal_x_[kNumPlanes];
+  float abs_normal_y_[kNumPlanes];
+  float abs_normal_z_[kNumPlanes];
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_FRUSTUM_HPP__
@@ -0,0 +1,110 @@
+// Copyright [2015] Albert Huang
+//
+// Micro-benchmark for view frustum culling. Compares testing boxes one at a
+// time with Frustum::Intersects() against the batched Frustum::CullBoxes().
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "sceneview/frustum.hpp"
+
+using sv::AxisAlignedBox;
+using sv::BoxArray;
+using sv::Frustum;
+using sv::Plane;
+
+static constexpr int kNumRepetitions = 5;
+
+template <typename Func>
+static double BestTimeMs(Func func) {
+  double best = 0;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    const double elapsed =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    if (rep == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+static void PrintResult(const char* name, int num_boxes, double ms,
+    size_t num_visible) {
+  printf("  %-24s %10.3f ms  %7.2f ns/box  %zu visible\n", name, ms,
+      ms * 1e6 / num_boxes, num_visible);
+}
+
+static void RunBenchmark(const Frustum& frustum, int num_boxes) {
+  // Scatter boxes through a volume around the frustum, so that some are well
+  // inside, some are well outside, and some straddle the planes.
+  std::mt19937 rng(num_boxes);
+  std::uniform_real_distribution<float> center_dist(-150, 150);
+  std::uniform_real_distribution<float> size_dist(0.1, 5);
+  std::vector<AxisAlignedBox> boxes;
+  BoxArray box_array;
+  boxes.reserve(num_boxes);
+  box_array.Reserve(num_boxes);
+  for (int i = 0; i < num_boxes; ++i) {
+    const QVector3D center(center_dist(rng) + 150, center_dist(rng),
+        center_dist(rng));
+    const QVector3D half_size(size_dist(rng), size_dist(rng),
+        size_dist(rng));
+    boxes.emplace_back(center - half_size, center + half_size);
+    box_array.Add(boxes.back());
+  }
+
+  printf("%d boxes\n", num_boxes);
+
+  std::vector<uint32_t> visible;
+  visible.reserve(num_boxes);
+
+  double ms = BestTimeMs([&]() {
+      visible.clear();
+      for (int i = 0; i < num_boxes; ++i) {
+        if (frustum.Intersects(boxes[i])) {
+          visible.push_back(i);
+        }
+      }
+    });
+  PrintResult("Intersects()", num_boxes, ms, visible.size());
+  const std::vector<uint32_t> expected = visible;
+
+  for (bool sphere_pretest : {false, true}) {
+    ms = BestTimeMs([&]() {
+        visible.clear();
+        frustum.CullBoxes(box_array, Frustum::kAllPlanes, sphere_pretest,
+            &visible);
+      });
+    PrintResult(sphere_pretest ? "CullBoxes() + spheres" : "CullBoxes()",
+        num_boxes, ms, visible.size());
+    if (visible != expected) {
+      printf("  WARNING: results differ from Intersects()\n");
+    }
+  }
+}
+
+int main() {
+  // Apex at the origin, looking down the +x axis with a 60 degree field of
+  // view, from x = 1 to x = 300.
+  const float tan_half_fov = std::tan(30 * M_PI / 180);
+  const Plane planes[Frustum::kNumPlanes] = {
+    Plane(tan_half_fov, 0, -1, 0),  // top
+    Plane(tan_half_fov, 0, 1, 0),   // bottom
+    Plane(tan_half_fov, -1, 0, 0),  // left
+    Plane(tan_half_fov, 1, 0, 0),   // right
+    Plane(1, 0, 0, -1),             // near
+    Plane(-1, 0, 0, 300),           // far
+  };
+  const Frustum frustum(planes);
+
+  for (int num_boxes : {10000, 100000, 1000000}) {
+    RunBenchmark(frustum, num_boxes);
+  }
+  return 0;
+}
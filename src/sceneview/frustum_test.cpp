@@ -0,0 +1,167 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "sceneview/frustum.hpp"
+
+using sv::AxisAlignedBox;
+using sv::BoxArray;
+using sv::Frustum;
+using sv::Plane;
+
+// A frustum with its apex at the origin, looking down the +x axis with a 90
+// degree field of view, from x = 1 to x = 100.
+static Frustum MakeFrustum() {
+  const Plane planes[Frustum::kNumPlanes] = {
+    Plane(1, 0, -1, 0),    // top
+    Plane(1, 0, 1, 0),     // bottom
+    Plane(1, -1, 0, 0),    // left
+    Plane(1, 1, 0, 0),     // right
+    Plane(1, 0, 0, -1),    // near
+    Plane(-1, 0, 0, 100),  // far
+  };
+  return Frustum(planes);
+}
+
+static std::vector<AxisAlignedBox> MakeBoxes(int num_boxes) {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> center_dist(-120, 120);
+  std::uniform_real_distribution<float> size_dist(0, 10);
+  std::vector<AxisAlignedBox> boxes;
+  for (int i = 0; i < num_boxes; ++i) {
+    const QVector3D center(center_dist(rng), center_dist(rng),
+        center_dist(rng));
+    const QVector3D half_size(size_dist(rng), size_dist(rng),
+        size_dist(rng));
+    boxes.emplace_back(center - half_size, center + half_size);
+  }
+  return boxes;
+}
+
+TEST(Frustum, Intersects) {
+  const Frustum frustum = MakeFrustum();
+  EXPECT_TRUE(frustum.Intersects(
+        AxisAlignedBox(QVector3D(10, -1, -1), QVector3D(12, 1, 1))));
+  EXPECT_FALSE(frustum.Intersects(
+        AxisAlignedBox(QVector3D(-5, -1, -1), QVector3D(-3, 1, 1))));
+  EXPECT_FALSE(frustum.Intersects(
+        AxisAlignedBox(QVector3D(10, 20, -1), QVector3D(12, 22, 1))));
+  EXPECT_TRUE(frustum.Intersects(
+        AxisAlignedBox(QVector3D(99, -1, -1), QVector3D(101, 1, 1))));
+
+  // A box fully inside the frustum is inside all of the planes.
+  uint32_t plane_mask = Frustum::kAllPlanes;
+  EXPECT_TRUE(frustum.Intersects(
+        AxisAlignedBox(QVector3D(10, -1, -1), QVector3D(12, 1, 1)),
+        &plane_mask));
+  EXPECT_EQ(0u, plane_mask);
+
+  // A box crossing the far plane is inside the other planes.
+  plane_mask = Frustum::kAllPlanes;
+  EXPECT_TRUE(frustum.Intersects(
+        AxisAlignedBox(QVector3D(99, -1, -1), QVector3D(101, 1, 1)),
+        &plane_mask));
+  EXPECT_EQ(1u << 5, plane_mask);
+}
+
+TEST(Frustum, CullBoxesMatchesIntersects) {
+  const Frustum frustum = MakeFrustum();
+  // Not a multiple of any batch size, to exercise the remainder.
+  const std::vector<AxisAlignedBox> boxes = MakeBoxes(10007);
+
+  BoxArray box_array;
+  std::vector<uint32_t> expected;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    box_array.Add(boxes[i]);
+    if (frustum.Intersects(boxes[i])) {
+      expected.push_back(i);
+    }
+  }
+  ASSERT_FALSE(expected.empty());
+  ASSERT_LT(expected.size(), boxes.size());
+
+  for (bool sphere_pretest : {false, true}) {
+    std::vector<uint32_t> visible;
+    frustum.CullBoxes(box_array, Frustum::kAllPlanes, sphere_pretest,
+        &visible);
+    EXPECT_EQ(expected, visible);
+  }
+}
+
+TEST(Frustum, CullBoxesWithIndices) {
+  const Frustum frustum = MakeFrustum();
+  const std::vector<AxisAlignedBox> boxes = MakeBoxes(1000);
+
+  BoxArray box_array;
+  for (const AxisAlignedBox& box : boxes) {
+    box_array.Add(box);
+  }
+
+  // Test every third box, in reverse order.
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> expected;
+  for (int i = boxes.size() - 1; i >= 0; i -= 3) {
+    indices.push_back(i);
+    if (frustum.Intersects(boxes[i])) {
+      expected.push_back(i);
+    }
+  }
+
+  for (bool sphere_pretest : {false, true}) {
+    std::vector<uint32_t> visible;
+    frustum.CullBoxes(box_array, indices.data(), indices.size(),
+        Frustum::kAllPlanes, sphere_pretest, &visible);
+    EXPECT_EQ(expected, visible);
+  }
+}
+
+TEST(Frustum, CullBoxesPlaneMask) {
+  const Frustum frustum = MakeFrustum();
+  BoxArray box_array;
+  // Behind the near plane, but inside the other planes.
+  box_array.Add(AxisAlignedBox(QVector3D(0, 0, 0), QVector3D(0.5, 0, 0)));
+  // Past the far plane.
+  box_array.Add(AxisAlignedBox(QVector3D(200, 0, 0), QVector3D(201, 1, 1)));
+
+  std::vector<uint32_t> visible;
+  frustum.CullBoxes(box_array, Frustum::kAllPlanes, false, &visible);
+  EXPECT_TRUE(visible.empty());
+
+  visible.clear();
+  frustum.CullBoxes(box_array, Frustum::kAllPlanes & ~(1 << 4), false,
+      &visible);
+  EXPECT_EQ(std::vector<uint32_t>({0}), visible);
+
+  visible.clear();
+  frustum.CullBoxes(box_array, 0, false, &visible);
+  EXPECT_EQ(std::vector<uint32_t>({0, 1}), visible);
+}
+
+TEST(Frustum, BoxArrayInvalidAndRemove) {
+  const Frustum frustum = MakeFrustum();
+  BoxArray box_array;
+  box_array.Add(AxisAlignedBox(QVector3D(-5, -1, -1), QVector3D(-3, 1, 1)));
+  box_array.Add(AxisAlignedBox());
+  box_array.Add(AxisAlignedBox(QVector3D(10, -1, -1), QVector3D(12, 1, 1)));
+
+  // Invalid boxes are never culled.
+  for (bool sphere_pretest : {false, true}) {
+    std::vector<uint32_t> visible;
+    frustum.CullBoxes(box_array, Frustum::kAllPlanes, sphere_pretest,
+        &visible);
+    EXPECT_EQ(std::vector<uint32_t>({1, 2}), visible);
+  }
+
+  box_array.SwapRemove(0);
+  ASSERT_EQ(2, box_array.Size());
+  EXPECT_EQ(11, box_array.CenterX()[0]);
+
+  box_array.Set(1, AxisAlignedBox(QVector3D(-5, -1, -1), QVector3D(-3, 1, 1)));
+  std::vector<uint32_t> visible;
+  frustum.CullBoxes(box_array, Frustum::kAllPlanes, true, &visible);
+  EXPECT_EQ(std::vector<uint32_t>({0}), visible);
+}
@@ -0,0 +1,207 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/internal_gl.hpp"
+#include "sceneview/geometry_buffer_pool.hpp"
+
+#include <vector>
+
+#include "sceneview/geometry_resource.hpp"
+
+namespace sv {
+
+GeometryArena::GeometryArena(uint32_t format, int stride,
+    int64_t max_vertices, int64_t max_indices) :
+  format(format),
+  stride(stride),
+  vbo(QOpenGLBuffer::VertexBuffer),
+  index_buffer(QOpenGLBuffer::IndexBuffer),
+  vertices(max_vertices),
+  indices(max_indices) {
+  vbo.create();
+  vbo.bind();
+  vbo.allocate(max_vertices * stride);
+  index_buffer.create();
+  index_buffer.bind();
+  index_buffer.allocate(max_indices * sizeof(GLuint));
+}
+
+GeometryArena::~GeometryArena() {
+  vbo.destroy();
+  index_buffer.destroy();
+}
+
+GeometryBufferPool::GeometryBufferPool(int64_t vertex_buffer_size,
+    int64_t index_buffer_size) :
+  vertex_buffer_size_(vertex_buffer_size),
+  index_buffer_size_(index_buffer_size) {}
+
+GeometryBufferPool::~GeometryBufferPool() {}
+
+int GeometryBufferPool::VertexLayout(uint32_t format, int offsets[6]) {
+  static const uint32_t kAttributes[6] = {
+    0, kGeometryNormals, kGeometryDiffuse, kGeometrySpecular,
+    kGeometryShininess, kGeometryTexCoords0 };
+  static const int kNumFloats[6] = { 3, 3, 4, 4, 1, 2 };
+
+  int stride = 0;
+  for (int attr = 0; attr < 6; ++attr) {
+    offsets[attr] = 0;
+    if (attr == 0 || (format & kAttributes[attr])) {
+      offsets[attr] = stride;
+      stride += kNumFloats[attr] * sizeof(GLfloat);
+    }
+  }
+  return stride;
+}
+
+bool GeometryBufferPool::TryAllocate(GeometryArena* arena,
+    int64_t num_vertices, int64_t num_indices, int64_t* base_vertex,
+    int64_t* first_index) {
+  const int64_t vertex_offset = arena->vertices.Allocate(num_vertices);
+  if (vertex_offset < 0) {
+    return false;
+  }
+  const int64_t index_offset = arena->indices.Allocate(num_indices);
+  if (index_offset < 0) {
+    arena->vertices.Free(vertex_offset);
+    return false;
+  }
+  *base_vertex = vertex_offset;
+  *first_index = index_offset;
+  return true;
+}
+
+GeometryArena* GeometryBufferPool::Allocate(GeometryResource* geometry,
+    uint32_t format, int64_t num_vertices, int64_t num_indices,
+    int64_t* base_vertex, int64_t* first_index) {
+  int offsets[6];
+  const int stride = VertexLayout(format, offsets);
+  const int64_t max_vertices = vertex_buffer_size_ / stride;
+  const int64_t max_indices = index_buffer_size_ / sizeof(GLuint);
+  if (num_vertices > max_vertices || num_indices > max_indices) {
+    return nullptr;
+  }
+
+  GeometryArena* result = nullptr;
+  for (auto& arena : arenas_) {
+    if (arena->format == format &&
+        TryAllocate(arena.get(), num_vertices, num_indices, base_vertex,
+          first_index)) {
+      result = arena.get();
+      break;
+    }
+  }
+
+  // Reclaim fragmented space before allocating more graphics memory.
+  if (!result) {
+    for (auto& arena : arenas_) {
+      if (arena->format == format &&
+          arena->vertices.FreeSize() >= num_vertices &&
+          arena->indices.FreeSize() >= num_indices) {
+        Compact(arena.get());
+        if (TryAllocate(arena.get(), num_vertices, num_indices, base_vertex,
+              first_index)) {
+          result = arena.get();
+          break;
+        }
+      }
+    }
+  }
+
+  if (!result) {
+    arenas_.emplace_back(
+        new GeometryArena(format, stride, max_vertices, max_indices));
+    result = arenas_.back().get();
+    TryAllocate(result, num_vertices, num_indices, base_vertex, first_index);
+  }
+
+  result->users[*base_vertex] = GeometryArena::User{geometry, *first_index};
+  return result;
+}
+
+void GeometryBufferPool::Free(GeometryArena* arena, int64_t base_vertex) {
+  auto iter = arena->users.find(base_vertex);
+  if (iter == arena->users.end()) {
+    return;
+  }
+  arena->vertices.Free(base_vertex);
+  arena->indices.Free(iter->second.first_index);
+  arena->users.erase(iter);
+}
+
+int64_t GeometryBufferPool::MemoryUsage() const {
+  int64_t result = 0;
+  for (auto& arena : arenas_) {
+    result += arena->vertices.Capacity() * arena->stride +
+        arena->indices.Capacity() * sizeof(GLuint);
+  }
+  return result;
+}
+
+void GeometryBufferPool::Compact() {
+  for (auto& arena : arenas_) {
+    Compact(arena.get());
+  }
+}
+
+// Copies the moved ranges of a buffer into a new buffer of the same size.
+// Ranges that did not move are copied too, since the whole buffer is
+// replaced.
+static void CopyCompacted(QOpenGLBuffer* buffer, int64_t unit_size,
+    const std::map<int64_t, int64_t>& old_to_new,
+    const RangeAllocator& allocator) {
+  QOpenGLBuffer compacted(buffer->type());
+  compacted.create();
+  compacted.bind();
+  compacted.allocate(allocator.Capacity() * unit_size);
+
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer->bufferId());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, compacted.bufferId());
+  for (const auto& item : old_to_new) {
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+        item.first * unit_size, item.second * unit_size,
+        allocator.AllocationSize(item.second) * unit_size);
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  buffer->destroy();
+  *buffer = compacted;
+}
+
+void GeometryBufferPool::Compact(GeometryArena* arena) {
+  if (arena->users.empty()) {
+    return;
+  }
+
+  // Map the old offset of each allocation to its new offset.
+  std::map<int64_t, int64_t> vertex_map;
+  std::map<int64_t, int64_t> index_map;
+  for (const auto& item : arena->users) {
+    vertex_map[item.first] = item.first;
+    index_map[item.second.first_index] = item.second.first_index;
+  }
+  for (const RangeAllocator::Move& move : arena->vertices.Compact()) {
+    vertex_map[move.from] = move.to;
+  }
+  for (const RangeAllocator::Move& move : arena->indices.Compact()) {
+    index_map[move.from] = move.to;
+  }
+
+  CopyCompacted(&arena->vbo, arena->stride, vertex_map, arena->vertices);
+  CopyCompacted(&arena->index_buffer, sizeof(GLuint), index_map,
+      arena->indices);
+
+  // The buffers were replaced, so every geometry must update its vertex
+  // array objects, even if its data did not move.
+  std::map<int64_t, GeometryArena::User> users;
+  for (const auto& item : arena->users) {
+    const int64_t base_vertex = vertex_map[item.first];
+    const int64_t first_index = index_map[item.second.first_index];
+    users[base_vertex] = GeometryArena::User{item.second.geometry, first_index};
+    item.second.geometry->ArenaMoved(base_vertex, first_index);
+  }
+  arena->users.swap(users);
+}
+
+}  // namespace sv
@@ -0,0 +1,142 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_GEOMETRY_BUFFER_POOL_HPP__
+#define SCENEVIEW_GEOMETRY_BUFFER_POOL_HPP__
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QOpenGLBuffer>
+
+#include "sceneview/range_allocator.hpp"
+
+namespace sv {
+
+class GeometryResource;
+
+/**
+ * Vertex attributes present in a batched geometry, as a bitmask. Vertex
+ * positions are always present.
+ */
+enum GeometryAttribute : uint32_t {
+  kGeometryNormals = 1 << 0,
+  kGeometryDiffuse = 1 << 1,
+  kGeometrySpecular = 1 << 2,
+  kGeometryShininess = 1 << 3,
+  kGeometryTexCoords0 = 1 << 4
+};
+
+/**
+ * A vertex buffer and an index buffer shared by batched geometries with the
+ * same vertex format.
+ *
+ * Vertices are interleaved, and indices are GL_UNSIGNED_INT values relative
+ * to the first vertex of their geometry.
+ *
+ * Internal struct, not part of the public API.
+ */
+struct GeometryArena {
+  GeometryArena(uint32_t format, int stride, int64_t max_vertices,
+      int64_t max_indices);
+
+  ~GeometryArena();
+
+  // Bitmask of GeometryAttribute values.
+  const uint32_t format;
+
+  // Size of one vertex, in bytes.
+  const int stride;
+
+  QOpenGLBuffer vbo;
+  QOpenGLBuffer index_buffer;
+
+  // Allocators, in units of vertices and indices respectively.
+  RangeAllocator vertices;
+  RangeAllocator indices;
+
+  struct User {
+    GeometryResource* geometry;
+    int64_t first_index;
+  };
+
+  // Geometry stored in each vertex range, keyed by first vertex.
+  std::map<int64_t, User> users;
+};
+
+/**
+ * Sub-allocates geometry resources out of a few large vertex and index
+ * buffers, so that many small meshes can be drawn without rebinding buffers,
+ * and with a single glMultiDrawElementsBaseVertex() call.
+ *
+ * Owned by the ResourceManager, and shared with the geometries allocated
+ * from it.
+ *
+ * Internal class, not part of the public API.
+ */
+class GeometryBufferPool {
+ public:
+  /**
+   * @param vertex_buffer_size size of each shared vertex buffer, in bytes.
+   * @param index_buffer_size size of each shared index buffer, in bytes.
+   */
+  GeometryBufferPool(int64_t vertex_buffer_size, int64_t index_buffer_size);
+
+  ~GeometryBufferPool();
+
+  GeometryBufferPool(const GeometryBufferPool&) = delete;
+
+  GeometryBufferPool& operator=(const GeometryBufferPool&) = delete;
+
+  /**
+   * Computes the interleaved vertex layout of a vertex format.
+   *
+   * @param offsets receives the byte offset of each attribute within a
+   * vertex, in the order: position, normal, diffuse, specular, shininess,
+   * tex_coords_0. Absent attributes get an offset of 0.
+   * @return the size of one vertex, in bytes.
+   */
+  static int VertexLayout(uint32_t format, int offsets[6]);
+
+  /**
+   * Allocates room for a geometry. If no shared buffer has a large enough
+   * free range, then a shared buffer of the same format with enough free
+   * space in total is compacted, or a new one is created.
+   *
+   * @return the shared buffers holding the geometry, or nullptr if the
+   * geometry is too large to fit in a shared buffer.
+   */
+  GeometryArena* Allocate(GeometryResource* geometry, uint32_t format,
+      int64_t num_vertices, int64_t num_indices, int64_t* base_vertex,
+      int64_t* first_index);
+
+  void Free(GeometryArena* arena, int64_t base_vertex);
+
+  /**
+   * Defragments every shared buffer. The OpenGL context must be current.
+   */
+  void Compact();
+
+  int NumArenas() const { return arenas_.size(); }
+
+  /**
+   * Number of bytes of graphics memory allocated for the shared buffers.
+   */
+  int64_t MemoryUsage() const;
+
+ private:
+  static bool TryAllocate(GeometryArena* arena, int64_t num_vertices,
+      int64_t num_indices, int64_t* base_vertex, int64_t* first_index);
+
+  void Compact(GeometryArena* arena);
+
+  int64_t vertex_buffer_size_;
+  int64_t index_buffer_size_;
+
+  std::vector<std::unique_ptr<GeometryArena>> arenas_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_GEOMETRY_BUFFER_POOL_HPP__
@@ -1,10 +1,18 @@
 // Copyright [2015] Albert Huang
 
+#include "sceneview/internal_gl.hpp"
 #include "sceneview/geometry_resource.hpp"
 
+#include <algorithm>
+#include <numeric>
 #include <vector>
 
+#include <QOpenGLVertexArrayObject>
+
 #include "drawable.hpp"
+#include "sceneview/geometry_buffer_pool.hpp"
+#include "sceneview/shader_resource.hpp"
+#include "sceneview/tracing.hpp"
 
 #if 0
 #define dbg(fmt, ...) printf(fmt, __VA_ARGS__)
@@ -14,6 +22,22 @@
 
 namespace sv {
 
+// Vertex array object binding the geometry to one shader.
+struct VertexArrayEntry {
+  ShaderResource* shader;
+
+  // Position of the geometry in the vertex array users of the shader.
+  int user_index;
+
+  // Null if vertex array objects are not supported.
+  std::unique_ptr<QOpenGLVertexArrayObject> vao;
+
+  // Geometry layout and shader link generations when the attribute arrays
+  // were last specified.
+  uint64_t layout_generation;
+  uint64_t link_generation;
+};
+
 struct GeometryResource::Priv {
   QString name;
 
@@ -41,13 +65,33 @@ struct GeometryResource::Priv {
   GLenum gl_mode;
   GLenum index_type;
 
+  // Shared buffers, if the geometry is batched.
+  std::shared_ptr<GeometryBufferPool> pool;
+  GeometryArena* arena = nullptr;
+  int64_t base_vertex = 0;
+  int64_t first_index = 0;
+  int vertex_stride = 0;
+
+  // Size of vbo and index_buffer, in bytes.
+  int64_t buffer_bytes = 0;
+
   AxisAlignedBox bounding_box;
 
   std::vector<Drawable*> listeners;
+
+  uint32_t sort_id;
+
+  // Incremented each time the geometry is loaded, which invalidates the
+  // attribute arrays of the vertex array objects.
+  uint64_t layout_generation = 0;
+
+  std::vector<VertexArrayEntry> vertex_arrays;
 };
 
 GeometryResource::GeometryResource(const QString& name) : p_(new Priv()) {
+  static uint32_t next_sort_id = 0;
   p_->name = name;
+  p_->sort_id = next_sort_id++;
   p_->created_vbo = false;
   p_->index_buffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
   p_->vertex_offset = 0;
@@ -69,29 +113,17 @@ GeometryResource::GeometryResource(const QString& name) : p_(new Priv()) {
 
 GeometryResource::~GeometryResource() {
   dbg("destroying geometry resource %s\n", p_->name.c_str());
-  if (p_->created_vbo) {
-    p_->vbo.destroy();
-  }
-  if (p_->num_indices) {
-    p_->index_buffer.destroy();
+  for (VertexArrayEntry& entry : p_->vertex_arrays) {
+    entry.shader->RemoveVertexArrayUser(entry.user_index);
   }
+  p_->vertex_arrays.clear();
+  ReleaseArena();
+  ReleaseOwnBuffers();
   delete p_;
 }
 
 void GeometryResource::Load(const GeometryData& data) {
-  if (!p_->created_vbo) {
-    p_->vbo.create();
-    p_->created_vbo = true;
-  }
-  p_->vbo.bind();
-
-  p_->vertex_offset = 0;
-  p_->normal_offset = 0;
-  p_->diffuse_offset = 0;
-  p_->specular_offset = 0;
-  p_->shininess_offset = 0;
-  p_->tex_coords_0_offset = 0;
-
+  SV_TRACE_SCOPE("resource", "GeometryResource::Load");
   const int num_vertices = data.vertices.size();
   const int num_normals = data.normals.size();
   const int num_diffuse = data.diffuse.size();
@@ -116,6 +148,29 @@ void GeometryResource::Load(const GeometryData& data) {
     throw std::invalid_argument("#vertices != #tex_coords_0");
   }
 
+  p_->layout_generation++;
+
+  if (p_->pool && LoadIntoArena(data)) {
+    // The geometry may have had its own buffers from an earlier load.
+    ReleaseOwnBuffers();
+    LoadBoundingBox(data);
+    return;
+  }
+  ReleaseArena();
+
+  if (!p_->created_vbo) {
+    p_->vbo.create();
+    p_->created_vbo = true;
+  }
+  p_->vbo.bind();
+
+  p_->vertex_offset = 0;
+  p_->normal_offset = 0;
+  p_->diffuse_offset = 0;
+  p_->specular_offset = 0;
+  p_->shininess_offset = 0;
+  p_->tex_coords_0_offset = 0;
+
   int offset = 0;
   const int vertices_size = num_vertices * 3 * sizeof(GLfloat);
   const int normals_size = num_normals * 3 * sizeof(GLfloat);
@@ -127,6 +182,7 @@ void GeometryResource::Load(const GeometryData& data) {
       vertices_size + normals_size + diffuse_size + tex_coords_0_size;
 
   p_->vbo.allocate(total_size);
+  p_->buffer_bytes = total_size;
 
   if (num_vertices) {
     p_->vbo.write(offset, data.vertices.data(), vertices_size);
@@ -173,6 +229,8 @@ void GeometryResource::Load(const GeometryData& data) {
 
   p_->gl_mode = data.gl_mode;
 
+  CountBytesUploaded(offset);
+
   // load indices
   p_->num_indices = data.indices.size();
   if (p_->num_indices) {
@@ -198,9 +256,167 @@ void GeometryResource::Load(const GeometryData& data) {
                              p_->num_indices * sizeof(uint32_t));
       p_->index_type = GL_UNSIGNED_INT;
     }
+    CountBytesUploaded(p_->index_buffer.size());
+    p_->buffer_bytes += p_->index_buffer.size();
   }
 
-  // Initialize the bounding box
+  LoadBoundingBox(data);
+}
+
+bool GeometryResource::LoadIntoArena(const GeometryData& data) {
+  SV_TRACE_SCOPE("resource", "GeometryResource::LoadIntoArena");
+  const int num_vertices = data.vertices.size();
+  if (!num_vertices || !GeometryBatchingSupported()) {
+    return false;
+  }
+
+  uint32_t format = 0;
+  if (!data.normals.empty()) {
+    format |= kGeometryNormals;
+  }
+  if (!data.diffuse.empty()) {
+    format |= kGeometryDiffuse;
+  }
+  if (!data.specular.empty()) {
+    format |= kGeometrySpecular;
+  }
+  if (!data.shininess.empty()) {
+    format |= kGeometryShininess;
+  }
+  if (!data.tex_coords_0.empty()) {
+    format |= kGeometryTexCoords0;
+  }
+  int offsets[6];
+  const int stride = GeometryBufferPool::VertexLayout(format, offsets);
+
+  // Geometry without indices is drawn with sequential indices, so that all
+  // geometry in the shared buffers can be drawn the same way.
+  const int num_indices =
+      data.indices.empty() ? num_vertices : data.indices.size();
+
+  // Reuse the current allocation if the new data fits in it.
+  GeometryArena* arena = p_->arena;
+  if (!arena || arena->format != format ||
+      arena->vertices.AllocationSize(p_->base_vertex) < num_vertices ||
+      arena->indices.AllocationSize(p_->first_index) < num_indices) {
+    ReleaseArena();
+    arena = p_->pool->Allocate(this, format, num_vertices, num_indices,
+        &p_->base_vertex, &p_->first_index);
+    if (!arena) {
+      return false;
+    }
+    p_->arena = arena;
+  }
+
+  // Interleave the vertex attributes.
+  const int floats_per_vertex = stride / sizeof(GLfloat);
+  std::vector<GLfloat> vertex_data(num_vertices * floats_per_vertex);
+  for (int index = 0; index < num_vertices; ++index) {
+    GLfloat* vertex = &vertex_data[index * floats_per_vertex];
+    const QVector3D& pos = data.vertices[index];
+    GLfloat* attr = vertex + offsets[0] / sizeof(GLfloat);
+    attr[0] = pos.x();
+    attr[1] = pos.y();
+    attr[2] = pos.z();
+    if (format & kGeometryNormals) {
+      const QVector3D& normal = data.normals[index];
+      attr = vertex + offsets[1] / sizeof(GLfloat);
+      attr[0] = normal.x();
+      attr[1] = normal.y();
+      attr[2] = normal.z();
+    }
+    if (format & kGeometryDiffuse) {
+      const QVector4D& diffuse = data.diffuse[index];
+      attr = vertex + offsets[2] / sizeof(GLfloat);
+      attr[0] = diffuse.x();
+      attr[1] = diffuse.y();
+      attr[2] = diffuse.z();
+      attr[3] = diffuse.w();
+    }
+    if (format & kGeometrySpecular) {
+      const QVector4D& specular = data.specular[index];
+      attr = vertex + offsets[3] / sizeof(GLfloat);
+      attr[0] = specular.x();
+      attr[1] = specular.y();
+      attr[2] = specular.z();
+      attr[3] = specular.w();
+    }
+    if (format & kGeometryShininess) {
+      vertex[offsets[4] / sizeof(GLfloat)] = data.shininess[index];
+    }
+    if (format & kGeometryTexCoords0) {
+      const QVector2D& tex_coords = data.tex_coords_0[index];
+      attr = vertex + offsets[5] / sizeof(GLfloat);
+      attr[0] = tex_coords.x();
+      attr[1] = tex_coords.y();
+    }
+  }
+  arena->vbo.bind();
+  arena->vbo.write(p_->base_vertex * stride, vertex_data.data(),
+      vertex_data.size() * sizeof(GLfloat));
+
+  std::vector<GLuint> index_data(data.indices.begin(), data.indices.end());
+  if (index_data.empty()) {
+    index_data.resize(num_vertices);
+    std::iota(index_data.begin(), index_data.end(), 0);
+  }
+  arena->index_buffer.bind();
+  arena->index_buffer.write(p_->first_index * sizeof(GLuint),
+      index_data.data(), index_data.size() * sizeof(GLuint));
+  CountBytesUploaded((vertex_data.size() + index_data.size()) *
+      sizeof(GLfloat));
+
+  // Attribute offsets are relative to the start of the shared buffer, and
+  // the first vertex is selected with the base vertex. That way all
+  // geometries in the shared buffers have the same attribute arrays.
+  p_->vertex_offset = offsets[0];
+  p_->normal_offset = offsets[1];
+  p_->diffuse_offset = offsets[2];
+  p_->specular_offset = offsets[3];
+  p_->shininess_offset = offsets[4];
+  p_->tex_coords_0_offset = offsets[5];
+  p_->vertex_stride = stride;
+
+  p_->num_vertices = num_vertices;
+  p_->num_normals = data.normals.size();
+  p_->num_diffuse = data.diffuse.size();
+  p_->num_specular = data.specular.size();
+  p_->num_shininess = data.shininess.size();
+  p_->num_tex_coords_0 = data.tex_coords_0.size();
+  p_->num_indices = num_indices;
+  p_->index_type = GL_UNSIGNED_INT;
+  p_->gl_mode = data.gl_mode;
+  return true;
+}
+
+void GeometryResource::ReleaseArena() {
+  if (p_->arena) {
+    p_->pool->Free(p_->arena, p_->base_vertex);
+    p_->arena = nullptr;
+    p_->base_vertex = 0;
+    p_->first_index = 0;
+    p_->vertex_stride = 0;
+  }
+}
+
+void GeometryResource::ReleaseOwnBuffers() {
+  if (p_->created_vbo) {
+    p_->vbo.destroy();
+    p_->created_vbo = false;
+  }
+  if (p_->index_buffer.isCreated()) {
+    p_->index_buffer.destroy();
+  }
+  p_->buffer_bytes = 0;
+}
+
+void GeometryResource::ArenaMoved(int64_t base_vertex, int64_t first_index) {
+  p_->base_vertex = base_vertex;
+  p_->first_index = first_index;
+  p_->layout_generation++;
+}
+
+void GeometryResource::LoadBoundingBox(const GeometryData& data) {
   p_->bounding_box = AxisAlignedBox();
   for (const auto& vertex : data.vertices) {
     p_->bounding_box.IncludePoint(QVector3D(vertex.x(), vertex.y(), vertex.z()));
@@ -211,12 +427,25 @@ void GeometryResource::Load(const GeometryData& data) {
   }
 }
 
-QOpenGLBuffer* GeometryResource::VBO() { return &p_->vbo; }
+QOpenGLBuffer* GeometryResource::VBO() {
+  return p_->arena ? &p_->arena->vbo : &p_->vbo;
+}
 
 QOpenGLBuffer* GeometryResource::IndexBuffer() {
-  return p_->num_indices ? &p_->index_buffer : nullptr;
+  if (!p_->num_indices) {
+    return nullptr;
+  }
+  return p_->arena ? &p_->arena->index_buffer : &p_->index_buffer;
 }
 
+int GeometryResource::VertexStride() const { return p_->vertex_stride; }
+
+int GeometryResource::IndexOffset() const {
+  return p_->first_index * sizeof(GLuint);
+}
+
+int GeometryResource::BaseVertex() const { return p_->base_vertex; }
+
 int GeometryResource::VertexOffset() const { return p_->vertex_offset; }
 
 int GeometryResource::NumVertices() const { return p_->num_vertices; }
@@ -257,6 +486,17 @@ GLenum GeometryResource::GLMode() const { return p_->gl_mode; }
 
 const AxisAlignedBox& GeometryResource::BoundingBox() const { return p_->bounding_box; }
 
+int64_t GeometryResource::MemoryUsage() const { return p_->buffer_bytes; }
+
+uint32_t GeometryResource::SortId() const { return p_->sort_id; }
+
+void GeometryResource::SetBufferPool(
+    const std::shared_ptr<GeometryBufferPool>& pool) {
+  p_->pool = pool;
+}
+
+GeometryArena* GeometryResource::Arena() const { return p_->arena; }
+
 void GeometryResource::AddListener(Drawable* listener) {
   p_->listeners.push_back(listener);
 }
@@ -268,4 +508,58 @@ void GeometryResource::RemoveListener(Drawable* listener) {
   }
 }
 
+QOpenGLVertexArrayObject* GeometryResource::VertexArray(ShaderResource* shader,
+    bool* needs_setup) {
+  auto iter = std::find_if(p_->vertex_arrays.begin(), p_->vertex_arrays.end(),
+      [shader](const VertexArrayEntry& entry) {
+        return entry.shader == shader;
+      });
+
+  if (iter == p_->vertex_arrays.end()) {
+    VertexArrayEntry entry;
+    entry.shader = shader;
+    entry.vao.reset(new QOpenGLVertexArrayObject());
+    if (!entry.vao->create()) {
+      entry.vao.reset();
+    }
+    entry.layout_generation = p_->layout_generation;
+    entry.link_generation = shader->LinkGeneration();
+    entry.user_index = shader->AddVertexArrayUser(this);
+    p_->vertex_arrays.push_back(std::move(entry));
+    *needs_setup = true;
+    return p_->vertex_arrays.back().vao.get();
+  }
+
+  VertexArrayEntry& entry = *iter;
+  // Without a vertex array object, the attribute arrays must be specified
+  // on every draw.
+  *needs_setup = !entry.vao ||
+                 entry.layout_generation != p_->layout_generation ||
+                 entry.link_generation != shader->LinkGeneration();
+  entry.layout_generation = p_->layout_generation;
+  entry.link_generation = shader->LinkGeneration();
+  return entry.vao.get();
+}
+
+void GeometryResource::ReleaseVertexArray(ShaderResource* shader) {
+  auto iter = std::find_if(p_->vertex_arrays.begin(), p_->vertex_arrays.end(),
+      [shader](const VertexArrayEntry& entry) {
+        return entry.shader == shader;
+      });
+  if (iter != p_->vertex_arrays.end()) {
+    p_->vertex_arrays.erase(iter);
+  }
+}
+
+void GeometryResource::SetVertexArrayUserIndex(ShaderResource* shader,
+    int index) {
+  // A geometry is drawn with few shaders, so the search is short.
+  for (VertexArrayEntry& entry : p_->vertex_arrays) {
+    if (entry.shader == shader) {
+      entry.user_index = index;
+      return;
+    }
+  }
+}
+
 }  // namespace sv
@@ -13,12 +13,20 @@
 #include <QVector4D>
 #include <QOpenGLBuffer>
 
+class QOpenGLVertexArrayObject;
+
 #include <sceneview/axis_aligned_box.hpp>
 
 namespace sv {
 
 class Drawable;
 
+class GeometryBufferPool;
+
+class ShaderResource;
+
+struct GeometryArena;
+
 /**
  * Geometry description to be used with GeometryResource.
  *
@@ -123,6 +131,23 @@ class GeometryResource {
 
     QOpenGLBuffer* IndexBuffer();
 
+    /**
+     * Number of bytes between consecutive vertices in VBO(), or 0 if the
+     * values of each attribute are tightly packed.
+     */
+    int VertexStride() const;
+
+    /**
+     * Byte offset of the first index in IndexBuffer().
+     */
+    int IndexOffset() const;
+
+    /**
+     * Value added to each index before fetching vertices, as with
+     * glDrawElementsBaseVertex().
+     */
+    int BaseVertex() const;
+
     int VertexOffset() const;
 
     int NumVertices() const;
@@ -163,17 +188,96 @@ class GeometryResource {
 
     const AxisAlignedBox& BoundingBox() const;
 
+    /**
+     * Number of bytes of graphics memory allocated for the geometry's own
+     * vertex and index buffers. Batched geometries are stored in buffers
+     * shared with other geometries, which are not included.
+     */
+    int64_t MemoryUsage() const;
+
   private:
     friend class ResourceManager;
 
     friend class Drawable;
 
+    friend class DrawContext;
+
+    friend class ShaderResource;
+
+    friend class GeometryBufferPool;
+
     explicit GeometryResource(const QString& name);
 
+    /**
+     * Makes subsequent calls to Load() store the geometry in buffers shared
+     * with other geometries, if possible.
+     */
+    void SetBufferPool(const std::shared_ptr<GeometryBufferPool>& pool);
+
+    /**
+     * Retrieve the shared buffers holding this geometry, or nullptr if it has
+     * its own buffers.
+     */
+    GeometryArena* Arena() const;
+
+    /**
+     * Loads the geometry into the shared buffers.
+     *
+     * @return false if the geometry could not be placed in the shared
+     * buffers.
+     */
+    bool LoadIntoArena(const GeometryData& data);
+
+    void ReleaseArena();
+
+    /**
+     * Frees the geometry's own vertex and index buffers, if it has any.
+     */
+    void ReleaseOwnBuffers();
+
+    /**
+     * Called by the buffer pool when it moves this geometry.
+     */
+    void ArenaMoved(int64_t base_vertex, int64_t first_index);
+
+    void LoadBoundingBox(const GeometryData& data);
+
+    /**
+     * Small integer that uniquely identifies this geometry, used to group
+     * draw calls by geometry.
+     */
+    uint32_t SortId() const;
+
     void AddListener(Drawable* drawable);
 
     void RemoveListener(Drawable* drawable);
 
+    /**
+     * Returns the vertex array object that binds the vertex attributes of
+     * this geometry to the specified shader, creating it if needed.
+     *
+     * needs_setup is set to true if the caller must specify the attribute
+     * arrays of the returned vertex array object, either because it was just
+     * created, or because the geometry was reloaded or the shader relinked
+     * since they were last specified.
+     *
+     * Returns nullptr if vertex array objects are not supported.
+     */
+    QOpenGLVertexArrayObject* VertexArray(ShaderResource* shader,
+        bool* needs_setup);
+
+    /**
+     * Frees the vertex array object for the specified shader. Called when
+     * the shader is destroyed.
+     */
+    void ReleaseVertexArray(ShaderResource* shader);
+
+    /**
+     * Called by the shader when the position of this geometry in its vertex
+     * array users changes.
+     */
+    void SetVertexArrayUserIndex(ShaderResource* shader, int index);
+
     struct Priv;
 
     Priv* p_;
@@ -0,0 +1,229 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/gl_state.hpp"
+
+#include <limits>
+
+namespace sv {
+
+// Value used for object names and enums that are not known. Never a valid
+// object name or enum in practice.
+static constexpr GLuint kUnknown = 0xffffffff;
+
+GLState::GLState() {
+  Invalidate();
+  ResetCounters();
+}
+
+void GLState::Invalidate() {
+  program_ = kUnknown;
+  vao_ = kUnknown;
+  array_buffer_ = kUnknown;
+  element_array_buffer_ = kUnknown;
+
+  active_texture_unit_ = -1;
+  for (int unit = 0; unit < kMaxTextureUnits; ++unit) {
+    texture_targets_[unit] = kUnknown;
+    textures_[unit] = kUnknown;
+  }
+
+  cull_face_enabled_ = Flag::kUnknown;
+  cull_face_ = kUnknown;
+  front_face_ = kUnknown;
+  depth_test_ = Flag::kUnknown;
+  depth_func_ = kUnknown;
+  depth_mask_ = Flag::kUnknown;
+  color_mask_ = Flag::kUnknown;
+  stencil_test_ = Flag::kUnknown;
+  stencil_known_ = false;
+  // NaN compares unequal to every size.
+  point_size_ = std::numeric_limits<float>::quiet_NaN();
+  line_width_ = std::numeric_limits<float>::quiet_NaN();
+  blend_ = Flag::kUnknown;
+  blend_sfactor_ = kUnknown;
+  blend_dfactor_ = kUnknown;
+}
+
+void GLState::ResetCounters() {
+  num_issued_ = 0;
+  num_skipped_ = 0;
+}
+
+bool GLState::Changed(bool changed) {
+  if (changed) {
+    num_issued_++;
+  } else {
+    num_skipped_++;
+  }
+  return changed;
+}
+
+void GLState::UseProgram(GLuint program) {
+  if (Changed(program_ != program)) {
+    program_ = program;
+    glUseProgram(program);
+  }
+}
+
+void GLState::BindVertexArray(GLuint vao) {
+  if (Changed(vao_ != vao)) {
+    vao_ = vao;
+    element_array_buffer_ = kUnknown;
+    glBindVertexArray(vao);
+  }
+}
+
+void GLState::BindArrayBuffer(GLuint buffer) {
+  if (Changed(array_buffer_ != buffer)) {
+    array_buffer_ = buffer;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  }
+}
+
+void GLState::BindElementArrayBuffer(GLuint buffer) {
+  if (Changed(element_array_buffer_ != buffer)) {
+    element_array_buffer_ = buffer;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+  }
+}
+
+void GLState::BindTexture(int unit, GLenum target, GLuint texture) {
+  const bool tracked = unit < kMaxTextureUnits;
+  if (!Changed(!tracked || texture_targets_[unit] != target ||
+               textures_[unit] != texture)) {
+    return;
+  }
+  if (active_texture_unit_ != unit) {
+    active_texture_unit_ = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+  glBindTexture(target, texture);
+  if (tracked) {
+    texture_targets_[unit] = target;
+    textures_[unit] = texture;
+  }
+}
+
+void GLState::SetCullFaceEnabled(bool enabled) {
+  if (Changed(cull_face_enabled_ != ToFlag(enabled))) {
+    cull_face_enabled_ = ToFlag(enabled);
+    if (enabled) {
+      glEnable(GL_CULL_FACE);
+    } else {
+      glDisable(GL_CULL_FACE);
+    }
+  }
+}
+
+void GLState::SetCullFace(GLenum mode) {
+  if (Changed(cull_face_ != mode)) {
+    cull_face_ = mode;
+    glCullFace(mode);
+  }
+}
+
+void GLState::SetFrontFace(GLenum mode) {
+  if (Changed(front_face_ != mode)) {
+    front_face_ = mode;
+    glFrontFace(mode);
+  }
+}
+
+void GLState::SetDepthTest(bool enabled) {
+  if (Changed(depth_test_ != ToFlag(enabled))) {
+    depth_test_ = ToFlag(enabled);
+    if (enabled) {
+      glEnable(GL_DEPTH_TEST);
+    } else {
+      glDisable(GL_DEPTH_TEST);
+    }
+  }
+}
+
+void GLState::SetDepthFunc(GLenum func) {
+  if (Changed(depth_func_ != func)) {
+    depth_func_ = func;
+    glDepthFunc(func);
+  }
+}
+
+void GLState::SetDepthMask(bool write) {
+  if (Changed(depth_mask_ != ToFlag(write))) {
+    depth_mask_ = ToFlag(write);
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+  }
+}
+
+void GLState::SetColorMask(bool write) {
+  if (Changed(color_mask_ != ToFlag(write))) {
+    color_mask_ = ToFlag(write);
+    const GLboolean mask = write ? GL_TRUE : GL_FALSE;
+    glColorMask(mask, mask, mask, mask);
+  }
+}
+
+void GLState::SetStencilTest(bool enabled) {
+  if (Changed(stencil_test_ != ToFlag(enabled))) {
+    stencil_test_ = ToFlag(enabled);
+    if (enabled) {
+      glEnable(GL_STENCIL_TEST);
+    } else {
+      glDisable(GL_STENCIL_TEST);
+    }
+  }
+}
+
+void GLState::SetStencil(const StencilSettings& stencil) {
+  if (!Changed(!stencil_known_ || stencil_ != stencil)) {
+    return;
+  }
+  stencil_known_ = true;
+  stencil_ = stencil;
+  glStencilOpSeparate(GL_FRONT, stencil.front.sfail, stencil.front.dpfail,
+      stencil.front.dppass);
+  glStencilOpSeparate(GL_BACK, stencil.back.sfail, stencil.back.dpfail,
+      stencil.back.dppass);
+
+  glStencilFuncSeparate(GL_FRONT, stencil.front.func, stencil.front.func_ref,
+      stencil.front.func_mask);
+  glStencilFuncSeparate(GL_BACK, stencil.back.func, stencil.back.func_ref,
+      stencil.back.func_mask);
+
+  glStencilMaskSeparate(GL_FRONT, stencil.front.mask);
+  glStencilMaskSeparate(GL_BACK, stencil.back.mask);
+}
+
+void GLState::SetPointSize(float size) {
+  if (Changed(point_size_ != size)) {
+    point_size_ = size;
+    glPointSize(size);
+  }
+}
+
+void GLState::SetLineWidth(float width) {
+  if (Changed(line_width_ != width)) {
+    line_width_ = width;
+    glLineWidth(width);
+  }
+}
+
+void GLState::SetBlend(bool enabled) {
+  if (Changed(blend_ != ToFlag(enabled))) {
+    blend_ = ToFlag(enabled);
+    if (enabled) {
+      glEnable(GL_BLEND);
+    } else {
+      glDisable(GL_BLEND);
+    }
+  }
+}
+
+void GLState::SetBlendFunc(GLenum sfactor, GLenum dfactor) {
+  if (Changed(blend_sfactor_ != sfactor || blend_dfactor_ != dfactor)) {
+    blend_sfactor_ = sfactor;
+    blend_dfactor_ = dfactor;
+    glBlendFunc(sfactor, dfactor);
+  }
+}
+
+}  // namespace sv
@@ -0,0 +1,129 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_GL_STATE_HPP__
+#define SCENEVIEW_GL_STATE_HPP__
+
+#include "sceneview/internal_gl.hpp"
+
+#include "sceneview/material_resource.hpp"
+
+namespace sv {
+
+/**
+ * Shadows the OpenGL state used by the DrawContext, and skips any call that
+ * would not change it.
+ *
+ * Tracks the bound program, vertex array object, array and index buffers,
+ * textures, and the raster state set by materials. Any code that changes
+ * this state without going through the tracker must be followed by a call to
+ * Invalidate().
+ *
+ * Internal class, not part of the public API.
+ */
+class GLState {
+ public:
+  static constexpr int kMaxTextureUnits = 16;
+
+  GLState();
+
+  /**
+   * Forgets all tracked state, so that the next call to each setter is
+   * issued.
+   */
+  void Invalidate();
+
+  void UseProgram(GLuint program);
+
+  /**
+   * Binds a vertex array object. The index buffer binding is part of the
+   * vertex array object, so it is forgotten when the vertex array changes.
+   */
+  void BindVertexArray(GLuint vao);
+
+  void BindArrayBuffer(GLuint buffer);
+
+  void BindElementArrayBuffer(GLuint buffer);
+
+  void BindTexture(int unit, GLenum target, GLuint texture);
+
+  void SetCullFaceEnabled(bool enabled);
+
+  void SetCullFace(GLenum mode);
+
+  void SetFrontFace(GLenum mode);
+
+  void SetDepthTest(bool enabled);
+
+  void SetDepthFunc(GLenum func);
+
+  void SetDepthMask(bool write);
+
+  void SetColorMask(bool write);
+
+  void SetStencilTest(bool enabled);
+
+  void SetStencil(const StencilSettings& stencil);
+
+  void SetPointSize(float size);
+
+  void SetLineWidth(float width);
+
+  void SetBlend(bool enabled);
+
+  void SetBlendFunc(GLenum sfactor, GLenum dfactor);
+
+  /**
+   * Number of OpenGL calls issued since the last call to ResetCounters().
+   */
+  int NumIssued() const { return num_issued_; }
+
+  /**
+   * Number of OpenGL calls skipped because they would not have changed
+   * anything, since the last call to ResetCounters().
+   */
+  int NumSkipped() const { return num_skipped_; }
+
+  void ResetCounters();
+
+ private:
+  // Returns true if the call should be issued, and updates the counters.
+  bool Changed(bool changed);
+
+  // Tri-state flags, so that the unknown state always differs from the
+  // requested one.
+  enum class Flag { kUnknown, kFalse, kTrue };
+
+  static Flag ToFlag(bool value) { return value ? Flag::kTrue : Flag::kFalse; }
+
+  GLuint program_;
+  GLuint vao_;
+  GLuint array_buffer_;
+  GLuint element_array_buffer_;
+
+  int active_texture_unit_;
+  GLenum texture_targets_[kMaxTextureUnits];
+  GLuint textures_[kMaxTextureUnits];
+
+  Flag cull_face_enabled_;
+  GLenum cull_face_;
+  GLenum front_face_;
+  Flag depth_test_;
+  GLenum depth_func_;
+  Flag depth_mask_;
+  Flag color_mask_;
+  Flag stencil_test_;
+  bool stencil_known_;
+  StencilSettings stencil_;
+  float point_size_;
+  float line_width_;
+  Flag blend_;
+  GLenum blend_sfactor_;
+  GLenum blend_dfactor_;
+
+  int num_issued_;
+  int num_skipped_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_GL_STATE_HPP__
@@ -3,9 +3,9 @@
 #include "sceneview/grid_renderer.hpp"
 
 #include "sceneview/camera_node.hpp"
+#include "sceneview/draw_group.hpp"
 #include "sceneview/draw_node.hpp"
 #include "sceneview/stock_resources.hpp"
-#include "sceneview/viewport.hpp"
 
 namespace sv {
 
@@ -96,7 +96,7 @@ void GridRenderer::InitializeGL() {
 
 void GridRenderer::RenderBegin() {
   // Calculate camera distance from grid
-  CameraNode* camera = GetViewport()->GetCamera();
+  CameraNode* camera = GetScene()->GetDefaultDrawGroup()->GetCamera();
   const double distance =
       (camera->Translation() - camera->GetLookAt()).length();
 
@@ -4,16 +4,20 @@
 
 #include <cassert>
 #include <deque>
+#include <stdexcept>
 #include <vector>
 
 #include "sceneview/camera_node.hpp"
 #include "sceneview/draw_node.hpp"
+#include "sceneview/instanced_draw_node.hpp"
 #include "sceneview/light_node.hpp"
+#include "sceneview/lod_draw_node.hpp"
+#include "sceneview/object_pool.hpp"
 #include "sceneview/scene.hpp"
 
 namespace sv {
 
-struct GroupNode::Priv {
+struct GroupNode::Priv : PooledObject<GroupNode::Priv> {
   std::vector<SceneNode*> children;
 
   AxisAlignedBox bounding_box;
@@ -27,9 +31,11 @@ GroupNode::GroupNode(const QString& name) : SceneNode(name), p_(new Priv()) {
 }
 
 SceneNode* GroupNode::AddChild(SceneNode* child) {
-  p_->children.push_back(child);
   assert(!child->ParentNode());
+  child->SetChildIndex(p_->children.size());
+  p_->children.push_back(child);
   child->SetParentNode(this);
+  BoundingBoxChanged();
   return child;
 }
 
@@ -56,6 +62,31 @@ void GroupNode::TransformChanged() {
   }
 }
 
+void GroupNode::BoundingBoxChanged() {
+  // Computing the bounding box of a group computes those of all of its
+  // descendants, so the ancestors of a dirty group are already dirty.
+  if (p_->bounding_box_dirty) {
+    return;
+  }
+  p_->bounding_box_dirty = true;
+  SceneNode::BoundingBoxChanged();
+}
+
+bool GroupNode::BoundingBoxDirty() const { return p_->bounding_box_dirty; }
+
+void GroupNode::VisibilityChanged() {
+  const bool was_visible = EffectivelyVisible();
+  SceneNode::VisibilityChanged();
+  // The descendants are only affected if this node's effective visibility
+  // changed, so for example hiding a node under a hidden group is free.
+  if (EffectivelyVisible() == was_visible) {
+    return;
+  }
+  for (SceneNode* child : p_->children) {
+    child->VisibilityChanged();
+  }
+}
+
 void GroupNode::CopyAsChildren(Scene* scene, GroupNode* root) {
   const std::vector<SceneNode*>& tocopy_children = root->Children();
   std::deque<SceneNode*> to_process(tocopy_children.begin(),
@@ -95,10 +126,35 @@ void GroupNode::CopyAsChildren(Scene* scene, GroupNode* root) {
       } break;
       case SceneNodeType::kDrawNode: {
         DrawNode* node_to_copy = dynamic_cast<DrawNode*>(to_copy);
-        DrawNode* child = scene->MakeDrawNode(this, Scene::kAutoName);
-        for (const Drawable::Ptr& item : node_to_copy->Drawables()) {
-          child->Add(item);
+        InstancedDrawNode* instanced_to_copy =
+            dynamic_cast<InstancedDrawNode*>(to_copy);
+        LodDrawNode* lod_to_copy = dynamic_cast<LodDrawNode*>(to_copy);
+        DrawNode* child;
+        if (lod_to_copy) {
+          LodDrawNode* lod_child =
+              scene->MakeLodDrawNode(this, Scene::kAutoName);
+          for (int level = 0; level < lod_to_copy->NumLevels(); ++level) {
+            lod_child->AddLevel(lod_to_copy->LevelDrawables(level),
+                lod_to_copy->LevelScreenSize(level));
+          }
+          lod_child->SetHysteresis(lod_to_copy->GetHysteresis());
+          child = lod_child;
+        } else if (instanced_to_copy) {
+          InstancedDrawNode* instanced_child =
+              scene->MakeInstancedDrawNode(this, Scene::kAutoName);
+          instanced_child->SetInstances(instanced_to_copy->InstanceTransforms(),
+              instanced_to_copy->InstanceColors());
+          child = instanced_child;
+        } else {
+          child = scene->MakeDrawNode(this, Scene::kAutoName);
+        }
+        // Levels of detail attach their own drawables.
+        if (!lod_to_copy) {
+          for (const Drawable::Ptr& item : node_to_copy->Drawables()) {
+            child->Add(item);
+          }
         }
+        child->SetOccluderMesh(node_to_copy->Occluder());
         node_copy = child;
       } break;
     }
@@ -111,12 +167,18 @@ void GroupNode::CopyAsChildren(Scene* scene, GroupNode* root) {
 }
 
 void GroupNode::RemoveChild(SceneNode* child) {
-  auto iter = std::find(p_->children.begin(), p_->children.end(), child);
-  if (iter != p_->children.end()) {
-    p_->children.erase(iter);
-  } else {
+  const int index = child->ChildIndex();
+  if (index < 0 || index >= static_cast<int>(p_->children.size()) ||
+      p_->children[index] != child) {
     throw std::invalid_argument("Not a child of this group node\n");
   }
+  // Swap with the last child and pop.
+  SceneNode* last = p_->children.back();
+  p_->children[index] = last;
+  last->SetChildIndex(index);
+  p_->children.pop_back();
+  child->SetChildIndex(-1);
+  BoundingBoxChanged();
 }
 
 }  // namespace sv
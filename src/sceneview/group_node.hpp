@@ -34,6 +34,10 @@ class GroupNode : public SceneNode {
 
   /**
    * Retrieve the node's children.
+   *
+   * Children are in the order they were added until one is removed. Removing
+   * a child moves the last child into its place, so that removal takes
+   * constant time.
    */
   const std::vector<SceneNode*>& Children();
 
@@ -42,8 +46,13 @@ class GroupNode : public SceneNode {
  protected:
   void TransformChanged() override;
 
+  void BoundingBoxChanged() override;
+
+  void VisibilityChanged() override;
+
  private:
   friend class Scene;
+  friend class SceneUpdater;
 
   explicit GroupNode(const QString& name);
 
@@ -53,6 +62,12 @@ class GroupNode : public SceneNode {
 
   void RemoveChild(SceneNode* child);
 
+  /**
+   * True if the world bounding box of this node or of any of its descendants
+   * needs to be recomputed.
+   */
+  bool BoundingBoxDirty() const;
+
   struct Priv;
 
   Priv* p_;
@@ -19,6 +19,8 @@
 
 #include "sceneview/group_node.hpp"
 #include "sceneview/draw_node.hpp"
+#include "sceneview/lod_draw_node.hpp"
+#include "sceneview/mesh_simplifier.hpp"
 #include "sceneview/stock_resources.hpp"
 
 //#define DBG
@@ -128,7 +130,8 @@ ShaderResource::Ptr TextureShader(const ResourceManager::Ptr& resources) {
 
 class Importer {
   public:
-    explicit Importer(ResourceManager::Ptr resources);
+    Importer(ResourceManager::Ptr resources,
+        const AssetImporter::LodOptions& lod_options);
 
     Scene::Ptr ImportFile(const QString& fname, const QString& scene_name);
 
@@ -141,6 +144,7 @@ class Importer {
         AssimpMaterial* mat);
 
     ResourceManager::Ptr resources_;
+    AssetImporter::LodOptions lod_options_;
     QString fname_;
 
     const struct aiScene* ai_scene_;
@@ -148,9 +152,14 @@ class Importer {
     std::vector<GeometryResource::Ptr> geometries_;
     std::map<GeometryResource::Ptr, MaterialResource::Ptr>
       geometry_materials_;
+    std::map<GeometryResource::Ptr, std::vector<GeometryResource::Ptr>>
+      geometry_lods_;
 };
 
-Importer::Importer(ResourceManager::Ptr resources) : resources_(resources) {
+Importer::Importer(ResourceManager::Ptr resources,
+    const AssetImporter::LodOptions& lod_options) :
+  resources_(resources),
+  lod_options_(lod_options) {
 }
 
 Scene::Ptr Importer::ImportFile(const QString& fname,
@@ -273,6 +282,15 @@ Scene::Ptr Importer::ImportFile(const QString& fname,
     geom->Load(gdata);
     geometries_.push_back(geom);
     geometry_materials_[geometries_.back()] = material;
+
+    // Generate levels of detail
+    std::vector<GeometryResource::Ptr>& lods = geometry_lods_[geom];
+    for (const GeometryData& lod_data : MeshSimplifier::MakeLodChain(gdata,
+          lod_options_.num_levels, lod_options_.reduction)) {
+      GeometryResource::Ptr lod_geom = resources_->MakeGeometry();
+      lod_geom->Load(lod_data);
+      lods.push_back(lod_geom);
+    }
   }
 
   // Create the graph structure
@@ -309,8 +327,21 @@ Scene::Ptr Importer::ImportFile(const QString& fname,
       GeometryResource::Ptr& geom = geometries_[mesh_id];
       assert(geometry_materials_.find(geom) != geometry_materials_.end());
       MaterialResource::Ptr& material = geometry_materials_[geom];
-      DrawNode* draw_node = model->MakeDrawNode(group);
-      draw_node->Add(geom, material);
+      const std::vector<GeometryResource::Ptr>& lods = geometry_lods_[geom];
+      if (lods.empty()) {
+        DrawNode* draw_node = model->MakeDrawNode(group);
+        draw_node->Add(geom, material);
+        continue;
+      }
+
+      LodDrawNode* lod_node = model->MakeLodDrawNode(group);
+      double screen_size = lod_options_.screen_size;
+      lod_node->AddLevel(geom, material, screen_size);
+      for (size_t lod_ind = 0; lod_ind < lods.size(); ++lod_ind) {
+        screen_size /= 2;
+        lod_node->AddLevel(lods[lod_ind], material,
+            lod_ind + 1 < lods.size() ? screen_size : 0);
+      }
     }
 
     // The node transform
@@ -467,8 +498,9 @@ AssimpMaterial Importer::LoadMaterial(const aiMaterial& mat) {
 }  // namespace
 
 Scene::Ptr ImportAssimpFile(ResourceManager::Ptr resources,
-    const QString& fname, const QString& scene_name) {
-  return Importer(resources).ImportFile(fname, scene_name);
+    const QString& fname, const QString& scene_name,
+    const AssetImporter::LodOptions& lod_options) {
+  return Importer(resources, lod_options).ImportFile(fname, scene_name);
 }
 
 }  // namespace sv
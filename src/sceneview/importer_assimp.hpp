@@ -3,6 +3,7 @@
 #ifndef SCENEVIEW_ASSIMP_IMPORTER_HPP__
 #define SCENEVIEW_ASSIMP_IMPORTER_HPP__
 
+#include <sceneview/asset_importer.hpp>
 #include <sceneview/scene.hpp>
 #include <sceneview/resource_manager.hpp>
 
@@ -13,10 +14,14 @@ namespace sv {
  *
  * @param fname file name. This can also be a Qt resource specifier (e.g.,
  * ":/assets/model.obj")
+ * @param lod_options if lod_options.num_levels is not zero, then levels of
+ * detail are generated for each mesh.
  */
 Scene::Ptr ImportAssimpFile(ResourceManager::Ptr resources,
     const QString& fname,
-    const QString& scene_name = ResourceManager::kAutoName);
+    const QString& scene_name = ResourceManager::kAutoName,
+    const AssetImporter::LodOptions& lod_options =
+        AssetImporter::LodOptions());
 
 }  // namespace sv
 
@@ -0,0 +1,178 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/internal_gl.hpp"
+#include "sceneview/instanced_draw_node.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <QOpenGLBuffer>
+
+#include "sceneview/gl_state.hpp"
+
+namespace sv {
+
+struct InstancedDrawNode::Priv {
+  std::vector<QMatrix4x4> transforms;
+  std::vector<QVector4D> colors;
+
+  // Per-instance attributes, in the layout uploaded to graphics memory.
+  std::vector<InstanceAttributes> attributes;
+
+  bool created_buffer = false;
+  QOpenGLBuffer buffer;
+
+  // Number of instances that fit in the allocated buffer.
+  int buffer_capacity = 0;
+
+  // Range of instances that need to be uploaded.
+  int dirty_first = 0;
+  int dirty_last = 0;
+
+  AxisAlignedBox bounding_box;
+  bool bounding_box_dirty = true;
+};
+
+InstancedDrawNode::InstancedDrawNode(const QString& name) :
+  DrawNode(name),
+  p_(new Priv()) {
+  p_->buffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+  p_->buffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+}
+
+InstancedDrawNode::~InstancedDrawNode() {
+  if (p_->created_buffer) {
+    p_->buffer.destroy();
+  }
+  delete p_;
+}
+
+void InstancedDrawNode::SetInstances(
+    const std::vector<QMatrix4x4>& transforms) {
+  SetInstances(transforms,
+      std::vector<QVector4D>(transforms.size(), QVector4D(1, 1, 1, 1)));
+}
+
+void InstancedDrawNode::SetInstances(const std::vector<QMatrix4x4>& transforms,
+    const std::vector<QVector4D>& colors) {
+  if (transforms.size() != colors.size()) {
+    throw std::invalid_argument("#transforms != #colors");
+  }
+  p_->transforms = transforms;
+  p_->colors = colors;
+  p_->attributes.resize(transforms.size());
+  InstancesChanged(0, transforms.size());
+  BoundingBoxChanged();
+}
+
+void InstancedDrawNode::UpdateInstances(int first,
+    const std::vector<QMatrix4x4>& transforms) {
+  const int last = first + transforms.size();
+  if (first < 0 || last > NumInstances()) {
+    throw std::invalid_argument("Instance range out of bounds");
+  }
+  std::copy(transforms.begin(), transforms.end(),
+      p_->transforms.begin() + first);
+  InstancesChanged(first, last);
+  BoundingBoxChanged();
+}
+
+void InstancedDrawNode::UpdateInstanceColors(int first,
+    const std::vector<QVector4D>& colors) {
+  const int last = first + colors.size();
+  if (first < 0 || last > NumInstances()) {
+    throw std::invalid_argument("Instance range out of bounds");
+  }
+  std::copy(colors.begin(), colors.end(), p_->colors.begin() + first);
+  InstancesChanged(first, last);
+}
+
+int InstancedDrawNode::NumInstances() const { return p_->transforms.size(); }
+
+const std::vector<QMatrix4x4>& InstancedDrawNode::InstanceTransforms() const {
+  return p_->transforms;
+}
+
+const std::vector<QVector4D>& InstancedDrawNode::InstanceColors() const {
+  return p_->colors;
+}
+
+const AxisAlignedBox& InstancedDrawNode::WorldBoundingBox() {
+  if (p_->bounding_box_dirty) {
+    AxisAlignedBox drawables_box;
+    for (const Drawable::Ptr& drawable : Drawables()) {
+      drawables_box.IncludeBox(drawable->BoundingBox());
+    }
+
+    AxisAlignedBox box;
+    if (drawables_box.Valid()) {
+      for (const QMatrix4x4& transform : p_->transforms) {
+        box.IncludeBox(drawables_box.Transformed(transform));
+      }
+    }
+    p_->bounding_box = box.Valid() ? box.Transformed(WorldTransform()) : box;
+    p_->bounding_box_dirty = false;
+  }
+  return p_->bounding_box;
+}
+
+void InstancedDrawNode::BoundingBoxChanged() {
+  p_->bounding_box_dirty = true;
+  DrawNode::BoundingBoxChanged();
+}
+
+QOpenGLBuffer* InstancedDrawNode::InstanceBuffer(GLState* gl_state) {
+  if (!p_->created_buffer) {
+    p_->buffer.create();
+    p_->created_buffer = true;
+  }
+  gl_state->BindArrayBuffer(p_->buffer.bufferId());
+
+  const int num_instances = NumInstances();
+  if (num_instances > p_->buffer_capacity) {
+    p_->buffer.allocate(p_->attributes.data(),
+        num_instances * sizeof(InstanceAttributes));
+    p_->buffer_capacity = num_instances;
+    CountBytesUploaded(num_instances * sizeof(InstanceAttributes));
+  } else if (p_->dirty_first < p_->dirty_last) {
+    p_->buffer.write(p_->dirty_first * sizeof(InstanceAttributes),
+        &p_->attributes[p_->dirty_first],
+        (p_->dirty_last - p_->dirty_first) * sizeof(InstanceAttributes));
+    CountBytesUploaded(
+        (p_->dirty_last - p_->dirty_first) * sizeof(InstanceAttributes));
+  }
+  p_->dirty_first = 0;
+  p_->dirty_last = 0;
+  return &p_->buffer;
+}
+
+void InstancedDrawNode::InstancesChanged(int first, int last) {
+  for (int index = first; index < last; ++index) {
+    InstanceAttributes& attributes = p_->attributes[index];
+    const QMatrix4x4& transform = p_->transforms[index];
+    const QMatrix3x3 normal_mat = transform.normalMatrix();
+    const QVector4D& color = p_->colors[index];
+
+    // Both matrices are stored in column-major order, as expected by
+    // OpenGL.
+    std::copy(transform.constData(), transform.constData() + 16,
+        attributes.model_mat);
+    std::copy(normal_mat.constData(), normal_mat.constData() + 9,
+        attributes.normal_mat);
+    attributes.color[0] = color.x();
+    attributes.color[1] = color.y();
+    attributes.color[2] = color.z();
+    attributes.color[3] = color.w();
+  }
+
+  if (p_->dirty_first < p_->dirty_last) {
+    p_->dirty_first = std::min(p_->dirty_first, first);
+    p_->dirty_last = std::max(p_->dirty_last, last);
+  } else {
+    p_->dirty_first = first;
+    p_->dirty_last = last;
+  }
+}
+
+}  // namespace sv
@@ -0,0 +1,129 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_INSTANCED_DRAW_NODE_HPP__
+#define SCENEVIEW_INSTANCED_DRAW_NODE_HPP__
+
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QVector4D>
+
+#include <sceneview/draw_node.hpp>
+
+class QOpenGLBuffer;
+
+namespace sv {
+
+class GLState;
+
+/**
+ * Draw node that draws its drawables many times with a single draw call, once
+ * per instance.
+ *
+ * Each instance has a transform, applied before the node's world transform,
+ * and a color. Instances are drawn with glDrawElementsInstanced() or
+ * glDrawArraysInstanced(), and the instance transforms and colors are passed
+ * to the shader as per-instance vertex attributes:
+ *
+ * @code
+ * attribute mat4 sv_instance_model_mat;
+ * attribute mat3 sv_instance_normal_mat;
+ * attribute vec4 sv_instance_color;
+ * @endcode
+ *
+ * The stock shaders StockResources::kUniformColorNoLightingInstanced and
+ * StockResources::kUniformColorLightingInstanced declare these attributes.
+ * With other shaders, or if instanced drawing is not supported, each instance
+ * is drawn separately.
+ *
+ * The node is culled as a whole, using the bounding box of all instances.
+ *
+ * InstancedDrawNode objects cannot be directly instantiated. Instead, use
+ * Scene::MakeInstancedDrawNode().
+ *
+ * @ingroup sv_scenegraph
+ * @headerfile sceneview/instanced_draw_node.hpp
+ */
+class InstancedDrawNode : public DrawNode {
+ public:
+  virtual ~InstancedDrawNode();
+
+  /**
+   * Replaces all instances. Each instance is colored white.
+   */
+  void SetInstances(const std::vector<QMatrix4x4>& transforms);
+
+  /**
+   * Replaces all instances.
+   *
+   * @param transforms the transform of each instance.
+   * @param colors the color of each instance. Must be the same size as
+   *        transforms.
+   */
+  void SetInstances(const std::vector<QMatrix4x4>& transforms,
+      const std::vector<QVector4D>& colors);
+
+  /**
+   * Replaces the transforms of instances [first, first + transforms.size()).
+   *
+   * Only the modified range is uploaded to graphics memory.
+   */
+  void UpdateInstances(int first, const std::vector<QMatrix4x4>& transforms);
+
+  /**
+   * Replaces the colors of instances [first, first + colors.size()).
+   *
+   * Only the modified range is uploaded to graphics memory.
+   */
+  void UpdateInstanceColors(int first, const std::vector<QVector4D>& colors);
+
+  int NumInstances() const;
+
+  const std::vector<QMatrix4x4>& InstanceTransforms() const;
+
+  const std::vector<QVector4D>& InstanceColors() const;
+
+  const AxisAlignedBox& WorldBoundingBox() override;
+
+ protected:
+  void BoundingBoxChanged() override;
+
+ private:
+  friend class Scene;
+
+  friend class DrawContext;
+
+  explicit InstancedDrawNode(const QString& name);
+
+  InstancedDrawNode* Instanced() override { return this; }
+
+  /**
+   * Retrieve the buffer holding the per-instance attributes, after uploading
+   * any pending changes. The buffer is left bound to GL_ARRAY_BUFFER.
+   */
+  QOpenGLBuffer* InstanceBuffer(GLState* gl_state);
+
+  /**
+   * Marks instances [first, last) as needing to be uploaded.
+   */
+  void InstancesChanged(int first, int last);
+
+  struct Priv;
+
+  Priv* p_;
+};
+
+/**
+ * Layout of the per-instance attributes in InstancedDrawNode buffers.
+ *
+ * Internal struct, not part of the public API.
+ */
+struct InstanceAttributes {
+  float model_mat[16];
+  float normal_mat[9];
+  float color[4];
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_INSTANCED_DRAW_NODE_HPP__
@@ -2,8 +2,14 @@
 
 #include "sceneview/internal_gl.hpp"
 
+#include <atomic>
+
+#include <QOpenGLContext>
+
 namespace sv {
 
+static std::atomic<int64_t> g_num_bytes_uploaded(0);
+
 const char* glErrorString(GLenum error) {
   switch (error) {
     case GL_NO_ERROR:
@@ -27,4 +33,51 @@ const char* glErrorString(GLenum error) {
   }
 }
 
+bool UniformBlocksSupported() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  return context &&
+      context->hasExtension("GL_ARB_uniform_buffer_object");
+}
+
+bool InstancingSupported() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  return context &&
+      context->hasExtension("GL_ARB_draw_instanced") &&
+      context->hasExtension("GL_ARB_instanced_arrays");
+}
+
+bool GeometryBatchingSupported() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  return context &&
+      context->hasExtension("GL_ARB_draw_elements_base_vertex") &&
+      context->hasExtension("GL_ARB_copy_buffer");
+}
+
+bool OcclusionQueriesSupported() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  return context &&
+      (context->format().version() >= qMakePair(1, 5) ||
+       context->hasExtension("GL_ARB_occlusion_query"));
+}
+
+bool ConditionalRenderSupported() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  return context && context->format().version() >= qMakePair(3, 0);
+}
+
+bool TimerQueriesSupported() {
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  return context &&
+      (context->format().version() >= qMakePair(3, 3) ||
+       context->hasExtension("GL_ARB_timer_query"));
+}
+
+void CountBytesUploaded(int64_t num_bytes) {
+  g_num_bytes_uploaded += num_bytes;
+}
+
+int64_t NumBytesUploaded() {
+  return g_num_bytes_uploaded;
+}
+
 }  // namespace sv
@@ -11,12 +11,63 @@
 #include <GL/glext.h>
 #endif
 
+#include <cstdint>
 #include <string>
 
 namespace sv {
 
 const char* glErrorString(GLenum error);
 
+/**
+ * Checks if the current OpenGL context supports uniform buffer objects and
+ * GLSL uniform blocks (GL_ARB_uniform_buffer_object).
+ */
+bool UniformBlocksSupported();
+
+/**
+ * Checks if the current OpenGL context supports instanced drawing with
+ * per-instance vertex attributes (GL_ARB_draw_instanced and
+ * GL_ARB_instanced_arrays).
+ */
+bool InstancingSupported();
+
+/**
+ * Checks if the current OpenGL context supports the features needed to draw
+ * geometry out of shared buffers (GL_ARB_draw_elements_base_vertex and
+ * GL_ARB_copy_buffer).
+ */
+bool GeometryBatchingSupported();
+
+/**
+ * Checks if the current OpenGL context supports GL_SAMPLES_PASSED occlusion
+ * queries.
+ */
+bool OcclusionQueriesSupported();
+
+/**
+ * Checks if the current OpenGL context supports conditional rendering
+ * (OpenGL 3.0).
+ */
+bool ConditionalRenderSupported();
+
+/**
+ * Checks if the current OpenGL context supports GL_TIME_ELAPSED timer
+ * queries (GL_ARB_timer_query).
+ */
+bool TimerQueriesSupported();
+
+/**
+ * Adds to the number of bytes uploaded to OpenGL buffer objects. Can be
+ * called from any thread.
+ */
+void CountBytesUploaded(int64_t num_bytes);
+
+/**
+ * Total number of bytes uploaded to OpenGL buffer objects by all contexts
+ * since the program started.
+ */
+int64_t NumBytesUploaded();
+
 }
 
 #endif  // INTERNAL_GL_H__
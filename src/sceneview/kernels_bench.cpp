@@ -0,0 +1,335 @@
+// Copyright [2015] Albert Huang
+//
+// Micro-benchmarks for the CPU kernels of the scene graph: bounding box
+// math, plane and frustum construction, frustum culling, transform
+// composition, world transform and bounding box propagation, ray cast
+// selection, and building and tearing down scenes. None of them need an
+// OpenGL context.
+//
+// Sizes and tree shapes are benchmark arguments, so for example
+//   sv_kernels_bench --benchmark_filter=WorldTransform
+// compares deep and wide trees.
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QQuaternion>
+#include <QVector3D>
+
+#include "sceneview/affine_transform.hpp"
+#include "sceneview/axis_aligned_box.hpp"
+#include "sceneview/camera_node.hpp"
+#include "sceneview/draw_node.hpp"
+#include "sceneview/drawable.hpp"
+#include "sceneview/frustum.hpp"
+#include "sceneview/group_node.hpp"
+#include "sceneview/plane.hpp"
+#include "sceneview/resource_manager.hpp"
+#include "sceneview/scene.hpp"
+#include "sceneview/selection_query.hpp"
+#include "sceneview/test_scenes.hpp"
+
+using sv::AffineTransform;
+using sv::AxisAlignedBox;
+using sv::BoxArray;
+using sv::CameraNode;
+using sv::DrawNode;
+using sv::Drawable;
+using sv::Frustum;
+using sv::GroupNode;
+using sv::Plane;
+using sv::QueryResult;
+using sv::ResourceManager;
+using sv::Scene;
+using sv::SelectionQuery;
+using sv::test::BoxDrawable;
+using sv::test::TreeScene;
+
+namespace {
+
+std::vector<AxisAlignedBox> RandomBoxes(int num_boxes, float spread) {
+  std::mt19937 rng(num_boxes);
+  std::uniform_real_distribution<float> center_dist(-spread, spread);
+  std::uniform_real_distribution<float> size_dist(0.1, 5);
+  std::vector<AxisAlignedBox> boxes;
+  boxes.reserve(num_boxes);
+  for (int i = 0; i < num_boxes; ++i) {
+    const QVector3D center(center_dist(rng), center_dist(rng),
+        center_dist(rng));
+    const QVector3D half_size(size_dist(rng), size_dist(rng), size_dist(rng));
+    boxes.emplace_back(center - half_size, center + half_size);
+  }
+  return boxes;
+}
+
+// Frustum of a camera at the origin looking down the +x axis.
+Frustum MakeFrustum() {
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  CameraNode* camera = scene->MakeCamera(scene->Root());
+  camera->SetViewportSize(1280, 720);
+  camera->SetPerspective(60, 1, 300);
+  camera->LookAt(QVector3D(0, 0, 0), QVector3D(1, 0, 0), QVector3D(0, 0, 1));
+  return Frustum(camera);
+}
+
+// Tree shapes as {depth, branching} pairs with 4096 or so leaves, from a
+// flat tree to a binary tree, plus a long chain.
+void TreeShapes(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({ "depth", "branching" });
+  bench->Args({ 1, 4096 });
+  bench->Args({ 2, 64 });
+  bench->Args({ 3, 16 });
+  bench->Args({ 4, 8 });
+  bench->Args({ 6, 4 });
+  bench->Args({ 12, 2 });
+  bench->Args({ 256, 1 });
+}
+
+}  // namespace
+
+static void BM_AxisAlignedBoxTransformed(benchmark::State& state) {
+  const std::vector<AxisAlignedBox> boxes = RandomBoxes(state.range(0), 100);
+  QMatrix4x4 transform;
+  transform.translate(1, 2, 3);
+  transform.rotate(30, QVector3D(1, 1, 0).normalized());
+  for (auto _ : state) {
+    for (const AxisAlignedBox& box : boxes) {
+      benchmark::DoNotOptimize(box.Transformed(transform));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_AxisAlignedBoxTransformed)->Range(64, 64 << 10);
+
+static void BM_AxisAlignedBoxSquaredDistance(benchmark::State& state) {
+  const std::vector<AxisAlignedBox> boxes = RandomBoxes(state.range(0), 100);
+  const QVector3D point(3, -7, 11);
+  for (auto _ : state) {
+    double sum = 0;
+    for (const AxisAlignedBox& box : boxes) {
+      sum += box.SquaredDistance(point);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_AxisAlignedBoxSquaredDistance)->Range(64, 64 << 10);
+
+static void BM_PlaneFromThreePoints(benchmark::State& state) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-100, 100);
+  std::vector<QVector3D> points(3 * state.range(0));
+  for (QVector3D& point : points) {
+    point = QVector3D(dist(rng), dist(rng), dist(rng));
+  }
+  for (auto _ : state) {
+    for (size_t i = 0; i < points.size(); i += 3) {
+      benchmark::DoNotOptimize(
+          Plane::FromThreePoints(points[i], points[i + 1], points[i + 2]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PlaneFromThreePoints)->Range(64, 64 << 10);
+
+static void BM_FrustumFromCamera(benchmark::State& state) {
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  CameraNode* camera = scene->MakeCamera(scene->Root());
+  camera->SetViewportSize(1280, 720);
+  camera->SetPerspective(60, 1, 300);
+  camera->LookAt(QVector3D(0, 0, 0), QVector3D(1, 0, 0), QVector3D(0, 0, 1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Frustum(camera));
+  }
+}
+BENCHMARK(BM_FrustumFromCamera);
+
+static void BM_FrustumIntersects(benchmark::State& state) {
+  const Frustum frustum = MakeFrustum();
+  std::vector<AxisAlignedBox> boxes = RandomBoxes(state.range(0), 150);
+  for (AxisAlignedBox& box : boxes) {
+    box = AxisAlignedBox(box.Min() + QVector3D(150, 0, 0),
+        box.Max() + QVector3D(150, 0, 0));
+  }
+  for (auto _ : state) {
+    int num_visible = 0;
+    for (const AxisAlignedBox& box : boxes) {
+      num_visible += frustum.Intersects(box);
+    }
+    benchmark::DoNotOptimize(num_visible);
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_FrustumIntersects)->Range(1 << 10, 1 << 20);
+
+static void BM_FrustumCullBoxes(benchmark::State& state) {
+  const Frustum frustum = MakeFrustum();
+  BoxArray box_array;
+  for (const AxisAlignedBox& box : RandomBoxes(state.range(0), 150)) {
+    box_array.Add(AxisAlignedBox(box.Min() + QVector3D(150, 0, 0),
+          box.Max() + QVector3D(150, 0, 0)));
+  }
+  std::vector<uint32_t> visible;
+  visible.reserve(box_array.Size());
+  for (auto _ : state) {
+    visible.clear();
+    frustum.CullBoxes(box_array, Frustum::kAllPlanes, state.range(1),
+        &visible);
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * box_array.Size());
+}
+BENCHMARK(BM_FrustumCullBoxes)
+  ->ArgNames({ "boxes", "spheres" })
+  ->ArgsProduct({ { 1 << 10, 1 << 15, 1 << 20 }, { 0, 1 } });
+
+// Random translation, rotation, and scale values.
+struct TrsValues {
+  explicit TrsValues(int num_values) {
+    std::mt19937 rng(num_values);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for (int i = 0; i < num_values; ++i) {
+      translations.emplace_back(dist(rng) * 10, dist(rng) * 10,
+          dist(rng) * 10);
+      rotations.push_back(QQuaternion::fromAxisAndAngle(
+            QVector3D(dist(rng), dist(rng), 1).normalized(), dist(rng) * 180));
+      scales.emplace_back(1 + dist(rng) / 2, 1 + dist(rng) / 2, 1);
+    }
+  }
+
+  std::vector<QVector3D> translations;
+  std::vector<QQuaternion> rotations;
+  std::vector<QVector3D> scales;
+};
+
+// Parent * Translation * Rotation * Scale with QMatrix4x4, as SceneNode used
+// to compute world transforms.
+static void BM_ComposeMatrix4x4(benchmark::State& state) {
+  const TrsValues values(state.range(0));
+  QMatrix4x4 parent;
+  parent.translate(1, 2, 3);
+  parent.rotate(30, QVector3D(1, 1, 0).normalized());
+  for (auto _ : state) {
+    for (size_t i = 0; i < values.translations.size(); ++i) {
+      QMatrix4x4 world = parent;
+      world.translate(values.translations[i]);
+      world.rotate(values.rotations[i]);
+      world.scale(values.scales[i]);
+      benchmark::DoNotOptimize(world.constData());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.translations.size());
+}
+BENCHMARK(BM_ComposeMatrix4x4)->Range(64, 64 << 10);
+
+// The same with AffineTransform, as SceneNode computes world transforms.
+// The result is written into a QMatrix4x4, as WorldTransform() returns.
+static void BM_ComposeAffine(benchmark::State& state) {
+  const TrsValues values(state.range(0));
+  QMatrix4x4 parent;
+  AffineTransform::FromTrs(QVector3D(1, 2, 3),
+      QQuaternion::fromAxisAndAngle(QVector3D(1, 1, 0).normalized(), 30),
+      QVector3D(1, 1, 1)).ToMatrix4x4(&parent);
+  QMatrix4x4 world;
+  for (auto _ : state) {
+    for (size_t i = 0; i < values.translations.size(); ++i) {
+      AffineTransform::Multiply(parent,
+          AffineTransform::FromTrs(values.translations[i],
+            values.rotations[i], values.scales[i]), &world);
+      benchmark::DoNotOptimize(world.constData());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.translations.size());
+}
+BENCHMARK(BM_ComposeAffine)->Range(64, 64 << 10);
+
+static void BM_WorldTransform(benchmark::State& state) {
+  TreeScene tree(state.range(0), state.range(1));
+  for (auto _ : state) {
+    state.PauseTiming();
+    tree.Invalidate();
+    state.ResumeTiming();
+    for (DrawNode* leaf : tree.leaves) {
+      benchmark::DoNotOptimize(leaf->WorldTransform());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * tree.leaves.size());
+}
+BENCHMARK(BM_WorldTransform)->Apply(TreeShapes);
+
+static void BM_GroupWorldBoundingBox(benchmark::State& state) {
+  TreeScene tree(state.range(0), state.range(1));
+  for (auto _ : state) {
+    state.PauseTiming();
+    tree.Invalidate();
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(tree.scene->Root()->WorldBoundingBox());
+  }
+  state.SetItemsProcessed(state.iterations() * tree.leaves.size());
+}
+BENCHMARK(BM_GroupWorldBoundingBox)->Apply(TreeShapes);
+
+// Creates state.range(0) draw nodes under groups of 1000, then destroys them
+// one group at a time, and then tears down the scene.
+static void BM_SceneBuildAndDestroy(benchmark::State& state) {
+  const int num_nodes = state.range(0);
+  const int group_size = 1000;
+  Drawable::Ptr drawable(new BoxDrawable());
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  std::vector<GroupNode*> groups;
+  for (auto _ : state) {
+    Scene::Ptr scene = resources->MakeScene();
+    groups.clear();
+    for (int ind = 0; ind < num_nodes; ++ind) {
+      if (ind % group_size == 0) {
+        groups.push_back(scene->MakeGroup(scene->Root()));
+      }
+      scene->MakeDrawNode(groups.back())->Add(drawable);
+    }
+    for (int ind = 0; ind < static_cast<int>(groups.size()); ind += 2) {
+      scene->DestroyNode(groups[ind]);
+    }
+    scene.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * num_nodes);
+}
+BENCHMARK(BM_SceneBuildAndDestroy)->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_SelectionIntersection(benchmark::State& state) {
+  const std::vector<AxisAlignedBox> boxes = RandomBoxes(state.range(0), 100);
+  const QVector3D start(-200, -3, 5);
+  const QVector3D dir = QVector3D(1, 0.01, -0.02).normalized();
+  for (auto _ : state) {
+    int num_hits = 0;
+    double distance;
+    for (const AxisAlignedBox& box : boxes) {
+      num_hits += SelectionQuery::Intersection(box, start, dir, &distance);
+    }
+    benchmark::DoNotOptimize(num_hits);
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_SelectionIntersection)->Range(64, 64 << 10);
+
+static void BM_SelectionCastRay(benchmark::State& state) {
+  TreeScene tree(state.range(0), state.range(1));
+  tree.scene->Root()->WorldBoundingBox();
+  SelectionQuery query(tree.scene);
+  const QVector3D start(-100, 0.5, 0.5);
+  const QVector3D dir(1, 0.01, 0.02);
+  for (auto _ : state) {
+    std::vector<QueryResult> results = query.CastRay(1, start, dir);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * tree.leaves.size());
+}
+BENCHMARK(BM_SelectionCastRay)->Apply(TreeShapes);
+
+BENCHMARK_MAIN();
@@ -2,11 +2,13 @@
 
 #include "sceneview/light_node.hpp"
 
+#include "sceneview/object_pool.hpp"
+
 namespace sv {
 
 const AxisAlignedBox LightNode::kBoundingBox;
 
-struct LightNode::Priv {
+struct LightNode::Priv : PooledObject<LightNode::Priv> {
   LightType light_type;
   QVector3D direction;
   QVector3D color;
@@ -0,0 +1,141 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/lod_draw_node.hpp"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace sv {
+
+constexpr double LodDrawNode::kDefaultHysteresis;
+
+struct LodDrawNode::Priv {
+  std::vector<std::vector<Drawable::Ptr>> level_drawables;
+  std::vector<double> level_screen_sizes;
+
+  double hysteresis = kDefaultHysteresis;
+
+  // The level drawn in the most recent frame. Equal to the number of levels
+  // if none was drawn, and -1 before the first selection.
+  int current_level = -1;
+};
+
+LodDrawNode::LodDrawNode(const QString& name) :
+  DrawNode(name),
+  p_(new Priv()) {}
+
+LodDrawNode::~LodDrawNode() {
+  delete p_;
+}
+
+int LodDrawNode::AddLevel(const std::vector<Drawable::Ptr>& drawables,
+    double min_screen_size) {
+  if (!p_->level_screen_sizes.empty() &&
+      min_screen_size > p_->level_screen_sizes.back()) {
+    throw std::invalid_argument(
+        "Level screen sizes must not increase with the level");
+  }
+  p_->level_drawables.push_back(drawables);
+  p_->level_screen_sizes.push_back(min_screen_size);
+  p_->current_level = -1;
+  for (const Drawable::Ptr& drawable : drawables) {
+    Add(drawable);
+  }
+  return NumLevels() - 1;
+}
+
+int LodDrawNode::AddLevel(const GeometryResource::Ptr& geometry,
+    const MaterialResource::Ptr& material, double min_screen_size) {
+  return AddLevel(std::vector<Drawable::Ptr>{
+      Drawable::Create(geometry, material) }, min_screen_size);
+}
+
+int LodDrawNode::NumLevels() const {
+  return p_->level_screen_sizes.size();
+}
+
+const std::vector<Drawable::Ptr>& LodDrawNode::LevelDrawables(
+    int level) const {
+  if (level < 0 || level >= NumLevels()) {
+    throw std::invalid_argument("Invalid level");
+  }
+  return p_->level_drawables[level];
+}
+
+double LodDrawNode::LevelScreenSize(int level) const {
+  if (level < 0 || level >= NumLevels()) {
+    throw std::invalid_argument("Invalid level");
+  }
+  return p_->level_screen_sizes[level];
+}
+
+void LodDrawNode::SetHysteresis(double hysteresis) {
+  p_->hysteresis = hysteresis;
+}
+
+double LodDrawNode::GetHysteresis() const {
+  return p_->hysteresis;
+}
+
+int LodDrawNode::CurrentLevel() const {
+  return p_->current_level < NumLevels() ? p_->current_level : -1;
+}
+
+double LodDrawNode::ScreenSize(const AxisAlignedBox& box,
+    const QMatrix4x4& proj_mat, const QVector3D& eye) {
+  if (!box.Valid()) {
+    return 0;
+  }
+  const QVector3D center = (box.Min() + box.Max()) / 2;
+  const double radius = (box.Max() - box.Min()).length() / 2;
+
+  // The second diagonal element of the projection matrix scales view
+  // heights to normalized device coordinates, which span a height of 2.
+  const double scale = proj_mat(1, 1);
+  if (proj_mat(3, 3) == 1) {
+    // Orthographic projection.
+    return radius * scale;
+  }
+  const double distance = (center - eye).length();
+  if (distance <= radius) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return radius * scale / distance;
+}
+
+const std::vector<Drawable::Ptr>* LodDrawNode::SelectLevel(
+    double screen_size) {
+  const std::vector<double>& thresholds = p_->level_screen_sizes;
+  const int num_levels = thresholds.size();
+  const int current = p_->current_level;
+
+  // Keep the current level while the screen size is within its range,
+  // widened by the hysteresis. With no level drawn, the range is below the
+  // threshold of the last level.
+  bool keep = false;
+  if (current >= 0) {
+    const double lower = current < num_levels ?
+        thresholds[current] * (1 - p_->hysteresis) : 0;
+    const double upper = current > 0 ?
+        thresholds[current - 1] * (1 + p_->hysteresis) :
+        std::numeric_limits<double>::infinity();
+    keep = screen_size >= lower && screen_size < upper;
+  }
+
+  if (!keep) {
+    int level = 0;
+    while (level < num_levels && screen_size < thresholds[level]) {
+      ++level;
+    }
+    p_->current_level = level;
+  }
+
+  if (p_->current_level >= num_levels) {
+    return nullptr;
+  }
+  return &p_->level_drawables[p_->current_level];
+}
+
+}  // namespace sv
@@ -0,0 +1,127 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_LOD_DRAW_NODE_HPP__
+#define SCENEVIEW_LOD_DRAW_NODE_HPP__
+
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include <sceneview/draw_node.hpp>
+
+namespace sv {
+
+/**
+ * Draw node with several levels of detail, of which only one is drawn at a
+ * time, depending on how large the node appears on screen.
+ *
+ * Level 0 is the most detailed. Each level has a minimum screen size, and
+ * the first level whose minimum the node's screen size reaches is drawn. If
+ * the node is smaller than the minimum of every level, then nothing is
+ * drawn. Give the last level a minimum screen size of 0 to always draw
+ * something.
+ *
+ * The screen size is the height of the bounding sphere of the node's world
+ * bounding box, as a fraction of the viewport height (see ScreenSize()). It
+ * accounts for both the distance to the camera and the field of view.
+ *
+ * To avoid rapidly switching back and forth between two levels when the
+ * screen size hovers around a threshold, the level drawn in the previous
+ * frame is kept until the screen size moves outside of that level's range by
+ * more than a fraction of the threshold. See SetHysteresis().
+ *
+ * The node is culled using the bounding box of all levels. Drawables must be
+ * attached with AddLevel(). Drawables attached with DrawNode::Add() are not
+ * part of any level, and are not drawn.
+ *
+ * Levels can be generated from a full detail mesh with
+ * MeshSimplifier::MakeLodChain().
+ *
+ * LodDrawNode objects cannot be directly instantiated. Instead, use
+ * Scene::MakeLodDrawNode().
+ *
+ * @ingroup sv_scenegraph
+ * @headerfile sceneview/lod_draw_node.hpp
+ */
+class LodDrawNode : public DrawNode {
+ public:
+  static constexpr double kDefaultHysteresis = 0.1;
+
+  virtual ~LodDrawNode();
+
+  /**
+   * Adds a level, less detailed than the levels already added.
+   *
+   * @param drawables the drawables of the level.
+   * @param min_screen_size the smallest screen size at which the level is
+   * drawn. Must not be larger than the minimum of the previous level.
+   *
+   * @return the index of the new level.
+   */
+  int AddLevel(const std::vector<Drawable::Ptr>& drawables,
+      double min_screen_size);
+
+  /**
+   * Convenience method to add a level with a single drawable.
+   */
+  int AddLevel(const GeometryResource::Ptr& geometry,
+      const MaterialResource::Ptr& material, double min_screen_size);
+
+  int NumLevels() const;
+
+  const std::vector<Drawable::Ptr>& LevelDrawables(int level) const;
+
+  double LevelScreenSize(int level) const;
+
+  /**
+   * Sets how far past a level's thresholds the screen size must move before
+   * switching away from the level, as a fraction of the threshold.
+   */
+  void SetHysteresis(double hysteresis);
+
+  double GetHysteresis() const;
+
+  /**
+   * The level drawn in the most recent frame, or -1 if none was drawn.
+   */
+  int CurrentLevel() const;
+
+  /**
+   * Computes the height of the bounding sphere of a box on screen, as a
+   * fraction of the viewport height.
+   *
+   * @param box the box, in the world frame.
+   * @param proj_mat the camera projection matrix.
+   * @param eye the camera position, in the world frame.
+   *
+   * @return the screen size, which may be larger than 1, or infinity if the
+   * camera is inside the bounding sphere of a perspective projection.
+   */
+  static double ScreenSize(const AxisAlignedBox& box,
+      const QMatrix4x4& proj_mat, const QVector3D& eye);
+
+ private:
+  friend class Scene;
+
+  friend class DrawContext;
+
+  explicit LodDrawNode(const QString& name);
+
+  LodDrawNode* Lod() override { return this; }
+
+  /**
+   * Picks the level to draw for a screen size.
+   *
+   * @return the drawables of the level, or nullptr if no level is drawn.
+   */
+  const std::vector<Drawable::Ptr>* SelectLevel(double screen_size);
+
+  struct Priv;
+
+  Priv* p_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_LOD_DRAW_NODE_HPP__
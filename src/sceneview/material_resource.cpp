@@ -2,8 +2,12 @@
 
 #include "sceneview/material_resource.hpp"
 
+#include <cstdio>
+#include <cstring>
 #include <vector>
 
+#include "sceneview/compiled_material.hpp"
+
 namespace sv {
 
 bool StencilFaceSettings::operator!=(const StencilFaceSettings& other) const {
@@ -54,6 +58,13 @@ struct MaterialResource::Priv {
   GLenum blend_dfactor = GL_ZERO;
 
   TextureDictionary textures;
+
+  uint32_t sort_id;
+
+  CompiledMaterial compiled;
+
+  // True if the shader parameters or textures changed since compiling.
+  bool compiled_dirty = true;
 };
 
 MaterialResource::~MaterialResource() { delete p_; }
@@ -61,14 +72,18 @@ MaterialResource::~MaterialResource() { delete p_; }
 const ShaderResource::Ptr& MaterialResource::Shader() { return p_->shader; }
 
 ShaderUniformMap& MaterialResource::ShaderParameters() {
+  // The caller may modify the parameters.
+  p_->compiled_dirty = true;
   return p_->shader_parameters;
 }
 
 MaterialResource::MaterialResource(const QString& name,
                                    ShaderResource::Ptr shader)
     : p_(new Priv()) {
+  static uint32_t next_sort_id = 0;
   p_->name = name;
   p_->shader = shader;
+  p_->sort_id = next_sort_id++;
 }
 
 template <typename ValueType>
@@ -134,46 +149,133 @@ void MaterialResource::BlendFunc(GLenum* sfactor, GLenum* dfactor) {
   *dfactor = p_->blend_dfactor;
 }
 
+bool MaterialResource::Opaque() const {
+  return p_->depth_test && p_->depth_write && p_->color_write &&
+         !p_->blend && !p_->stencil &&
+         (p_->depth_func == GL_LESS || p_->depth_func == GL_LEQUAL);
+}
+
+uint32_t MaterialResource::SortId() const { return p_->sort_id; }
+
+const CompiledMaterial& MaterialResource::Compiled() {
+  CompiledMaterial& compiled = p_->compiled;
+  QOpenGLShaderProgram* program =
+      p_->shader ? p_->shader->Program() : nullptr;
+  if (!program) {
+    compiled.uniforms.clear();
+    compiled.textures.clear();
+    return compiled;
+  }
+
+  const uint64_t shader_generation = p_->shader->LinkGeneration();
+  if (!p_->compiled_dirty && compiled.shader_generation == shader_generation) {
+    return compiled;
+  }
+  p_->compiled_dirty = false;
+  compiled.shader_generation = shader_generation;
+  compiled.uniforms.clear();
+  compiled.textures.clear();
+
+  for (auto& item : p_->shader_parameters) {
+    const ShaderUniform& param = item.second;
+    CompiledUniform uniform;
+    uniform.location = program->uniformLocation(param.Name());
+    if (uniform.location < 0) {
+      printf("Warning: Unable to find uniform %s\n",
+             param.Name().toStdString().c_str());
+      continue;
+    }
+    uniform.type = param.ParamType();
+    switch (uniform.type) {
+      case ShaderUniform::Type::kFloat: {
+        const std::vector<float>& value = param.FloatValue();
+        uniform.size = value.size();
+        if (uniform.size < 1 || uniform.size > 4) {
+          continue;
+        }
+        memcpy(uniform.floats, value.data(), uniform.size * sizeof(float));
+      } break;
+      case ShaderUniform::Type::kInt: {
+        const std::vector<int>& value = param.IntValue();
+        uniform.size = value.size();
+        if (uniform.size < 1 || uniform.size > 4) {
+          continue;
+        }
+        memcpy(uniform.ints, value.data(), uniform.size * sizeof(int));
+      } break;
+      case ShaderUniform::Type::kMat4f:
+        uniform.size = 16;
+        memcpy(uniform.floats, param.Mat4fValue().constData(),
+               sizeof(uniform.floats));
+        break;
+      case ShaderUniform::Type::kInvalid:
+      default:
+        continue;
+    }
+    compiled.uniforms.push_back(uniform);
+  }
+
+  // Each texture gets its own texture unit.
+  int unit = 0;
+  for (auto& item : p_->textures) {
+    CompiledTexture texture;
+    texture.location = program->uniformLocation(item.first);
+    texture.unit = unit++;
+    texture.texture = item.second.get();
+    compiled.textures.push_back(texture);
+  }
+  return compiled;
+}
+
 void MaterialResource::SetParam(const QString& name, int val) {
   SUMapSet(&p_->shader_parameters, name, val);
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::SetParam(const QString& name,
                                 const std::vector<int>& val) {
   SUMapSet(&p_->shader_parameters, name, val);
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::SetParam(const QString& name, float val) {
   SUMapSet(&p_->shader_parameters, name, val);
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::SetParam(const QString& name, float val1, float val2) {
   SUMapSet(&p_->shader_parameters, name, std::vector<float>({val1, val2}));
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::SetParam(const QString& name, float val1, float val2,
                                 float val3) {
   SUMapSet(&p_->shader_parameters, name,
            std::vector<float>({val1, val2, val3}));
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::SetParam(const QString& name, float val1, float val2,
                                 float val3, float val4) {
   SUMapSet(&p_->shader_parameters, name,
            std::vector<float>({val1, val2, val3, val4}));
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::SetParam(const QString& name,
                                 const std::vector<float>& val) {
   SUMapSet(&p_->shader_parameters, name, val);
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::SetParam(const QString& name, const QMatrix4x4& value) {
   SUMapSet(&p_->shader_parameters, name, value);
+  p_->compiled_dirty = true;
 }
 
 void MaterialResource::AddTexture(const QString& name,
                                   const MaterialResource::TexturePtr& texture) {
+  p_->compiled_dirty = true;
   if (texture == nullptr) {
     auto iter = p_->textures.find(name);
     if (iter != p_->textures.end()) {
@@ -16,6 +16,7 @@ class QOpenGLTexture;
 
 namespace sv {
 
+struct CompiledMaterial;
 struct StencilSettings;
 
 /**
@@ -47,6 +48,12 @@ class MaterialResource {
 
   const ShaderResource::Ptr& Shader();
 
+  /**
+   * Retrieve the shader parameters for modification.
+   *
+   * Prefer SetParam(), since calling this forces the parameters to be
+   * recompiled on the next draw.
+   */
   ShaderUniformMap& ShaderParameters();
 
   void SetParam(const QString& name, int val);
@@ -130,11 +137,35 @@ class MaterialResource {
 
   void BlendFunc(GLenum* sfactor, GLenum* dfactor);
 
+  /**
+   * Returns true if drawing with this material is independent of draw order
+   * (i.e., depth tested and depth written, with no blending or stencil
+   * operations).
+   */
+  bool Opaque() const;
+
  private:
   friend class ResourceManager;
 
+  friend class DrawContext;
+
   MaterialResource(const QString& name, ShaderResource::Ptr shader);
 
+  /**
+   * Small integer that uniquely identifies this material, used to group draw
+   * calls by material.
+   */
+  uint32_t SortId() const;
+
+  /**
+   * Retrieve the shader parameters and textures in a form that can be
+   * uploaded directly, recompiling them first if the parameters, textures,
+   * or shader program have changed.
+   *
+   * Must be called with the OpenGL context current.
+   */
+  const CompiledMaterial& Compiled();
+
   struct Priv;
 
   Priv* p_;
@@ -0,0 +1,524 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sceneview/tracing.hpp"
+
+namespace sv {
+
+// Weight of the planes that hold mesh borders in place, relative to the
+// planes of the triangles.
+static constexpr double kBorderWeight = 1000;
+
+namespace {
+
+struct Vec3 {
+  double x;
+  double y;
+  double z;
+};
+
+// Symmetric 4x4 matrix that sums the squared distances of a point to a set
+// of planes.
+struct Quadric {
+  // Upper triangle, row by row.
+  double m[10];
+
+  Quadric() {
+    std::fill(m, m + 10, 0.0);
+  }
+
+  void AddPlane(const Vec3& normal, double d, double weight) {
+    const double a = normal.x;
+    const double b = normal.y;
+    const double c = normal.z;
+    m[0] += weight * a * a;
+    m[1] += weight * a * b;
+    m[2] += weight * a * c;
+    m[3] += weight * a * d;
+    m[4] += weight * b * b;
+    m[5] += weight * b * c;
+    m[6] += weight * b * d;
+    m[7] += weight * c * c;
+    m[8] += weight * c * d;
+    m[9] += weight * d * d;
+  }
+
+  void Add(const Quadric& other) {
+    for (int ind = 0; ind < 10; ++ind) {
+      m[ind] += other.m[ind];
+    }
+  }
+
+  double Error(const Vec3& p) const {
+    const double error =
+        m[0] * p.x * p.x + 2 * m[1] * p.x * p.y + 2 * m[2] * p.x * p.z +
+        2 * m[3] * p.x + m[4] * p.y * p.y + 2 * m[5] * p.y * p.z +
+        2 * m[6] * p.y + m[7] * p.z * p.z + 2 * m[8] * p.z + m[9];
+    return std::max(error, 0.0);
+  }
+};
+
+// Collapse of the position `from` into the position `to`. Collapses are
+// stale if either position changed since the collapse was queued.
+struct Collapse {
+  double cost;
+  int from;
+  int to;
+  uint32_t from_version;
+  uint32_t to_version;
+
+  bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+}  // namespace
+
+static Vec3 Sub(const Vec3& a, const Vec3& b) {
+  return Vec3{a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static Vec3 Cross(const Vec3& a, const Vec3& b) {
+  return Vec3{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+      a.x * b.y - a.y * b.x};
+}
+
+static double Dot(const Vec3& a, const Vec3& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static uint64_t EdgeKey(int a, int b) {
+  return (static_cast<uint64_t>(std::min(a, b)) << 32) |
+      static_cast<uint32_t>(std::max(a, b));
+}
+
+// Copies the values of a per-vertex attribute for a subset of the vertices,
+// unless the attribute is not specified for every vertex.
+template <typename T>
+static void CopyAttribute(const std::vector<T>& from, size_t num_vertices,
+    const std::vector<int>& vertices, std::vector<T>* to) {
+  if (from.size() != num_vertices) {
+    return;
+  }
+  to->reserve(vertices.size());
+  for (int vertex : vertices) {
+    to->push_back(from[vertex]);
+  }
+}
+
+static int NumTriangles(const GeometryData& data) {
+  const size_t num_corners =
+      data.indices.empty() ? data.vertices.size() : data.indices.size();
+  return num_corners / 3;
+}
+
+namespace {
+
+// Edge collapse state. Vertices with the same position are welded together
+// into a single position, and the collapses operate on positions.
+class Simplifier {
+ public:
+  explicit Simplifier(const GeometryData& data);
+
+  void Run(int target_num_triangles);
+
+  GeometryData Result() const;
+
+ private:
+  void QueueCollapses(int a, int b);
+
+  bool CanCollapse(int from, int to) const;
+
+  void DoCollapse(int from, int to);
+
+  // Picks the vertex at the candidates whose attributes are the closest to
+  // those of a vertex.
+  int ClosestVertex(int vertex, const std::vector<int>& candidates) const;
+
+  const GeometryData& data_;
+
+  std::vector<Vec3> positions_;
+  std::vector<Quadric> quadrics_;
+  std::vector<uint32_t> versions_;
+  std::vector<bool> position_alive_;
+
+  // Vertices at each position, and the position of each vertex.
+  std::vector<std::vector<int>> position_vertices_;
+  std::vector<int> vertex_positions_;
+
+  // Triangles that use each position. May include removed triangles.
+  std::vector<std::vector<int>> position_triangles_;
+
+  // Vertex indices of each triangle.
+  std::vector<int> triangles_;
+  std::vector<bool> triangle_alive_;
+  int num_triangles_ = 0;
+
+  std::priority_queue<Collapse, std::vector<Collapse>,
+      std::greater<Collapse>> queue_;
+};
+
+}  // namespace
+
+Simplifier::Simplifier(const GeometryData& data) :
+  data_(data) {
+  const int num_vertices = data.vertices.size();
+
+  // Weld vertices with identical positions.
+  std::vector<int> order(num_vertices);
+  std::iota(order.begin(), order.end(), 0);
+  auto less = [&data](int a, int b) {
+    const QVector3D& va = data.vertices[a];
+    const QVector3D& vb = data.vertices[b];
+    if (va.x() != vb.x()) {
+      return va.x() < vb.x();
+    }
+    if (va.y() != vb.y()) {
+      return va.y() < vb.y();
+    }
+    return va.z() < vb.z();
+  };
+  std::sort(order.begin(), order.end(), less);
+  vertex_positions_.resize(num_vertices);
+  for (int ind = 0; ind < num_vertices; ++ind) {
+    const int vertex = order[ind];
+    if (ind == 0 || less(order[ind - 1], vertex)) {
+      const QVector3D& v = data.vertices[vertex];
+      positions_.push_back(Vec3{v.x(), v.y(), v.z()});
+      position_vertices_.emplace_back();
+    }
+    vertex_positions_[vertex] = positions_.size() - 1;
+    position_vertices_.back().push_back(vertex);
+  }
+
+  const int num_positions = positions_.size();
+  quadrics_.resize(num_positions);
+  versions_.resize(num_positions, 0);
+  position_alive_.resize(num_positions, true);
+  position_triangles_.resize(num_positions);
+
+  // Keep the triangles with valid indices and three distinct positions.
+  const int num_corners = NumTriangles(data) * 3;
+  for (int corner = 0; corner < num_corners; corner += 3) {
+    int vertices[3];
+    for (int ind = 0; ind < 3; ++ind) {
+      vertices[ind] = data.indices.empty() ? corner + ind :
+          static_cast<int>(data.indices[corner + ind]);
+    }
+    if (vertices[0] < 0 || vertices[0] >= num_vertices ||
+        vertices[1] < 0 || vertices[1] >= num_vertices ||
+        vertices[2] < 0 || vertices[2] >= num_vertices) {
+      continue;
+    }
+    const int p0 = vertex_positions_[vertices[0]];
+    const int p1 = vertex_positions_[vertices[1]];
+    const int p2 = vertex_positions_[vertices[2]];
+    if (p0 == p1 || p1 == p2 || p2 == p0) {
+      continue;
+    }
+    const int triangle = triangles_.size() / 3;
+    triangles_.insert(triangles_.end(), vertices, vertices + 3);
+    position_triangles_[p0].push_back(triangle);
+    position_triangles_[p1].push_back(triangle);
+    position_triangles_[p2].push_back(triangle);
+  }
+  num_triangles_ = triangles_.size() / 3;
+  triangle_alive_.resize(num_triangles_, true);
+
+  // Each position starts with the planes of its triangles, weighted by
+  // area. Edges used by a single triangle are on a border, and get a plane
+  // perpendicular to the triangle through the edge.
+  std::unordered_map<uint64_t, int> edge_counts;
+  for (int triangle = 0; triangle < num_triangles_; ++triangle) {
+    for (int ind = 0; ind < 3; ++ind) {
+      const int a = vertex_positions_[triangles_[triangle * 3 + ind]];
+      const int b = vertex_positions_[triangles_[triangle * 3 + (ind + 1) % 3]];
+      edge_counts[EdgeKey(a, b)]++;
+    }
+  }
+  for (int triangle = 0; triangle < num_triangles_; ++triangle) {
+    int p[3];
+    for (int ind = 0; ind < 3; ++ind) {
+      p[ind] = vertex_positions_[triangles_[triangle * 3 + ind]];
+    }
+    Vec3 normal = Cross(Sub(positions_[p[1]], positions_[p[0]]),
+        Sub(positions_[p[2]], positions_[p[0]]));
+    const double length = std::sqrt(Dot(normal, normal));
+    if (length <= 0) {
+      continue;
+    }
+    normal = Vec3{normal.x / length, normal.y / length, normal.z / length};
+
+    Quadric quadric;
+    quadric.AddPlane(normal, -Dot(normal, positions_[p[0]]), length / 2);
+    for (int ind = 0; ind < 3; ++ind) {
+      quadrics_[p[ind]].Add(quadric);
+    }
+
+    for (int ind = 0; ind < 3; ++ind) {
+      const int a = p[ind];
+      const int b = p[(ind + 1) % 3];
+      if (edge_counts[EdgeKey(a, b)] != 1) {
+        continue;
+      }
+      const Vec3 edge = Sub(positions_[b], positions_[a]);
+      Vec3 border_normal = Cross(edge, normal);
+      const double edge_length = std::sqrt(Dot(border_normal, border_normal));
+      if (edge_length <= 0) {
+        continue;
+      }
+      border_normal = Vec3{border_normal.x / edge_length,
+          border_normal.y / edge_length, border_normal.z / edge_length};
+      Quadric border;
+      border.AddPlane(border_normal, -Dot(border_normal, positions_[a]),
+          kBorderWeight * edge_length * edge_length);
+      quadrics_[a].Add(border);
+      quadrics_[b].Add(border);
+    }
+  }
+
+  for (const auto& item : edge_counts) {
+    QueueCollapses(item.first >> 32, item.first & 0xffffffff);
+  }
+}
+
+void Simplifier::QueueCollapses(int a, int b) {
+  Quadric quadric = quadrics_[a];
+  quadric.Add(quadrics_[b]);
+  queue_.push(Collapse{quadric.Error(positions_[b]), a, b, versions_[a],
+      versions_[b]});
+  queue_.push(Collapse{quadric.Error(positions_[a]), b, a, versions_[b],
+      versions_[a]});
+}
+
+void Simplifier::Run(int target_num_triangles) {
+  while (num_triangles_ > target_num_triangles && !queue_.empty()) {
+    const Collapse collapse = queue_.top();
+    queue_.pop();
+    if (!position_alive_[collapse.from] || !position_alive_[collapse.to] ||
+        versions_[collapse.from] != collapse.from_version ||
+        versions_[collapse.to] != collapse.to_version) {
+      continue;
+    }
+    if (CanCollapse(collapse.from, collapse.to)) {
+      DoCollapse(collapse.from, collapse.to);
+    }
+  }
+}
+
+bool Simplifier::CanCollapse(int from, int to) const {
+  // Triangles that use both positions are removed by the collapse. The
+  // others must not flip over or become degenerate when moved.
+  for (int triangle : position_triangles_[from]) {
+    if (!triangle_alive_[triangle]) {
+      continue;
+    }
+    Vec3 before[3];
+    Vec3 after[3];
+    bool removed = false;
+    for (int ind = 0; ind < 3; ++ind) {
+      const int position = vertex_positions_[triangles_[triangle * 3 + ind]];
+      removed = removed || position == to;
+      before[ind] = positions_[position];
+      after[ind] = position == from ? positions_[to] : before[ind];
+    }
+    if (removed) {
+      continue;
+    }
+    const Vec3 normal_before =
+        Cross(Sub(before[1], before[0]), Sub(before[2], before[0]));
+    const Vec3 normal_after =
+        Cross(Sub(after[1], after[0]), Sub(after[2], after[0]));
+    if (Dot(normal_before, normal_after) <= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Simplifier::DoCollapse(int from, int to) {
+  // Each vertex at the removed position continues as the vertex at the
+  // remaining position with the most similar attributes.
+  std::vector<std::pair<int, int>> remap;
+  for (int vertex : position_vertices_[from]) {
+    remap.emplace_back(vertex, ClosestVertex(vertex, position_vertices_[to]));
+  }
+
+  std::vector<int>& to_triangles = position_triangles_[to];
+  for (int triangle : position_triangles_[from]) {
+    if (!triangle_alive_[triangle]) {
+      continue;
+    }
+    int* vertices = &triangles_[triangle * 3];
+    if (vertex_positions_[vertices[0]] == to ||
+        vertex_positions_[vertices[1]] == to ||
+        vertex_positions_[vertices[2]] == to) {
+      triangle_alive_[triangle] = false;
+      num_triangles_--;
+      continue;
+    }
+    for (int ind = 0; ind < 3; ++ind) {
+      for (const auto& item : remap) {
+        if (vertices[ind] == item.first) {
+          vertices[ind] = item.second;
+          break;
+        }
+      }
+    }
+    to_triangles.push_back(triangle);
+  }
+
+  quadrics_[to].Add(quadrics_[from]);
+  position_alive_[from] = false;
+  std::vector<int>().swap(position_vertices_[from]);
+  std::vector<int>().swap(position_triangles_[from]);
+  versions_[to]++;
+
+  // Drop removed triangles, and requeue the collapses of every edge of the
+  // remaining position, since its quadric changed.
+  std::vector<int> neighbors;
+  int num_kept = 0;
+  for (int triangle : to_triangles) {
+    if (!triangle_alive_[triangle]) {
+      continue;
+    }
+    to_triangles[num_kept++] = triangle;
+    for (int ind = 0; ind < 3; ++ind) {
+      const int position = vertex_positions_[triangles_[triangle * 3 + ind]];
+      if (position != to) {
+        neighbors.push_back(position);
+      }
+    }
+  }
+  to_triangles.resize(num_kept);
+
+  std::sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+      neighbors.end());
+  for (int neighbor : neighbors) {
+    QueueCollapses(to, neighbor);
+  }
+}
+
+int Simplifier::ClosestVertex(int vertex,
+    const std::vector<int>& candidates) const {
+  if (candidates.size() == 1) {
+    return candidates.front();
+  }
+
+  const size_t num_vertices = data_.vertices.size();
+  auto distance = [this, num_vertices](int a, int b) {
+    double result = 0;
+    if (data_.normals.size() == num_vertices) {
+      result += (data_.normals[a] - data_.normals[b]).lengthSquared();
+    }
+    if (data_.tex_coords_0.size() == num_vertices) {
+      result += (data_.tex_coords_0[a] - data_.tex_coords_0[b]).lengthSquared();
+    }
+    if (data_.diffuse.size() == num_vertices) {
+      result += (data_.diffuse[a] - data_.diffuse[b]).lengthSquared();
+    }
+    if (data_.specular.size() == num_vertices) {
+      result += (data_.specular[a] - data_.specular[b]).lengthSquared();
+    }
+    if (data_.shininess.size() == num_vertices) {
+      const double diff = data_.shininess[a] - data_.shininess[b];
+      result += diff * diff;
+    }
+    return result;
+  };
+
+  int closest = candidates.front();
+  double closest_distance = distance(vertex, closest);
+  for (size_t ind = 1; ind < candidates.size(); ++ind) {
+    const double candidate_distance = distance(vertex, candidates[ind]);
+    if (candidate_distance < closest_distance) {
+      closest = candidates[ind];
+      closest_distance = candidate_distance;
+    }
+  }
+  return closest;
+}
+
+GeometryData Simplifier::Result() const {
+  GeometryData result;
+  result.gl_mode = data_.gl_mode;
+
+  // Copy the vertices used by the remaining triangles, in order of first use.
+  const size_t num_vertices = data_.vertices.size();
+  std::vector<int> new_indices(num_vertices, -1);
+  std::vector<int> used_vertices;
+  const int num_triangles = triangle_alive_.size();
+  for (int triangle = 0; triangle < num_triangles; ++triangle) {
+    if (!triangle_alive_[triangle]) {
+      continue;
+    }
+    for (int ind = 0; ind < 3; ++ind) {
+      const int vertex = triangles_[triangle * 3 + ind];
+      if (new_indices[vertex] < 0) {
+        new_indices[vertex] = used_vertices.size();
+        used_vertices.push_back(vertex);
+      }
+      result.indices.push_back(new_indices[vertex]);
+    }
+  }
+
+  CopyAttribute(data_.vertices, num_vertices, used_vertices, &result.vertices);
+  CopyAttribute(data_.normals, num_vertices, used_vertices, &result.normals);
+  CopyAttribute(data_.diffuse, num_vertices, used_vertices, &result.diffuse);
+  CopyAttribute(data_.specular, num_vertices, used_vertices, &result.specular);
+  CopyAttribute(data_.shininess, num_vertices, used_vertices,
+      &result.shininess);
+  CopyAttribute(data_.tex_coords_0, num_vertices, used_vertices,
+      &result.tex_coords_0);
+  return result;
+}
+
+GeometryData MeshSimplifier::Simplify(const GeometryData& data,
+    int target_num_triangles) {
+  if (data.gl_mode != GL_TRIANGLES) {
+    return data;
+  }
+  SV_TRACE_SCOPE("import", "MeshSimplifier::Simplify");
+  Simplifier simplifier(data);
+  simplifier.Run(std::max(target_num_triangles, 0));
+  return simplifier.Result();
+}
+
+std::vector<GeometryData> MeshSimplifier::MakeLodChain(
+    const GeometryData& data, int num_levels, double reduction) {
+  std::vector<GeometryData> levels;
+  if (data.gl_mode != GL_TRIANGLES) {
+    return levels;
+  }
+
+  // Each level is simplified from the previous one, which is much faster
+  // than starting over from the full detail mesh.
+  int num_triangles = NumTriangles(data);
+  for (int level = 0; level < num_levels; ++level) {
+    const int target = num_triangles * reduction;
+    if (target < 1) {
+      break;
+    }
+    GeometryData simplified =
+        Simplify(levels.empty() ? data : levels.back(), target);
+    const int num_simplified = NumTriangles(simplified);
+    if (num_simplified == 0 || num_simplified >= num_triangles) {
+      break;
+    }
+    levels.push_back(std::move(simplified));
+    num_triangles = num_simplified;
+  }
+  return levels;
+}
+
+}  // namespace sv
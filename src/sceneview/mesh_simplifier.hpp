@@ -0,0 +1,66 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_MESH_SIMPLIFIER_HPP__
+#define SCENEVIEW_MESH_SIMPLIFIER_HPP__
+
+#include <vector>
+
+#include <sceneview/geometry_resource.hpp>
+
+namespace sv {
+
+/**
+ * Reduces the number of triangles of a mesh, e.g., to generate the levels of
+ * a LodDrawNode.
+ *
+ * Edges are repeatedly collapsed into one of their vertices, picking the
+ * collapse with the smallest quadric error metric (Garland and Heckbert,
+ * "Surface Simplification Using Quadric Error Metrics"). Mesh borders are
+ * penalized so that they keep their shape, and collapses that would flip a
+ * triangle over are skipped.
+ *
+ * Since vertices are only ever removed, the remaining vertices keep their
+ * normals, colors and texture coordinates. Vertices at the same position,
+ * such as those along texture seams or hard edges, are moved together.
+ *
+ * Simplification is meant to be done offline or at load time. It is not
+ * fast enough to be done every frame.
+ *
+ * @ingroup sv_resources
+ * @headerfile sceneview/mesh_simplifier.hpp
+ */
+class MeshSimplifier {
+  public:
+    /**
+     * Simplifies a triangle mesh.
+     *
+     * @param data the mesh to simplify. If it does not use GL_TRIANGLES, then
+     * it is returned unchanged.
+     * @param target_num_triangles the number of triangles to reduce the mesh
+     * to. The result may have more triangles if no more edges can be
+     * collapsed without flipping triangles.
+     *
+     * @return the simplified mesh, always with indices.
+     */
+    static GeometryData Simplify(const GeometryData& data,
+        int target_num_triangles);
+
+    /**
+     * Generates successively simplified versions of a mesh.
+     *
+     * @param data the full detail mesh. It is not included in the result.
+     * @param num_levels the number of simplified meshes to generate.
+     * @param reduction the number of triangles of each simplified mesh,
+     * relative to the previous one.
+     *
+     * @return up to @p num_levels meshes, from the most to the least
+     * detailed. Fewer meshes are returned if the mesh cannot be reduced any
+     * further.
+     */
+    static std::vector<GeometryData> MakeLodChain(const GeometryData& data,
+        int num_levels, double reduction = 0.5);
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_MESH_SIMPLIFIER_HPP__
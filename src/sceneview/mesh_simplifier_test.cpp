@@ -0,0 +1,186 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "sceneview/mesh_simplifier.hpp"
+
+using sv::GeometryData;
+using sv::MeshSimplifier;
+
+static int NumTriangles(const GeometryData& data) {
+  return data.indices.size() / 3;
+}
+
+static QVector3D Cross(const QVector3D& a, const QVector3D& b) {
+  return QVector3D(a.y() * b.z() - a.z() * b.y(),
+      a.z() * b.x() - a.x() * b.z(),
+      a.x() * b.y() - a.y() * b.x());
+}
+
+static float Dot(const QVector3D& a, const QVector3D& b) {
+  return a.x() * b.x() + a.y() * b.y() + a.z() * b.z();
+}
+
+// A flat grid of size x size quads in the z = 0 plane, spanning [0, 1] x
+// [0, 1], with texture coordinates equal to the x and y coordinates.
+static GeometryData MakeGrid(int size) {
+  GeometryData data;
+  data.gl_mode = GL_TRIANGLES;
+  for (int row = 0; row <= size; ++row) {
+    for (int col = 0; col <= size; ++col) {
+      const float x = static_cast<float>(col) / size;
+      const float y = static_cast<float>(row) / size;
+      data.vertices.emplace_back(x, y, 0);
+      data.normals.emplace_back(0, 0, 1);
+      data.tex_coords_0.emplace_back(x, y);
+    }
+  }
+  for (int row = 0; row < size; ++row) {
+    for (int col = 0; col < size; ++col) {
+      const uint32_t v0 = row * (size + 1) + col;
+      const uint32_t v1 = v0 + 1;
+      const uint32_t v2 = v0 + size + 1;
+      const uint32_t v3 = v2 + 1;
+      data.indices.insert(data.indices.end(), { v0, v1, v3, v0, v3, v2 });
+    }
+  }
+  return data;
+}
+
+// A unit sphere, with outward facing triangles.
+static GeometryData MakeSphere(int num_rings, int num_segments) {
+  GeometryData data;
+  data.gl_mode = GL_TRIANGLES;
+  for (int ring = 0; ring <= num_rings; ++ring) {
+    const double theta = M_PI * ring / num_rings;
+    for (int seg = 0; seg < num_segments; ++seg) {
+      const double phi = 2 * M_PI * seg / num_segments;
+      // Make the poles a single position.
+      const double sin_theta =
+          (ring == 0 || ring == num_rings) ? 0 : std::sin(theta);
+      const QVector3D vertex(sin_theta * std::cos(phi),
+          sin_theta * std::sin(phi), std::cos(theta));
+      data.vertices.push_back(vertex);
+      data.normals.push_back(vertex);
+    }
+  }
+  for (int ring = 0; ring < num_rings; ++ring) {
+    for (int seg = 0; seg < num_segments; ++seg) {
+      const uint32_t v0 = ring * num_segments + seg;
+      const uint32_t v1 = ring * num_segments + (seg + 1) % num_segments;
+      const uint32_t v2 = v0 + num_segments;
+      const uint32_t v3 = v1 + num_segments;
+      if (ring != 0) {
+        data.indices.insert(data.indices.end(), { v0, v2, v1 });
+      }
+      if (ring != num_rings - 1) {
+        data.indices.insert(data.indices.end(), { v1, v2, v3 });
+      }
+    }
+  }
+  return data;
+}
+
+TEST(MeshSimplifier, FlatGrid) {
+  const GeometryData grid = MakeGrid(16);
+  const GeometryData result = MeshSimplifier::Simplify(grid, 32);
+  EXPECT_GT(NumTriangles(result), 0);
+  EXPECT_LE(NumTriangles(result), 32);
+  EXPECT_EQ(result.vertices.size(), result.normals.size());
+  EXPECT_EQ(result.vertices.size(), result.tex_coords_0.size());
+  EXPECT_TRUE(result.diffuse.empty());
+
+  // The corners of the grid are kept, and the triangles still face up.
+  float min_x = 1, min_y = 1, max_x = 0, max_y = 0;
+  for (size_t ind = 0; ind < result.vertices.size(); ++ind) {
+    const QVector3D& vertex = result.vertices[ind];
+    EXPECT_EQ(0, vertex.z());
+    EXPECT_EQ(vertex.x(), result.tex_coords_0[ind].x());
+    EXPECT_EQ(vertex.y(), result.tex_coords_0[ind].y());
+    min_x = std::min(min_x, vertex.x());
+    min_y = std::min(min_y, vertex.y());
+    max_x = std::max(max_x, vertex.x());
+    max_y = std::max(max_y, vertex.y());
+  }
+  EXPECT_EQ(0, min_x);
+  EXPECT_EQ(0, min_y);
+  EXPECT_EQ(1, max_x);
+  EXPECT_EQ(1, max_y);
+
+  float area = 0;
+  for (size_t ind = 0; ind < result.indices.size(); ind += 3) {
+    const QVector3D& v0 = result.vertices[result.indices[ind]];
+    const QVector3D& v1 = result.vertices[result.indices[ind + 1]];
+    const QVector3D& v2 = result.vertices[result.indices[ind + 2]];
+    const QVector3D normal = Cross(v1 - v0, v2 - v0);
+    EXPECT_GT(normal.z(), 0);
+    area += normal.z() / 2;
+  }
+  EXPECT_NEAR(1, area, 1e-4);
+}
+
+TEST(MeshSimplifier, Sphere) {
+  const GeometryData sphere = MakeSphere(16, 32);
+  const int num_triangles = NumTriangles(sphere);
+  const GeometryData result =
+      MeshSimplifier::Simplify(sphere, num_triangles / 4);
+  EXPECT_LE(NumTriangles(result), num_triangles / 4);
+  EXPECT_GT(NumTriangles(result), 0);
+  EXPECT_LT(result.vertices.size(), sphere.vertices.size() / 2);
+
+  for (size_t ind = 0; ind < result.indices.size(); ind += 3) {
+    const QVector3D& v0 = result.vertices[result.indices[ind]];
+    const QVector3D& v1 = result.vertices[result.indices[ind + 1]];
+    const QVector3D& v2 = result.vertices[result.indices[ind + 2]];
+    const QVector3D normal = Cross(v1 - v0, v2 - v0);
+    EXPECT_GT(Dot(normal, v0 + v1 + v2), 0);
+  }
+}
+
+TEST(MeshSimplifier, UnindexedAndSplitVertices) {
+  // Each triangle of the grid has its own vertices.
+  const GeometryData grid = MakeGrid(8);
+  GeometryData split;
+  split.gl_mode = GL_TRIANGLES;
+  for (uint32_t index : grid.indices) {
+    split.vertices.push_back(grid.vertices[index]);
+    split.diffuse.emplace_back(1, 0, 0, 1);
+  }
+
+  const GeometryData result = MeshSimplifier::Simplify(split, 16);
+  EXPECT_LE(NumTriangles(result), 16);
+  EXPECT_GT(NumTriangles(result), 0);
+  EXPECT_EQ(result.vertices.size(), result.diffuse.size());
+  EXPECT_TRUE(result.normals.empty());
+}
+
+TEST(MeshSimplifier, NotTriangles) {
+  GeometryData lines;
+  lines.gl_mode = GL_LINES;
+  lines.vertices = { QVector3D(0, 0, 0), QVector3D(1, 0, 0) };
+  const GeometryData result = MeshSimplifier::Simplify(lines, 0);
+  EXPECT_EQ(2, result.vertices.size());
+  EXPECT_TRUE(MeshSimplifier::MakeLodChain(lines, 3).empty());
+}
+
+TEST(MeshSimplifier, LodChain) {
+  const GeometryData sphere = MakeSphere(16, 32);
+  const std::vector<GeometryData> levels =
+      MeshSimplifier::MakeLodChain(sphere, 3);
+  ASSERT_EQ(3, levels.size());
+  int num_triangles = NumTriangles(sphere);
+  for (const GeometryData& level : levels) {
+    EXPECT_LE(NumTriangles(level), num_triangles / 2);
+    num_triangles = NumTriangles(level);
+  }
+
+  // A single triangle cannot be reduced.
+  GeometryData triangle;
+  triangle.gl_mode = GL_TRIANGLES;
+  triangle.vertices = {
+    QVector3D(0, 0, 0), QVector3D(1, 0, 0), QVector3D(0, 1, 0) };
+  EXPECT_TRUE(MeshSimplifier::MakeLodChain(triangle, 3).empty());
+}
@@ -0,0 +1,157 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_OBJECT_POOL_HPP__
+#define SCENEVIEW_OBJECT_POOL_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace sv {
+
+/**
+ * Allocates storage for objects of type T from slabs of contiguous slots.
+ *
+ * Objects allocated one after the other sit next to each other in memory,
+ * and freed slots are reused. Only storage is managed: callers construct
+ * objects with placement new, and destroy them before freeing their slot.
+ * Slabs are only released when the pool is destroyed.
+ *
+ * Not thread-safe. See PooledObject for a thread-safe use.
+ *
+ * Internal class, not part of the public API.
+ */
+template <typename T>
+class ObjectPool {
+ public:
+  static constexpr int kDefaultSlabSize = 256;
+
+  /**
+   * @param slab_size number of objects per slab.
+   */
+  explicit ObjectPool(int slab_size = kDefaultSlabSize) :
+    slab_size_(slab_size > 0 ? slab_size : kDefaultSlabSize) {}
+
+  ObjectPool(const ObjectPool&) = delete;
+
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  /**
+   * Returns uninitialized storage for one T.
+   */
+  void* Allocate() {
+    Slot* slot;
+    if (free_list_) {
+      slot = free_list_;
+      free_list_ = slot->next;
+    } else {
+      if (slabs_.empty() || num_used_in_slab_ == slab_size_) {
+        slabs_.emplace_back(new Slot[slab_size_]);
+        num_used_in_slab_ = 0;
+      }
+      slot = &slabs_.back()[num_used_in_slab_++];
+    }
+    num_allocated_++;
+    return slot;
+  }
+
+  /**
+   * Returns storage obtained from Allocate() to the pool. The object in it
+   * must already be destroyed.
+   */
+  void Free(void* ptr) {
+    Slot* slot = static_cast<Slot*>(ptr);
+    slot->next = free_list_;
+    free_list_ = slot;
+    num_allocated_--;
+  }
+
+  /**
+   * Number of slots allocated and not freed.
+   */
+  int NumAllocated() const { return num_allocated_; }
+
+ private:
+  union Slot {
+    Slot* next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  int slab_size_;
+
+  std::vector<std::unique_ptr<Slot[]>> slabs_;
+
+  // Number of slots of the newest slab that have been handed out.
+  int num_used_in_slab_ = 0;
+
+  // Freed slots, linked through Slot::next.
+  Slot* free_list_ = nullptr;
+
+  int num_allocated_ = 0;
+};
+
+template <typename T>
+constexpr int ObjectPool<T>::kDefaultSlabSize;
+
+/**
+ * Base class that makes new and delete of T use an ObjectPool shared by all
+ * objects of type T.
+ *
+ * Meant for small objects that are created in large numbers, such as the
+ * private data of scene nodes:
+ * @code
+ * struct DrawNode::Priv : PooledObject<DrawNode::Priv> {
+ *   ...
+ * };
+ * @endcode
+ *
+ * The pool is protected by a mutex, so objects can be created and destroyed
+ * on any thread. Its memory is kept for reuse until the program exits.
+ *
+ * Internal class, not part of the public API.
+ */
+template <typename T>
+struct PooledObject {
+  static void* operator new(std::size_t size) {
+    // Classes derived from T have a different size.
+    if (size != sizeof(T)) {
+      return ::operator new(size);
+    }
+    SharedPool& shared = Pool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    return shared.pool.Allocate();
+  }
+
+  static void operator delete(void* ptr, std::size_t size) {
+    if (!ptr) {
+      return;
+    }
+    if (size != sizeof(T)) {
+      ::operator delete(ptr);
+      return;
+    }
+    SharedPool& shared = Pool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.pool.Free(ptr);
+  }
+
+ private:
+  struct SharedPool {
+    std::mutex mutex;
+    ObjectPool<T> pool;
+  };
+
+  // Never destroyed, so that objects can still be deleted while the program
+  // exits.
+  static SharedPool& Pool() {
+    static SharedPool* pool = new SharedPool();
+    return *pool;
+  }
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_OBJECT_POOL_HPP__
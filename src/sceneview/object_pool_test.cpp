@@ -0,0 +1,94 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "sceneview/object_pool.hpp"
+
+using sv::ObjectPool;
+using sv::PooledObject;
+
+struct Item {
+  double values[3];
+};
+
+TEST(ObjectPool, AllocateAndFree) {
+  ObjectPool<Item> pool(4);
+  std::vector<void*> slots;
+  for (int ind = 0; ind < 10; ++ind) {
+    slots.push_back(pool.Allocate());
+  }
+  EXPECT_EQ(10, pool.NumAllocated());
+  EXPECT_EQ(10, std::set<void*>(slots.begin(), slots.end()).size());
+  for (void* slot : slots) {
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(slot) % alignof(Item));
+  }
+
+  // Objects allocated together within a slab are adjacent.
+  for (int ind = 1; ind < 4; ++ind) {
+    EXPECT_EQ(static_cast<Item*>(slots[ind - 1]) + 1,
+        static_cast<Item*>(slots[ind]));
+  }
+
+  // Freed slots are reused before new slabs are made.
+  pool.Free(slots[7]);
+  pool.Free(slots[2]);
+  EXPECT_EQ(8, pool.NumAllocated());
+  EXPECT_EQ(slots[2], pool.Allocate());
+  EXPECT_EQ(slots[7], pool.Allocate());
+  EXPECT_EQ(10, pool.NumAllocated());
+
+  for (void* slot : slots) {
+    pool.Free(slot);
+  }
+  EXPECT_EQ(0, pool.NumAllocated());
+}
+
+struct PooledItem : PooledObject<PooledItem> {
+  int value = 0;
+};
+
+struct DerivedItem : PooledItem {
+  double extra[8];
+};
+
+TEST(ObjectPool, PooledObject) {
+  std::unique_ptr<PooledItem> item(new PooledItem());
+  EXPECT_EQ(0, item->value);
+  PooledItem* address = item.get();
+  item.reset();
+  item.reset(new PooledItem());
+  EXPECT_EQ(address, item.get());
+
+  // Larger derived classes use the global heap.
+  std::unique_ptr<PooledItem> derived(new DerivedItem());
+  derived->value = 3;
+  EXPECT_EQ(3, derived->value);
+}
+
+TEST(ObjectPool, PooledObjectThreads) {
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; ++thread) {
+    threads.emplace_back([]() {
+      std::vector<std::unique_ptr<PooledItem>> items;
+      for (int round = 0; round < 10; ++round) {
+        for (int ind = 0; ind < 1000; ++ind) {
+          items.emplace_back(new PooledItem());
+          items.back()->value = ind;
+        }
+        for (int ind = 0; ind < 1000; ++ind) {
+          EXPECT_EQ(ind, items[ind]->value);
+        }
+        items.clear();
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
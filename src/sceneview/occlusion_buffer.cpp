@@ -0,0 +1,406 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/occlusion_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "sceneview/worker_pool.hpp"
+
+namespace sv {
+
+// Number of rows of the depth buffer rasterized by each task.
+static constexpr int kBandHeight = 8;
+
+// Triangles with less than this area, in squared texels, are skipped.
+static constexpr float kMinTriangleArea = 1e-6;
+
+static void TransformPoint(const float* mat, const float* point,
+    float* result) {
+  for (int row = 0; row < 4; ++row) {
+    result[row] = mat[row] * point[0] + mat[4 + row] * point[1] +
+        mat[8 + row] * point[2] + mat[12 + row];
+  }
+}
+
+// Clamps a window coordinate to [low, high] before converting it, since
+// vertices close to the near plane can project very far out.
+static int ClampCoord(float value, int low, int high) {
+  return static_cast<int>(std::min<float>(std::max<float>(value, low), high));
+}
+
+// Signed distance-like value to the near clipping plane (z = -w).
+static float NearDistance(const float* clip) {
+  return clip[2] + clip[3];
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) :
+  width_((std::max(width, 1) + 3) & ~3),
+  height_(std::max(height, 1)) {
+  for (int ind = 0; ind < 16; ++ind) {
+    view_proj_[ind] = (ind % 5 == 0);
+  }
+
+  int level_width = width_;
+  int level_height = height_;
+  while (true) {
+    level_widths_.push_back(level_width);
+    level_heights_.push_back(level_height);
+    levels_.emplace_back(level_width * level_height, 1.0f);
+    if (level_width == 1 && level_height == 1) {
+      break;
+    }
+    level_width = (level_width + 1) / 2;
+    level_height = (level_height + 1) / 2;
+  }
+}
+
+void OcclusionBuffer::Begin(const QMatrix4x4& view_proj) {
+  view_proj_mat_ = view_proj;
+  memcpy(view_proj_, view_proj.constData(), sizeof(view_proj_));
+  occluders_.clear();
+  std::fill(levels_[0].begin(), levels_[0].end(), 1.0f);
+}
+
+void OcclusionBuffer::AddOccluder(const QMatrix4x4& model_mat,
+    const OccluderMesh* mesh) {
+  const QMatrix4x4 mvp = view_proj_mat_ * model_mat;
+
+  Occluder occluder;
+  memcpy(occluder.mvp, mvp.constData(), sizeof(occluder.mvp));
+  occluder.mesh = mesh;
+  occluders_.push_back(occluder);
+}
+
+void OcclusionBuffer::Rasterize(WorkerPool* pool) {
+  const int num_occluders = occluders_.size();
+  if (static_cast<int>(triangles_.size()) < num_occluders) {
+    triangles_.resize(num_occluders);
+    clip_vertices_.resize(num_occluders);
+  }
+
+  const int num_bands = (height_ + kBandHeight - 1) / kBandHeight;
+  if (pool) {
+    pool->Run(num_occluders, [this](int ind) { SetupTriangles(ind); });
+    pool->Run(num_bands, [this](int band) { RasterizeBand(band); });
+  } else {
+    for (int ind = 0; ind < num_occluders; ++ind) {
+      SetupTriangles(ind);
+    }
+    for (int band = 0; band < num_bands; ++band) {
+      RasterizeBand(band);
+    }
+  }
+
+  BuildPyramid();
+}
+
+void OcclusionBuffer::SetupTriangles(int occluder_ind) {
+  const Occluder& occluder = occluders_[occluder_ind];
+  const OccluderMesh& mesh = *occluder.mesh;
+  std::vector<ScreenTriangle>& triangles = triangles_[occluder_ind];
+  std::vector<float>& clip = clip_vertices_[occluder_ind];
+  triangles.clear();
+
+  const int num_vertices = mesh.vertices.size() / 3;
+  clip.resize(num_vertices * 4);
+  for (int ind = 0; ind < num_vertices; ++ind) {
+    TransformPoint(occluder.mvp, &mesh.vertices[ind * 3], &clip[ind * 4]);
+  }
+
+  const int num_indices = mesh.indices.size() - mesh.indices.size() % 3;
+  for (int ind = 0; ind < num_indices; ind += 3) {
+    const float* verts[3];
+    bool valid = true;
+    for (int corner = 0; corner < 3; ++corner) {
+      const uint32_t vert_ind = mesh.indices[ind + corner];
+      valid = valid && vert_ind < static_cast<uint32_t>(num_vertices);
+      verts[corner] = valid ? &clip[vert_ind * 4] : nullptr;
+    }
+    if (!valid) {
+      continue;
+    }
+
+    // Skip triangles entirely outside one of the clipping planes, except
+    // for the far plane, since their depth would not change anything.
+    bool outside = false;
+    for (int axis = 0; axis < 2 && !outside; ++axis) {
+      outside =
+          (verts[0][axis] < -verts[0][3] && verts[1][axis] < -verts[1][3] &&
+           verts[2][axis] < -verts[2][3]) ||
+          (verts[0][axis] > verts[0][3] && verts[1][axis] > verts[1][3] &&
+           verts[2][axis] > verts[2][3]);
+    }
+    if (outside || (NearDistance(verts[0]) < 0 &&
+                    NearDistance(verts[1]) < 0 &&
+                    NearDistance(verts[2]) < 0)) {
+      continue;
+    }
+
+    // Clip against the near plane, which yields a polygon of up to four
+    // vertices.
+    float polygon[4][4];
+    int num_polygon = 0;
+    for (int corner = 0; corner < 3; ++corner) {
+      const float* cur = verts[corner];
+      const float* next = verts[(corner + 1) % 3];
+      const float cur_dist = NearDistance(cur);
+      const float next_dist = NearDistance(next);
+      if (cur_dist >= 0) {
+        memcpy(polygon[num_polygon++], cur, 4 * sizeof(float));
+      }
+      if ((cur_dist >= 0) != (next_dist >= 0)) {
+        const float t = cur_dist / (cur_dist - next_dist);
+        for (int coord = 0; coord < 4; ++coord) {
+          polygon[num_polygon][coord] =
+              cur[coord] + t * (next[coord] - cur[coord]);
+        }
+        num_polygon++;
+      }
+    }
+
+    // Project to window coordinates.
+    float window[4][3];
+    bool behind = false;
+    for (int vert = 0; vert < num_polygon; ++vert) {
+      const float w = polygon[vert][3];
+      if (w <= 0) {
+        behind = true;
+        break;
+      }
+      window[vert][0] = (polygon[vert][0] / w * 0.5f + 0.5f) * width_;
+      window[vert][1] = (polygon[vert][1] / w * 0.5f + 0.5f) * height_;
+      window[vert][2] = polygon[vert][2] / w * 0.5f + 0.5f;
+    }
+    if (behind) {
+      continue;
+    }
+
+    for (int vert = 2; vert < num_polygon; ++vert) {
+      const int fan[3] = { 0, vert - 1, vert };
+      ScreenTriangle tri;
+      for (int corner = 0; corner < 3; ++corner) {
+        tri.x[corner] = window[fan[corner]][0];
+        tri.y[corner] = window[fan[corner]][1];
+        tri.z[corner] = window[fan[corner]][2];
+      }
+      triangles.push_back(tri);
+    }
+  }
+}
+
+void OcclusionBuffer::RasterizeBand(int band) {
+  const int row_begin = band * kBandHeight;
+  const int row_end = std::min(row_begin + kBandHeight, height_);
+  const int num_occluders = occluders_.size();
+  for (int ind = 0; ind < num_occluders; ++ind) {
+    for (const ScreenTriangle& tri : triangles_[ind]) {
+      RasterizeTriangle(tri, row_begin, row_end);
+    }
+  }
+}
+
+void OcclusionBuffer::RasterizeTriangle(const ScreenTriangle& tri,
+    int row_begin, int row_end) {
+  const float min_y = std::min(tri.y[0], std::min(tri.y[1], tri.y[2]));
+  const float max_y = std::max(tri.y[0], std::max(tri.y[1], tri.y[2]));
+  const int y_begin =
+      std::max(row_begin, ClampCoord(std::floor(min_y), 0, height_));
+  const int y_end =
+      std::min(row_end, ClampCoord(std::ceil(max_y), 0, height_));
+  if (y_begin >= y_end) {
+    return;
+  }
+  const float min_x = std::min(tri.x[0], std::min(tri.x[1], tri.x[2]));
+  const float max_x = std::max(tri.x[0], std::max(tri.x[1], tri.x[2]));
+  // Start on a multiple of 4, so that groups of 4 texels are aligned.
+  const int x_begin = ClampCoord(std::floor(min_x), 0, width_) & ~3;
+  const int x_end = ClampCoord(std::ceil(max_x), 0, width_);
+  if (x_begin >= x_end) {
+    return;
+  }
+
+  // Orient the triangle counter-clockwise.
+  int v1 = 1;
+  int v2 = 2;
+  float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) -
+      (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+  if (area < 0) {
+    std::swap(v1, v2);
+    area = -area;
+  }
+  if (area < kMinTriangleArea) {
+    return;
+  }
+  const int order[3] = { 0, v1, v2 };
+
+  // Edge functions a * x + b * y + c, non-negative inside the triangle.
+  // Texels are covered if their center is inside, so that triangles that
+  // share an edge leave no gaps.
+  float edge_a[3];
+  float edge_b[3];
+  float edge_c[3];
+  for (int edge = 0; edge < 3; ++edge) {
+    const int from = order[edge];
+    const int to = order[(edge + 1) % 3];
+    edge_a[edge] = tri.y[from] - tri.y[to];
+    edge_b[edge] = tri.x[to] - tri.x[from];
+    edge_c[edge] = -(edge_a[edge] * tri.x[from] + edge_b[edge] * tri.y[from]);
+  }
+
+  // Depth plane, conservatively biased to the farthest depth within each
+  // texel, and never beyond the farthest vertex.
+  const float dz_dx = ((tri.z[v1] - tri.z[0]) * (tri.y[v2] - tri.y[0]) -
+      (tri.z[v2] - tri.z[0]) * (tri.y[v1] - tri.y[0])) / area;
+  const float dz_dy = ((tri.x[v1] - tri.x[0]) * (tri.z[v2] - tri.z[0]) -
+      (tri.x[v2] - tri.x[0]) * (tri.z[v1] - tri.z[0])) / area;
+  const float z_bias = 0.5f * (std::fabs(dz_dx) + std::fabs(dz_dy));
+  const float max_z = std::max(tri.z[0], std::max(tri.z[1], tri.z[2]));
+  const float z_c = tri.z[0] - dz_dx * tri.x[0] - dz_dy * tri.y[0] + z_bias;
+
+  float* depth = levels_[0].data();
+  for (int y = y_begin; y < y_end; ++y) {
+    const float center_y = y + 0.5f;
+    float* row = depth + y * width_;
+    float row_edge[3];
+    for (int edge = 0; edge < 3; ++edge) {
+      row_edge[edge] = edge_b[edge] * center_y + edge_c[edge];
+    }
+    const float row_z = dz_dy * center_y + z_c;
+
+#if defined(__SSE2__)
+    const __m128 lane_x = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 max_z4 = _mm_set1_ps(max_z);
+    for (int x = x_begin; x < x_end; x += 4) {
+      const __m128 center_x = _mm_add_ps(_mm_set1_ps(x), lane_x);
+      __m128 inside = _mm_cmpge_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge_a[0]), center_x),
+                     _mm_set1_ps(row_edge[0])), _mm_setzero_ps());
+      for (int edge = 1; edge < 3; ++edge) {
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge_a[edge]), center_x),
+                       _mm_set1_ps(row_edge[edge])), _mm_setzero_ps()));
+      }
+      if (!_mm_movemask_ps(inside)) {
+        continue;
+      }
+      const __m128 z = _mm_min_ps(max_z4, _mm_add_ps(
+          _mm_mul_ps(_mm_set1_ps(dz_dx), center_x), _mm_set1_ps(row_z)));
+      const __m128 old_z = _mm_loadu_ps(row + x);
+      const __m128 new_z = _mm_min_ps(old_z, z);
+      _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_z),
+                                       _mm_andnot_ps(inside, old_z)));
+    }
+#else
+    for (int x = x_begin; x < x_end; ++x) {
+      const float center_x = x + 0.5f;
+      if (edge_a[0] * center_x + row_edge[0] < 0 ||
+          edge_a[1] * center_x + row_edge[1] < 0 ||
+          edge_a[2] * center_x + row_edge[2] < 0) {
+        continue;
+      }
+      const float z = std::min(max_z, dz_dx * center_x + row_z);
+      row[x] = std::min(row[x], z);
+    }
+#endif
+  }
+}
+
+void OcclusionBuffer::BuildPyramid() {
+  const int num_levels = levels_.size();
+  for (int level = 1; level < num_levels; ++level) {
+    const std::vector<float>& src = levels_[level - 1];
+    std::vector<float>& dst = levels_[level];
+    const int src_width = level_widths_[level - 1];
+    const int src_height = level_heights_[level - 1];
+    const int dst_width = level_widths_[level];
+    const int dst_height = level_heights_[level];
+    for (int y = 0; y < dst_height; ++y) {
+      const int y0 = 2 * y;
+      const int y1 = std::min(y0 + 1, src_height - 1);
+      for (int x = 0; x < dst_width; ++x) {
+        const int x0 = 2 * x;
+        const int x1 = std::min(x0 + 1, src_width - 1);
+        dst[y * dst_width + x] = std::max(
+            std::max(src[y0 * src_width + x0], src[y0 * src_width + x1]),
+            std::max(src[y1 * src_width + x0], src[y1 * src_width + x1]));
+      }
+    }
+  }
+}
+
+bool OcclusionBuffer::IsOccluded(const AxisAlignedBox& box) const {
+  if (!box.Valid()) {
+    return false;
+  }
+
+  const QVector3D& box_min = box.Min();
+  const QVector3D& box_max = box.Max();
+  float min_x = std::numeric_limits<float>::max();
+  float max_x = -std::numeric_limits<float>::max();
+  float min_y = std::numeric_limits<float>::max();
+  float max_y = -std::numeric_limits<float>::max();
+  float min_z = 1;
+  for (int corner = 0; corner < 8; ++corner) {
+    const float point[3] = {
+      (corner & 1) ? box_max.x() : box_min.x(),
+      (corner & 2) ? box_max.y() : box_min.y(),
+      (corner & 4) ? box_max.z() : box_min.z(),
+    };
+    float clip[4];
+    TransformPoint(view_proj_, point, clip);
+    if (NearDistance(clip) <= 0 || clip[3] <= 0) {
+      return false;
+    }
+    const float x = (clip[0] / clip[3] * 0.5f + 0.5f) * width_;
+    const float y = (clip[1] / clip[3] * 0.5f + 0.5f) * height_;
+    min_x = std::min(min_x, x);
+    max_x = std::max(max_x, x);
+    min_y = std::min(min_y, y);
+    max_y = std::max(max_y, y);
+    min_z = std::min(min_z, clip[2] / clip[3] * 0.5f + 0.5f);
+  }
+
+  // Texels touched by the projected box, plus a border of one texel, since
+  // an occluder may cover a texel at its silhouette without covering all of
+  // it. The texel next to it is then not covered.
+  if (max_x < 0 || min_x >= width_ || max_y < 0 || min_y >= height_) {
+    return false;
+  }
+  const int x0 = ClampCoord(std::floor(min_x) - 1, 0, width_ - 1);
+  const int x1 = ClampCoord(std::floor(max_x) + 1, 0, width_ - 1);
+  const int y0 = ClampCoord(std::floor(min_y) - 1, 0, height_ - 1);
+  const int y1 = ClampCoord(std::floor(max_y) + 1, 0, height_ - 1);
+
+  // Use the finest level where the box touches at most 4x4 texels.
+  const int num_levels = levels_.size();
+  int level = 0;
+  while (level + 1 < num_levels &&
+         ((x1 >> level) - (x0 >> level) > 3 ||
+          (y1 >> level) - (y0 >> level) > 3)) {
+    level++;
+  }
+
+  const std::vector<float>& depth = levels_[level];
+  const int level_width = level_widths_[level];
+  for (int y = y0 >> level; y <= (y1 >> level); ++y) {
+    for (int x = x0 >> level; x <= (x1 >> level); ++x) {
+      if (min_z <= depth[y * level_width + x]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+float OcclusionBuffer::Depth(int level, int x, int y) const {
+  return levels_[level][y * level_widths_[level] + x];
+}
+
+}  // namespace sv
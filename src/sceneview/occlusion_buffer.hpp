@@ -0,0 +1,153 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_OCCLUSION_BUFFER_HPP__
+#define SCENEVIEW_OCCLUSION_BUFFER_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include <QMatrix4x4>
+
+#include "sceneview/axis_aligned_box.hpp"
+
+namespace sv {
+
+class WorkerPool;
+
+/**
+ * Simplified triangle mesh of an occluder. See DrawNode::SetOccluder().
+ *
+ * Internal struct, not part of the public API.
+ */
+struct OccluderMesh {
+  // Vertex positions, as consecutive x, y, z values.
+  std::vector<float> vertices;
+
+  // Vertex indices, three per triangle.
+  std::vector<uint32_t> indices;
+};
+
+/**
+ * Low resolution depth buffer that occluders are rasterized into on the CPU,
+ * and that bounding boxes are tested against for software occlusion culling.
+ *
+ * Occluders are written with the farthest depth that they have in each
+ * texel that they cover, and boxes are tested against the texels that they
+ * touch plus a one texel border, so that a box is never reported as
+ * occluded when some of it is visible past the silhouette of an occluder.
+ * After rasterization, a pyramid of successively halved resolutions is
+ * built, where each texel holds the farthest depth of the texels that it
+ * covers in the level below, so that each box is tested against at most
+ * 4x4 texels.
+ *
+ * Depths are window depths in [0, 1], as with the default glDepthRange().
+ *
+ * Internal class, not part of the public API.
+ */
+class OcclusionBuffer {
+ public:
+  static constexpr int kDefaultWidth = 256;
+  static constexpr int kDefaultHeight = 128;
+
+  /**
+   * @param width width of the depth buffer, rounded up to a multiple of 4.
+   * @param height height of the depth buffer.
+   */
+  OcclusionBuffer(int width = kDefaultWidth, int height = kDefaultHeight);
+
+  OcclusionBuffer(const OcclusionBuffer&) = delete;
+
+  OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+
+  int Width() const { return width_; }
+
+  int Height() const { return height_; }
+
+  /**
+   * Number of levels of the depth pyramid, including the full resolution
+   * level 0.
+   */
+  int NumLevels() const { return levels_.size(); }
+
+  /**
+   * Clears the depth buffer and the list of occluders, and sets the
+   * transform from the world frame to clip coordinates.
+   */
+  void Begin(const QMatrix4x4& view_proj);
+
+  /**
+   * Adds an occluder to rasterize. The mesh must stay valid until
+   * Rasterize() returns.
+   */
+  void AddOccluder(const QMatrix4x4& model_mat, const OccluderMesh* mesh);
+
+  int NumOccluders() const { return occluders_.size(); }
+
+  /**
+   * Rasterizes the occluders, and builds the depth pyramid.
+   *
+   * @param pool if not null, the occluders are transformed, and bands of the
+   * depth buffer rasterized, in parallel.
+   */
+  void Rasterize(WorkerPool* pool);
+
+  /**
+   * Checks if a world-frame box is hidden by the rasterized occluders.
+   *
+   * Boxes that cross the near clipping plane or lie outside the view are
+   * never considered occluded. Safe to call from multiple threads at once.
+   */
+  bool IsOccluded(const AxisAlignedBox& box) const;
+
+  /**
+   * Depth of a texel of the depth pyramid.
+   */
+  float Depth(int level, int x, int y) const;
+
+ private:
+  // Triangle in window coordinates: x and y in texels, and z in [0, 1].
+  struct ScreenTriangle {
+    float x[3];
+    float y[3];
+    float z[3];
+  };
+
+  struct Occluder {
+    float mvp[16];
+    const OccluderMesh* mesh;
+  };
+
+  void SetupTriangles(int occluder_ind);
+
+  void RasterizeBand(int band);
+
+  void RasterizeTriangle(const ScreenTriangle& tri, int row_begin,
+      int row_end);
+
+  void BuildPyramid();
+
+  int width_;
+  int height_;
+
+  // Transform from the world frame to clip coordinates, also as a
+  // column-major array.
+  QMatrix4x4 view_proj_mat_;
+  float view_proj_[16];
+
+  std::vector<Occluder> occluders_;
+
+  // Screen space triangles of each occluder, and scratch space for the
+  // clip coordinates of its vertices.
+  std::vector<std::vector<ScreenTriangle>> triangles_;
+  std::vector<std::vector<float>> clip_vertices_;
+
+  // Level 0 is the depth buffer, and level k has half the resolution of
+  // level k - 1, rounded up.
+  std::vector<std::vector<float>> levels_;
+  std::vector<int> level_widths_;
+  std::vector<int> level_heights_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_OCCLUSION_BUFFER_HPP__
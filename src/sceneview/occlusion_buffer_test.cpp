@@ -0,0 +1,153 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "sceneview/occlusion_buffer.hpp"
+#include "sceneview/worker_pool.hpp"
+
+using sv::AxisAlignedBox;
+using sv::OccluderMesh;
+using sv::OcclusionBuffer;
+using sv::WorkerPool;
+
+// Camera at the origin looking down the -z axis.
+static QMatrix4x4 ViewProjection() {
+  QMatrix4x4 proj;
+  proj.perspective(60, 2, 1, 1000);
+  return proj;
+}
+
+// A rectangle in the z = 0 plane.
+static OccluderMesh MakeRectangle(float x0, float y0, float x1, float y1) {
+  OccluderMesh mesh;
+  mesh.vertices = { x0, y0, 0, x1, y0, 0, x1, y1, 0, x0, y1, 0 };
+  mesh.indices = { 0, 1, 2, 0, 2, 3 };
+  return mesh;
+}
+
+static QMatrix4x4 Translation(float x, float y, float z) {
+  QMatrix4x4 result;
+  result.translate(x, y, z);
+  return result;
+}
+
+static AxisAlignedBox Box(float x0, float y0, float z0, float x1, float y1,
+    float z1) {
+  return AxisAlignedBox(QVector3D(x0, y0, z0), QVector3D(x1, y1, z1));
+}
+
+TEST(OcclusionBuffer, Empty) {
+  OcclusionBuffer buffer(64, 32);
+  buffer.Begin(ViewProjection());
+  buffer.Rasterize(nullptr);
+  EXPECT_EQ(7, buffer.NumLevels());
+  EXPECT_EQ(1.0f, buffer.Depth(0, 10, 10));
+  EXPECT_FALSE(buffer.IsOccluded(Box(-1, -1, -20, 1, 1, -19)));
+}
+
+TEST(OcclusionBuffer, Wall) {
+  OcclusionBuffer buffer;
+  const OccluderMesh wall = MakeRectangle(-5, -5, 5, 5);
+  buffer.Begin(ViewProjection());
+  buffer.AddOccluder(Translation(0, 0, -10), &wall);
+  buffer.Rasterize(nullptr);
+  EXPECT_LT(buffer.Depth(0, buffer.Width() / 2, buffer.Height() / 2), 1.0f);
+
+  // Behind the wall.
+  EXPECT_TRUE(buffer.IsOccluded(Box(-1, -1, -20, 1, 1, -19)));
+  EXPECT_TRUE(buffer.IsOccluded(Box(-3, -3, -100, 3, 3, -11)));
+
+  // In front of the wall, straddling it, or sticking out from behind it.
+  EXPECT_FALSE(buffer.IsOccluded(Box(-1, -1, -6, 1, 1, -5)));
+  EXPECT_FALSE(buffer.IsOccluded(Box(-1, -1, -12, 1, 1, -8)));
+  EXPECT_FALSE(buffer.IsOccluded(Box(3, -1, -12, 8, 1, -11)));
+
+  // Crossing the near plane.
+  EXPECT_FALSE(buffer.IsOccluded(Box(-1, -1, -20, 1, 1, 1)));
+}
+
+TEST(OcclusionBuffer, Gap) {
+  OcclusionBuffer buffer;
+  const OccluderMesh left = MakeRectangle(-5, -5, -0.5, 5);
+  const OccluderMesh right = MakeRectangle(0.5, -5, 5, 5);
+  buffer.Begin(ViewProjection());
+  buffer.AddOccluder(Translation(0, 0, -10), &left);
+  buffer.AddOccluder(Translation(0, 0, -10), &right);
+  buffer.Rasterize(nullptr);
+
+  EXPECT_FALSE(buffer.IsOccluded(Box(-0.2, -1, -30, 0.2, 1, -29)));
+  EXPECT_TRUE(buffer.IsOccluded(Box(-12, -1, -30, -9, 1, -29)));
+  EXPECT_TRUE(buffer.IsOccluded(Box(9, -1, -30, 12, 1, -29)));
+}
+
+TEST(OcclusionBuffer, NearPlane) {
+  // A ground plane that extends behind the camera.
+  OcclusionBuffer buffer;
+  OccluderMesh ground;
+  ground.vertices = { -100, -1, 10, 100, -1, 10, 100, -1, -100,
+                      -100, -1, -100 };
+  ground.indices = { 0, 1, 2, 0, 2, 3 };
+  buffer.Begin(ViewProjection());
+  buffer.AddOccluder(QMatrix4x4(), &ground);
+  buffer.Rasterize(nullptr);
+
+  EXPECT_TRUE(buffer.IsOccluded(Box(-1, -5, -30, 1, -4, -29)));
+  EXPECT_FALSE(buffer.IsOccluded(Box(-1, -0.5, -30, 1, 0.5, -29)));
+}
+
+TEST(OcclusionBuffer, Pyramid) {
+  OcclusionBuffer buffer(100, 50);
+  EXPECT_EQ(100, buffer.Width());
+  const OccluderMesh wall = MakeRectangle(-3, -2, 4, 1);
+  buffer.Begin(ViewProjection());
+  buffer.AddOccluder(Translation(0, 0, -10), &wall);
+  buffer.Rasterize(nullptr);
+
+  int width = buffer.Width();
+  int height = buffer.Height();
+  for (int level = 1; level < buffer.NumLevels(); ++level) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        ASSERT_LE(buffer.Depth(level - 1, x, y),
+                  buffer.Depth(level, x / 2, y / 2));
+      }
+    }
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+  }
+}
+
+TEST(OcclusionBuffer, ParallelMatchesSerial) {
+  std::mt19937 rng(4321);
+  std::uniform_real_distribution<float> coord_dist(-20, 20);
+  std::uniform_real_distribution<float> depth_dist(-60, -2);
+  OccluderMesh mesh;
+  for (int ind = 0; ind < 300; ++ind) {
+    mesh.vertices.push_back(coord_dist(rng));
+    mesh.vertices.push_back(coord_dist(rng));
+    mesh.vertices.push_back(depth_dist(rng));
+    mesh.indices.push_back(ind);
+  }
+
+  OcclusionBuffer serial;
+  serial.Begin(ViewProjection());
+  serial.AddOccluder(QMatrix4x4(), &mesh);
+  serial.AddOccluder(Translation(1, 2, -3), &mesh);
+  serial.Rasterize(nullptr);
+
+  WorkerPool pool(4);
+  OcclusionBuffer parallel;
+  parallel.Begin(ViewProjection());
+  parallel.AddOccluder(QMatrix4x4(), &mesh);
+  parallel.AddOccluder(Translation(1, 2, -3), &mesh);
+  parallel.Rasterize(&pool);
+
+  for (int y = 0; y < serial.Height(); ++y) {
+    for (int x = 0; x < serial.Width(); ++x) {
+      ASSERT_EQ(serial.Depth(0, x, y), parallel.Depth(0, x, y));
+    }
+  }
+}
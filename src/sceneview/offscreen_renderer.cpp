@@ -0,0 +1,272 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/offscreen_renderer.hpp"
+#include "sceneview/internal_gl.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QSurfaceFormat>
+
+#include "sceneview/camera_node.hpp"
+#include "sceneview/draw_context.hpp"
+#include "sceneview/draw_group.hpp"
+#include "sceneview/renderer.hpp"
+#include "sceneview/tracing.hpp"
+
+namespace sv {
+
+struct OffscreenRenderer::Priv {
+  ResourceManager::Ptr resources;
+
+  Scene::Ptr scene;
+
+  CameraNode* camera = nullptr;
+
+  int width;
+
+  int height;
+
+  int samples;
+
+  // The surface must outlive the context.
+  std::unique_ptr<QOffscreenSurface> surface;
+
+  std::unique_ptr<QOpenGLContext> context;
+
+  // Framebuffer drawn into.
+  std::unique_ptr<QOpenGLFramebufferObject> render_fbo;
+
+  // Single-sample framebuffer that a multisample render_fbo is resolved into
+  // before reading it back. nullptr without multisampling.
+  std::unique_ptr<QOpenGLFramebufferObject> resolve_fbo;
+
+  std::unique_ptr<DrawContext> draw;
+
+  std::vector<Renderer*> renderers;
+};
+
+// Reverses the order of the rows of an image in place. OpenGL stores the
+// bottom row first.
+static void FlipRows(uint8_t* data, int row_size, int num_rows) {
+  std::vector<uint8_t> row(row_size);
+  for (int top = 0, bottom = num_rows - 1; top < bottom; ++top, --bottom) {
+    uint8_t* top_row = data + top * row_size;
+    uint8_t* bottom_row = data + bottom * row_size;
+    memcpy(row.data(), top_row, row_size);
+    memcpy(top_row, bottom_row, row_size);
+    memcpy(bottom_row, row.data(), row_size);
+  }
+}
+
+OffscreenRenderer::OffscreenRenderer(const ResourceManager::Ptr& resources,
+    const Scene::Ptr& scene, int width, int height, int samples) :
+  p_(new Priv()) {
+  if (width <= 0 || height <= 0) {
+    delete p_;
+    throw std::invalid_argument("Invalid image size");
+  }
+  p_->resources = resources;
+  p_->scene = scene;
+  p_->width = width;
+  p_->height = height;
+  p_->samples = std::max(samples, 0);
+
+  p_->context.reset(new QOpenGLContext());
+  p_->context->setFormat(QSurfaceFormat::defaultFormat());
+  p_->surface.reset(new QOffscreenSurface());
+  if (!p_->context->create()) {
+    delete p_;
+    throw std::runtime_error("Unable to create OpenGL context");
+  }
+  p_->surface->setFormat(p_->context->format());
+  p_->surface->create();
+  if (!p_->surface->isValid() ||
+      !p_->context->makeCurrent(p_->surface.get())) {
+    delete p_;
+    throw std::runtime_error("Unable to create offscreen surface");
+  }
+
+  try {
+    CreateFramebuffers();
+  } catch (const std::runtime_error&) {
+    p_->resolve_fbo.reset();
+    p_->render_fbo.reset();
+    p_->context->doneCurrent();
+    delete p_;
+    throw;
+  }
+
+  p_->draw.reset(new DrawContext(p_->resources, p_->scene));
+  p_->draw->SetDrawGroups({p_->scene->GetDefaultDrawGroup()});
+}
+
+OffscreenRenderer::~OffscreenRenderer() {
+  MakeCurrent();
+  for (Renderer* renderer : p_->renderers) {
+    renderer->ShutdownGL();
+  }
+  p_->renderers.clear();
+
+  // OpenGL objects can only be released while the context is current.
+  p_->draw.reset();
+  p_->resolve_fbo.reset();
+  p_->render_fbo.reset();
+  p_->context->doneCurrent();
+  delete p_;
+}
+
+void OffscreenRenderer::AddRenderer(Renderer* renderer) {
+  p_->renderers.push_back(renderer);
+  renderer->SetScene(p_->resources, p_->scene);
+  renderer->SetBaseNode(
+      p_->scene->MakeGroup(p_->scene->Root(), "basenode_" + renderer->Name()));
+
+  MakeCurrent();
+  renderer->InitializeGL();
+}
+
+std::vector<Renderer*> OffscreenRenderer::GetRenderers() {
+  return p_->renderers;
+}
+
+void OffscreenRenderer::SetCamera(CameraNode* camera_node) {
+  if (!p_->scene->ContainsNode(camera_node)) {
+    throw std::invalid_argument("camera doesn't belong the scene");
+  }
+  p_->camera = camera_node;
+  p_->camera->SetViewportSize(p_->width, p_->height);
+  p_->scene->GetDefaultDrawGroup()->SetCamera(p_->camera);
+}
+
+CameraNode* OffscreenRenderer::GetCamera() { return p_->camera; }
+
+Scene::Ptr OffscreenRenderer::GetScene() { return p_->scene; }
+
+ResourceManager::Ptr OffscreenRenderer::GetResources() {
+  return p_->resources;
+}
+
+void OffscreenRenderer::SetBackgroundColor(const QColor& color) {
+  p_->draw->SetClearColor(color);
+}
+
+void OffscreenRenderer::SetDrawGroups(const std::vector<DrawGroup*>& groups) {
+  p_->draw->SetDrawGroups(groups);
+}
+
+void OffscreenRenderer::Resize(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    throw std::invalid_argument("Invalid image size");
+  }
+  if (width == p_->width && height == p_->height) {
+    return;
+  }
+  p_->width = width;
+  p_->height = height;
+  MakeCurrent();
+  CreateFramebuffers();
+  if (p_->camera) {
+    p_->camera->SetViewportSize(width, height);
+  }
+}
+
+int OffscreenRenderer::Width() const { return p_->width; }
+
+int OffscreenRenderer::Height() const { return p_->height; }
+
+QImage OffscreenRenderer::RenderImage() {
+  std::vector<uint8_t> rgba;
+  Render(&rgba, nullptr);
+
+  QImage image(p_->width, p_->height, QImage::Format_RGBA8888);
+  const int row_size = p_->width * 4;
+  for (int row = 0; row < p_->height; ++row) {
+    memcpy(image.scanLine(row), rgba.data() + row * row_size, row_size);
+  }
+  return image;
+}
+
+void OffscreenRenderer::Render(std::vector<uint8_t>* rgba,
+    std::vector<float>* depth) {
+  SV_TRACE_SCOPE("render", "OffscreenRenderer::Render");
+  const int width = p_->width;
+  const int height = p_->height;
+
+  MakeCurrent();
+  glViewport(0, 0, width, height);
+  p_->draw->Draw(width, height, &p_->renderers);
+
+  SV_TRACE_SCOPE("render", "OffscreenRenderer::ReadPixels");
+  QOpenGLFramebufferObject* read_fbo = p_->render_fbo.get();
+  if (p_->resolve_fbo) {
+    QOpenGLFramebufferObject::blitFramebuffer(p_->resolve_fbo.get(),
+        p_->render_fbo.get(), GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT,
+        GL_NEAREST);
+    read_fbo = p_->resolve_fbo.get();
+  }
+  read_fbo->bind();
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  if (rgba) {
+    rgba->resize(width * height * 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+        rgba->data());
+    FlipRows(rgba->data(), width * 4, height);
+  }
+  if (depth) {
+    depth->resize(width * height);
+    glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT,
+        depth->data());
+    FlipRows(reinterpret_cast<uint8_t*>(depth->data()),
+        width * sizeof(float), height);
+  }
+}
+
+const FrameStats& OffscreenRenderer::GetFrameStats() const {
+  return p_->draw->Stats();
+}
+
+const FrameStatsHistory& OffscreenRenderer::GetFrameStatsHistory() const {
+  return p_->draw->StatsHistory();
+}
+
+void OffscreenRenderer::MakeCurrent() {
+  p_->context->makeCurrent(p_->surface.get());
+  p_->render_fbo->bind();
+}
+
+void OffscreenRenderer::DoneCurrent() {
+  p_->context->doneCurrent();
+}
+
+void OffscreenRenderer::CreateFramebuffers() {
+  const QSize size(p_->width, p_->height);
+  QOpenGLFramebufferObjectFormat format;
+  format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+  format.setSamples(p_->samples);
+  p_->render_fbo.reset(new QOpenGLFramebufferObject(size, format));
+
+  if (p_->samples > 0) {
+    QOpenGLFramebufferObjectFormat resolve_format;
+    resolve_format.setAttachment(
+        QOpenGLFramebufferObject::CombinedDepthStencil);
+    p_->resolve_fbo.reset(new QOpenGLFramebufferObject(size, resolve_format));
+  } else {
+    p_->resolve_fbo.reset();
+  }
+
+  if (!p_->render_fbo->isValid() ||
+      (p_->resolve_fbo && !p_->resolve_fbo->isValid())) {
+    throw std::runtime_error("Unable to create framebuffer object");
+  }
+  p_->render_fbo->bind();
+}
+
+}  // namespace sv
@@ -0,0 +1,158 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_OFFSCREEN_RENDERER_HPP__
+#define SCENEVIEW_OFFSCREEN_RENDERER_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include <QColor>
+#include <QImage>
+
+#include <sceneview/frame_stats.hpp>
+#include <sceneview/resource_manager.hpp>
+#include <sceneview/scene.hpp>
+
+namespace sv {
+
+class CameraNode;
+class DrawGroup;
+class Renderer;
+
+/**
+ * Draws a scene into an offscreen framebuffer, without a window.
+ *
+ * OffscreenRenderer is the headless counterpart of Viewport. It draws with
+ * the same rendering engine and manages Renderer objects the same way, but
+ * renders into a QOpenGLFramebufferObject on a QOffscreenSurface, and returns
+ * the result as a QImage or as raw color and depth buffers. It has no input
+ * handling and never redraws on its own: each call to RenderImage() or
+ * Render() draws exactly one frame.
+ *
+ * A QGuiApplication (or QApplication) must exist, and the OffscreenRenderer
+ * must be created and used from the GUI thread. It works with the
+ * "offscreen" Qt platform plugin (QT_QPA_PLATFORM=offscreen), for example on
+ * a server with a software OpenGL implementation such as Mesa llvmpipe.
+ *
+ * Each OffscreenRenderer has its own OpenGL context, and resources are
+ * uploaded into the context that first draws them. Thus a ResourceManager
+ * should not be drawn by an OffscreenRenderer and a Viewport, or by two
+ * OffscreenRenderer objects, at the same time.
+ *
+ * Typical usage:
+ * @code
+ * OffscreenRenderer offscreen(resources, scene, 256, 256);
+ * offscreen.SetCamera(camera);
+ * for (...) {
+ *   // Modify the scene...
+ *   offscreen.RenderImage().save(...);
+ * }
+ * @endcode
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/offscreen_renderer.hpp
+ */
+class OffscreenRenderer {
+  public:
+    /**
+     * Creates the OpenGL context and framebuffer.
+     *
+     * @param width the image width, in pixels.
+     * @param height the image height, in pixels.
+     * @param samples number of samples per pixel for multisample
+     * antialiasing, or 0 to disable multisampling.
+     *
+     * @throw std::runtime_error if the OpenGL context or the framebuffer
+     * could not be created.
+     */
+    OffscreenRenderer(const ResourceManager::Ptr& resources,
+        const Scene::Ptr& scene, int width, int height, int samples = 0);
+
+    OffscreenRenderer(const OffscreenRenderer&) = delete;
+
+    OffscreenRenderer& operator=(const OffscreenRenderer&) = delete;
+
+    /**
+     * Shuts down the renderers and releases the OpenGL context.
+     */
+    ~OffscreenRenderer();
+
+    /**
+     * Adds a renderer, and initializes it. The OffscreenRenderer does not
+     * take ownership of the renderer, which must remain valid until the
+     * OffscreenRenderer is destroyed.
+     */
+    void AddRenderer(Renderer* renderer);
+
+    std::vector<Renderer*> GetRenderers();
+
+    /**
+     * Sets the camera for the scene's default draw group.
+     */
+    void SetCamera(CameraNode* camera_node);
+
+    CameraNode* GetCamera();
+
+    Scene::Ptr GetScene();
+
+    ResourceManager::Ptr GetResources();
+
+    void SetBackgroundColor(const QColor& color);
+
+    void SetDrawGroups(const std::vector<DrawGroup*>& groups);
+
+    /**
+     * Changes the image size, recreating the framebuffer.
+     */
+    void Resize(int width, int height);
+
+    int Width() const;
+
+    int Height() const;
+
+    /**
+     * Draws a frame, and returns the color buffer.
+     *
+     * @return an image in QImage::Format_RGBA8888.
+     */
+    QImage RenderImage();
+
+    /**
+     * Draws a frame, and reads back the color and depth buffers. Both are
+     * stored row by row, starting at the top of the image.
+     *
+     * @param rgba if not nullptr, filled with Width() * Height() * 4 bytes of
+     * 8-bit red, green, blue, and alpha values.
+     * @param depth if not nullptr, filled with Width() * Height() window
+     * depth values, in [0, 1].
+     */
+    void Render(std::vector<uint8_t>* rgba, std::vector<float>* depth);
+
+    /**
+     * Statistics of the most recently drawn frame.
+     */
+    const FrameStats& GetFrameStats() const;
+
+    /**
+     * Statistics of the recently drawn frames.
+     */
+    const FrameStatsHistory& GetFrameStatsHistory() const;
+
+    /**
+     * Makes the OpenGL context current, with the framebuffer bound. Use this
+     * to create or release OpenGL resources outside of a Renderer.
+     */
+    void MakeCurrent();
+
+    void DoneCurrent();
+
+  private:
+    void CreateFramebuffers();
+
+    struct Priv;
+    Priv* p_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_OFFSCREEN_RENDERER_HPP__
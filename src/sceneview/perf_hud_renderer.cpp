@@ -0,0 +1,353 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/perf_hud_renderer.hpp"
+#include "sceneview/internal_gl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include <QColor>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QStringList>
+#include <QVector2D>
+
+#include "sceneview/frame_stats.hpp"
+
+namespace sv {
+
+typedef std::chrono::steady_clock Clock;
+
+// Interval between text updates, in milliseconds.
+static const double kTextRefreshMs = 250;
+
+// Layout, in pixels.
+static const float kLineHeight = 15;
+static const float kMargin = 6;
+static const int kGraphFrames = 120;
+static const float kBarWidth = 2;
+static const float kGraphHeight = 60;
+
+// Frame time at the top of the graph, unless a frame took longer.
+static const double kGraphMinScaleMs = 33.3;
+
+// Frame time budget at 60 Hz, drawn as a line across the graph.
+static const double kTargetFrameMs = 1000.0 / 60;
+
+// Position of the baseline within a line of text, relative to the line
+// height.
+static const float kBaseline = 0.8;
+
+struct HudVertex {
+  float x;
+  float y;
+  float u;
+  float v;
+  // 1 for text, 0 for solid colors.
+  float textured;
+  float r;
+  float g;
+  float b;
+  float a;
+};
+
+struct PerfHudRenderer::Priv {
+  ShaderResource::Ptr shader;
+  int pos_location;
+  int tex_coords_location;
+  int color_location;
+
+  FontResource::Ptr font;
+
+  // Rewritten every frame.
+  QOpenGLBuffer vbo;
+  int vbo_capacity = 0;
+
+  // The background quad, followed by the text and the graph.
+  std::vector<HudVertex> vertices;
+
+  // Text quads, laid out when the text is refreshed.
+  std::vector<HudVertex> text_vertices;
+  float text_width = 0;
+  float text_height = 0;
+
+  Clock::time_point last_refresh;
+  int frames_since_refresh = 0;
+  double fps = -1;
+};
+
+static void AddQuad(std::vector<HudVertex>* vertices, float x0, float y0,
+    float x1, float y1, float u0, float v0, float u1, float v1,
+    float textured, const QColor& color) {
+  const float r = color.redF();
+  const float g = color.greenF();
+  const float b = color.blueF();
+  const float a = color.alphaF();
+  const HudVertex top_left = { x0, y0, u0, v0, textured, r, g, b, a };
+  const HudVertex top_right = { x1, y0, u1, v0, textured, r, g, b, a };
+  const HudVertex bottom_left = { x0, y1, u0, v1, textured, r, g, b, a };
+  const HudVertex bottom_right = { x1, y1, u1, v1, textured, r, g, b, a };
+  vertices->push_back(top_left);
+  vertices->push_back(bottom_left);
+  vertices->push_back(top_right);
+  vertices->push_back(top_right);
+  vertices->push_back(bottom_left);
+  vertices->push_back(bottom_right);
+}
+
+static void AddRect(std::vector<HudVertex>* vertices, float x0, float y0,
+    float x1, float y1, const QColor& color) {
+  AddQuad(vertices, x0, y0, x1, y1, 0, 0, 0, 0, 0, color);
+}
+
+static QString FormatMs(double ms) {
+  if (ms < 0) {
+    return "--";
+  }
+  return QString::number(ms, 'f', 2);
+}
+
+static QString FormatCount(int64_t count) {
+  if (count >= 10000000) {
+    return QString::number(count / 1e6, 'f', 1) + "M";
+  } else if (count >= 10000) {
+    return QString::number(count / 1e3, 'f', 1) + "k";
+  }
+  return QString::number(count);
+}
+
+static QString FormatBytes(int64_t bytes) {
+  return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+}
+
+PerfHudRenderer::PerfHudRenderer(const QString& name, QObject* parent) :
+  Renderer(name, parent),
+  p_(new Priv()) {}
+
+PerfHudRenderer::~PerfHudRenderer() { delete p_; }
+
+void PerfHudRenderer::InitializeGL() {
+  ResourceManager::Ptr resources = GetResources();
+
+  // Share the shader between overlays of the same resource manager.
+  const QString shader_name = "sv_perf_hud_shader";
+  p_->shader = resources->GetShader(shader_name);
+  if (!p_->shader) {
+    p_->shader = resources->MakeShader(shader_name);
+    p_->shader->LoadFromFiles(":sceneview/stock_shaders/perf_hud");
+  }
+  QOpenGLShaderProgram* program = p_->shader->Program();
+  p_->pos_location = program->attributeLocation("hud_pos");
+  p_->tex_coords_location = program->attributeLocation("hud_tex_coords");
+  p_->color_location = program->attributeLocation("hud_color");
+  program->release();
+
+  QFont font("Monospace");
+  font.setStyleHint(QFont::TypeWriter);
+  p_->font = resources->Font(font);
+
+  p_->vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+  p_->vbo.create();
+  p_->vbo_capacity = 0;
+
+  p_->last_refresh = Clock::now();
+}
+
+void PerfHudRenderer::RenderEnd() {
+  const FrameStatsHistory* stats_history = GetFrameStatsHistory();
+  if (!stats_history || !p_->shader) {
+    return;
+  }
+  const FrameStatsHistory& history = *stats_history;
+
+  p_->frames_since_refresh++;
+  const Clock::time_point now = Clock::now();
+  const double elapsed_ms = std::chrono::duration<double, std::milli>(
+      now - p_->last_refresh).count();
+  if (elapsed_ms >= kTextRefreshMs) {
+    p_->fps = p_->frames_since_refresh * 1000.0 / elapsed_ms;
+    p_->frames_since_refresh = 0;
+    p_->last_refresh = now;
+    UpdateText(history);
+  } else if (p_->text_vertices.empty()) {
+    UpdateText(history);
+  }
+
+  UpdateVertices(history);
+
+  DrawVertices(ViewportWidth(), ViewportHeight());
+}
+
+void PerfHudRenderer::ShutdownGL() {
+  p_->vbo.destroy();
+  p_->vbo_capacity = 0;
+  p_->shader.reset();
+  p_->font.reset();
+}
+
+void PerfHudRenderer::UpdateText(const FrameStatsHistory& history) {
+  QStringList lines;
+  if (history.Size() == 0) {
+    lines << "Waiting for frames";
+  } else {
+    const FrameStats& stats = history.At(history.Size() - 1);
+    const double cpu_p95 = history.Percentile(95,
+        [](const FrameStats& frame) { return frame.cpu_ms; });
+    const double gpu_p95 = history.Percentile(95,
+        [](const FrameStats& frame) { return frame.gpu_ms; });
+
+    lines << "FPS " + (p_->fps < 0 ? QString("--") :
+        QString::number(p_->fps, 'f', 1));
+    lines << "CPU " + FormatMs(stats.cpu_ms) + " ms (p95 " +
+        FormatMs(cpu_p95) + ")";
+    lines << "GPU " + FormatMs(stats.gpu_ms) + " ms (p95 " +
+        FormatMs(gpu_p95) + ")";
+    lines << "Draw calls " + FormatCount(stats.draw_calls) + ", triangles " +
+        FormatCount(stats.triangles);
+    lines << "Nodes " + FormatCount(stats.nodes_considered) + ", drawn " +
+        FormatCount(stats.nodes_drawn);
+    lines << "Culled " + FormatCount(stats.nodes_culled) + ", occluded " +
+        FormatCount(stats.nodes_occluded);
+
+    ResourceManager::Ptr resources = GetResources();
+    lines << "Geometry " + FormatBytes(resources->GeometryMemoryUsage()) +
+        ", textures " + FormatBytes(resources->TextureMemoryUsage());
+
+    for (const RendererStats& renderer : stats.renderers) {
+      lines << "  " + renderer.name + " " +
+          FormatMs(renderer.begin_ms + renderer.end_ms) + " ms";
+    }
+  }
+
+  // Lay out the text, one quad per character.
+  p_->text_vertices.clear();
+  p_->text_width = 0;
+  float baseline = kMargin + kBaseline * kLineHeight;
+  for (const QString& line : lines) {
+    const std::string text = line.toStdString();
+    float cursor_x = kMargin;
+    for (const char ch : text) {
+      const FontResource::CharData& cdata =
+          p_->font->GetCharData(static_cast<unsigned char>(ch));
+      AddQuad(&p_->text_vertices,
+          cursor_x + cdata.x0 * kLineHeight, baseline + cdata.y0 * kLineHeight,
+          cursor_x + cdata.x1 * kLineHeight, baseline + cdata.y1 * kLineHeight,
+          cdata.u0, cdata.v0, cdata.u1, cdata.v1, 1, Qt::white);
+      cursor_x += cdata.width_to_height * kLineHeight;
+    }
+    p_->text_width = std::max(p_->text_width, cursor_x - kMargin);
+    baseline += kLineHeight;
+  }
+  p_->text_height = lines.size() * kLineHeight;
+}
+
+void PerfHudRenderer::UpdateVertices(const FrameStatsHistory& history) {
+  std::vector<HudVertex>& vertices = p_->vertices;
+  vertices.clear();
+
+  const float graph_width = kGraphFrames * kBarWidth;
+  const float panel_width =
+      std::max(p_->text_width, graph_width) + 2 * kMargin;
+  const float graph_left = kMargin;
+  const float graph_top = kMargin + p_->text_height + kMargin;
+  const float graph_bottom = graph_top + kGraphHeight;
+  const float panel_height = graph_bottom + kMargin;
+
+  // The background is drawn first, so that everything else blends over it.
+  AddRect(&vertices, 0, 0, panel_width, panel_height, QColor(0, 0, 0, 160));
+  vertices.insert(vertices.end(), p_->text_vertices.begin(),
+      p_->text_vertices.end());
+  AddRect(&vertices, graph_left, graph_top, graph_left + graph_width,
+      graph_bottom, QColor(40, 40, 40, 160));
+
+  // One bar per frame, with the most recent frame on the right.
+  const int num_frames = std::min(history.Size(), kGraphFrames);
+  const int first_frame = history.Size() - num_frames;
+  double scale_ms = kGraphMinScaleMs;
+  for (int ind = first_frame; ind < history.Size(); ++ind) {
+    const FrameStats& stats = history.At(ind);
+    scale_ms = std::max(scale_ms, std::max(stats.cpu_ms, stats.gpu_ms));
+  }
+  const float pixels_per_ms = kGraphHeight / scale_ms;
+  for (int ind = first_frame; ind < history.Size(); ++ind) {
+    const FrameStats& stats = history.At(ind);
+    const float x0 = graph_left + graph_width -
+        (history.Size() - ind) * kBarWidth;
+    const float x1 = x0 + kBarWidth;
+
+    QColor color(80, 200, 80);
+    if (stats.cpu_ms > 2 * kTargetFrameMs) {
+      color = QColor(230, 60, 60);
+    } else if (stats.cpu_ms > kTargetFrameMs) {
+      color = QColor(230, 200, 60);
+    }
+    AddRect(&vertices, x0, graph_bottom - stats.cpu_ms * pixels_per_ms, x1,
+        graph_bottom, color);
+
+    if (stats.gpu_ms >= 0) {
+      const float y = graph_bottom - stats.gpu_ms * pixels_per_ms;
+      AddRect(&vertices, x0, y - 1, x1, y + 1, QColor(80, 170, 255));
+    }
+  }
+
+  const float target_y = graph_bottom - kTargetFrameMs * pixels_per_ms;
+  AddRect(&vertices, graph_left, target_y, graph_left + graph_width,
+      target_y + 1, QColor(255, 255, 255, 120));
+}
+
+void PerfHudRenderer::DrawVertices(int width, int height) {
+  if (p_->vertices.empty() || width <= 0 || height <= 0) {
+    return;
+  }
+
+  glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_STENCIL_TEST);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  QOpenGLShaderProgram* program = p_->shader->Program();
+  program->bind();
+  program->setUniformValue("hud_viewport_size", QVector2D(width, height));
+  program->setUniformValue("texture0", 0);
+
+  QOpenGLTexture* texture = p_->font->Texture().get();
+  texture->bind(0);
+
+  // Orphan the previous contents, so that the driver does not wait for the
+  // previous frame's draw call to finish reading them.
+  const int num_bytes = p_->vertices.size() * sizeof(HudVertex);
+  p_->vbo.bind();
+  p_->vbo_capacity = std::max(p_->vbo_capacity, num_bytes);
+  p_->vbo.allocate(p_->vbo_capacity);
+  p_->vbo.write(0, p_->vertices.data(), num_bytes);
+
+  const int stride = sizeof(HudVertex);
+  program->enableAttributeArray(p_->pos_location);
+  program->setAttributeBuffer(p_->pos_location, GL_FLOAT,
+      offsetof(HudVertex, x), 2, stride);
+  program->enableAttributeArray(p_->tex_coords_location);
+  program->setAttributeBuffer(p_->tex_coords_location, GL_FLOAT,
+      offsetof(HudVertex, u), 3, stride);
+  program->enableAttributeArray(p_->color_location);
+  program->setAttributeBuffer(p_->color_location, GL_FLOAT,
+      offsetof(HudVertex, r), 4, stride);
+
+  glDrawArrays(GL_TRIANGLES, 0, p_->vertices.size());
+
+  program->disableAttributeArray(p_->pos_location);
+  program->disableAttributeArray(p_->tex_coords_location);
+  program->disableAttributeArray(p_->color_location);
+  p_->vbo.release();
+  texture->release(0);
+  program->release();
+
+  glPopAttrib();
+}
+
+}  // namespace sv
@@ -0,0 +1,69 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_PERF_HUD_RENDERER_HPP__
+#define SCENEVIEW_PERF_HUD_RENDERER_HPP__
+
+#include <sceneview/renderer.hpp>
+
+namespace sv {
+
+class FrameStatsHistory;
+
+/**
+ * A stock renderer that draws a performance overlay in the top left corner
+ * of the viewport.
+ *
+ * The overlay shows:
+ * - the frame rate, and the CPU and GPU frame times
+ * - a graph of the CPU time of recent frames, with GPU times as ticks
+ * - the number of draw calls and triangles
+ * - the number of draw nodes drawn, culled, and occluded
+ * - the graphics memory used by geometry and textures
+ * - the time spent in each renderer
+ *
+ * The numbers are those of the most recent frame in
+ * Viewport::GetFrameStatsHistory(), and the text is refreshed a few times a
+ * second so that it can be read. The frame rate counts the frames actually
+ * drawn, so it is low when the viewport only redraws on demand.
+ *
+ * The overlay is drawn in RenderEnd() with a single dynamic vertex buffer and
+ * a single draw call, outside of the draw groups, so that it does not add to
+ * the draw call, triangle, and node counts that it reports. Its own CPU time
+ * shows up with the other renderers.
+ *
+ * The Viewer adds a disabled PerfHudRenderer to its viewport, which can be
+ * toggled from the Renderers menu. It draws nothing when used with an
+ * OffscreenRenderer.
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/perf_hud_renderer.hpp
+ */
+class PerfHudRenderer : public Renderer {
+  Q_OBJECT
+
+  public:
+    explicit PerfHudRenderer(const QString& name, QObject* parent = 0);
+
+    virtual ~PerfHudRenderer();
+
+    void InitializeGL() override;
+
+    void RenderEnd() override;
+
+    void ShutdownGL() override;
+
+  private:
+    void UpdateText(const FrameStatsHistory& history);
+
+    void UpdateVertices(const FrameStatsHistory& history);
+
+    void DrawVertices(int width, int height);
+
+    struct Priv;
+
+    Priv* p_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_PERF_HUD_RENDERER_HPP__
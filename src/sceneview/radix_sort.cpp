@@ -0,0 +1,62 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/radix_sort.hpp"
+
+#include <cstring>
+
+namespace sv {
+
+void RadixSort(std::vector<SortItem>* items, std::vector<SortItem>* scratch) {
+  const size_t num_items = items->size();
+  if (num_items < 2) {
+    return;
+  }
+  scratch->resize(num_items);
+
+  constexpr int kNumDigits = 8;
+  constexpr int kRadix = 256;
+
+  // Build the histograms for all digits in a single pass.
+  uint32_t counts[kNumDigits][kRadix];
+  memset(counts, 0, sizeof(counts));
+  for (const SortItem& item : *items) {
+    uint64_t key = item.key;
+    for (int digit = 0; digit < kNumDigits; ++digit) {
+      counts[digit][key & 0xff]++;
+      key >>= 8;
+    }
+  }
+
+  SortItem* src = items->data();
+  SortItem* dst = scratch->data();
+
+  for (int digit = 0; digit < kNumDigits; ++digit) {
+    const int shift = digit * 8;
+
+    // If every item has the same value for this digit, the pass would not
+    // change anything.
+    const int first_value = (src[0].key >> shift) & 0xff;
+    if (counts[digit][first_value] == num_items) {
+      continue;
+    }
+
+    uint32_t offsets[kRadix];
+    uint32_t total = 0;
+    for (int value = 0; value < kRadix; ++value) {
+      offsets[value] = total;
+      total += counts[digit][value];
+    }
+
+    for (size_t i = 0; i < num_items; ++i) {
+      const int value = (src[i].key >> shift) & 0xff;
+      dst[offsets[value]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+
+  if (src != items->data()) {
+    items->swap(*scratch);
+  }
+}
+
+}  // namespace sv
@@ -0,0 +1,36 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_RADIX_SORT_HPP__
+#define SCENEVIEW_RADIX_SORT_HPP__
+
+#include <cstdint>
+#include <vector>
+
+namespace sv {
+
+/**
+ * A 64-bit sort key paired with the index of the item it refers to.
+ */
+struct SortItem {
+  uint64_t key;
+  uint32_t index;
+};
+
+/**
+ * Sorts items by ascending key using a least-significant-digit radix sort.
+ *
+ * The sort is stable, so items with equal keys keep their relative order.
+ * Digits that have the same value across all items are skipped, so keys with
+ * few distinct high bits sort in fewer passes.
+ *
+ * @param items the items to sort.
+ * @param scratch temporary storage. Passing the same vector in every call
+ * avoids reallocating it.
+ *
+ * Internal function, not part of the public API.
+ */
+void RadixSort(std::vector<SortItem>* items, std::vector<SortItem>* scratch);
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_RADIX_SORT_HPP__
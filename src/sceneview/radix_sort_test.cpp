@@ -0,0 +1,81 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "sceneview/radix_sort.hpp"
+
+using sv::RadixSort;
+using sv::SortItem;
+
+static std::vector<SortItem> MakeItems(const std::vector<uint64_t>& keys) {
+  std::vector<SortItem> items;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    items.push_back(SortItem{keys[i], static_cast<uint32_t>(i)});
+  }
+  return items;
+}
+
+static void ExpectSortedAndStable(const std::vector<SortItem>& items) {
+  for (size_t i = 1; i < items.size(); ++i) {
+    ASSERT_LE(items[i - 1].key, items[i].key);
+    if (items[i - 1].key == items[i].key) {
+      ASSERT_LT(items[i - 1].index, items[i].index);
+    }
+  }
+}
+
+TEST(RadixSort, Empty) {
+  std::vector<SortItem> items;
+  std::vector<SortItem> scratch;
+  RadixSort(&items, &scratch);
+  EXPECT_TRUE(items.empty());
+}
+
+TEST(RadixSort, Random) {
+  std::mt19937_64 rng(1234);
+  for (int num_items : {1, 2, 17, 1000, 65536}) {
+    std::vector<uint64_t> keys(num_items);
+    for (uint64_t& key : keys) {
+      key = rng();
+    }
+    std::vector<SortItem> items = MakeItems(keys);
+    std::vector<SortItem> scratch;
+    RadixSort(&items, &scratch);
+    ASSERT_EQ(num_items, static_cast<int>(items.size()));
+    ExpectSortedAndStable(items);
+
+    std::sort(keys.begin(), keys.end());
+    for (int i = 0; i < num_items; ++i) {
+      EXPECT_EQ(keys[i], items[i].key);
+    }
+  }
+}
+
+TEST(RadixSort, Stable) {
+  // Few distinct keys, spread across the high and low bytes.
+  std::mt19937 rng(42);
+  std::vector<uint64_t> keys(5000);
+  for (uint64_t& key : keys) {
+    const uint64_t high = rng() % 4;
+    const uint64_t low = rng() % 3;
+    key = (high << 56) | low;
+  }
+  std::vector<SortItem> items = MakeItems(keys);
+  std::vector<SortItem> scratch;
+  RadixSort(&items, &scratch);
+  ExpectSortedAndStable(items);
+}
+
+TEST(RadixSort, UniformKeys) {
+  // Every digit is skipped, so the input order must be left as is.
+  std::vector<SortItem> items = MakeItems(std::vector<uint64_t>(100, 7));
+  std::vector<SortItem> scratch;
+  RadixSort(&items, &scratch);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, static_cast<int>(items[i].index));
+  }
+}
@@ -0,0 +1,103 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/range_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace sv {
+
+RangeAllocator::RangeAllocator(int64_t capacity) :
+  capacity_(capacity),
+  free_size_(capacity) {
+  if (capacity > 0) {
+    free_[0] = capacity;
+  }
+}
+
+int64_t RangeAllocator::Allocate(int64_t size) {
+  if (size <= 0) {
+    return -1;
+  }
+  for (auto iter = free_.begin(); iter != free_.end(); ++iter) {
+    if (iter->second < size) {
+      continue;
+    }
+    const int64_t offset = iter->first;
+    const int64_t remaining = iter->second - size;
+    free_.erase(iter);
+    if (remaining) {
+      free_[offset + size] = remaining;
+    }
+    allocated_[offset] = size;
+    free_size_ -= size;
+    return offset;
+  }
+  return -1;
+}
+
+void RangeAllocator::Free(int64_t offset) {
+  auto alloc_iter = allocated_.find(offset);
+  assert(alloc_iter != allocated_.end());
+  if (alloc_iter == allocated_.end()) {
+    return;
+  }
+  int64_t start = offset;
+  int64_t size = alloc_iter->second;
+  allocated_.erase(alloc_iter);
+  free_size_ += size;
+
+  // Merge with the free range that follows, if any.
+  auto next = free_.find(start + size);
+  if (next != free_.end()) {
+    size += next->second;
+    free_.erase(next);
+  }
+
+  // Merge with the free range that precedes, if any.
+  auto prev = free_.lower_bound(start);
+  if (prev != free_.begin()) {
+    --prev;
+    if (prev->first + prev->second == start) {
+      start = prev->first;
+      size += prev->second;
+      free_.erase(prev);
+    }
+  }
+  free_[start] = size;
+}
+
+int64_t RangeAllocator::AllocationSize(int64_t offset) const {
+  auto iter = allocated_.find(offset);
+  return iter == allocated_.end() ? 0 : iter->second;
+}
+
+std::vector<RangeAllocator::Move> RangeAllocator::Compact() {
+  std::vector<Move> moves;
+  std::map<int64_t, int64_t> compacted;
+  int64_t next_offset = 0;
+  for (const auto& item : allocated_) {
+    if (item.first != next_offset) {
+      moves.push_back(Move{item.first, next_offset, item.second});
+    }
+    compacted[next_offset] = item.second;
+    next_offset += item.second;
+  }
+  allocated_.swap(compacted);
+
+  free_.clear();
+  if (next_offset < capacity_) {
+    free_[next_offset] = capacity_ - next_offset;
+  }
+  return moves;
+}
+
+int64_t RangeAllocator::LargestFreeRange() const {
+  int64_t largest = 0;
+  for (const auto& item : free_) {
+    largest = std::max(largest, item.second);
+  }
+  return largest;
+}
+
+}  // namespace sv
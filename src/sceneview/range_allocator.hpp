@@ -0,0 +1,89 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_RANGE_ALLOCATOR_HPP__
+#define SCENEVIEW_RANGE_ALLOCATOR_HPP__
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace sv {
+
+/**
+ * Sub-allocates ranges of [0, capacity) using a first-fit free list.
+ *
+ * Freed ranges are merged with adjacent free ranges. Units are up to the
+ * caller (e.g., vertices or indices).
+ *
+ * Internal class, not part of the public API.
+ */
+class RangeAllocator {
+ public:
+  /**
+   * Describes an allocation moved by Compact().
+   */
+  struct Move {
+    int64_t from;
+    int64_t to;
+    int64_t size;
+  };
+
+  explicit RangeAllocator(int64_t capacity);
+
+  /**
+   * Allocates a range of @p size units.
+   *
+   * @return the offset of the range, or -1 if there is no free range large
+   * enough.
+   */
+  int64_t Allocate(int64_t size);
+
+  /**
+   * Frees the range that starts at @p offset, which must have been returned
+   * by Allocate().
+   */
+  void Free(int64_t offset);
+
+  /**
+   * Size of the allocated range that starts at @p offset, or 0 if there is
+   * none.
+   */
+  int64_t AllocationSize(int64_t offset) const;
+
+  /**
+   * Moves all allocations to the start of the range, in order, so that the
+   * free space forms a single range at the end.
+   *
+   * @return the allocations that moved, in ascending order. Since
+   * allocations only move towards the start, applying the moves in order
+   * never overwrites an allocation that has yet to move.
+   */
+  std::vector<Move> Compact();
+
+  int64_t Capacity() const { return capacity_; }
+
+  /**
+   * Total size of all free ranges.
+   */
+  int64_t FreeSize() const { return free_size_; }
+
+  /**
+   * Size of the largest free range.
+   */
+  int64_t LargestFreeRange() const;
+
+  int NumAllocations() const { return allocated_.size(); }
+
+ private:
+  int64_t capacity_;
+
+  int64_t free_size_;
+
+  // Offset -> size of each free range, and of each allocation.
+  std::map<int64_t, int64_t> free_;
+  std::map<int64_t, int64_t> allocated_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_RANGE_ALLOCATOR_HPP__
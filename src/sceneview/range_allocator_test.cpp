@@ -0,0 +1,119 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "sceneview/range_allocator.hpp"
+
+using sv::RangeAllocator;
+
+TEST(RangeAllocator, AllocateUntilFull) {
+  RangeAllocator allocator(100);
+  EXPECT_EQ(0, allocator.Allocate(40));
+  EXPECT_EQ(40, allocator.Allocate(40));
+  EXPECT_EQ(-1, allocator.Allocate(40));
+  EXPECT_EQ(80, allocator.Allocate(20));
+  EXPECT_EQ(0, allocator.FreeSize());
+  EXPECT_EQ(-1, allocator.Allocate(1));
+  EXPECT_EQ(-1, allocator.Allocate(0));
+  EXPECT_EQ(3, allocator.NumAllocations());
+}
+
+TEST(RangeAllocator, FreeMergesNeighbors) {
+  RangeAllocator allocator(100);
+  const int64_t a = allocator.Allocate(30);
+  const int64_t b = allocator.Allocate(30);
+  const int64_t c = allocator.Allocate(30);
+  EXPECT_EQ(30, allocator.AllocationSize(b));
+
+  allocator.Free(a);
+  allocator.Free(c);
+  EXPECT_EQ(70, allocator.FreeSize());
+  EXPECT_EQ(40, allocator.LargestFreeRange());
+
+  // Freeing the middle range merges all three free ranges.
+  allocator.Free(b);
+  EXPECT_EQ(0, allocator.AllocationSize(b));
+  EXPECT_EQ(100, allocator.LargestFreeRange());
+  EXPECT_EQ(0, allocator.Allocate(100));
+}
+
+TEST(RangeAllocator, FirstFit) {
+  RangeAllocator allocator(100);
+  const int64_t a = allocator.Allocate(10);
+  allocator.Allocate(10);
+  const int64_t c = allocator.Allocate(30);
+  allocator.Allocate(10);
+  allocator.Free(a);
+  allocator.Free(c);
+
+  EXPECT_EQ(20, allocator.Allocate(20));
+  EXPECT_EQ(0, allocator.Allocate(5));
+  EXPECT_EQ(60, allocator.Allocate(40));
+}
+
+TEST(RangeAllocator, Compact) {
+  RangeAllocator allocator(100);
+  const int64_t a = allocator.Allocate(10);
+  const int64_t b = allocator.Allocate(20);
+  const int64_t c = allocator.Allocate(30);
+  const int64_t d = allocator.Allocate(10);
+  allocator.Free(a);
+  allocator.Free(c);
+  EXPECT_EQ(-1, allocator.Allocate(50));
+
+  const std::vector<RangeAllocator::Move> moves = allocator.Compact();
+  ASSERT_EQ(2u, moves.size());
+  EXPECT_EQ(b, moves[0].from);
+  EXPECT_EQ(0, moves[0].to);
+  EXPECT_EQ(20, moves[0].size);
+  EXPECT_EQ(d, moves[1].from);
+  EXPECT_EQ(20, moves[1].to);
+  EXPECT_EQ(10, moves[1].size);
+
+  EXPECT_EQ(20, allocator.AllocationSize(0));
+  EXPECT_EQ(10, allocator.AllocationSize(20));
+  EXPECT_EQ(70, allocator.LargestFreeRange());
+  EXPECT_EQ(30, allocator.Allocate(70));
+}
+
+TEST(RangeAllocator, RandomAllocations) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> size_dist(1, 50);
+  RangeAllocator allocator(10000);
+  std::vector<char> used(10000, 0);
+  std::vector<int64_t> live;
+
+  for (int iter = 0; iter < 10000; ++iter) {
+    if (live.empty() || rng() % 3 != 0) {
+      const int64_t size = size_dist(rng);
+      const int64_t offset = allocator.Allocate(size);
+      if (offset < 0) {
+        continue;
+      }
+      for (int64_t i = offset; i < offset + size; ++i) {
+        ASSERT_FALSE(used[i]);
+        used[i] = 1;
+      }
+      live.push_back(offset);
+    } else {
+      const size_t index = rng() % live.size();
+      const int64_t offset = live[index];
+      const int64_t size = allocator.AllocationSize(offset);
+      for (int64_t i = offset; i < offset + size; ++i) {
+        used[i] = 0;
+      }
+      allocator.Free(offset);
+      live[index] = live.back();
+      live.pop_back();
+    }
+  }
+
+  int64_t num_used = 0;
+  for (char value : used) {
+    num_used += value;
+  }
+  EXPECT_EQ(10000 - num_used, allocator.FreeSize());
+}
@@ -0,0 +1,125 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/render_queue.hpp"
+
+#include <cassert>
+
+#include "sceneview/draw_node.hpp"
+#include "sceneview/group_node.hpp"
+
+namespace sv {
+
+RenderQueue::RenderQueue() {}
+
+void RenderQueue::Add(DrawNode* node) {
+  assert(node->RenderQueueIndex() < 0);
+  const int index = entries_.size();
+  entries_.emplace_back();
+  entries_.back().node = node;
+  boxes_.Add(AxisAlignedBox());
+  node->SetRenderQueueIndex(index);
+  MarkEntryDirty(index);
+  generation_++;
+}
+
+void RenderQueue::Remove(DrawNode* node) {
+  const int index = node->RenderQueueIndex();
+  if (index < 0) {
+    return;
+  }
+  assert(entries_[index].node == node);
+
+  if (entries_[index].detached) {
+    num_detached_--;
+  }
+  if (entries_[index].unbounded) {
+    num_unbounded_--;
+  }
+
+  // Drop the entry from the dirty list.
+  const int dirty_index = entries_[index].dirty_index;
+  if (dirty_index >= 0) {
+    const int last_dirty = dirty_.back();
+    dirty_[dirty_index] = last_dirty;
+    entries_[last_dirty].dirty_index = dirty_index;
+    dirty_.pop_back();
+  }
+
+  // Swap with the last entry and pop.
+  const int last = entries_.size() - 1;
+  if (index != last) {
+    entries_[index] = entries_[last];
+    entries_[index].node->SetRenderQueueIndex(index);
+    if (entries_[index].dirty_index >= 0) {
+      dirty_[entries_[index].dirty_index] = index;
+    }
+  }
+  entries_.pop_back();
+  boxes_.SwapRemove(index);
+  node->SetRenderQueueIndex(-1);
+  generation_++;
+}
+
+const RenderQueueEntry* RenderQueue::Find(DrawNode* node) const {
+  const int index = node->RenderQueueIndex();
+  if (index < 0 || index >= static_cast<int>(entries_.size()) ||
+      entries_[index].node != node) {
+    return nullptr;
+  }
+  return &entries_[index];
+}
+
+void RenderQueue::MarkDirty(DrawNode* node) {
+  const int index = node->RenderQueueIndex();
+  if (index >= 0) {
+    MarkEntryDirty(index);
+  }
+}
+
+void RenderQueue::MarkEntryDirty(int index) {
+  RenderQueueEntry& entry = entries_[index];
+  if (entry.dirty_index < 0) {
+    entry.dirty_index = dirty_.size();
+    dirty_.push_back(index);
+  }
+}
+
+void RenderQueue::Update(const SceneNode* root) {
+  if (dirty_.empty()) {
+    return;
+  }
+
+  for (int index : dirty_) {
+    RenderQueueEntry& entry = entries_[index];
+    DrawNode* draw_node = entry.node;
+
+    entry.visible = draw_node->EffectivelyVisible();
+
+    if (!entry.attachment_known) {
+      SceneNode* top = draw_node;
+      while (top->ParentNode()) {
+        top = top->ParentNode();
+      }
+      const bool detached = top != root;
+      if (detached != entry.detached) {
+        num_detached_ += detached ? 1 : -1;
+        entry.detached = detached;
+      }
+      entry.attachment_known = true;
+    }
+
+    entry.model_mat = draw_node->WorldTransform();
+    entry.world_bbox = draw_node->WorldBoundingBox();
+    const bool unbounded = !entry.world_bbox.Valid();
+    if (unbounded != entry.unbounded) {
+      num_unbounded_ += unbounded ? 1 : -1;
+      entry.unbounded = unbounded;
+    }
+    boxes_.Set(index, entry.world_bbox);
+    entry.dirty_index = -1;
+  }
+  dirty_.clear();
+  generation_++;
+}
+
+}  // namespace sv
@@ -0,0 +1,192 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_RENDER_QUEUE_HPP__
+#define SCENEVIEW_RENDER_QUEUE_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include "sceneview/axis_aligned_box.hpp"
+#include "sceneview/frustum.hpp"
+#include "sceneview/radix_sort.hpp"
+
+namespace sv {
+
+class DrawNode;
+class SceneNode;
+
+/**
+ * Occlusion culling state of a RenderQueueEntry, maintained by the
+ * DrawContext. See DrawGroup::SetOcclusionCulling().
+ */
+struct OcclusionState {
+  // True if the most recent occlusion query found the node to be occluded.
+  bool occluded = false;
+
+  // True if an occlusion query for the node has been issued, but its result
+  // has not been read back yet.
+  bool query_pending = false;
+
+  // Frame number at which a visible node is next tested for occlusion.
+  uint64_t next_test_frame = 0;
+};
+
+/**
+ * Cached per-node data used by the DrawContext to render a DrawNode.
+ */
+struct RenderQueueEntry {
+  DrawNode* node = nullptr;
+
+  // World transform of the node.
+  QMatrix4x4 model_mat;
+
+  // World-frame axis-aligned bounding box of the node.
+  AxisAlignedBox world_bbox;
+
+  // True if the node and all of its ancestors are visible.
+  bool visible = true;
+
+  // True if the node is not a descendant of the scene root.
+  bool detached = false;
+
+  // True if world_bbox is not valid.
+  bool unbounded = false;
+
+  // True once detached has been determined. Nodes keep the parent that they
+  // are created with, so it only needs to be determined once.
+  bool attachment_known = false;
+
+  // Index of this entry in RenderQueue::dirty_, or -1 if not dirty.
+  int dirty_index = -1;
+
+  OcclusionState occlusion;
+};
+
+/**
+ * Draw order computed for a RenderQueue during a previous frame.
+ *
+ * Used by the DrawContext to skip sorting when neither the camera nor the
+ * nodes in view have changed.
+ */
+struct RenderQueueSortCache {
+  bool valid = false;
+
+  // RenderQueue::Generation() when the cache was filled.
+  uint64_t generation = 0;
+
+  int node_ordering = 0;
+
+  // Camera position used to compute squared_distances.
+  QVector3D eye;
+
+  // Entries that passed visibility and culling tests.
+  std::vector<const RenderQueueEntry*> candidates;
+
+  // Squared distance from the camera to each candidate.
+  std::vector<float> squared_distances;
+
+  // Sort key of each candidate.
+  std::vector<uint64_t> keys;
+
+  // Candidate indices, in draw order.
+  std::vector<SortItem> order;
+};
+
+/**
+ * Persistent list of the draw nodes in a DrawGroup.
+ *
+ * Entries are added and removed as nodes join and leave the draw group, and
+ * are flagged as dirty when a node's transform, bounding box, or visibility
+ * changes. Only dirty entries are refreshed by Update(), so a frame with no
+ * scene changes does not touch the scene graph at all.
+ *
+ * Internal class, not part of the public API.
+ */
+class RenderQueue {
+ public:
+  RenderQueue();
+
+  RenderQueue(const RenderQueue&) = delete;
+
+  RenderQueue& operator=(const RenderQueue&) = delete;
+
+  void Add(DrawNode* node);
+
+  void Remove(DrawNode* node);
+
+  /**
+   * Flags the entry for @p node as needing to be refreshed.
+   */
+  void MarkDirty(DrawNode* node);
+
+  /**
+   * Refreshes all dirty entries.
+   *
+   * @param root the root node of the scene, used to identify detached nodes.
+   */
+  void Update(const SceneNode* root);
+
+  const std::vector<RenderQueueEntry>& Entries() const { return entries_; }
+
+  /**
+   * World bounding box of each entry, in the same order as Entries(), for
+   * batched frustum culling.
+   */
+  const BoxArray& Boxes() const { return boxes_; }
+
+  /**
+   * Retrieve the entry for @p node, or nullptr if the node is not in this
+   * queue.
+   */
+  const RenderQueueEntry* Find(DrawNode* node) const;
+
+  /**
+   * Occlusion culling state of an entry of this queue. Changing it does not
+   * affect Generation().
+   */
+  OcclusionState* Occlusion(const RenderQueueEntry* entry) {
+    return &entries_[entry - entries_.data()].occlusion;
+  }
+
+  /**
+   * Incremented whenever entries are added, removed, or refreshed.
+   */
+  uint64_t Generation() const { return generation_; }
+
+  /**
+   * Number of entries whose node is not a descendant of the scene root.
+   */
+  int NumDetached() const { return num_detached_; }
+
+  /**
+   * Number of entries without a valid world bounding box. Group bounding
+   * boxes leave those nodes out, so culling a group does not cull them.
+   */
+  int NumUnbounded() const { return num_unbounded_; }
+
+  RenderQueueSortCache* SortCache() { return &sort_cache_; }
+
+ private:
+  void MarkEntryDirty(int index);
+
+  std::vector<RenderQueueEntry> entries_;
+
+  BoxArray boxes_;
+
+  std::vector<int> dirty_;
+
+  uint64_t generation_ = 0;
+
+  int num_detached_ = 0;
+
+  int num_unbounded_ = 0;
+
+  RenderQueueSortCache sort_cache_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_RENDER_QUEUE_HPP__
@@ -1,6 +1,7 @@
 // Copyright [2015] Albert Huang
 
 #include "sceneview/renderer.hpp"
+#include "sceneview/draw_context.hpp"
 #include "sceneview/group_node.hpp"
 #include "sceneview/viewport.hpp"
 
@@ -11,7 +12,13 @@ namespace sv {
 struct Renderer::Priv {
   QString name;
 
-  Viewport* viewport;
+  Viewport* viewport = nullptr;
+
+  const DrawContext* draw_context = nullptr;
+
+  ResourceManager::Ptr resources;
+
+  Scene::Ptr scene;
 
   GroupNode* base_node;
 
@@ -30,15 +37,38 @@ const QString& Renderer::Name() const { return p_->name; }
 
 Viewport* Renderer::GetViewport() { return p_->viewport; }
 
-Scene::Ptr Renderer::GetScene() { return p_->viewport->GetScene(); }
+const FrameStatsHistory* Renderer::GetFrameStatsHistory() const {
+  return p_->draw_context ? &p_->draw_context->StatsHistory() : nullptr;
+}
 
-ResourceManager::Ptr Renderer::GetResources() {
-  return p_->viewport->GetResources();
+int Renderer::ViewportWidth() const {
+  return p_->draw_context ? p_->draw_context->ViewportWidth() : 0;
 }
 
+int Renderer::ViewportHeight() const {
+  return p_->draw_context ? p_->draw_context->ViewportHeight() : 0;
+}
+
+Scene::Ptr Renderer::GetScene() { return p_->scene; }
+
+ResourceManager::Ptr Renderer::GetResources() { return p_->resources; }
+
 GroupNode* Renderer::GetBaseNode() { return p_->base_node; }
 
-void Renderer::SetViewport(Viewport* viewport) { p_->viewport = viewport; }
+void Renderer::SetViewport(Viewport* viewport) {
+  p_->viewport = viewport;
+  SetScene(viewport->GetResources(), viewport->GetScene());
+}
+
+void Renderer::SetDrawContext(const DrawContext* draw_context) {
+  p_->draw_context = draw_context;
+}
+
+void Renderer::SetScene(const ResourceManager::Ptr& resources,
+    const Scene::Ptr& scene) {
+  p_->resources = resources;
+  p_->scene = scene;
+}
 
 void Renderer::SetBaseNode(GroupNode* node) { p_->base_node = node; }
 
@@ -13,6 +13,9 @@
 
 namespace sv {
 
+class DrawContext;
+class FrameStatsHistory;
+class OffscreenRenderer;
 class Viewport;
 
 /**
@@ -91,10 +94,30 @@ class Renderer : public QObject {
   const QString& Name() const;
 
   /**
-   * Retrieve the viewport that manages this renderer.
+   * Retrieve the viewport that manages this renderer, or nullptr if the
+   * renderer was added to an OffscreenRenderer instead.
    */
   Viewport* GetViewport();
 
+  /**
+   * Retrieve the statistics of the recent frames drawn by the viewport or
+   * offscreen renderer that manages this renderer. Only available during
+   * RenderBegin() and RenderEnd(); returns nullptr otherwise.
+   */
+  const FrameStatsHistory* GetFrameStatsHistory() const;
+
+  /**
+   * Width, in pixels, of the area being drawn into. Only meaningful during
+   * RenderBegin() and RenderEnd().
+   */
+  int ViewportWidth() const;
+
+  /**
+   * Height, in pixels, of the area being drawn into. Only meaningful during
+   * RenderBegin() and RenderEnd().
+   */
+  int ViewportHeight() const;
+
   /**
    * Retrieve the Scene graph used by the Sceneview rendering engine.
    */
@@ -208,10 +231,19 @@ class Renderer : public QObject {
   virtual void OnEnableChanged(bool enabled) {}
 
  private:
+  friend class DrawContext;
+
+  friend class OffscreenRenderer;
+
   friend class Viewport;
 
   void SetViewport(Viewport* viewport);
 
+  void SetDrawContext(const DrawContext* draw_context);
+
+  void SetScene(const ResourceManager::Ptr& resources,
+      const Scene::Ptr& scene);
+
   void SetBaseNode(GroupNode* node);
 
   struct Priv;
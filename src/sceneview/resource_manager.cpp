@@ -1,6 +1,13 @@
 // Copyright [2015] Albert Huang
 
 #include "sceneview/resource_manager.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include <QOpenGLTexture>
+
+#include "sceneview/geometry_buffer_pool.hpp"
 #include "sceneview/scene.hpp"
 
 #if 0
@@ -13,6 +20,10 @@ namespace sv {
 
 const QString ResourceManager::kAutoName = "";
 
+// Size of each vertex and index buffer shared by batched geometries.
+static const int64_t kGeometryPoolVertexBufferSize = 16 * 1024 * 1024;
+static const int64_t kGeometryPoolIndexBufferSize = 16 * 1024 * 1024;
+
 struct ResourceManager::Priv {
   std::map<QString, MaterialResourceWeakPtr> materials;
   std::map<QString, ShaderResourceWeakPtr> shaders;
@@ -20,6 +31,9 @@ struct ResourceManager::Priv {
   std::map<QString, SceneWeakPtr> scenes;
   std::map<QString, FontResourceWeakPtr> fonts;
 
+  // Shared buffers for batched geometries, if batching is enabled.
+  std::shared_ptr<GeometryBufferPool> geometry_pool;
+
   int64_t name_counter;
 };
 
@@ -53,12 +67,35 @@ ShaderResource::Ptr ResourceManager::MakeShader(const QString& name) {
 GeometryResource::Ptr ResourceManager::MakeGeometry(const QString& name) {
   QString actual_name = PickName(name);
   GeometryResource::Ptr result(new GeometryResource(actual_name));
+  if (p_->geometry_pool) {
+    result->SetBufferPool(p_->geometry_pool);
+  }
   p_->geometries[actual_name] = result;
   dbg("MakeGeometry: -> %s (total: %d)\n", actual_name.c_str(),
       static_cast<int>(p_->geometries.size()));
   return result;
 }
 
+void ResourceManager::SetGeometryBatching(bool enabled) {
+  if (!enabled) {
+    // Geometries that are already batched keep the pool alive.
+    p_->geometry_pool.reset();
+  } else if (!p_->geometry_pool) {
+    p_->geometry_pool.reset(new GeometryBufferPool(
+        kGeometryPoolVertexBufferSize, kGeometryPoolIndexBufferSize));
+  }
+}
+
+bool ResourceManager::GeometryBatching() const {
+  return static_cast<bool>(p_->geometry_pool);
+}
+
+void ResourceManager::CompactGeometryBuffers() {
+  if (p_->geometry_pool) {
+    p_->geometry_pool->Compact();
+  }
+}
+
 Scene::Ptr ResourceManager::MakeScene(const QString& name) {
   QString actual_name = PickName(name);
   Scene::Ptr result(new Scene(actual_name));
@@ -156,6 +193,91 @@ bool ResourceManager::NameExists(const QString& name) {
          InMap(p_->scenes, name);
 }
 
+int64_t ResourceManager::GeometryMemoryUsage() {
+  int64_t result = 0;
+  for (auto& item : p_->geometries) {
+    GeometryResource::Ptr geometry = item.second.lock();
+    if (geometry) {
+      result += geometry->MemoryUsage();
+    }
+  }
+  if (p_->geometry_pool) {
+    result += p_->geometry_pool->MemoryUsage();
+  }
+  return result;
+}
+
+// Estimates the memory used by a texture from its size and format.
+static int64_t TextureBytes(QOpenGLTexture* texture) {
+  if (!texture->isStorageAllocated()) {
+    return 0;
+  }
+  int bytes_per_texel = 4;
+  switch (texture->format()) {
+    case QOpenGLTexture::R8_UNorm:
+    case QOpenGLTexture::AlphaFormat:
+    case QOpenGLTexture::LuminanceFormat:
+      bytes_per_texel = 1;
+      break;
+    case QOpenGLTexture::RG8_UNorm:
+    case QOpenGLTexture::R16F:
+    case QOpenGLTexture::D16:
+    case QOpenGLTexture::LuminanceAlphaFormat:
+      bytes_per_texel = 2;
+      break;
+    case QOpenGLTexture::RGB8_UNorm:
+    case QOpenGLTexture::RGBFormat:
+      bytes_per_texel = 3;
+      break;
+    case QOpenGLTexture::RGBA16F:
+    case QOpenGLTexture::RG32F:
+      bytes_per_texel = 8;
+      break;
+    case QOpenGLTexture::RGB32F:
+      bytes_per_texel = 12;
+      break;
+    case QOpenGLTexture::RGBA32F:
+      bytes_per_texel = 16;
+      break;
+    default:
+      break;
+  }
+  int64_t result = static_cast<int64_t>(bytes_per_texel) *
+      std::max(texture->width(), 1) * std::max(texture->height(), 1) *
+      std::max(texture->depth(), 1) * std::max(texture->layers(), 1) *
+      std::max(texture->faces(), 1);
+  // A full mipmap chain adds a third.
+  if (texture->mipLevels() > 1) {
+    result = result * 4 / 3;
+  }
+  return result;
+}
+
+int64_t ResourceManager::TextureMemoryUsage() {
+  std::set<QOpenGLTexture*> textures;
+  for (auto& item : p_->materials) {
+    MaterialResource::Ptr material = item.second.lock();
+    if (material) {
+      for (auto& texture_item : material->GetTextures()) {
+        textures.insert(texture_item.second.get());
+      }
+    }
+  }
+  for (auto& item : p_->fonts) {
+    FontResource::Ptr font = item.second.lock();
+    if (font) {
+      textures.insert(font->Texture().get());
+    }
+  }
+  textures.erase(nullptr);
+
+  int64_t result = 0;
+  for (QOpenGLTexture* texture : textures) {
+    result += TextureBytes(texture);
+  }
+  return result;
+}
+
 void ResourceManager::PrintStats() {
   Cleanup();
   printf("materials: %d\n", static_cast<int>(p_->materials.size()));
@@ -71,6 +71,35 @@ class ResourceManager {
      */
     GeometryResource::Ptr MakeGeometry(const QString& name = kAutoName);
 
+    /**
+     * Enables or disables geometry batching for geometries created
+     * afterwards by MakeGeometry().
+     *
+     * Batched geometries store their vertices and indices in a few large
+     * vertex and index buffers shared with other batched geometries, instead
+     * of in their own buffers. The DrawContext draws consecutive draw nodes
+     * that share a material and a world transform, and whose geometry is in
+     * the same shared buffers, with a single glMultiDrawElementsBaseVertex()
+     * call.
+     *
+     * Batching is intended for static geometry with many small parts, such
+     * as imported CAD or building models. It is disabled by default, and
+     * geometries are not batched if the OpenGL implementation lacks
+     * GL_ARB_draw_elements_base_vertex or GL_ARB_copy_buffer.
+     */
+    void SetGeometryBatching(bool enabled);
+
+    bool GeometryBatching() const;
+
+    /**
+     * Defragments the buffers shared by batched geometries.
+     *
+     * This is done automatically when a geometry does not fit in the
+     * fragmented free space, but can also be called after unloading many
+     * geometries. The OpenGL context must be current.
+     */
+    void CompactGeometryBuffers();
+
     /**
      * Create a new scene graph.
      *
@@ -105,6 +134,22 @@ class ResourceManager {
      */
     GeometryResource::Ptr GetGeometry(const QString& name);
 
+    /**
+     * Number of bytes of graphics memory allocated for the vertex and index
+     * buffers of the geometries, including the buffers shared by batched
+     * geometries.
+     */
+    int64_t GeometryMemoryUsage();
+
+    /**
+     * Estimated number of bytes of graphics memory used by the textures of
+     * the materials and fonts.
+     *
+     * Textures shared by several materials are counted once. The estimate
+     * assumes tightly packed texels, so drivers may use somewhat more.
+     */
+    int64_t TextureMemoryUsage();
+
     /**
      * Debugging
      */
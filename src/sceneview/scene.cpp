@@ -6,11 +6,16 @@
 #include <deque>
 #include <vector>
 
+#include <QHash>
+
 #include "sceneview/camera_node.hpp"
 #include "sceneview/draw_group.hpp"
 #include "sceneview/group_node.hpp"
+#include "sceneview/instanced_draw_node.hpp"
 #include "sceneview/light_node.hpp"
+#include "sceneview/lod_draw_node.hpp"
 #include "sceneview/draw_node.hpp"
+#include "sceneview/object_pool.hpp"
 #include "sceneview/scene_node.hpp"
 #include "sceneview/stock_resources.hpp"
 
@@ -28,27 +33,57 @@ struct Scene::Priv {
     std::vector<LightNode*> lights_;
     std::vector<CameraNode*> cameras_;
     std::vector<DrawGroup*> draw_groups_;
-    std::map<QString, SceneNode*> nodes_;
+
+    // Every node of the scene. Nodes know their index, so that they can be
+    // removed by swapping them with the last node.
+    std::vector<SceneNode*> nodes_;
+
+    // Nodes that were given an explicit name. Other nodes generate their
+    // name when asked for it.
+    QHash<QString, SceneNode*> named_nodes_;
+
+    // Number of explicit names that have the form of generated names.
+    int num_generated_like_names_ = 0;
+
+    // Storage of the nodes, one pool per node class, so that nodes created
+    // together sit next to each other in memory.
+    ObjectPool<GroupNode> group_pool_;
+    ObjectPool<CameraNode> camera_pool_;
+    ObjectPool<LightNode> light_pool_;
+    ObjectPool<DrawNode> draw_pool_;
+    ObjectPool<InstancedDrawNode> instanced_draw_pool_;
+    ObjectPool<LodDrawNode> lod_draw_pool_;
 };
 
+template <typename T>
+static void DeleteFromPool(SceneNode* node, ObjectPool<T>* pool) {
+  T* derived = static_cast<T*>(node);
+  derived->~T();
+  pool->Free(derived);
+}
+
 Scene::Scene(const QString& name) :
   p_(new Scene::Priv)
 {
   p_->scene_name_ = name;
-  p_->root_node_ = new GroupNode("root");
+  p_->root_node_ = new (p_->group_pool_.Allocate()) GroupNode("root");
   p_->name_counter_ = 0;
+  AddNode(p_->root_node_, -1);
   p_->default_draw_group_ = new DrawGroup(kDefaultDrawGroupName,
         kDefaultDrawGroupOrder);
   p_->draw_groups_.push_back(p_->default_draw_group_);
-  p_->nodes_[p_->root_node_->Name()] = p_->root_node_;
 }
 
 Scene::~Scene() {
   for (DrawGroup* dgroup : p_->draw_groups_) {
     delete dgroup;
   }
-  for (auto& item : p_->nodes_) {
-    delete item.second;
+
+  // Destroy the nodes in the reverse of the order in which they were
+  // created, for the most part. The node storage itself is released all at
+  // once with the pools.
+  for (auto iter = p_->nodes_.rbegin(); iter != p_->nodes_.rend(); ++iter) {
+    (*iter)->~SceneNode();
   }
   delete p_;
 }
@@ -68,12 +103,14 @@ bool Scene::ContainsNode(SceneNode* node) const {
 
 GroupNode* Scene::MakeGroup(GroupNode* parent,
     const QString& name) {
-  const QString actual_name = PickName(name);
-  GroupNode* node = new GroupNode(actual_name);
+  const int name_number = PickName(name);
+  GroupNode* node =
+      new (p_->group_pool_.Allocate()) GroupNode(
+        name_number < 0 ? name : QString());
   if (parent) {
     parent->AddChild(node);
   }
-  p_->nodes_[actual_name] = node;
+  AddNode(node, name_number);
   return node;
 }
 
@@ -90,35 +127,43 @@ GroupNode* Scene::MakeGroupFromScene(GroupNode* parent,
 
 CameraNode* Scene::MakeCamera(GroupNode* parent,
     const QString& name) {
-  const QString actual_name = PickName(name);
-  CameraNode* camera = new CameraNode(actual_name);
+  const int name_number = PickName(name);
+  CameraNode* camera =
+      new (p_->camera_pool_.Allocate()) CameraNode(
+        name_number < 0 ? name : QString());
   if (parent) {
     parent->AddChild(camera);
   }
+  AddNode(camera, name_number);
+  camera->SetListIndex(p_->cameras_.size());
   p_->cameras_.push_back(camera);
-  p_->nodes_[actual_name] = camera;
   return camera;
 }
 
 LightNode* Scene::MakeLight(GroupNode* parent,
     const QString& name) {
-  const QString actual_name = PickName(name);
-  LightNode* light = new LightNode(actual_name);
+  const int name_number = PickName(name);
+  LightNode* light =
+      new (p_->light_pool_.Allocate()) LightNode(
+        name_number < 0 ? name : QString());
   if (parent) {
     parent->AddChild(light);
   }
+  AddNode(light, name_number);
+  light->SetListIndex(p_->lights_.size());
   p_->lights_.push_back(light);
-  p_->nodes_[actual_name] = light;
   return light;
 }
 
 DrawNode* Scene::MakeDrawNode(GroupNode* parent, const QString& name) {
-  const QString actual_name = PickName(name);
-  DrawNode* node = new DrawNode(actual_name);
+  const int name_number = PickName(name);
+  DrawNode* node =
+      new (p_->draw_pool_.Allocate()) DrawNode(
+        name_number < 0 ? name : QString());
   if (parent) {
     parent->AddChild(node);
   }
-  p_->nodes_[actual_name] = node;
+  AddNode(node, name_number);
   SetDrawGroup(node, p_->default_draw_group_);
   return node;
 }
@@ -132,6 +177,42 @@ DrawNode* Scene::MakeDrawNode(GroupNode* parent,
   return node;
 }
 
+InstancedDrawNode* Scene::MakeInstancedDrawNode(GroupNode* parent,
+    const QString& name) {
+  const int name_number = PickName(name);
+  InstancedDrawNode* node =
+      new (p_->instanced_draw_pool_.Allocate()) InstancedDrawNode(
+        name_number < 0 ? name : QString());
+  if (parent) {
+    parent->AddChild(node);
+  }
+  AddNode(node, name_number);
+  SetDrawGroup(node, p_->default_draw_group_);
+  return node;
+}
+
+InstancedDrawNode* Scene::MakeInstancedDrawNode(GroupNode* parent,
+        const GeometryResource::Ptr& geometry,
+        const MaterialResource::Ptr& material,
+        const QString& name) {
+  InstancedDrawNode* node = MakeInstancedDrawNode(parent, name);
+  node->Add(geometry, material);
+  return node;
+}
+
+LodDrawNode* Scene::MakeLodDrawNode(GroupNode* parent, const QString& name) {
+  const int name_number = PickName(name);
+  LodDrawNode* node =
+      new (p_->lod_draw_pool_.Allocate()) LodDrawNode(
+        name_number < 0 ? name : QString());
+  if (parent) {
+    parent->AddChild(node);
+  }
+  AddNode(node, name_number);
+  SetDrawGroup(node, p_->default_draw_group_);
+  return node;
+}
+
 DrawGroup* Scene::MakeDrawGroup(int ordering, const QString& name) {
   for (DrawGroup* dgroup : p_->draw_groups_) {
     if (dgroup->Name() == name) {
@@ -173,39 +254,101 @@ void Scene::SetDrawGroup(GroupNode* node, DrawGroup* draw_group) {
 
 void Scene::DestroyNode(SceneNode* node) {
   assert(node != p_->root_node_);
-  p_->nodes_.erase(node->Name());
+  RemoveNode(node);
   switch (node->NodeType()) {
     case SceneNodeType::kGroupNode:
       {
-        GroupNode* group = dynamic_cast<GroupNode*>(node);
-        std::vector<SceneNode*> children = group->Children();
-        for (SceneNode* child : children) {
-          DestroyNode(child);
+        // Children are destroyed last first, so that removing each of them
+        // from the group is a pop.
+        GroupNode* group = static_cast<GroupNode*>(node);
+        const std::vector<SceneNode*>& children = group->Children();
+        while (!children.empty()) {
+          DestroyNode(children.back());
         }
       }
       break;
     case SceneNodeType::kCameraNode:
-      {
-        CameraNode* camera = dynamic_cast<CameraNode*>(node);
-        p_->cameras_.erase(std::find(p_->cameras_.begin(), p_->cameras_.end(), camera));
-      }
+      RemoveFromList(&p_->cameras_, static_cast<CameraNode*>(node));
       break;
     case SceneNodeType::kLightNode:
-      {
-        LightNode* light = dynamic_cast<LightNode*>(node);
-        p_->lights_.erase(std::find(p_->lights_.begin(), p_->lights_.end(), light));
-      }
+      RemoveFromList(&p_->lights_, static_cast<LightNode*>(node));
       break;
     case SceneNodeType::kDrawNode:
       {
-        DrawNode* draw_node = dynamic_cast<DrawNode*>(node);
+        DrawNode* draw_node = static_cast<DrawNode*>(node);
         draw_node->GetDrawGroup()->RemoveNode(draw_node);
         draw_node->SetDrawGroup(nullptr);
       }
       break;
   }
-  node->ParentNode()->RemoveChild(node);
-  delete node;
+  if (node->ParentNode()) {
+    node->ParentNode()->RemoveChild(node);
+  }
+  DeleteNode(node);
+}
+
+void Scene::AddNode(SceneNode* node, int name_number) {
+  node->SetNameNumber(name_number);
+  if (name_number < 0) {
+    const QString name = node->Name();
+    p_->named_nodes_.insert(name, node);
+    if (SceneNode::AutoNameNumber(name) >= 0) {
+      p_->num_generated_like_names_++;
+    }
+  }
+  node->SetSceneIndex(p_->nodes_.size());
+  p_->nodes_.push_back(node);
+}
+
+void Scene::RemoveNode(SceneNode* node) {
+  if (node->NameNumber() < 0) {
+    const QString name = node->Name();
+    p_->named_nodes_.remove(name);
+    if (SceneNode::AutoNameNumber(name) >= 0) {
+      p_->num_generated_like_names_--;
+    }
+  }
+  // Swap with the last node and pop.
+  const int index = node->SceneIndex();
+  SceneNode* last = p_->nodes_.back();
+  p_->nodes_[index] = last;
+  last->SetSceneIndex(index);
+  p_->nodes_.pop_back();
+  node->SetSceneIndex(-1);
+}
+
+template <typename T>
+void Scene::RemoveFromList(std::vector<T*>* list, T* node) {
+  // Swap with the last node and pop.
+  const int index = node->ListIndex();
+  T* last = list->back();
+  (*list)[index] = last;
+  last->SetListIndex(index);
+  list->pop_back();
+  node->SetListIndex(-1);
+}
+
+void Scene::DeleteNode(SceneNode* node) {
+  switch (node->NodeType()) {
+    case SceneNodeType::kGroupNode:
+      DeleteFromPool(node, &p_->group_pool_);
+      break;
+    case SceneNodeType::kCameraNode:
+      DeleteFromPool(node, &p_->camera_pool_);
+      break;
+    case SceneNodeType::kLightNode:
+      DeleteFromPool(node, &p_->light_pool_);
+      break;
+    case SceneNodeType::kDrawNode:
+      if (dynamic_cast<InstancedDrawNode*>(node)) {
+        DeleteFromPool(node, &p_->instanced_draw_pool_);
+      } else if (dynamic_cast<LodDrawNode*>(node)) {
+        DeleteFromPool(node, &p_->lod_draw_pool_);
+      } else {
+        DeleteFromPool(node, &p_->draw_pool_);
+      }
+      break;
+  }
 }
 
 std::vector<LightNode*>& Scene::Lights() { return p_->lights_; }
@@ -237,27 +380,39 @@ void Scene::PrintStats() {
   }
 
   printf("nodes: %d\n", static_cast<int>(num_nodes));
-  printf("nodes in map: %d\n", static_cast<int>(p_->nodes_.size()));
+  printf("nodes registered: %d\n", static_cast<int>(p_->nodes_.size()));
+  printf("named nodes: %d\n", p_->named_nodes_.size());
 }
 
-QString Scene::AutogenerateName() {
-  QString name;
+int Scene::AutogenerateName() {
+  int number;
   do {
-    name = "sv_" + QString::number(p_->name_counter_);
+    number = p_->name_counter_;
     p_->name_counter_++;
-  } while (p_->nodes_.find(name) != p_->nodes_.end());
-  return name;
+  } while (p_->num_generated_like_names_ > 0 &&
+      p_->named_nodes_.contains(SceneNode::AutoName(number)));
+  return number;
 }
 
-QString Scene::PickName(const QString& name) {
+int Scene::PickName(const QString& name) {
   if (name == kAutoName) {
     return AutogenerateName();
-  } else {
-    if (p_->nodes_.find(name) != p_->nodes_.end()) {
-      throw std::invalid_argument("Duplicate node name " + name.toStdString());
+  }
+  if (p_->named_nodes_.contains(name)) {
+    throw std::invalid_argument("Duplicate node name " + name.toStdString());
+  }
+  // The name may already have been generated for a node. That only happens
+  // when a name of that form is given explicitly, so a scan is fine.
+  const int number = SceneNode::AutoNameNumber(name);
+  if (number >= 0 && number < p_->name_counter_) {
+    for (SceneNode* node : p_->nodes_) {
+      if (node->NameNumber() == number) {
+        throw std::invalid_argument("Duplicate node name " +
+            name.toStdString());
+      }
     }
-    return name;
   }
+  return -1;
 }
 
 }  // namespace sv
@@ -18,6 +18,8 @@ class CameraNode;
 class GroupNode;
 class LightNode;
 class DrawNode;
+class InstancedDrawNode;
+class LodDrawNode;
 class SceneNode;
 class DrawGroup;
 
@@ -120,6 +122,41 @@ class Scene {
         const MaterialResource::Ptr& material,
         const QString& name = kAutoName);
 
+    /**
+     * Create an empty instanced draw node. The returned node is owned by this
+     * object.
+     *
+     * To attach drawables to the node, use DrawNode::Add(). To set the
+     * instances, use InstancedDrawNode::SetInstances().
+     *
+     * @return a newly created InstancedDrawNode.
+     */
+    InstancedDrawNode* MakeInstancedDrawNode(GroupNode* parent,
+        const QString& name = kAutoName);
+
+    /**
+     * Create an instanced draw node with a single drawable.
+     *
+     * The returned node is owned by this object.
+     *
+     * @return a newly created InstancedDrawNode.
+     */
+    InstancedDrawNode* MakeInstancedDrawNode(GroupNode* parent,
+        const GeometryResource::Ptr& geometry,
+        const MaterialResource::Ptr& material,
+        const QString& name = kAutoName);
+
+    /**
+     * Create a level of detail draw node with no levels. The returned node is
+     * owned by this object.
+     *
+     * To add levels to the node, use LodDrawNode::AddLevel().
+     *
+     * @return a newly created LodDrawNode.
+     */
+    LodDrawNode* MakeLodDrawNode(GroupNode* parent,
+        const QString& name = kAutoName);
+
     /**
      * Create a draw group.
      *
@@ -159,6 +196,9 @@ class Scene {
     /**
      * Retrieve a list of all lights in the scene.
      *
+     * Destroying a light moves the last light into its place, so the lights
+     * are only in creation order until one is destroyed.
+     *
      * Don't modify the returned vector.
      */
     std::vector<LightNode*>& Lights();
@@ -180,9 +220,24 @@ class Scene {
 
     explicit Scene(const QString& name);
 
-    QString AutogenerateName();
+    // Returns the number to generate a node name from.
+    int AutogenerateName();
+
+    // Checks that @p name is free, and returns the number to generate the
+    // node name from if @p name is kAutoName, or -1.
+    int PickName(const QString& name);
+
+    // Adds a node to the registry of nodes.
+    void AddNode(SceneNode* node, int name_number);
+
+    // Removes a node from the registry of nodes.
+    void RemoveNode(SceneNode* node);
+
+    template <typename T>
+    static void RemoveFromList(std::vector<T*>* list, T* node);
 
-    QString PickName(const QString& name);
+    // Destroys a node and returns its storage to the pool it came from.
+    void DeleteNode(SceneNode* node);
 
     class Priv;
 
@@ -0,0 +1,452 @@
+// Copyright [2015] Albert Huang
+//
+// End-to-end rendering benchmark. Procedurally builds a scene of a
+// configurable size, renders it offscreen while the camera orbits the scene,
+// and prints frame time percentiles and per-phase timings as JSON.
+//
+// Run with --help for the options. By default, the benchmark uses the
+// offscreen Qt platform plugin, so it needs no display.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include "sceneview/camera_node.hpp"
+#include "sceneview/draw_group.hpp"
+#include "sceneview/draw_node.hpp"
+#include "sceneview/group_node.hpp"
+#include "sceneview/instanced_draw_node.hpp"
+#include "sceneview/light_node.hpp"
+#include "sceneview/offscreen_renderer.hpp"
+#include "sceneview/stock_resources.hpp"
+
+using sv::CameraNode;
+using sv::DrawGroup;
+using sv::DrawGroupStats;
+using sv::DrawNode;
+using sv::FrameStats;
+using sv::FrameStatsHistory;
+using sv::GeometryData;
+using sv::GeometryResource;
+using sv::GroupNode;
+using sv::InstancedDrawNode;
+using sv::LightNode;
+using sv::MaterialResource;
+using sv::OffscreenRenderer;
+using sv::ResourceManager;
+using sv::Scene;
+using sv::StockResources;
+
+// Frames drawn before measuring, so that resources are uploaded and caches
+// are warm.
+static constexpr int kNumWarmupFrames = 10;
+
+// Frames drawn after measuring, so that the GPU times of the last measured
+// frames become available.
+static constexpr int kNumDrainFrames = 5;
+
+static constexpr int kNumMaterials = 8;
+
+struct BenchConfig {
+  int num_nodes;
+  int drawables_per_node;
+  int group_depth;
+  double transparent_fraction;
+  int num_instanced_nodes;
+  int instances_per_node;
+  int num_points;
+  int num_frames;
+  int width;
+  int height;
+  int samples;
+  bool occlusion_culling;
+  bool software_occlusion_culling;
+  unsigned int seed;
+};
+
+// Builds a tree of group nodes with the given depth below the root, and
+// returns the leaves.
+static std::vector<GroupNode*> MakeGroupTree(Scene* scene, int depth,
+    int num_leaves) {
+  const int branching = depth > 0 ?
+      std::max(2, static_cast<int>(std::ceil(
+          std::pow(std::max(num_leaves, 1), 1.0 / depth)))) : 1;
+  std::vector<GroupNode*> level = { scene->Root() };
+  for (int d = 0; d < depth; ++d) {
+    std::vector<GroupNode*> next;
+    for (GroupNode* parent : level) {
+      for (int child = 0; child < branching; ++child) {
+        next.push_back(scene->MakeGroup(parent));
+      }
+      if (static_cast<int>(next.size()) >= num_leaves) {
+        break;
+      }
+    }
+    level.swap(next);
+  }
+  return level;
+}
+
+static MaterialResource::Ptr MakeMaterial(StockResources* stock,
+    std::mt19937* rng, bool transparent) {
+  std::uniform_real_distribution<float> color_dist(0.2, 1.0);
+  MaterialResource::Ptr material =
+      stock->NewMaterial(StockResources::kUniformColorLighting);
+  material->SetParam(sv::kDiffuse, color_dist(*rng), color_dist(*rng),
+      color_dist(*rng), transparent ? 0.5 : 1.0);
+  if (transparent) {
+    material->SetBlend(true);
+    material->SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    material->SetDepthWrite(false);
+  }
+  return material;
+}
+
+// Populates the scene, and returns the length of a side of the cube that
+// contains it.
+static double BuildScene(const BenchConfig& config,
+    const ResourceManager::Ptr& resources, const Scene::Ptr& scene) {
+  std::mt19937 rng(config.seed);
+  StockResources stock(resources);
+
+  // Spread the nodes out so that roughly the same fraction of them is in
+  // view regardless of the number of nodes.
+  const double extent = 3 * std::cbrt(std::max(config.num_nodes, 1));
+  std::uniform_real_distribution<float> pos_dist(-extent / 2, extent / 2);
+  std::uniform_real_distribution<float> unit_dist(0, 1);
+
+  LightNode* light = scene->MakeLight(scene->Root());
+  light->SetDirection(QVector3D(-1, -1, -2).normalized());
+
+  const std::vector<GeometryResource::Ptr> shapes = {
+    stock.Cube(), stock.Sphere(), stock.Cone(), stock.Cylinder() };
+  std::vector<MaterialResource::Ptr> opaque_materials;
+  std::vector<MaterialResource::Ptr> transparent_materials;
+  for (int ind = 0; ind < kNumMaterials; ++ind) {
+    opaque_materials.push_back(MakeMaterial(&stock, &rng, false));
+    transparent_materials.push_back(MakeMaterial(&stock, &rng, true));
+  }
+
+  // Regular draw nodes, distributed among the leaves of the group tree.
+  const std::vector<GroupNode*> leaves = MakeGroupTree(scene.get(),
+      config.group_depth, std::max(config.num_nodes / 16, 1));
+  for (int node_ind = 0; node_ind < config.num_nodes; ++node_ind) {
+    DrawNode* node = scene->MakeDrawNode(leaves[node_ind % leaves.size()]);
+    const bool transparent = unit_dist(rng) < config.transparent_fraction;
+    const std::vector<MaterialResource::Ptr>& materials =
+        transparent ? transparent_materials : opaque_materials;
+    for (int ind = 0; ind < config.drawables_per_node; ++ind) {
+      node->Add(shapes[rng() % shapes.size()],
+          materials[rng() % materials.size()]);
+    }
+    node->SetTranslation(pos_dist(rng), pos_dist(rng), pos_dist(rng));
+  }
+
+  // Instanced draw nodes, each with a grid of small shapes.
+  MaterialResource::Ptr instanced_material =
+      stock.NewMaterial(StockResources::kUniformColorLightingInstanced);
+  instanced_material->SetParam(sv::kDiffuse, 0.8f, 0.8f, 0.8f, 1.0f);
+  const int grid_size = std::ceil(std::sqrt(config.instances_per_node));
+  for (int node_ind = 0; node_ind < config.num_instanced_nodes; ++node_ind) {
+    std::vector<QMatrix4x4> transforms;
+    std::vector<QVector4D> colors;
+    transforms.reserve(config.instances_per_node);
+    colors.reserve(config.instances_per_node);
+    for (int ind = 0; ind < config.instances_per_node; ++ind) {
+      QMatrix4x4 transform;
+      transform.translate(ind % grid_size, ind / grid_size, 0);
+      transform.scale(0.4);
+      transforms.push_back(transform);
+      colors.emplace_back(unit_dist(rng), unit_dist(rng), unit_dist(rng), 1);
+    }
+    InstancedDrawNode* node = scene->MakeInstancedDrawNode(scene->Root(),
+        shapes[node_ind % shapes.size()], instanced_material);
+    node->SetInstances(transforms, colors);
+    node->SetTranslation(pos_dist(rng), pos_dist(rng), pos_dist(rng));
+  }
+
+  // A point cloud filling the scene.
+  if (config.num_points > 0) {
+    GeometryData points;
+    points.gl_mode = GL_POINTS;
+    points.vertices.reserve(config.num_points);
+    points.diffuse.reserve(config.num_points);
+    for (int ind = 0; ind < config.num_points; ++ind) {
+      points.vertices.emplace_back(pos_dist(rng), pos_dist(rng),
+          pos_dist(rng));
+      points.diffuse.emplace_back(unit_dist(rng), unit_dist(rng),
+          unit_dist(rng), 1);
+    }
+    GeometryResource::Ptr geometry = resources->MakeGeometry();
+    geometry->Load(points);
+    scene->MakeDrawNode(scene->Root(), geometry,
+        stock.NewMaterial(StockResources::kPerVertexColorNoLighting));
+  }
+
+  return extent;
+}
+
+// Copies the GPU times that have become available from the history into the
+// measured frames, which start at frame number first_frame.
+static void CopyGpuTimes(const FrameStatsHistory& history,
+    uint64_t first_frame, std::vector<FrameStats>* frames) {
+  for (int ind = 0; ind < history.Size(); ++ind) {
+    const FrameStats& done = history.At(ind);
+    if (done.gpu_ms < 0 || done.frame_number < first_frame ||
+        done.frame_number - first_frame >= frames->size()) {
+      continue;
+    }
+    FrameStats& stats = (*frames)[done.frame_number - first_frame];
+    stats.gpu_ms = done.gpu_ms;
+    stats.draw_groups = done.draw_groups;
+  }
+}
+
+// Nearest rank percentile. Negative values are unknown, and skipped.
+static double Percentile(std::vector<double> values, double percentile) {
+  values.erase(std::remove_if(values.begin(), values.end(),
+        [](double value) { return value < 0; }), values.end());
+  if (values.empty()) {
+    return -1;
+  }
+  const int rank = std::max(static_cast<int>(
+        std::ceil(percentile / 100 * values.size())), 1);
+  std::nth_element(values.begin(), values.begin() + rank - 1, values.end());
+  return values[rank - 1];
+}
+
+static double Mean(const std::vector<double>& values) {
+  double sum = 0;
+  int count = 0;
+  for (double value : values) {
+    if (value >= 0) {
+      sum += value;
+      count++;
+    }
+  }
+  return count ? sum / count : -1;
+}
+
+static void PrintSummary(FILE* out, const char* name,
+    const std::vector<double>& values, bool last = false) {
+  fprintf(out, "    \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+      "\"p99\": %.4f, \"max\": %.4f}%s\n", name, Mean(values),
+      Percentile(values, 50), Percentile(values, 90),
+      Percentile(values, 99), Percentile(values, 100), last ? "" : ",");
+}
+
+int main(int argc, char* argv[]) {
+  if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QGuiApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Sceneview end-to-end rendering benchmark");
+  parser.addHelpOption();
+  const QCommandLineOption nodes_opt("nodes", "Number of draw nodes.", "N",
+      "2000");
+  const QCommandLineOption drawables_opt("drawables",
+      "Number of drawables per draw node.", "M", "1");
+  const QCommandLineOption depth_opt("depth", "Depth of the group tree.", "D",
+      "3");
+  const QCommandLineOption transparent_opt("transparent",
+      "Fraction of draw nodes with transparent materials.", "F", "0.1");
+  const QCommandLineOption instanced_opt("instanced-nodes",
+      "Number of instanced draw nodes.", "N", "10");
+  const QCommandLineOption instances_opt("instances",
+      "Number of instances per instanced draw node.", "N", "1000");
+  const QCommandLineOption points_opt("points",
+      "Number of points in the point cloud.", "N", "1000000");
+  const QCommandLineOption frames_opt("frames", "Number of frames to measure.",
+      "N", "300");
+  const QCommandLineOption width_opt("width", "Image width.", "pixels",
+      "1280");
+  const QCommandLineOption height_opt("height", "Image height.", "pixels",
+      "720");
+  const QCommandLineOption samples_opt("samples",
+      "Multisample antialiasing samples per pixel.", "N", "0");
+  const QCommandLineOption occlusion_opt("occlusion",
+      "Enable occlusion culling with occlusion queries.");
+  const QCommandLineOption software_occlusion_opt("software-occlusion",
+      "Enable software occlusion culling.");
+  const QCommandLineOption seed_opt("seed", "Random seed.", "N", "1");
+  const QCommandLineOption output_opt("output",
+      "Write the JSON report to a file instead of stdout.", "file");
+  parser.addOptions({ nodes_opt, drawables_opt, depth_opt, transparent_opt,
+      instanced_opt, instances_opt, points_opt, frames_opt, width_opt,
+      height_opt, samples_opt, occlusion_opt, software_occlusion_opt,
+      seed_opt, output_opt });
+  parser.process(app);
+
+  BenchConfig config;
+  config.num_nodes = parser.value(nodes_opt).toInt();
+  config.drawables_per_node = parser.value(drawables_opt).toInt();
+  config.group_depth = parser.value(depth_opt).toInt();
+  config.transparent_fraction = parser.value(transparent_opt).toDouble();
+  config.num_instanced_nodes = parser.value(instanced_opt).toInt();
+  config.instances_per_node = parser.value(instances_opt).toInt();
+  config.num_points = parser.value(points_opt).toInt();
+  config.num_frames = std::max(parser.value(frames_opt).toInt(), 1);
+  config.width = parser.value(width_opt).toInt();
+  config.height = parser.value(height_opt).toInt();
+  config.samples = parser.value(samples_opt).toInt();
+  config.occlusion_culling = parser.isSet(occlusion_opt);
+  config.software_occlusion_culling = parser.isSet(software_occlusion_opt);
+  config.seed = parser.value(seed_opt).toUInt();
+
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  OffscreenRenderer renderer(resources, scene, config.width, config.height,
+      config.samples);
+  renderer.MakeCurrent();
+  QOpenGLFunctions* gl = QOpenGLContext::currentContext()->functions();
+
+  const double extent = BuildScene(config, resources, scene);
+  CameraNode* camera = scene->MakeCamera(scene->Root());
+  camera->SetPerspective(50, 0.1, extent * 4);
+  renderer.SetCamera(camera);
+  DrawGroup* dgroup = scene->GetDefaultDrawGroup();
+  dgroup->SetOcclusionCulling(config.occlusion_culling);
+  dgroup->SetSoftwareOcclusionCulling(config.software_occlusion_culling);
+
+  // Orbit the scene once over the measured frames, bobbing up and down.
+  const int total_frames = kNumWarmupFrames + config.num_frames +
+      kNumDrainFrames;
+  std::vector<FrameStats> frames;
+  uint64_t first_frame = 0;
+  std::vector<double> wall_ms;
+  frames.reserve(config.num_frames);
+  wall_ms.reserve(config.num_frames);
+  for (int frame = 0; frame < total_frames; ++frame) {
+    const double t = static_cast<double>(frame) / config.num_frames;
+    const double angle = 2 * M_PI * t;
+    const double radius = extent * 1.2;
+    const QVector3D eye(radius * std::cos(angle), radius * std::sin(angle),
+        extent * 0.5 * std::sin(3 * angle));
+    camera->LookAt(eye, QVector3D(0, 0, 0), QVector3D(0, 0, 1));
+
+    // Wait for the GPU, so that the wall time covers the whole frame.
+    const auto start = std::chrono::steady_clock::now();
+    renderer.Render(nullptr, nullptr);
+    gl->glFinish();
+    const auto end = std::chrono::steady_clock::now();
+
+    const int measured = frame - kNumWarmupFrames;
+    if (measured == 0) {
+      first_frame = renderer.GetFrameStats().frame_number;
+    }
+    if (measured >= 0 && measured < config.num_frames) {
+      frames.push_back(renderer.GetFrameStats());
+      wall_ms.push_back(
+          std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    // GPU times arrive a few frames late. Pick them up before the frames
+    // drop out of the history.
+    CopyGpuTimes(renderer.GetFrameStatsHistory(), first_frame, &frames);
+  }
+
+  std::vector<double> cpu_ms;
+  std::vector<double> gpu_ms;
+  std::vector<double> cull_ms;
+  std::vector<double> sort_ms;
+  std::vector<double> submit_ms;
+  std::vector<double> renderers_ms;
+  std::vector<double> nodes_drawn;
+  std::vector<double> draw_calls;
+  std::vector<double> triangles;
+  std::vector<double> state_changes;
+  for (const FrameStats& stats : frames) {
+    double cull = 0;
+    double sort = 0;
+    double submit = 0;
+    for (const DrawGroupStats& group_stats : stats.draw_groups) {
+      cull += group_stats.cull_ms;
+      sort += group_stats.sort_ms;
+      submit += group_stats.submit_ms;
+    }
+    double renderer_time = 0;
+    for (const sv::RendererStats& renderer_stats : stats.renderers) {
+      renderer_time += renderer_stats.begin_ms + renderer_stats.end_ms;
+    }
+    cpu_ms.push_back(stats.cpu_ms);
+    gpu_ms.push_back(stats.gpu_ms);
+    cull_ms.push_back(cull);
+    sort_ms.push_back(sort);
+    submit_ms.push_back(submit);
+    renderers_ms.push_back(renderer_time);
+    nodes_drawn.push_back(stats.nodes_drawn);
+    draw_calls.push_back(stats.draw_calls);
+    triangles.push_back(stats.triangles);
+    state_changes.push_back(stats.state_changes);
+  }
+
+  FILE* out = stdout;
+  if (parser.isSet(output_opt)) {
+    out = fopen(parser.value(output_opt).toLocal8Bit().constData(), "w");
+    if (!out) {
+      fprintf(stderr, "Unable to open %s\n",
+          parser.value(output_opt).toLocal8Bit().constData());
+      return 1;
+    }
+  }
+
+  const char* gl_renderer = reinterpret_cast<const char*>(
+      gl->glGetString(GL_RENDERER));
+  fprintf(out, "{\n");
+  fprintf(out, "  \"config\": {\n");
+  fprintf(out, "    \"nodes\": %d,\n", config.num_nodes);
+  fprintf(out, "    \"drawables_per_node\": %d,\n", config.drawables_per_node);
+  fprintf(out, "    \"group_depth\": %d,\n", config.group_depth);
+  fprintf(out, "    \"transparent_fraction\": %g,\n",
+      config.transparent_fraction);
+  fprintf(out, "    \"instanced_nodes\": %d,\n", config.num_instanced_nodes);
+  fprintf(out, "    \"instances_per_node\": %d,\n", config.instances_per_node);
+  fprintf(out, "    \"points\": %d,\n", config.num_points);
+  fprintf(out, "    \"frames\": %d,\n", config.num_frames);
+  fprintf(out, "    \"width\": %d,\n", config.width);
+  fprintf(out, "    \"height\": %d,\n", config.height);
+  fprintf(out, "    \"samples\": %d,\n", config.samples);
+  fprintf(out, "    \"occlusion\": %s,\n",
+      config.occlusion_culling ? "true" : "false");
+  fprintf(out, "    \"software_occlusion\": %s,\n",
+      config.software_occlusion_culling ? "true" : "false");
+  fprintf(out, "    \"seed\": %u,\n", config.seed);
+  // Renderer strings do not contain quotes or backslashes in practice.
+  fprintf(out, "    \"gl_renderer\": \"%s\"\n",
+      gl_renderer ? gl_renderer : "");
+  fprintf(out, "  },\n");
+  fprintf(out, "  \"frame_ms\": {\n");
+  PrintSummary(out, "wall", wall_ms);
+  PrintSummary(out, "cpu", cpu_ms);
+  PrintSummary(out, "gpu", gpu_ms, true);
+  fprintf(out, "  },\n");
+  fprintf(out, "  \"phase_ms\": {\n");
+  PrintSummary(out, "cull", cull_ms);
+  PrintSummary(out, "sort", sort_ms);
+  PrintSummary(out, "submit", submit_ms);
+  PrintSummary(out, "renderers", renderers_ms, true);
+  fprintf(out, "  },\n");
+  fprintf(out, "  \"per_frame\": {\n");
+  PrintSummary(out, "nodes_drawn", nodes_drawn);
+  PrintSummary(out, "draw_calls", draw_calls);
+  PrintSummary(out, "triangles", triangles);
+  PrintSummary(out, "state_changes", state_changes, true);
+  fprintf(out, "  }\n");
+  fprintf(out, "}\n");
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -1,26 +1,44 @@
 // Copyright [2015] Albert Huang
 
 #include "sceneview/scene_node.hpp"
+#include "sceneview/affine_transform.hpp"
 #include "sceneview/group_node.hpp"
+#include "sceneview/object_pool.hpp"
 
 namespace sv {
 
-struct SceneNode::Priv {
+struct SceneNode::Priv : PooledObject<SceneNode::Priv> {
   QString node_name;
 
   QVector3D translation;
   QQuaternion rotation;
   QVector3D scale{1, 1, 1};
 
+  // Node to parent transform, composed directly from the translation,
+  // rotation, and scale.
+  AffineTransform to_parent;
+  bool to_parent_dirty = true;
+
+  // Node to world transform.
   QMatrix4x4 to_world;
   bool to_world_dirty = true;
 
   GroupNode* parent_node = nullptr;
 
   bool visible = true;
+  bool effectively_visible = true;
   int64_t selection_mask = 0;
 
   int draw_order = 0;
+
+  // Number the name is generated from, for nodes without an explicit name.
+  int name_number = -1;
+
+  // Index in the scene's registry, in the parent's children, and in the
+  // scene's cameras or lights.
+  int scene_index = -1;
+  int child_index = -1;
+  int list_index = -1;
 };
 
 SceneNode::SceneNode(const QString& node_name) : p_(new Priv()) {
@@ -32,7 +50,45 @@ SceneNode::~SceneNode()
   delete p_;
 }
 
-const QString SceneNode::Name() const { return p_->node_name; }
+const QString SceneNode::Name() const {
+  if (p_->name_number >= 0) {
+    return AutoName(p_->name_number);
+  }
+  return p_->node_name;
+}
+
+QString SceneNode::AutoName(int number) {
+  return "sv_" + QString::number(number);
+}
+
+int SceneNode::AutoNameNumber(const QString& name) {
+  if (!name.startsWith("sv_")) {
+    return -1;
+  }
+  bool ok = false;
+  const int number = name.mid(3).toInt(&ok);
+  // Names such as "sv_01" or "sv_+1" are never generated.
+  if (!ok || number < 0 || AutoName(number) != name) {
+    return -1;
+  }
+  return number;
+}
+
+int SceneNode::NameNumber() const { return p_->name_number; }
+
+void SceneNode::SetNameNumber(int number) { p_->name_number = number; }
+
+int SceneNode::SceneIndex() const { return p_->scene_index; }
+
+void SceneNode::SetSceneIndex(int index) { p_->scene_index = index; }
+
+int SceneNode::ChildIndex() const { return p_->child_index; }
+
+void SceneNode::SetChildIndex(int index) { p_->child_index = index; }
+
+int SceneNode::ListIndex() const { return p_->list_index; }
+
+void SceneNode::SetListIndex(int index) { p_->list_index = index; }
 
 /**
  * Retrieve the translation component of the node to parent transform.
@@ -51,14 +107,18 @@ const QVector3D& SceneNode::Scale() const { return p_->scale; }
 
 const QMatrix4x4& SceneNode::WorldTransform() {
   if (p_->to_world_dirty) {
-    if (p_->parent_node) {
-      p_->to_world = p_->parent_node->WorldTransform();
+    if (p_->to_parent_dirty) {
+      p_->to_parent = AffineTransform::FromTrs(p_->translation, p_->rotation,
+          p_->scale);
+      p_->to_parent_dirty = false;
+    }
+    SceneNode* parent = p_->parent_node;
+    if (parent) {
+      AffineTransform::Multiply(parent->WorldTransform(), p_->to_parent,
+          &p_->to_world);
     } else {
-      p_->to_world.setToIdentity();
+      p_->to_parent.ToMatrix4x4(&p_->to_world);
     }
-    p_->to_world.translate(p_->translation);
-    p_->to_world.rotate(p_->rotation);
-    p_->to_world.scale(p_->scale);
     p_->to_world_dirty = false;
   }
   return p_->to_world;
@@ -66,29 +126,41 @@ const QMatrix4x4& SceneNode::WorldTransform() {
 
 bool SceneNode::Visible() const { return p_->visible; }
 
+bool SceneNode::EffectivelyVisible() const {
+  return p_->effectively_visible;
+}
+
 void SceneNode::SetTranslation(const QVector3D& vec) {
   p_->translation = vec;
+  p_->to_parent_dirty = true;
   TransformChanged();
 }
 
 void SceneNode::SetRotation(const QQuaternion& quat) {
   p_->rotation = quat;
+  p_->to_parent_dirty = true;
   TransformChanged();
 }
 
 void SceneNode::SetScale(const QVector3D& vec) {
   p_->scale = vec;
+  p_->to_parent_dirty = true;
   TransformChanged();
 }
 
 void SceneNode::SetVisible(bool visible) {
+  if (p_->visible == visible) {
+    return;
+  }
   p_->visible = visible;
+  VisibilityChanged();
 }
 
 GroupNode* SceneNode::ParentNode() { return p_->parent_node; }
 
 void SceneNode::SetParentNode(GroupNode* parent) {
   p_->parent_node = parent;
+  VisibilityChanged();
 }
 
 void SceneNode::SetSelectionMask(int64_t mask) { p_->selection_mask = mask; }
@@ -113,4 +185,9 @@ void SceneNode::BoundingBoxChanged() {
   }
 }
 
+void SceneNode::VisibilityChanged() {
+  p_->effectively_visible = p_->visible &&
+      (!p_->parent_node || p_->parent_node->EffectivelyVisible());
+}
+
 }  // namespace sv
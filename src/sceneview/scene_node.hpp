@@ -84,6 +84,14 @@ class SceneNode {
      */
     bool Visible() const;
 
+    /**
+     * Check if the node and all of its ancestors are visible.
+     *
+     * The result is cached and kept up to date as the visibility of the node
+     * and of its ancestors changes, so this does not walk up the tree.
+     */
+    bool EffectivelyVisible() const;
+
     /**
      * Sets the translation component of the node transform.
      */
@@ -158,7 +166,10 @@ class SceneNode {
      * Set the draw order of this node within the draw group. Use this to force
      * certain nodes to draw before or after other nodes within the draw group.
      *
-     * Nodes with a lower order are drawn first.
+     * Nodes with a lower order are drawn first. Any int values may be used, but
+     * at most 65536 distinct values are told apart among the nodes drawn by a
+     * draw group in one frame. Beyond that, the highest values are drawn in an
+     * arbitrary order relative to each other.
      */
     void SetDrawOrder(int order);
 
@@ -185,8 +196,44 @@ class SceneNode {
      */
     virtual void BoundingBoxChanged();
 
+    /**
+     * Internal method, called when the visibility of the node or one of its
+     * ancestors changes, or when the node's parent is set. Updates the value
+     * returned by EffectivelyVisible(), so overrides must call the base
+     * class method first.
+     */
+    virtual void VisibilityChanged();
+
   private:
     friend class GroupNode;
+    friend class Scene;
+
+    // Name of nodes that were not given one, generated from @p number.
+    static QString AutoName(int number);
+
+    // The number that @p name was generated from, or -1 if it is not a
+    // generated name.
+    static int AutoNameNumber(const QString& name);
+
+    // For nodes without an explicit name, the number their name is generated
+    // from, or -1.
+    int NameNumber() const;
+
+    void SetNameNumber(int number);
+
+    // Positions of the node in the containers that hold it, so that it can be
+    // removed from them in constant time. -1 when not held.
+    int SceneIndex() const;
+
+    void SetSceneIndex(int index);
+
+    int ChildIndex() const;
+
+    void SetChildIndex(int index);
+
+    int ListIndex() const;
+
+    void SetListIndex(int index);
 
     class Priv;
 
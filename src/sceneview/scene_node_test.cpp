@@ -0,0 +1,184 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <QVector3D>
+
+#include "sceneview/axis_aligned_box.hpp"
+#include "sceneview/camera_node.hpp"
+#include "sceneview/draw_node.hpp"
+#include "sceneview/group_node.hpp"
+#include "sceneview/instanced_draw_node.hpp"
+#include "sceneview/light_node.hpp"
+#include "sceneview/lod_draw_node.hpp"
+#include "sceneview/resource_manager.hpp"
+#include "sceneview/scene.hpp"
+#include "sceneview/test_scenes.hpp"
+
+using sv::AxisAlignedBox;
+using sv::CameraNode;
+using sv::DrawNode;
+using sv::GroupNode;
+using sv::InstancedDrawNode;
+using sv::LightNode;
+using sv::LodDrawNode;
+using sv::ResourceManager;
+using sv::Scene;
+using sv::SceneNode;
+using sv::test::BoxDrawable;
+
+TEST(SceneNode, EffectivelyVisible) {
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  GroupNode* outer = scene->MakeGroup(scene->Root());
+  GroupNode* inner = scene->MakeGroup(outer);
+  DrawNode* leaf = scene->MakeDrawNode(inner);
+  EXPECT_TRUE(leaf->EffectivelyVisible());
+
+  outer->SetVisible(false);
+  EXPECT_FALSE(outer->EffectivelyVisible());
+  EXPECT_FALSE(inner->EffectivelyVisible());
+  EXPECT_FALSE(leaf->EffectivelyVisible());
+  EXPECT_TRUE(inner->Visible());
+  EXPECT_TRUE(leaf->Visible());
+
+  // Nodes created under a hidden group are hidden too.
+  DrawNode* new_leaf = scene->MakeDrawNode(inner);
+  EXPECT_FALSE(new_leaf->EffectivelyVisible());
+
+  // Hiding a node under a hidden group keeps it hidden once the group is
+  // shown again.
+  inner->SetVisible(false);
+  outer->SetVisible(true);
+  EXPECT_TRUE(outer->EffectivelyVisible());
+  EXPECT_FALSE(inner->EffectivelyVisible());
+  EXPECT_FALSE(leaf->EffectivelyVisible());
+
+  inner->SetVisible(true);
+  EXPECT_TRUE(leaf->EffectivelyVisible());
+  EXPECT_TRUE(new_leaf->EffectivelyVisible());
+
+  leaf->SetVisible(false);
+  EXPECT_FALSE(leaf->EffectivelyVisible());
+  EXPECT_TRUE(new_leaf->EffectivelyVisible());
+}
+
+TEST(SceneNode, DestroyAndReuse) {
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  GroupNode* group = scene->MakeGroup(scene->Root());
+  scene->MakeGroup(group);
+  scene->MakeCamera(group);
+  scene->MakeLight(group);
+  scene->MakeDrawNode(group);
+  scene->MakeInstancedDrawNode(group);
+  scene->MakeLodDrawNode(group);
+  DrawNode* draw_node = scene->MakeDrawNode(scene->Root());
+
+  // Nodes are stored in pools, and destroyed nodes make room for new ones.
+  scene->DestroyNode(draw_node);
+  EXPECT_EQ(draw_node, scene->MakeDrawNode(scene->Root()));
+  scene->DestroyNode(group);
+  EXPECT_TRUE(scene->Lights().empty());
+  GroupNode* new_group = scene->MakeGroup(scene->Root());
+  EXPECT_EQ(group, new_group);
+
+  // Nodes outside of the tree are destroyed with the scene.
+  scene->MakeGroup(nullptr);
+  scene->MakeLodDrawNode(nullptr);
+  scene->MakeInstancedDrawNode(nullptr);
+  scene->MakeCamera(scene->MakeGroup(nullptr));
+}
+
+TEST(SceneNode, Names) {
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  EXPECT_EQ(QString("root"), scene->Root()->Name());
+  GroupNode* named = scene->MakeGroup(scene->Root(), "named");
+  EXPECT_EQ(QString("named"), named->Name());
+  EXPECT_THROW(scene->MakeGroup(scene->Root(), "named"),
+      std::invalid_argument);
+
+  // Generated names do not collide with explicit ones, in either order.
+  GroupNode* generated = scene->MakeGroup(scene->Root());
+  EXPECT_TRUE(generated->Name().startsWith("sv_"));
+  EXPECT_THROW(scene->MakeGroup(scene->Root(), generated->Name()),
+      std::invalid_argument);
+  const int next_number = generated->Name().mid(3).toInt() + 1;
+  scene->MakeGroup(scene->Root(),
+      "sv_" + QString::number(next_number));
+  EXPECT_NE("sv_" + QString::number(next_number),
+      scene->MakeGroup(scene->Root())->Name());
+
+  // Names of destroyed nodes are free again.
+  scene->DestroyNode(named);
+  EXPECT_EQ(QString("named"),
+      scene->MakeDrawNode(scene->Root(), "named")->Name());
+}
+
+TEST(SceneNode, DestroyChildren) {
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  GroupNode* group = scene->MakeGroup(scene->Root());
+  std::vector<SceneNode*> children;
+  for (int ind = 0; ind < 10; ++ind) {
+    children.push_back(scene->MakeDrawNode(group));
+  }
+  LightNode* light = scene->MakeLight(group);
+  LightNode* other_light = scene->MakeLight(scene->Root());
+
+  // Removing a child keeps the other children.
+  scene->DestroyNode(children[3]);
+  children.erase(children.begin() + 3);
+  scene->DestroyNode(light);
+  ASSERT_EQ(children.size(), group->Children().size());
+  for (SceneNode* child : children) {
+    EXPECT_EQ(1, std::count(group->Children().begin(),
+          group->Children().end(), child));
+    EXPECT_EQ(group, child->ParentNode());
+  }
+  ASSERT_EQ(1, scene->Lights().size());
+  EXPECT_EQ(other_light, scene->Lights()[0]);
+
+  scene->DestroyNode(group);
+  ASSERT_EQ(1, scene->Root()->Children().size());
+  EXPECT_EQ(other_light, scene->Root()->Children()[0]);
+}
+
+TEST(SceneNode, SharedDrawable) {
+  ResourceManager::Ptr resources = ResourceManager::Create();
+  Scene::Ptr scene = resources->MakeScene();
+  std::shared_ptr<BoxDrawable> drawable(new BoxDrawable());
+  std::vector<DrawNode*> nodes;
+  for (int ind = 0; ind < 10; ++ind) {
+    DrawNode* node = scene->MakeDrawNode(scene->Root());
+    node->Add(drawable);
+    nodes.push_back(node);
+  }
+  // A node may hold the same drawable more than once.
+  nodes[4]->Add(drawable);
+
+  // Destroy nodes out of order, including ones whose listener entries were
+  // moved by earlier removals.
+  for (int ind : { 0, 9, 4, 2, 7 }) {
+    scene->DestroyNode(nodes[ind]);
+    nodes[ind] = nullptr;
+  }
+  nodes.erase(std::remove(nodes.begin(), nodes.end(), nullptr), nodes.end());
+
+  // The remaining nodes still follow the drawable's bounding box.
+  const AxisAlignedBox box(QVector3D(1, 2, 3), QVector3D(4, 5, 6));
+  for (DrawNode* node : nodes) {
+    node->WorldBoundingBox();
+  }
+  drawable->SetBox(box);
+  for (DrawNode* node : nodes) {
+    EXPECT_EQ(box.Min(), node->WorldBoundingBox().Min());
+    EXPECT_EQ(box.Max(), node->WorldBoundingBox().Max());
+  }
+}
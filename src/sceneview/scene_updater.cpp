@@ -0,0 +1,122 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/scene_updater.hpp"
+
+#include <algorithm>
+
+#include "sceneview/group_node.hpp"
+#include "sceneview/tracing.hpp"
+#include "sceneview/worker_pool.hpp"
+
+namespace sv {
+
+// Number of subtrees per thread to split the dirty part of the scene graph
+// into, so that subtrees of uneven sizes still keep every thread busy.
+static constexpr int kSubtreesPerThread = 8;
+
+// Number of tasks per thread. Each task updates a range of subtrees.
+static constexpr int kTasksPerThread = 4;
+
+// Minimum number of nodes without children to update in parallel.
+static constexpr int kMinParallelNodes = 256;
+
+SceneUpdater::SceneUpdater() {}
+
+int SceneUpdater::Update(GroupNode* root, std::unique_ptr<WorkerPool>* pool) {
+  if (!root->BoundingBoxDirty()) {
+    return 0;
+  }
+  SV_TRACE_SCOPE("render", "SceneUpdater::Update");
+  int num_threads = 1;
+  if (pool) {
+    num_threads = *pool ? (*pool)->NumThreads() :
+        WorkerPool::DefaultNumThreads();
+  }
+  if (num_threads == 1) {
+    UpdateSubtree(root);
+    return 1;
+  }
+
+  // Split dirty groups into their children, one level at a time. The
+  // transforms of the split groups are computed here, so that the subtrees
+  // below them only read them. Groups whose bounding box is up to date have
+  // nothing below them to update, and are dropped.
+  std::vector<SceneNode*>& subtrees = subtrees_;
+  subtrees.clear();
+  subtrees.push_back(root);
+  const size_t target_size = num_threads * kSubtreesPerThread;
+  int num_groups = 1;
+  while (num_groups && subtrees.size() < target_size) {
+    num_groups = 0;
+    next_subtrees_.clear();
+    for (SceneNode* node : subtrees) {
+      GroupNode* group = DirtyGroup(node);
+      if (!group) {
+        next_subtrees_.push_back(node);
+        continue;
+      }
+      group->WorldTransform();
+      for (SceneNode* child : group->Children()) {
+        if (child->NodeType() != SceneNodeType::kGroupNode) {
+          next_subtrees_.push_back(child);
+        } else if (DirtyGroup(child)) {
+          next_subtrees_.push_back(child);
+          num_groups++;
+        }
+      }
+    }
+    subtrees.swap(next_subtrees_);
+  }
+
+  // Nodes without children are cheap to update, so only wake up the other
+  // threads for groups or for many of them.
+  const int num_subtrees = subtrees.size();
+  if (!num_groups && num_subtrees < kMinParallelNodes) {
+    for (SceneNode* node : subtrees) {
+      UpdateSubtree(node);
+    }
+  } else {
+    const int num_tasks =
+        std::min(num_subtrees, num_threads * kTasksPerThread);
+    // The task only captures a pointer and an int, so that std::function can
+    // store it without allocating.
+    const std::vector<SceneNode*>* psubtrees = &subtrees;
+    if (!*pool) {
+      pool->reset(new WorkerPool());
+    }
+    (*pool)->Run(num_tasks, [psubtrees, num_tasks](int task) {
+      const int num_subtrees = psubtrees->size();
+      const int begin = task * num_subtrees / num_tasks;
+      const int end = (task + 1) * num_subtrees / num_tasks;
+      for (int index = begin; index < end; ++index) {
+        UpdateSubtree((*psubtrees)[index]);
+      }
+    });
+  }
+
+  // Combine the bounding boxes of the split groups. Everything below them
+  // is up to date.
+  root->WorldBoundingBox();
+  return num_subtrees;
+}
+
+GroupNode* SceneUpdater::DirtyGroup(SceneNode* node) {
+  if (node->NodeType() != SceneNodeType::kGroupNode) {
+    return nullptr;
+  }
+  GroupNode* group = static_cast<GroupNode*>(node);
+  return group->BoundingBoxDirty() ? group : nullptr;
+}
+
+void SceneUpdater::UpdateSubtree(SceneNode* node) {
+  node->WorldTransform();
+  GroupNode* group = DirtyGroup(node);
+  if (group) {
+    for (SceneNode* child : group->Children()) {
+      UpdateSubtree(child);
+    }
+  }
+  node->WorldBoundingBox();
+}
+
+}  // namespace sv
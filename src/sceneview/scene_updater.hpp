@@ -0,0 +1,76 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_SCENE_UPDATER_HPP__
+#define SCENEVIEW_SCENE_UPDATER_HPP__
+
+#include <memory>
+#include <vector>
+
+namespace sv {
+
+class GroupNode;
+class SceneNode;
+class WorkerPool;
+
+/**
+ * Brings the world transforms and world bounding boxes of a scene graph up to
+ * date, in parallel.
+ *
+ * SceneNode::WorldTransform() and SceneNode::WorldBoundingBox() are computed
+ * lazily and recursively, so when a large subtree moves, the first call to
+ * them recomputes the whole subtree on the calling thread. Update() does the
+ * same work ahead of time, spread over the threads of a WorkerPool:
+ * - Starting from the root, groups whose bounding box is dirty are split into
+ *   their children until there are enough independent subtrees to keep the
+ *   threads busy. The transforms of the split groups are computed first.
+ * - The subtrees are updated in parallel. Subtrees under groups whose
+ *   bounding box is up to date are skipped.
+ * - The bounding boxes of the split groups are then computed from those of
+ *   their children.
+ *
+ * Each node is computed exactly as the lazy path would compute it, so the
+ * results are identical, and the lazy accessors then only read cached
+ * values. Nodes that are not descendants of the root are left to the lazy
+ * path.
+ *
+ * The scene graph must not be modified during Update().
+ * Drawable::BoundingBox() is called from the worker threads, possibly on the
+ * same drawable from several threads at once, so its overrides must only
+ * read state.
+ *
+ * Internal class, not part of the public API.
+ */
+class SceneUpdater {
+ public:
+  SceneUpdater();
+
+  SceneUpdater(const SceneUpdater&) = delete;
+
+  SceneUpdater& operator=(const SceneUpdater&) = delete;
+
+  /**
+   * Updates the subtree under @p root.
+   *
+   * @param pool the threads to use. If it holds no pool, then one is created
+   * the first time that an update is large enough to be spread over threads.
+   * Pass nullptr to update on the calling thread only.
+   * @return the number of subtrees that the update was split into, or zero
+   * if nothing was dirty.
+   */
+  int Update(GroupNode* root, std::unique_ptr<WorkerPool>* pool);
+
+ private:
+  // Returns @p node as a group if it is a group whose bounding box is dirty.
+  static GroupNode* DirtyGroup(SceneNode* node);
+
+  // Updates a subtree on the calling thread.
+  static void UpdateSubtree(SceneNode* node);
+
+  // Subtrees to update, reused across calls.
+  std::vector<SceneNode*> subtrees_;
+  std::vector<SceneNode*> next_subtrees_;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_SCENE_UPDATER_HPP__
@@ -0,0 +1,121 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include "sceneview/axis_aligned_box.hpp"
+#include "sceneview/draw_node.hpp"
+#include "sceneview/group_node.hpp"
+#include "sceneview/scene_updater.hpp"
+#include "sceneview/test_scenes.hpp"
+#include "sceneview/worker_pool.hpp"
+
+using sv::AxisAlignedBox;
+using sv::SceneNode;
+using sv::SceneUpdater;
+using sv::WorkerPool;
+using sv::test::TreeScene;
+
+static void ExpectSameBox(const AxisAlignedBox& expected,
+    const AxisAlignedBox& actual) {
+  EXPECT_EQ(expected.Valid(), actual.Valid());
+  if (expected.Valid() && actual.Valid()) {
+    EXPECT_EQ(expected.Min(), actual.Min());
+    EXPECT_EQ(expected.Max(), actual.Max());
+  }
+}
+
+// Updates @p updated with a SceneUpdater and @p lazy with the lazy
+// accessors, and checks that both give the same results.
+static void ExpectSameAsLazy(TreeScene* updated, TreeScene* lazy,
+    std::unique_ptr<WorkerPool>* pool) {
+  SceneUpdater updater;
+  EXPECT_LT(0, updater.Update(updated->scene->Root(), pool));
+  EXPECT_EQ(0, updater.Update(updated->scene->Root(), pool));
+
+  ExpectSameBox(lazy->scene->Root()->WorldBoundingBox(),
+      updated->scene->Root()->WorldBoundingBox());
+  ASSERT_EQ(lazy->groups.size(), updated->groups.size());
+  for (size_t ind = 0; ind < lazy->groups.size(); ++ind) {
+    EXPECT_EQ(lazy->groups[ind]->WorldTransform(),
+        updated->groups[ind]->WorldTransform());
+    ExpectSameBox(lazy->groups[ind]->WorldBoundingBox(),
+        updated->groups[ind]->WorldBoundingBox());
+  }
+  ASSERT_EQ(lazy->leaves.size(), updated->leaves.size());
+  for (size_t ind = 0; ind < lazy->leaves.size(); ++ind) {
+    EXPECT_EQ(lazy->leaves[ind]->WorldTransform(),
+        updated->leaves[ind]->WorldTransform());
+    ExpectSameBox(lazy->leaves[ind]->WorldBoundingBox(),
+        updated->leaves[ind]->WorldBoundingBox());
+  }
+}
+
+TEST(SceneUpdater, SameAsLazy) {
+  std::unique_ptr<WorkerPool> pool(new WorkerPool(4));
+  const int shapes[][2] = { { 1, 1000 }, { 3, 10 }, { 6, 3 }, { 40, 1 } };
+  for (const auto& shape : shapes) {
+    TreeScene updated(shape[0], shape[1]);
+    TreeScene lazy(shape[0], shape[1]);
+    ExpectSameAsLazy(&updated, &lazy, &pool);
+  }
+}
+
+TEST(SceneUpdater, SingleThread) {
+  std::unique_ptr<WorkerPool> pool(new WorkerPool(1));
+  TreeScene updated(4, 4);
+  TreeScene lazy(4, 4);
+  ExpectSameAsLazy(&updated, &lazy, &pool);
+
+  TreeScene updated_no_pool(4, 4);
+  TreeScene lazy_no_pool(4, 4);
+  ExpectSameAsLazy(&updated_no_pool, &lazy_no_pool, nullptr);
+}
+
+TEST(SceneUpdater, MovedSubtree) {
+  std::unique_ptr<WorkerPool> pool(new WorkerPool(4));
+  TreeScene updated(4, 5);
+  TreeScene lazy(4, 5);
+  ExpectSameAsLazy(&updated, &lazy, &pool);
+
+  // Move one subtree and a single leaf elsewhere.
+  const AxisAlignedBox old_leaf_box =
+      updated.leaves.back()->WorldBoundingBox();
+  for (TreeScene* tree : { &updated, &lazy }) {
+    tree->groups[2]->SetTranslation(100, 0, 0);
+    tree->leaves.back()->SetTranslation(0, -50, 0);
+  }
+  ExpectSameAsLazy(&updated, &lazy, &pool);
+
+  // The bounding boxes of the ancestors follow the moved nodes.
+  const AxisAlignedBox& leaf_box = updated.leaves.back()->WorldBoundingBox();
+  EXPECT_NE(old_leaf_box.Min(), leaf_box.Min());
+  for (SceneNode* node = updated.leaves.back(); node;
+      node = node->ParentNode()) {
+    const AxisAlignedBox& box = node->WorldBoundingBox();
+    for (int axis = 0; axis < 3; ++axis) {
+      EXPECT_LE(box.Min()[axis], leaf_box.Min()[axis]);
+      EXPECT_GE(box.Max()[axis], leaf_box.Max()[axis]);
+    }
+  }
+}
+
+TEST(SceneUpdater, CreatesPoolWhenNeeded) {
+  // A few leaves are updated on the calling thread.
+  std::unique_ptr<WorkerPool> pool;
+  TreeScene small(1, 10);
+  TreeScene small_lazy(1, 10);
+  ExpectSameAsLazy(&small, &small_lazy, &pool);
+  EXPECT_FALSE(pool);
+
+  // Groups are worth spreading over threads, if there is more than one.
+  TreeScene large(3, 10);
+  TreeScene large_lazy(3, 10);
+  ExpectSameAsLazy(&large, &large_lazy, &pool);
+  EXPECT_EQ(WorkerPool::DefaultNumThreads() > 1, static_cast<bool>(pool));
+}
@@ -17,15 +17,21 @@
 #include <sceneview/draw_group.hpp>
 #include <sceneview/expander_widget.hpp>
 #include <sceneview/font_resource.hpp>
+#include <sceneview/frame_stats.hpp>
 #include <sceneview/geometry_resource.hpp>
 #include <sceneview/grid_renderer.hpp>
 #include <sceneview/group_node.hpp>
 #include <sceneview/input_handler.hpp>
 #include <sceneview/input_handler_widget_stack.hpp>
+#include <sceneview/instanced_draw_node.hpp>
 #include <sceneview/light_node.hpp>
+#include <sceneview/lod_draw_node.hpp>
 #include <sceneview/material_resource.hpp>
+#include <sceneview/mesh_simplifier.hpp>
+#include <sceneview/offscreen_renderer.hpp>
 #include <sceneview/draw_node.hpp>
 #include <sceneview/param_widget.hpp>
+#include <sceneview/perf_hud_renderer.hpp>
 #include <sceneview/renderer.hpp>
 #include <sceneview/renderer_widget_stack.hpp>
 #include <sceneview/resource_manager.hpp>
@@ -37,6 +43,7 @@
 #include <sceneview/shader_uniform.hpp>
 #include <sceneview/stock_resources.hpp>
 #include <sceneview/text_billboard.hpp>
+#include <sceneview/tracing.hpp>
 #include <sceneview/viewer.hpp>
 #include <sceneview/view_handler_horizontal.hpp>
 #include <sceneview/viewport.hpp>
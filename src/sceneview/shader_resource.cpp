@@ -1,5 +1,7 @@
 // Copyright [2015] Albert Huang
 
+#include "sceneview/internal_gl.hpp"
+
 #include "sceneview/shader_resource.hpp"
 
 #include <string>
@@ -8,23 +10,56 @@
 #include <QFile>
 #include <QTextStream>
 
+#include "sceneview/geometry_resource.hpp"
+#include "sceneview/tracing.hpp"
+
 namespace sv {
 
 int kShaderMaxLights = 4;
 
+const int kShaderCameraBlockBinding = 0;
+
+const int kShaderLightsBlockBinding = 1;
+
+// Looks up a uniform block and assigns it to a fixed binding point.
+static int BindUniformBlock(QOpenGLShaderProgram* program, const char* name,
+                            int binding) {
+  const GLuint program_id = program->programId();
+  const GLuint index = glGetUniformBlockIndex(program_id, name);
+  if (index == GL_INVALID_INDEX) {
+    return -1;
+  }
+  glUniformBlockBinding(program_id, index, binding);
+  return index;
+}
+
 struct ShaderResource::Priv {
   QString name;
 
   std::unique_ptr<QOpenGLShaderProgram> program;
 
   ShaderStandardVariables locations;
+
+  uint32_t sort_id;
+
+  uint64_t link_generation = 0;
+
+  // Geometries holding a vertex array object for this shader.
+  std::vector<GeometryResource*> vertex_array_users;
 };
 
 ShaderResource::ShaderResource(const QString& name) : p_(new Priv()) {
+  static uint32_t next_sort_id = 0;
   p_->name = name;
+  p_->sort_id = next_sort_id++;
 }
 
-ShaderResource::~ShaderResource() { delete p_; }
+ShaderResource::~ShaderResource() {
+  for (GeometryResource* geometry : p_->vertex_array_users) {
+    geometry->ReleaseVertexArray(this);
+  }
+  delete p_;
+}
 
 const QString ShaderResource::Name() const { return p_->name; }
 
@@ -34,6 +69,7 @@ void ShaderResource::LoadFromFiles(const QString& prefix) {
 
 void ShaderResource::LoadFromFiles(const QString& prefix,
                                    const QString& preamble) {
+  SV_TRACE_SCOPE_DETAIL("resource", "ShaderResource::LoadFromFiles", prefix);
   p_->program.reset(new QOpenGLShaderProgram());
 
   QFile vshader_file(prefix + ".vshader");
@@ -69,10 +105,33 @@ void ShaderResource::LoadFromFiles(const QString& prefix,
   }
 
   LoadLocations();
+  p_->link_generation++;
 }
 
 QOpenGLShaderProgram* ShaderResource::Program() { return p_->program.get(); }
 
+uint32_t ShaderResource::SortId() const { return p_->sort_id; }
+
+uint64_t ShaderResource::LinkGeneration() const {
+  return p_->link_generation;
+}
+
+int ShaderResource::AddVertexArrayUser(GeometryResource* geometry) {
+  p_->vertex_array_users.push_back(geometry);
+  return p_->vertex_array_users.size() - 1;
+}
+
+void ShaderResource::RemoveVertexArrayUser(int index) {
+  // Move the last geometry into the hole, and tell it where it went.
+  std::vector<GeometryResource*>& users = p_->vertex_array_users;
+  GeometryResource* last = users.back();
+  users.pop_back();
+  if (index < static_cast<int>(users.size())) {
+    users[index] = last;
+    last->SetVertexArrayUserIndex(this, index);
+  }
+}
+
 const ShaderStandardVariables& ShaderResource::StandardVariables() const {
   return p_->locations;
 }
@@ -104,6 +163,16 @@ void ShaderResource::LoadLocations() {
     light.cone_angle = p_->program->uniformLocation(prefix + "cone_angle");
   }
 
+  if (UniformBlocksSupported()) {
+    p_->locations.sv_camera_block = BindUniformBlock(p_->program.get(),
+        "sv_camera_block", kShaderCameraBlockBinding);
+    p_->locations.sv_lights_block = BindUniformBlock(p_->program.get(),
+        "sv_lights_block", kShaderLightsBlockBinding);
+  } else {
+    p_->locations.sv_camera_block = -1;
+    p_->locations.sv_lights_block = -1;
+  }
+
   p_->locations.sv_vert_pos = p_->program->attributeLocation("sv_vert_pos");
   p_->locations.sv_normal = p_->program->attributeLocation("sv_normal");
   p_->locations.sv_diffuse = p_->program->attributeLocation("sv_diffuse");
@@ -112,6 +181,13 @@ void ShaderResource::LoadLocations() {
   p_->locations.sv_shininess = p_->program->attributeLocation("sv_shininess");
   p_->locations.sv_tex_coords_0 =
       p_->program->attributeLocation("sv_tex_coords_0");
+
+  p_->locations.sv_instance_model_mat =
+      p_->program->attributeLocation("sv_instance_model_mat");
+  p_->locations.sv_instance_normal_mat =
+      p_->program->attributeLocation("sv_instance_normal_mat");
+  p_->locations.sv_instance_color =
+      p_->program->attributeLocation("sv_instance_color");
 }
 
 }  // namespace sv
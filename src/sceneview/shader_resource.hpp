@@ -3,6 +3,7 @@
 #ifndef SCENEVIEW_SHADER_RESOURCE_HPP__
 #define SCENEVIEW_SHADER_RESOURCE_HPP__
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -10,8 +11,20 @@
 
 namespace sv {
 
+class GeometryResource;
+
 extern int kShaderMaxLights;
 
+/**
+ * Uniform buffer binding point of the sv_camera_block uniform block.
+ */
+extern const int kShaderCameraBlockBinding;
+
+/**
+ * Uniform buffer binding point of the sv_lights_block uniform block.
+ */
+extern const int kShaderLightsBlockBinding;
+
 /**
  * Holds the GLSL locations of light parameters in a shader program.
  *
@@ -89,6 +102,48 @@ struct ShaderStandardVariables {
   // Lights
   std::vector<ShaderLightLocation> sv_lights;
 
+  // ============ Uniform blocks
+  // Filled once per frame by the DrawContext, when uniform buffer objects are
+  // supported. Shaders can declare these blocks instead of the equivalent
+  // loose uniform variables above.
+
+  /**
+   * Index of the camera uniform block, or -1 if not present.
+   *
+   * @code
+   * layout(std140) uniform sv_camera_block {
+   *   mat4 sv_proj_mat;
+   *   mat4 sv_view_mat;
+   *   mat4 sv_view_mat_inv;
+   * };
+   * @endcode
+   */
+  int sv_camera_block;
+
+  /**
+   * Index of the lights uniform block, or -1 if not present.
+   *
+   * @code
+   * struct SvLight {
+   *   bool is_directional;
+   *   vec3 position;
+   *   vec3 direction;
+   *   vec3 color;
+   *   float ambient;
+   *   float specular;
+   *   float attenuation;
+   *   float cone_angle;
+   * };
+   *
+   * layout(std140) uniform sv_lights_block {
+   *   SvLight sv_lights[SV_MAX_LIGHTS];
+   * };
+   * @endcode
+   *
+   * SV_MAX_LIGHTS must match kShaderMaxLights.
+   */
+  int sv_lights_block;
+
   // ============== Per-vertex attributes
   // Automatically populated based on the object geometry
 
@@ -126,6 +181,27 @@ struct ShaderStandardVariables {
    * Texture coordinates set 0
    */
   int sv_tex_coords_0;
+
+  // ============== Per-instance attributes
+  // Automatically populated when drawing an InstancedDrawNode
+
+  /**
+   * Instance transform, applied before the model matrix.
+   * Type: mat4
+   */
+  int sv_instance_model_mat;
+
+  /**
+   * Instance normal matrix, applied before the model normal matrix.
+   * Type: mat3
+   */
+  int sv_instance_normal_mat;
+
+  /**
+   * Instance color.
+   * Type: vec4
+   */
+  int sv_instance_color;
 };
 
 /**
@@ -173,10 +249,39 @@ class ShaderResource {
  private:
   friend class ResourceManager;
 
+  friend class DrawContext;
+
+  friend class MaterialResource;
+
+  friend class GeometryResource;
+
   explicit ShaderResource(const QString& name);
 
+  /**
+   * Small integer that uniquely identifies this shader, used to group draw
+   * calls by shader.
+   */
+  uint32_t SortId() const;
+
+  /**
+   * Incremented each time the shader program is linked, which invalidates
+   * any cached uniform locations.
+   */
+  uint64_t LinkGeneration() const;
+
   void LoadLocations();
 
+  /**
+   * Records that the geometry holds a vertex array object for this shader,
+   * so that it can be freed when this shader is destroyed.
+   *
+   * @return the position of the geometry, to pass to
+   * RemoveVertexArrayUser().
+   */
+  int AddVertexArrayUser(GeometryResource* geometry);
+
+  void RemoveVertexArrayUser(int index);
+
   struct Priv;
   Priv* p_;
 };
@@ -36,6 +36,18 @@ int ShaderUniform::Location() const { return p_->location; }
 
 ShaderUniform::Type ShaderUniform::ParamType() const { return p_->type; }
 
+const QString& ShaderUniform::Name() const { return p_->name; }
+
+const std::vector<int>& ShaderUniform::IntValue() const {
+  return p_->value.int_data;
+}
+
+const std::vector<float>& ShaderUniform::FloatValue() const {
+  return p_->value.float_data;
+}
+
+const QMatrix4x4& ShaderUniform::Mat4fValue() const { return p_->value.mat4f; }
+
 void ShaderUniform::Set(int val) {
   Clear();
   p_->type = Type::kInt;
@@ -34,6 +34,23 @@ class ShaderUniform {
 
   Type ParamType() const;
 
+  const QString& Name() const;
+
+  /**
+   * Retrieve the value of a kInt uniform.
+   */
+  const std::vector<int>& IntValue() const;
+
+  /**
+   * Retrieve the value of a kFloat uniform.
+   */
+  const std::vector<float>& FloatValue() const;
+
+  /**
+   * Retrieve the value of a kMat4f uniform.
+   */
+  const QMatrix4x4& Mat4fValue() const;
+
   void Set(int val);
 
   void Set(const std::vector<int>& val);
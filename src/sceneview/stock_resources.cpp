@@ -1,5 +1,7 @@
 // Copyright [2015] Albert Huang
 
+#include "sceneview/internal_gl.hpp"
+
 #include "sceneview/stock_resources.hpp"
 
 #include <cassert>
@@ -8,6 +10,8 @@
 #include <utility>
 #include <vector>
 
+#include <QFile>
+#include <QTextStream>
 #include <QVector4D>
 
 namespace sv {
@@ -89,7 +93,11 @@ static std::vector<StockShaderData> g_stock_shader_data = {
      "#define COLOR_UNIFORM\n#define USE_TEXTURE0\n"},
     {StockResources::kBillboardTextured, "billboard", "#define USE_TEXTURE0\n"},
     {StockResources::kBillboardUniformColor, "billboard",
-     "#define COLOR_UNIFORM\n"}};
+     "#define COLOR_UNIFORM\n"},
+    {StockResources::kUniformColorNoLightingInstanced, "no_lighting",
+     "#define COLOR_UNIFORM\n#define INSTANCED\n"},
+    {StockResources::kUniformColorLightingInstanced, "lighting",
+     "#define COLOR_UNIFORM\n#define INSTANCED\n"}};
 
 static const StockShaderData& GetStockShaderData(
     StockResources::StockShaderId id) {
@@ -101,6 +109,27 @@ static const StockShaderData& GetStockShaderData(
   throw std::invalid_argument("Invalid stock shader id");
 }
 
+// Builds the text prepended to a stock shader: uniform block support, the
+// shader's own preamble, and the standard uniform declarations.
+static QString StockShaderPreamble(const StockShaderData& sdata) {
+  static QString uniforms_src;
+  if (uniforms_src.isEmpty()) {
+    QFile uniforms_file(":sceneview/stock_shaders/sv_uniforms.glsl");
+    if (uniforms_file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      uniforms_src = QTextStream(&uniforms_file).readAll();
+    }
+  }
+
+  QString result;
+  if (UniformBlocksSupported()) {
+    result = "#extension GL_ARB_uniform_buffer_object : require\n"
+             "#define SV_UNIFORM_BLOCKS\n";
+  }
+  result += "#define SV_MAX_LIGHTS " + QString::number(kShaderMaxLights) +
+            "\n";
+  return result + sdata.preamble + uniforms_src;
+}
+
 ShaderResource::Ptr StockResources::Shader(StockShaderId id) {
   const StockShaderData& sdata = GetStockShaderData(id);
   const QString shader_name = "sv_stock_shader:" + QString::number(sdata.id);
@@ -109,7 +138,7 @@ ShaderResource::Ptr StockResources::Shader(StockShaderId id) {
   if (!shader) {
     shader = p_->resources->MakeShader(shader_name);
     shader->LoadFromFiles(":sceneview/stock_shaders/" + sdata.fname_stem,
-                          sdata.preamble);
+                          StockShaderPreamble(sdata));
     if (!shader) {
       shader.reset();
     }
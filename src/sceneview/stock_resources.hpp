@@ -228,7 +228,34 @@ class StockResources {
      */
     kTextureUniformColorLighting,
     kBillboardTextured,
-    kBillboardUniformColor
+    kBillboardUniformColor,
+    /**
+     * Like kUniformColorNoLighting, for use with InstancedDrawNode.
+     *
+     * Each instance is transformed by its instance transform, and its color
+     * is the uniform color multiplied by its instance color.
+     *
+     * For example:
+     * @code
+     *  StockResources stock(resources);
+     *  MaterialResource::Ptr material =
+     *      stock.NewMaterial(StockResources::kUniformColorNoLightingInstanced);
+     *  material->SetParam(sv::kColor, 1.0, 1.0, 1.0, 1.0);
+     *
+     *  InstancedDrawNode* node = scene->MakeInstancedDrawNode(scene->Root(),
+     *      stock.Cube(), material);
+     *  node->SetInstances(transforms, colors);
+     * @endcode
+     */
+    kUniformColorNoLightingInstanced,
+    /**
+     * Like kUniformColorLighting, for use with InstancedDrawNode.
+     *
+     * Each instance is transformed by its instance transform, and its
+     * diffuse color is the sv::kDiffuse parameter multiplied by its instance
+     * color.
+     */
+    kUniformColorLightingInstanced
   };
 
  public:
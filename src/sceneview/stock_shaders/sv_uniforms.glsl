@@ -0,0 +1,49 @@
+// Standard sceneview camera and light uniforms, shared by the stock shaders.
+// This file is prepended to each stock shader, after the stock shader's own
+// preamble.
+//
+// SV_MAX_LIGHTS must be #defined before this file. If SV_UNIFORM_BLOCKS is
+// #defined, the variables are declared in std140 uniform blocks that the
+// DrawContext fills once per frame. Otherwise, they are loose uniforms that
+// are set for every draw.
+
+struct SvLight {
+  bool is_directional;
+  vec3 position;
+  vec3 direction;
+  vec3 color;
+  float ambient;
+  float specular;
+  float attenuation;
+  float cone_angle;
+};
+
+#ifdef SV_UNIFORM_BLOCKS
+layout(std140) uniform sv_camera_block {
+  // Projection matrix
+  mat4 sv_proj_mat;
+
+  // View matrix
+  mat4 sv_view_mat;
+
+  // View matrix inverse
+  mat4 sv_view_mat_inv;
+};
+
+layout(std140) uniform sv_lights_block {
+  SvLight sv_lights[SV_MAX_LIGHTS];
+};
+#else
+// Projection matrix
+uniform mat4 sv_proj_mat;
+
+// View matrix
+uniform mat4 sv_view_mat;
+
+// View matrix inverse
+uniform mat4 sv_view_mat_inv;
+
+uniform SvLight sv_lights[SV_MAX_LIGHTS];
+#endif
+
+// vim: ft=glsl
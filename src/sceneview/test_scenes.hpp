@@ -0,0 +1,102 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_TEST_SCENES_HPP__
+#define SCENEVIEW_TEST_SCENES_HPP__
+
+#include <random>
+#include <vector>
+
+#include <QQuaternion>
+#include <QVector3D>
+
+#include "sceneview/axis_aligned_box.hpp"
+#include "sceneview/draw_node.hpp"
+#include "sceneview/drawable.hpp"
+#include "sceneview/group_node.hpp"
+#include "sceneview/resource_manager.hpp"
+#include "sceneview/scene.hpp"
+
+namespace sv {
+namespace test {
+
+/**
+ * Drawable with a fixed bounding box and no geometry, so that scenes can be
+ * built without an OpenGL context.
+ *
+ * Internal class, shared by the tests and benchmarks. Not part of the public
+ * API.
+ */
+class BoxDrawable : public Drawable {
+ public:
+  BoxDrawable() :
+    Drawable(nullptr, nullptr),
+    box_(QVector3D(-0.5, -0.5, -0.5), QVector3D(0.5, 0.5, 0.5)) {}
+
+  const AxisAlignedBox& BoundingBox() override { return box_; }
+
+  void SetBox(const AxisAlignedBox& box) {
+    box_ = box;
+    BoundingBoxChanged();
+  }
+
+ private:
+  AxisAlignedBox box_;
+};
+
+/**
+ * Scene graph shaped as a tree of group nodes, with selectable draw nodes as
+ * leaves. Trees built with the same arguments are identical.
+ *
+ * Internal class, shared by the tests and benchmarks. Not part of the public
+ * API.
+ */
+struct TreeScene {
+  TreeScene(int depth, int branching) {
+    resources = ResourceManager::Create();
+    scene = resources->MakeScene();
+    drawable.reset(new BoxDrawable());
+    std::mt19937 rng(depth * 100 + branching);
+    std::uniform_real_distribution<float> dist(-1, 1);
+
+    std::vector<GroupNode*> level = { scene->Root() };
+    for (int d = 0; d < depth; ++d) {
+      std::vector<GroupNode*> next;
+      for (GroupNode* parent : level) {
+        for (int child = 0; child < branching; ++child) {
+          GroupNode* group = scene->MakeGroup(parent);
+          group->SetTranslation(dist(rng) * 10, dist(rng) * 10,
+              dist(rng) * 10);
+          group->SetRotation(QQuaternion::fromAxisAndAngle(0, 0, 1,
+                dist(rng) * 180));
+          groups.push_back(group);
+          next.push_back(group);
+        }
+      }
+      level.swap(next);
+    }
+    for (GroupNode* parent : level) {
+      DrawNode* node = scene->MakeDrawNode(parent);
+      node->Add(drawable);
+      node->SetScale(1 + dist(rng), 1, 1);
+      node->SetSelectionMask(1);
+      leaves.push_back(node);
+    }
+  }
+
+  // Invalidates the world transforms and bounding boxes of every node.
+  void Invalidate() {
+    GroupNode* root = scene->Root();
+    root->SetTranslation(root->Translation());
+  }
+
+  ResourceManager::Ptr resources;
+  Scene::Ptr scene;
+  Drawable::Ptr drawable;
+  std::vector<GroupNode*> groups;
+  std::vector<DrawNode*> leaves;
+};
+
+}  // namespace test
+}  // namespace sv
+
+#endif  // SCENEVIEW_TEST_SCENES_HPP__
@@ -10,6 +10,7 @@
 #include "sceneview/draw_node.hpp"
 #include "sceneview/group_node.hpp"
 #include "sceneview/stock_resources.hpp"
+#include "sceneview/tracing.hpp"
 #include "sceneview/viewport.hpp"
 
 namespace sv {
@@ -176,6 +177,7 @@ void TextBillboard::SetYDirection(YDirection direction) {
 GroupNode* TextBillboard::Node() { return p_->node; }
 
 void TextBillboard::Recompute() {
+  SV_TRACE_SCOPE("resource", "TextBillboard::Recompute");
   p_->font_resource = p_->resources->Font(p_->qfont);
 
   GeometryData gdata;
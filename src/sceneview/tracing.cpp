@@ -0,0 +1,228 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/tracing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace sv {
+
+std::atomic<bool> Tracer::recording_(false);
+
+constexpr int Tracer::kDefaultEventsPerThread;
+
+namespace {
+
+struct TraceEvent {
+  const char* category;
+  const char* name;
+  int64_t start_ns;
+  int64_t end_ns;
+  std::string detail;
+};
+
+// Events of a single thread. Only that thread adds events, but the buffer
+// is read and cleared by other threads, so it still has a mutex.
+struct ThreadBuffer {
+  std::mutex mutex;
+
+  int thread_id;
+
+  std::string thread_name;
+
+  // Ring buffer. Grows up to the capacity, and then wraps around.
+  std::vector<TraceEvent> events;
+
+  // Index of the oldest event once the buffer has wrapped around.
+  size_t next = 0;
+
+  void Clear() {
+    events.clear();
+    next = 0;
+  }
+};
+
+struct Registry {
+  std::mutex mutex;
+
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+  std::atomic<size_t> events_per_thread{Tracer::kDefaultEventsPerThread};
+};
+
+// Never destroyed, so that threads can still record while the program
+// exits.
+Registry* GetRegistry() {
+  static Registry* registry = new Registry();
+  return registry;
+}
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+ThreadBuffer* GetThreadBuffer() {
+  if (!t_buffer) {
+    Registry* registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    registry->buffers.emplace_back(new ThreadBuffer());
+    t_buffer = registry->buffers.back().get();
+    t_buffer->thread_id = registry->buffers.size();
+  }
+  return t_buffer;
+}
+
+void WriteJsonString(std::ostream& stream, const char* str) {
+  stream << '"';
+  for (const char* ch = str; *ch; ++ch) {
+    switch (*ch) {
+      case '"':
+        stream << "\\\"";
+        break;
+      case '\\':
+        stream << "\\\\";
+        break;
+      case '\n':
+        stream << "\\n";
+        break;
+      case '\t':
+        stream << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(*ch) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x",
+              static_cast<unsigned int>(*ch));
+          stream << escaped;
+        } else {
+          stream << *ch;
+        }
+    }
+  }
+  stream << '"';
+}
+
+}  // namespace
+
+void Tracer::Start(int events_per_thread) {
+  Registry* registry = GetRegistry();
+  registry->events_per_thread = std::max(events_per_thread, 1);
+  Clear();
+  recording_ = true;
+}
+
+void Tracer::Stop() {
+  recording_ = false;
+}
+
+void Tracer::Clear() {
+  Registry* registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  for (auto& buffer : registry->buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->Clear();
+  }
+}
+
+void Tracer::SetThreadName(const QString& name) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  buffer->thread_name = name.toStdString();
+}
+
+int64_t Tracer::NowNs() {
+  typedef std::chrono::steady_clock Clock;
+  static const Clock::time_point epoch = Clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - epoch).count();
+}
+
+void Tracer::AddEvent(const char* category, const char* name,
+    int64_t start_ns, int64_t end_ns, const std::string& detail) {
+  if (!Recording()) {
+    return;
+  }
+  ThreadBuffer* buffer = GetThreadBuffer();
+  const size_t capacity = GetRegistry()->events_per_thread;
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  TraceEvent* event;
+  if (buffer->events.size() < capacity) {
+    buffer->events.emplace_back();
+    event = &buffer->events.back();
+  } else {
+    // Reuse the oldest event, and its string memory.
+    event = &buffer->events[buffer->next];
+    buffer->next = (buffer->next + 1) % buffer->events.size();
+  }
+  event->category = category;
+  event->name = name;
+  event->start_ns = start_ns;
+  event->end_ns = end_ns;
+  event->detail = detail;
+}
+
+void Tracer::WriteJson(const QString& filename) {
+  std::ofstream stream(filename.toStdString());
+  if (!stream) {
+    throw std::runtime_error("Unable to open " + filename.toStdString());
+  }
+  WriteJson(stream);
+  if (!stream) {
+    throw std::runtime_error("Unable to write " + filename.toStdString());
+  }
+}
+
+void Tracer::WriteJson(std::ostream& stream) {
+  // All events are in a single process.
+  constexpr int kProcessId = 1;
+
+  Registry* registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  char number[64];
+  for (auto& buffer : registry->buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    if (!buffer->thread_name.empty()) {
+      stream << (first ? "\n" : ",\n");
+      first = false;
+      stream << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" <<
+          kProcessId << ",\"tid\":" << buffer->thread_id <<
+          ",\"args\":{\"name\":";
+      WriteJsonString(stream, buffer->thread_name.c_str());
+      stream << "}}";
+    }
+
+    // Oldest event first.
+    const size_t num_events = buffer->events.size();
+    for (size_t ind = 0; ind < num_events; ++ind) {
+      const TraceEvent& event =
+          buffer->events[(buffer->next + ind) % num_events];
+      stream << (first ? "\n" : ",\n");
+      first = false;
+      stream << "{\"ph\":\"X\",\"cat\":";
+      WriteJsonString(stream, event.category);
+      stream << ",\"name\":";
+      WriteJsonString(stream, event.name);
+      // Timestamps are in microseconds.
+      snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f",
+          event.start_ns / 1e3, (event.end_ns - event.start_ns) / 1e3);
+      stream << number << ",\"pid\":" << kProcessId << ",\"tid\":" <<
+          buffer->thread_id;
+      if (!event.detail.empty()) {
+        stream << ",\"args\":{\"detail\":";
+        WriteJsonString(stream, event.detail.c_str());
+        stream << "}";
+      }
+      stream << "}";
+    }
+  }
+  stream << "\n]}\n";
+}
+
+}  // namespace sv
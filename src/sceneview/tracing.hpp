@@ -0,0 +1,190 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_TRACING_HPP__
+#define SCENEVIEW_TRACING_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include <QString>
+
+namespace sv {
+
+/**
+ * Records timed events into per-thread ring buffers, and writes them out in
+ * the Chrome trace event format.
+ *
+ * The written JSON files can be opened with chrome://tracing or
+ * https://ui.perfetto.dev to see a timeline of what each thread was doing,
+ * which helps to find the cause of individual slow frames.
+ *
+ * Events are recorded by the SV_TRACE_* macros, which expand to nothing
+ * unless SV_ENABLE_TRACING is defined (see the SV_ENABLE_TRACING CMake
+ * option). When tracing is compiled in, the macros only read an atomic flag
+ * until Start() is called.
+ *
+ * Each thread records into its own ring buffer, so only the most recent
+ * events of each thread are kept. Buffers of threads that have exited are
+ * kept until the program ends, so that events of short-lived background
+ * threads are not lost.
+ *
+ * @code
+ * sv::Tracer::Start();
+ * // ... draw some frames ...
+ * sv::Tracer::Stop();
+ * sv::Tracer::WriteJson("frames.json");
+ * @endcode
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/tracing.hpp
+ */
+class Tracer {
+  public:
+    static constexpr int kDefaultEventsPerThread = 1 << 16;
+
+    /**
+     * Discards previously recorded events, and starts recording.
+     *
+     * @param events_per_thread the size of the ring buffer of each thread.
+     */
+    static void Start(int events_per_thread = kDefaultEventsPerThread);
+
+    /**
+     * Stops recording. Recorded events are kept until the next Start() or
+     * Clear().
+     */
+    static void Stop();
+
+    static bool Recording() {
+      return recording_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Discards recorded events.
+     */
+    static void Clear();
+
+    /**
+     * Sets the name that the calling thread is shown with.
+     */
+    static void SetThreadName(const QString& name);
+
+    /**
+     * Writes the recorded events as trace event JSON.
+     *
+     * @throw std::runtime_error if the file cannot be written.
+     */
+    static void WriteJson(const QString& filename);
+
+    static void WriteJson(std::ostream& stream);
+
+    /**
+     * Nanoseconds since an arbitrary time near the start of the program.
+     */
+    static int64_t NowNs();
+
+    /**
+     * Records an event of the calling thread, if recording.
+     *
+     * @param category, name must remain valid until the events are written,
+     * and are usually string literals.
+     * @param detail shown with the event, or empty.
+     */
+    static void AddEvent(const char* category, const char* name,
+        int64_t start_ns, int64_t end_ns, const std::string& detail);
+
+  private:
+    static std::atomic<bool> recording_;
+};
+
+/**
+ * Records an event that lasts from construction until End() or destruction.
+ *
+ * Usually created with the SV_TRACE_SCOPE() macros.
+ *
+ * @ingroup sv_gui
+ * @headerfile sceneview/tracing.hpp
+ */
+class TraceScope {
+  public:
+    TraceScope(const char* category, const char* name) :
+      category_(category),
+      name_(name),
+      start_ns_(Tracer::Recording() ? Tracer::NowNs() : -1) {}
+
+    ~TraceScope() { End(); }
+
+    TraceScope(const TraceScope&) = delete;
+
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    /**
+     * Whether the event is being recorded.
+     */
+    bool Active() const { return start_ns_ >= 0; }
+
+    void SetDetail(const QString& detail) { detail_ = detail.toStdString(); }
+
+    /**
+     * Ends the event early.
+     */
+    void End() {
+      if (start_ns_ >= 0) {
+        Tracer::AddEvent(category_, name_, start_ns_, Tracer::NowNs(),
+            detail_);
+        start_ns_ = -1;
+      }
+    }
+
+  private:
+    const char* category_;
+    const char* name_;
+    int64_t start_ns_;
+    std::string detail_;
+};
+
+}  // namespace sv
+
+#ifdef SV_ENABLE_TRACING
+
+#define SV_TRACE_CONCAT2(a, b) a##b
+#define SV_TRACE_CONCAT(a, b) SV_TRACE_CONCAT2(a, b)
+
+/**
+ * Records an event for the rest of the enclosing scope.
+ */
+#define SV_TRACE_SCOPE(category, name) \
+  ::sv::TraceScope SV_TRACE_CONCAT(sv_trace_scope_, __LINE__)(category, name)
+
+/**
+ * Like SV_TRACE_SCOPE(), with a QString detail that is only evaluated while
+ * recording.
+ */
+#define SV_TRACE_SCOPE_DETAIL(category, name, detail) \
+  SV_TRACE_SCOPE(category, name); \
+  if (SV_TRACE_CONCAT(sv_trace_scope_, __LINE__).Active()) \
+    SV_TRACE_CONCAT(sv_trace_scope_, __LINE__).SetDetail(detail)
+
+/**
+ * Records an event from here until SV_TRACE_END(var) or the end of the
+ * enclosing scope.
+ */
+#define SV_TRACE_BEGIN(var, category, name) ::sv::TraceScope var(category, name)
+
+#define SV_TRACE_END(var) var.End()
+
+#define SV_TRACE_THREAD_NAME(name) ::sv::Tracer::SetThreadName(name)
+
+#else
+
+#define SV_TRACE_SCOPE(category, name)
+#define SV_TRACE_SCOPE_DETAIL(category, name, detail)
+#define SV_TRACE_BEGIN(var, category, name)
+#define SV_TRACE_END(var)
+#define SV_TRACE_THREAD_NAME(name)
+
+#endif  // SV_ENABLE_TRACING
+
+#endif  // SCENEVIEW_TRACING_HPP__
@@ -0,0 +1,93 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "sceneview/tracing.hpp"
+
+using sv::TraceScope;
+using sv::Tracer;
+
+static int CountOccurrences(const std::string& str, const std::string& sub) {
+  int count = 0;
+  for (size_t pos = str.find(sub); pos != std::string::npos;
+      pos = str.find(sub, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+static std::string TraceJson() {
+  std::ostringstream stream;
+  Tracer::WriteJson(stream);
+  return stream.str();
+}
+
+TEST(Tracer, NotRecording) {
+  Tracer::Start();
+  Tracer::Stop();
+  {
+    TraceScope scope("test", "ignored");
+    EXPECT_FALSE(scope.Active());
+  }
+  EXPECT_EQ(0, CountOccurrences(TraceJson(), "\"ignored\""));
+}
+
+TEST(Tracer, Scopes) {
+  Tracer::Start();
+  {
+    TraceScope outer("test", "outer");
+    EXPECT_TRUE(outer.Active());
+    outer.SetDetail("with \"quotes\"");
+    TraceScope inner("test", "inner");
+    inner.End();
+    EXPECT_FALSE(inner.Active());
+  }
+  Tracer::Stop();
+
+  const std::string json = TraceJson();
+  EXPECT_EQ(1, CountOccurrences(json, "\"name\":\"outer\""));
+  EXPECT_EQ(1, CountOccurrences(json, "\"name\":\"inner\""));
+  EXPECT_EQ(1, CountOccurrences(json, "with \\\"quotes\\\""));
+  EXPECT_EQ(0, json.find("{\"displayTimeUnit\""));
+}
+
+TEST(Tracer, Threads) {
+  Tracer::Start();
+  std::thread thread([] {
+      Tracer::SetThreadName("background");
+      TraceScope scope("test", "load");
+    });
+  thread.join();
+  {
+    TraceScope scope("test", "draw");
+  }
+  Tracer::Stop();
+
+  // Events of the thread are kept after it exits.
+  const std::string json = TraceJson();
+  EXPECT_EQ(1, CountOccurrences(json, "\"name\":\"load\""));
+  EXPECT_EQ(1, CountOccurrences(json, "\"name\":\"draw\""));
+  EXPECT_EQ(1, CountOccurrences(json, "\"args\":{\"name\":\"background\"}"));
+}
+
+TEST(Tracer, RingBuffer) {
+  Tracer::Start(4);
+  const char* names[] = { "e0", "e1", "e2", "e3", "e4", "e5" };
+  for (const char* name : names) {
+    TraceScope scope("test", name);
+  }
+  Tracer::Stop();
+
+  // Only the most recent events are kept, oldest first.
+  const std::string json = TraceJson();
+  EXPECT_EQ(4, CountOccurrences(json, "\"ph\":\"X\""));
+  EXPECT_EQ(std::string::npos, json.find("\"e1\""));
+  EXPECT_LT(json.find("\"e2\""), json.find("\"e5\""));
+
+  Tracer::Clear();
+  EXPECT_EQ(0, CountOccurrences(TraceJson(), "\"ph\":\"X\""));
+}
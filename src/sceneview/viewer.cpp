@@ -12,6 +12,7 @@
 #include "sceneview/camera_node.hpp"
 #include "sceneview/input_handler_widget_stack.hpp"
 #include "sceneview/light_node.hpp"
+#include "sceneview/perf_hud_renderer.hpp"
 #include "sceneview/renderer.hpp"
 #include "sceneview/renderer_widget_stack.hpp"
 #include "sceneview/view_handler_horizontal.hpp"
@@ -88,6 +89,13 @@ Viewer::Viewer(QWidget* parent) :
 
   CreateMenus();
 
+  // Add a performance overlay, disabled until it's turned on from the
+  // Renderers menu.
+  PerfHudRenderer* perf_hud =
+    new PerfHudRenderer("Performance HUD", p_->viewport);
+  p_->viewport->AddRenderer(perf_hud);
+  perf_hud->SetEnabled(false);
+
   resize(800, 600);
 }
 
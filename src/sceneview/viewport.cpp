@@ -16,6 +16,7 @@
 #include "sceneview/input_handler.hpp"
 #include "sceneview/light_node.hpp"
 #include "sceneview/renderer.hpp"
+#include "sceneview/tracing.hpp"
 
 namespace sv {
 
@@ -85,6 +86,8 @@ void Viewport::AddRenderer(Renderer* renderer) {
 
   if (p_->gl_context) {
     makeCurrent();
+    SV_TRACE_SCOPE_DETAIL("render", "Renderer::InitializeGL",
+        renderer->Name());
     renderer->InitializeGL();
   }
 
@@ -159,10 +162,20 @@ void Viewport::SetDrawGroups(const std::vector<DrawGroup*>& groups) {
 
 InputHandler* Viewport::GetActiveInputHandler() { return p_->input_handler; }
 
+const FrameStats& Viewport::GetFrameStats() const {
+  return p_->draw->Stats();
+}
+
+const FrameStatsHistory& Viewport::GetFrameStatsHistory() const {
+  return p_->draw->StatsHistory();
+}
+
 void Viewport::initializeGL() {
   p_->gl_context = QOpenGLContext::currentContext();
 
   for (Renderer* renderer : p_->renderers) {
+    SV_TRACE_SCOPE_DETAIL("render", "Renderer::InitializeGL",
+        renderer->Name());
     renderer->InitializeGL();
   }
 
@@ -180,8 +193,10 @@ void Viewport::resizeGL(int width, int height) {
 }
 
 void Viewport::paintGL() {
+  SV_TRACE_SCOPE("render", "Viewport::paintGL");
   p_->redraw_scheduled = false;
   p_->draw->Draw(width(), height(), &p_->renderers);
+  emit FrameStatsUpdated(p_->draw->Stats());
 }
 
 void Viewport::mousePressEvent(QMouseEvent* event) {
@@ -7,6 +7,7 @@
 
 #include <QOpenGLWidget>
 
+#include <sceneview/frame_stats.hpp>
 #include <sceneview/resource_manager.hpp>
 #include <sceneview/scene.hpp>
 
@@ -67,6 +68,16 @@ class Viewport : public QOpenGLWidget {
 
   InputHandler* GetActiveInputHandler();
 
+  /**
+   * Statistics of the most recently drawn frame.
+   */
+  const FrameStats& GetFrameStats() const;
+
+  /**
+   * Statistics of the recently drawn frames.
+   */
+  const FrameStatsHistory& GetFrameStatsHistory() const;
+
  public slots:
   void ScheduleRedraw();
 
@@ -83,6 +94,12 @@ class Viewport : public QOpenGLWidget {
 
   void GLShuttingDown();
 
+  /**
+   * Emitted after each frame is drawn. GPU times are usually not yet
+   * available, and are filled into GetFrameStatsHistory() a few frames later.
+   */
+  void FrameStatsUpdated(const FrameStats& stats);
+
  protected:
   void initializeGL() override;
 
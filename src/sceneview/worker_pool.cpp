@@ -0,0 +1,110 @@
+// Copyright [2015] Albert Huang
+
+#include "sceneview/worker_pool.hpp"
+
+#include <algorithm>
+
+#include "sceneview/tracing.hpp"
+
+namespace sv {
+
+WorkerPool::WorkerPool(int num_threads) :
+  next_task_(0) {
+  if (num_threads <= 0) {
+    num_threads = DefaultNumThreads();
+  }
+  for (int ind = 1; ind < num_threads; ++ind) {
+    workers_.emplace_back(&WorkerPool::WorkerLoop, this);
+  }
+}
+
+int WorkerPool::DefaultNumThreads() {
+  // hardware_concurrency() is zero when it is not known.
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  job_started_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkerPool::Run(int num_tasks, const std::function<void(int)>& task) {
+  if (num_tasks <= 0) {
+    return;
+  }
+  if (workers_.empty() || num_tasks == 1) {
+    for (int ind = 0; ind < num_tasks; ++ind) {
+      task(ind);
+    }
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Workers that woke up too late for the previous job may still be
+    // checking it for tasks.
+    job_finished_.wait(lock, [this] { return num_active_ == 0; });
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    job_id_++;
+  }
+  job_started_.notify_all();
+
+  RunTasks(task, num_tasks);
+
+  // Every task has been claimed, so the job is done once no worker is still
+  // running one.
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_finished_.wait(lock, [this] { return num_active_ == 0; });
+  task_ = nullptr;
+}
+
+void WorkerPool::WorkerLoop() {
+  SV_TRACE_THREAD_NAME("WorkerPool");
+  uint64_t last_job_id = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    job_started_.wait(lock, [this, last_job_id] {
+      return shutdown_ || job_id_ != last_job_id;
+    });
+    if (shutdown_) {
+      return;
+    }
+    last_job_id = job_id_;
+    if (!task_) {
+      continue;
+    }
+
+    const std::function<void(int)>& task = *task_;
+    const int num_tasks = num_tasks_;
+    num_active_++;
+    lock.unlock();
+    RunTasks(task, num_tasks);
+    lock.lock();
+    num_active_--;
+    if (num_active_ == 0) {
+      job_finished_.notify_all();
+    }
+  }
+}
+
+void WorkerPool::RunTasks(const std::function<void(int)>& task,
+    int num_tasks) {
+  SV_TRACE_SCOPE("worker", "WorkerPool::RunTasks");
+  while (true) {
+    const int ind = next_task_++;
+    if (ind >= num_tasks) {
+      return;
+    }
+    task(ind);
+  }
+}
+
+}  // namespace sv
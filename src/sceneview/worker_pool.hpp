@@ -0,0 +1,88 @@
+// Copyright [2015] Albert Huang
+
+#ifndef SCENEVIEW_WORKER_POOL_HPP__
+#define SCENEVIEW_WORKER_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sv {
+
+/**
+ * Fixed set of worker threads that run numbered tasks in parallel.
+ *
+ * The calling thread runs tasks too, and Run() returns once every task has
+ * finished. Tasks must not call Run() on the same pool.
+ *
+ * Internal class, not part of the public API.
+ */
+class WorkerPool {
+ public:
+  /**
+   * @param num_threads total number of threads that run tasks, including
+   * the thread that calls Run(). If zero, then one thread per hardware
+   * thread is used.
+   */
+  explicit WorkerPool(int num_threads = 0);
+
+  /**
+   * Number of threads that a pool created with no thread count has: one per
+   * hardware thread.
+   */
+  static int DefaultNumThreads();
+
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+   * Number of threads that run tasks, including the calling thread.
+   */
+  int NumThreads() const { return workers_.size() + 1; }
+
+  /**
+   * Calls @p task once for each value in [0, num_tasks), in parallel, and
+   * waits for all of the calls to return.
+   */
+  void Run(int num_tasks, const std::function<void(int)>& task);
+
+ private:
+  void WorkerLoop();
+
+  // Runs tasks of the current job until none are left.
+  void RunTasks(const std::function<void(int)>& task, int num_tasks);
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+
+  // Signaled when a job starts or the pool shuts down.
+  std::condition_variable job_started_;
+
+  // Signaled when the last worker running tasks of a job is done.
+  std::condition_variable job_finished_;
+
+  // Incremented for each job, so that workers can tell new jobs apart.
+  uint64_t job_id_ = 0;
+
+  bool shutdown_ = false;
+
+  // The current job, or nullptr between jobs.
+  const std::function<void(int)>* task_ = nullptr;
+  int num_tasks_ = 0;
+  std::atomic<int> next_task_;
+
+  // Number of workers running tasks of the current job.
+  int num_active_ = 0;
+};
+
+}  // namespace sv
+
+#endif  // SCENEVIEW_WORKER_POOL_HPP__
@@ -0,0 +1,47 @@
+// Copyright [2015] Albert Huang
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "sceneview/worker_pool.hpp"
+
+using sv::WorkerPool;
+
+TEST(WorkerPool, RunsEveryTaskOnce) {
+  WorkerPool pool(4);
+  EXPECT_EQ(4, pool.NumThreads());
+
+  std::vector<std::atomic<int>> counts(1000);
+  for (auto& count : counts) {
+    count = 0;
+  }
+  pool.Run(counts.size(), [&counts](int task) { counts[task]++; });
+  for (const auto& count : counts) {
+    EXPECT_EQ(1, count);
+  }
+}
+
+TEST(WorkerPool, ManyJobs) {
+  WorkerPool pool(3);
+  std::atomic<int> sum(0);
+  for (int job = 0; job < 2000; ++job) {
+    pool.Run(job % 7, [&sum](int task) { sum += task + 1; });
+  }
+
+  int expected = 0;
+  for (int job = 0; job < 2000; ++job) {
+    const int num_tasks = job % 7;
+    expected += num_tasks * (num_tasks + 1) / 2;
+  }
+  EXPECT_EQ(expected, sum);
+}
+
+TEST(WorkerPool, SingleThread) {
+  WorkerPool pool(1);
+  EXPECT_EQ(1, pool.NumThreads());
+  std::vector<int> order;
+  pool.Run(5, [&order](int task) { order.push_back(task); });
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}), order);
+}